@@ -0,0 +1,79 @@
+#ifndef CULLING_COMMON_INCLUDE
+#define CULLING_COMMON_INCLUDE
+
+#define REDEFINE_PUSH_CONSTANT // We want our special push constant definition
+#include "../common.shader"
+
+// have to match Shape.h and GPUInstanceCulling.h
+#define MAX_INSTANCE_VIEWS 5
+#define MAX_GPU_CULLING_LODS 8
+
+// see GPUCullingParams
+layout(buffer_reference, std430) readonly buffer CullingParams {
+    vec4 planes[MAX_INSTANCE_VIEWS * 6]; // 6 planes per view (camera first, then the cascades)
+    vec4 offset;                         // w: bounding radius
+    vec4 camera_position;                // w: near plane
+    vec4 camera_direction;               // w: far plane
+    float lod_ratios[MAX_GPU_CULLING_LODS];
+    uint view_count;
+    uint lod_count;
+    uint instance_count;
+    uint draw_count;                     // of all lods
+    mat4 occlusion_view_proj;            // camera the hi-z pyramid was rendered with
+    uvec2 hiz_size;
+    uint hiz_levels;
+    uint occlusion;                      // tests view 0 against the hi-z pyramid if not 0
+};
+
+// see GPUCullingDraw
+struct CullingDraw {
+    uint index_count;
+    uint first_index;
+    uint lod;
+};
+
+layout(buffer_reference, std430) readonly buffer CullingDraws {
+    CullingDraw draws[];
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(buffer_reference, std430) writeonly buffer DrawCommands {
+    DrawCommand commands[];
+};
+
+// one per lod and view, followed by the number of occlusion culled instances
+#define OCCLUDED_COUNTER (MAX_GPU_CULLING_LODS * MAX_INSTANCE_VIEWS)
+
+layout(buffer_reference, std430) buffer InstanceCounters {
+    uint counts[];
+};
+
+layout(buffer_reference, std430) writeonly buffer CulledInstances {
+    Instance instances[];
+};
+
+layout( push_constant ) uniform constants
+{
+    CullingParams params;
+    InstanceBuffer instance_buffer;
+    InstanceCounters counters;
+    CulledInstances culled_instances;
+    CullingDraws draws;
+    DrawCommands commands;
+    uint first_view;                     // views handled by this dispatch
+    uint view_count;
+} pc;
+
+uint counter_index(uint lod, uint view) {
+    return lod * MAX_INSTANCE_VIEWS + view;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef HIZ_DEPTH_INCLUDE
+#define HIZ_DEPTH_INCLUDE
+
+// writes the farthest depth of each pixel (over all of its samples) into the first level of the hi-z pyramid (see HiZPyramid)
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+#ifdef MULTISAMPLED
+layout(binding = 0) uniform sampler2DMS depth;
+#else
+layout(binding = 0) uniform sampler2D depth;
+#endif
+
+layout(r32f, binding = 1) uniform writeonly image2D dst_level;
+
+// see HiZPushConstants
+layout( push_constant ) uniform constants
+{
+    uvec2 src_size;
+    uvec2 dst_size;
+} pc;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(gl_GlobalInvocationID.xy, pc.dst_size))) {
+        return;
+    }
+
+#ifdef MULTISAMPLED
+    float max_depth = 0.0;
+    for (int i = 0; i < textureSamples(depth); i++) {
+        max_depth = max(max_depth, texelFetch(depth, texel, i).r);
+    }
+#else
+    float max_depth = texelFetch(depth, texel, 0).r;
+#endif
+
+    imageStore(dst_level, texel, vec4(max_depth));
+}
+
+#endif
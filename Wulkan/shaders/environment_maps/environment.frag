@@ -9,5 +9,6 @@ layout(location = 0) out vec4 outColor;
 
 void main() {
     // cube maps in vulkan are y down but engine is z up
-    outColor = texture(cube_map, inUVW.xzy);
+    // higher levels are prefiltered for rough reflections
+    outColor = textureLod(cube_map, inUVW.xzy, 0);
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#version 450
+#extension GL_EXT_demote_to_helper_invocation : require // to use discard
+// shades the baked albedo and normals of the frame like pbr.frag, the depth is moved from the quad back onto the baked surface
+
+#include "../common.shader"
+#include "../pbr/shadow.shader"
+#include "../pbr/pbr_common.shader"
+#include "impostor_common.shader"
+
+layout (location = 0) in vec3 inWorldPos;
+layout (location = 1) in vec2 inUV;
+layout (location = 2) flat in vec3 inFrameDir;
+layout (location = 3) flat in float inRadius;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+    // material 0 samples the albedo atlas, the normal and depth atlas is the second diffuse texture
+    load_material(0);
+
+    vec4 albedo = sample_diffuse(inUV);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+
+    vec4 normal_depth = texture(diffuse_textures[1], inUV);
+    vec3 n = normalize(normal_depth.xyz * 2.0 - 1.0);
+
+    // depth 0 is the front of the sphere the frame was baked with (see impostor_bake.vert)
+    vec3 world_pos = inWorldPos + inFrameDir * inRadius * (1.0 - 2.0 * normal_depth.w);
+    vec4 clip_pos = ubo.proj * ubo.view * vec4(world_pos, 1.0f);
+    gl_FragDepth = clip_pos.z / clip_pos.w;
+
+    // stored in the upper 16 bits of pbr_uniforms.configuration
+    uint visualization_mode = pbr_uniforms.configuration >> 16;
+
+    switch (visualization_mode) {
+        case 0: // shading
+            {
+                vec3 w_i = spherical_to_dir(directional_light_ubo.light_direction);
+
+                vec3 camera_pos = vec3(ubo.inv_view[3][0], ubo.inv_view[3][1], ubo.inv_view[3][2]);
+                vec3 w_o = normalize(camera_pos - world_pos);
+
+                float in_shadow = shadow(world_pos);
+
+                // the normals face the frame's direction, which is close to the camera's
+                outColor = vec4(pbr(w_i, w_o, n, directional_light_ubo.light_color, inUV, in_shadow).rgb, 1);
+            }
+            break;
+        case 1: // normal
+            outColor = vec4(abs(n), 1);
+            break;
+        case 2: // diffuse color
+            outColor = vec4(albedo.rgb, 1);
+            break;
+        default: // cascade idx and lod level are shown in a single color
+            outColor = vec4(1,0,1,1);
+            break;
+    }
+}
@@ -0,0 +1,39 @@
+#version 450
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : enable
+// places the quad of each instance in front of the frame baked closest to the direction of the camera
+// the quad's vertices store their corner in position.xy and the sphere the frames were fitted to in color (see Impostor)
+
+layout (location = 0) out vec3 outWorldPos;
+layout (location = 1) out vec2 outUV;
+layout (location = 2) flat out vec3 outFrameDir;
+layout (location = 3) flat out float outRadius;
+
+#include "../common.shader"
+#include "impostor_common.shader"
+
+void main()
+{
+    Vertex v = pc.vertex_buffer.vertices[gl_VertexIndex];
+
+    vec3 local_center = v.color.xyz;
+    if (uint64_t(pc.instance_buffer) != 0) {
+        Instance i = pc.instance_buffer.instances[gl_InstanceIndex];
+        local_center += i.position;
+    }
+    vec3 center = vec3(pc.model * vec4(local_center, 1.0f));
+
+    vec3 camera_pos = vec3(ubo.inv_view[3][0], ubo.inv_view[3][1], ubo.inv_view[3][2]);
+    ivec2 frame = nearest_frame(normalize(camera_pos - center));
+    vec3 dir = frame_direction(frame);
+    vec3 right, up;
+    frame_basis(dir, right, up);
+
+    // instances are only translated, so the frames are in world orientation
+    vec3 world_pos = center + v.color.w * (v.position.x * right + v.position.y * up);
+    gl_Position = ubo.proj * ubo.view * vec4(world_pos, 1.0f);
+
+    outWorldPos = world_pos;
+    outUV = atlas_uv(frame, v.position.xy);
+    outFrameDir = dir;
+    outRadius = v.color.w;
+}
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_EXT_demote_to_helper_invocation : require // to use discard
+// writes the albedo or (bake_normals) the normal and depth of the mesh into the atlas
+
+#include "impostor_bake_common.shader"
+
+// set for the second pass into the normal and depth atlas
+layout(constant_id = 0) const bool bake_normals = false;
+
+layout(set = 0, binding = 0) uniform sampler2D diffuse_texture;
+
+layout (location = 0) in vec2 inUV;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) flat in vec3 inViewDir;
+
+layout (location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 albedo = pc.diffuse.w != 0.0 ? texture(diffuse_texture, inUV) : vec4(pc.diffuse.rgb, 1);
+
+    // same alpha test as pbr.frag, the coverage is stored as alpha of the albedo
+    if (albedo.a < 0.2) {
+        discard;
+    }
+
+    if (bake_normals) {
+        // leaves are double sided, so the normal faces the viewer
+        vec3 n = normalize(inNormal);
+        n = dot(n, inViewDir) < 0 ? -n : n;
+        outColor = vec4(n * 0.5 + 0.5, gl_FragCoord.z);
+    }
+    else {
+        outColor = vec4(albedo.rgb, 1);
+    }
+}
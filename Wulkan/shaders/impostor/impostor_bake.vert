@@ -0,0 +1,26 @@
+#version 450
+// renders the mesh orthographically from the direction of one frame into its tile of the atlas (see Impostor::bake)
+
+layout (location = 0) out vec2 outUV;
+layout (location = 1) out vec3 outNormal;
+layout (location = 2) flat out vec3 outViewDir;
+
+#include "impostor_bake_common.shader"
+
+void main()
+{
+    Vertex v = pc.vertex_buffer.vertices[gl_VertexIndex];
+
+    ivec2 frame = ivec2(pc.frame % IMPOSTOR_FRAMES, pc.frame / IMPOSTOR_FRAMES);
+    vec3 dir = frame_direction(frame);
+    vec3 right, up;
+    frame_basis(dir, right, up);
+
+    // the sphere fills the tile, depth 0 is its point closest to the viewer
+    vec3 local_pos = (v.position - pc.bounds.xyz) / pc.bounds.w;
+    gl_Position = vec4(dot(local_pos, right), dot(local_pos, up), 0.5 - 0.5 * dot(local_pos, dir), 1.0);
+
+    outUV = vec2(v.uv_x, v.uv_y);
+    outNormal = v.normal;
+    outViewDir = dir;
+}
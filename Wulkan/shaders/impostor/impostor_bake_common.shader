@@ -0,0 +1,17 @@
+#ifndef IMPOSTOR_BAKE_COMMON_INCLUDE
+#define IMPOSTOR_BAKE_COMMON_INCLUDE
+
+#define REDEFINE_PUSH_CONSTANT // We want our special push constant definition
+#include "../common.shader"
+#include "impostor_common.shader"
+
+// see ImpostorBakePushConstants
+layout( push_constant ) uniform constants
+{
+    vec4 bounds;        // xyz: center, w: radius of the sphere the frames are fitted to
+    vec4 diffuse;       // w: 1 if the diffuse texture is used
+    VertexBuffer vertex_buffer;
+    uint frame;         // index of the frame in the atlas, row major
+} pc;
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef IMPOSTOR_COMMON_INCLUDE
+#define IMPOSTOR_COMMON_INCLUDE
+
+// frames per side of the atlas, has to match IMPOSTOR_FRAMES in Impostor.h
+#define IMPOSTOR_FRAMES 8
+
+// the frames are baked from directions of the upper hemisphere, mapped onto the atlas with a hemi octahedral mapping
+// uv in [0,1]^2, the center is straight up and the corners / edges lie on the horizon
+vec2 hemi_octahedral_encode(vec3 dir) {
+    dir.z = max(dir.z, 0.0);
+    vec2 p = dir.xy / (abs(dir.x) + abs(dir.y) + dir.z);
+    return vec2(p.x + p.y, p.x - p.y) * 0.5 + 0.5;
+}
+
+vec3 hemi_octahedral_decode(vec2 uv) {
+    vec2 e = uv * 2.0 - 1.0;
+    vec2 p = vec2(e.x + e.y, e.x - e.y) * 0.5;
+    return normalize(vec3(p, 1.0 - abs(p.x) - abs(p.y)));
+}
+
+// frame baked closest to dir (pointing from the shape to the viewer)
+ivec2 nearest_frame(vec3 dir) {
+    return ivec2(round(hemi_octahedral_encode(dir) * (IMPOSTOR_FRAMES - 1)));
+}
+
+// direction a frame was baked from
+vec3 frame_direction(ivec2 frame) {
+    return hemi_octahedral_decode(vec2(frame) / (IMPOSTOR_FRAMES - 1));
+}
+
+// orientation of a frame, z up except for the frame looking straight down
+void frame_basis(vec3 dir, out vec3 right, out vec3 up) {
+    vec3 world_up = abs(dir.z) > 0.999 ? vec3(0, 1, 0) : vec3(0, 0, 1);
+    right = normalize(cross(world_up, dir));
+    up = cross(dir, right);
+}
+
+// corner in [-1,1]^2 of the quad drawn for frame
+vec2 atlas_uv(ivec2 frame, vec2 corner) {
+    return (vec2(frame) + corner * 0.5 + 0.5) / IMPOSTOR_FRAMES;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#version 450
+#extension GL_EXT_demote_to_helper_invocation : require // to use discard
+// alpha tested quad, keeps the rasterized depth such that the depth bias of the cascades applies
+
+#include "../common.shader"
+#include "../pbr/pbr_common.shader"
+
+layout (location = 0) in vec2 inUV;
+
+void main()
+{
+    // the albedo atlas is the first diffuse texture of the impostor
+    load_material(0);
+    if (sample_diffuse(inUV).a < 0.5) {
+        discard;
+    }
+}
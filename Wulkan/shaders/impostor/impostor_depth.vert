@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_shader_explicit_arithmetic_types_int64 : enable
+// same as impostor.vert, but facing the light of the cascade
+
+layout (location = 0) out vec2 outUV;
+
+#include "../common.shader"
+#define SHADOW_UNIFORM_ONLY // Don't want the actual shadow functions
+#include "../pbr/shadow.shader"
+#include "impostor_common.shader"
+
+void main()
+{
+    Vertex v = pc.vertex_buffer.vertices[gl_VertexIndex];
+
+    vec3 local_center = v.color.xyz;
+    if (uint64_t(pc.instance_buffer) != 0) {
+        Instance i = pc.instance_buffer.instances[gl_InstanceIndex];
+        local_center += i.position;
+    }
+    vec3 center = vec3(pc.model * vec4(local_center, 1.0f));
+
+    ivec2 frame = nearest_frame(spherical_to_dir(directional_light_ubo.light_direction));
+    vec3 right, up;
+    frame_basis(frame_direction(frame), right, up);
+
+    vec3 world_pos = center + v.color.w * (v.position.x * right + v.position.y * up);
+    gl_Position = directional_light_ubo.proj_views[pc.cascade_idx] * vec4(world_pos, 1.0f);
+
+    outUV = atlas_uv(frame, v.position.xy);
+}
@@ -9,11 +9,14 @@
 layout (location = 0) in vec3 inWorldPos;
 layout (location = 1) in vec3 inWorldNormal;
 layout (location = 2) in vec2 inUV;
+layout (location = 3) flat in uint inMaterial;
 
 layout (location = 0) out vec4 outColor;
 
 void main() 
 {
+	load_material(inMaterial);
+
 	// stored in the upper 16 bits of pbr_uniforms.configuration
 	uint visualization_mode = pbr_uniforms.configuration >> 16;
 
@@ -31,7 +34,8 @@ void main()
 				vec4 pbr_res = pbr(w_i, w_o, n, directional_light_ubo.light_color, inUV, in_shadow);
 
 				// pbr frag does not support semitransparent geometry. Only fully transparant
-				if (pbr_res.a < 0.2) {
+				// after a depth prepass only the alpha tested fragments pass the equal depth test, without discard early depth tests stay enabled
+				if (!depth_prepass && pbr_res.a < 0.2) {
 					discard;
 				}
 				outColor = pbr_res;
@@ -42,7 +46,7 @@ void main()
             break;
 		case 2: // diffuse color
 			uint use_diffuse_texture = pbr_uniforms.configuration & 1<<0;
-			vec3 diffuse_col = texture(diffuse_tex, inUV).rgb;
+			vec3 diffuse_col = sample_diffuse(inUV).rgb;
 	
 			outColor = vec4((1 - use_diffuse_texture) *  pbr_uniforms.diffuse + use_diffuse_texture * diffuse_col, 1);
             break;
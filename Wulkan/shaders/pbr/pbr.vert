@@ -1,14 +1,18 @@
 #version 450
 #extension GL_EXT_shader_explicit_arithmetic_types_int64 : enable
+#extension GL_ARB_shader_draw_parameters : require
 // Simple vertex shader
 
 layout (location = 0) out vec3 outWorldPos;
 layout (location = 1) out vec3 outNormal;
 layout (location = 2) out vec2 outUV;
+layout (location = 3) flat out uint outMaterial;
 
 #include "../common.shader"
 #include "pbr_common.shader"
 
+invariant gl_Position;
+
 void main() 
 {	
 	Vertex v = pc.vertex_buffer.vertices[gl_VertexIndex];
@@ -25,4 +29,5 @@ void main()
 	outWorldPos = vec3(pc.model * vec4(local_pos, 1.0f));
 	outNormal = mat3(transpose(pc.inv_model)) * v.normal;
 	outUV = vec2(v.uv_x, v.uv_y);
+	outMaterial = draw_materials[gl_DrawIDARB];
 }
@@ -1,7 +1,15 @@
 #ifndef PBR_COMMON_INCLUDE
 #define PBR_COMMON_INCLUDE
 
-layout(std430, set = 2, binding = 0) uniform PBRData {
+#extension GL_EXT_nonuniform_qualifier : require
+
+// has to match MAX_PBR_MATERIALS in PBRMaterial.h
+#define MAX_PBR_MATERIALS 64
+
+// set for the camera's depth prepass (pbr_depth) and the shading after it (pbr), see PBRMesh::create_render_pass
+layout(constant_id = 1) const bool depth_prepass = false;
+
+struct PBRData {
 	vec3 diffuse;
 	float metallic;
 
@@ -13,9 +21,37 @@ layout(std430, set = 2, binding = 0) uniform PBRData {
 
 	// TODO: add ambient
 	uint configuration;
-} pbr_uniforms;
+};
+
+// all materials of the mesh
+layout(std430, set = 2, binding = 0) readonly buffer PBRMaterials {
+	PBRData materials[];
+};
+
+// elements without a material hold the fallback texture
+layout(set = 2, binding = 1) uniform sampler2D diffuse_textures[MAX_PBR_MATERIALS];
+
+// material of each indirect draw, indexed by gl_DrawIDARB
+layout(std430, set = 2, binding = 2) readonly buffer PBRDraws {
+	uint draw_materials[];
+};
+
+// material of the current fragment, set by load_material
+uint material_idx;
+PBRData pbr_uniforms;
 
-layout(set = 2, binding = 1) uniform sampler2D diffuse_tex;
+void load_material(uint idx) {
+	material_idx = idx;
+	pbr_uniforms = materials[idx];
+}
+
+// the material can differ between invocations, as fragments of several draws can end up in the same subgroup
+vec4 sample_diffuse(vec2 uv) {
+	return texture(diffuse_textures[nonuniformEXT(material_idx)], uv);
+}
+
+// environment radiance, mip level i is prefiltered for roughness i / (levels - 1) (see prefilter_cube_map)
+layout(set = 0, binding = 1) uniform samplerCube environment_map;
 
 	// TODO: Could share cos^2 instead of just cos_theta
 vec3 diffuse(vec3 albedo, float cos_theta_i, float cos_theta_o, float cos_theta_d) {
@@ -42,8 +78,8 @@ vec3 calculate_tint(vec3 base_color) {
     return (luminance > 0.0f) ? base_color * (1.0f / luminance) : vec3(1);
 }
 
-// fresnel approx
-vec3 eval_F(vec3 albedo, float cos_theta_d) {
+// reflectance at normal incidence
+vec3 eval_R0(vec3 albedo) {
 	float eta = pbr_uniforms.eta;
 
 	float temp0 = (eta - 1) / (eta + 1);
@@ -54,7 +90,12 @@ vec3 eval_F(vec3 albedo, float cos_theta_d) {
 	// this assumes specTint = 1 otherwise would need to 
 	// t1 = F0 * mix(vec3(1), spec, specTint)
 	// R0 = mix(t1, albedo, metallic)
-	vec3 R0 = mix(F0 * calculate_tint(pbr_uniforms.specular), albedo, pbr_uniforms.metallic);
+	return mix(F0 * calculate_tint(pbr_uniforms.specular), albedo, pbr_uniforms.metallic);
+}
+
+// fresnel approx
+vec3 eval_F(vec3 albedo, float cos_theta_d) {
+	vec3 R0 = eval_R0(albedo);
 
 	float F_weight = pow(1 - cos_theta_d, 5);
 
@@ -87,6 +128,24 @@ vec3 specular(vec3 albedo, float cos_theta_i, float cos_theta_o, float cos_theta
 	return (D * F * G) / (4 * cos_theta_i * cos_theta_o);
 }
 
+// specular reflection of the environment, single lookup into the prefiltered environment map (split sum approximation)
+// the environment brdf is fitted analytically instead of read from a lookup table, see Karis - Physically Based Shading on Mobile
+vec3 specular_ibl(vec3 albedo, vec3 n, vec3 w_o, float cos_theta_o) {
+	vec3 r = reflect(-w_o, n);
+	float lod = pbr_uniforms.roughness * (textureQueryLevels(environment_map) - 1);
+
+	// cube maps in vulkan are y down but engine is z up
+	vec3 radiance = textureLod(environment_map, r.xzy, lod).rgb;
+
+	const vec4 c0 = vec4(-1, -0.0275, -0.572, 0.022);
+	const vec4 c1 = vec4(1, 0.0425, 1.04, -0.04);
+	vec4 t = pbr_uniforms.roughness * c0 + c1;
+	float a004 = min(t.x * t.x, exp2(-9.28 * cos_theta_o)) * t.x + t.y;
+	vec2 env_brdf = vec2(-1.04, 1.04) * a004 + t.zw;
+
+	return radiance * (eval_R0(albedo) * env_brdf.x + env_brdf.y);
+}
+
 vec4 pbr(vec3 w_i, vec3 w_o, vec3 n, vec3 light_color, vec2 uv, float in_shadow) {
 	vec3 w_h = normalize(w_i + w_o);
 	
@@ -95,28 +154,34 @@ vec4 pbr(vec3 w_i, vec3 w_o, vec3 n, vec3 light_color, vec2 uv, float in_shadow)
 	float cos_theta_o = dot(w_o, n);
 
 	uint use_diffuse_texture = pbr_uniforms.configuration & 1<<0;
-	vec4 diffuse_col = texture(diffuse_tex, uv).rgba;
+	vec4 diffuse_col = sample_diffuse(uv).rgba;
 
 	float alpha = (1 - use_diffuse_texture) + use_diffuse_texture * diffuse_col.a; // for transparency only the alpha of the diffuse texture counts
-	if (cos_theta_i <= 0 || cos_theta_o <= 0) {
+	vec3 albedo = (1 - use_diffuse_texture) *  pbr_uniforms.diffuse + use_diffuse_texture * diffuse_col.rgb;
+
+	if (cos_theta_o <= 0) {
 		return vec4(0,0,0,alpha);
 	}
 
+	// ambient, independent of the light direction
+	vec3 ambient = specular_ibl(albedo, n, w_o, cos_theta_o);
+	if (cos_theta_i <= 0) {
+		return vec4(ambient, alpha);
+	}
+
 	// angle between w_h and w_i (or w_o)
 	float cos_theta_d = dot(w_i, w_h);
 	float cos_theta_h = dot(w_h, n);
 
 	float diffuse_weight = 1 - pbr_uniforms.metallic;
 
-	vec3 albedo = (1 - use_diffuse_texture) *  pbr_uniforms.diffuse + use_diffuse_texture * diffuse_col.rgb;
 	vec3 color = specular(albedo,  cos_theta_i, cos_theta_o, cos_theta_d, cos_theta_h);
 	
 	if (diffuse_weight > 0) {
 		color += diffuse_weight * diffuse(albedo, cos_theta_i, cos_theta_o, cos_theta_d);
 	}
-	// + ambient * albedo
 	
-	return vec4(color * light_color * max(cos_theta_i * in_shadow, 0.05), alpha);
+	return vec4(color * light_color * max(cos_theta_i * in_shadow, 0.05) + ambient, alpha);
 }
 
 #endif
\ No newline at end of file
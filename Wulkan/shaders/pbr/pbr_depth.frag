@@ -6,10 +6,23 @@
 #include "pbr_common.shader"
 
 layout (location = 0) in vec2 inUV;
+layout (location = 1) flat in uint inMaterial;
 
 void main() 
 {
-	if (texture(diffuse_tex, inUV).a == 0) {
+	load_material(inMaterial);
+
+	vec4 diffuse_col = sample_diffuse(inUV);
+
+	if (depth_prepass) {
+		// same alpha test as the shading in pbr.frag, which does not discard after the prepass
+		uint use_diffuse_texture = pbr_uniforms.configuration & 1<<0;
+		float alpha = (1 - use_diffuse_texture) + use_diffuse_texture * diffuse_col.a;
+		if (alpha < 0.2) {
+			discard;
+		}
+	}
+	else if (diffuse_col.a == 0) {
 		discard;
 	}
 }
\ No newline at end of file
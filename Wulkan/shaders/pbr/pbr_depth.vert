@@ -1,12 +1,17 @@
 #version 450
 #extension GL_EXT_shader_explicit_arithmetic_types_int64 : enable
+#extension GL_ARB_shader_draw_parameters : require
 // Simple vertex shader
 
 layout (location = 0) out vec2 outUV;
+layout (location = 1) flat out uint outMaterial;
 
 #include "../common.shader"
 #define SHADOW_UNIFORM_ONLY // Don't want the actual shadow functions
 #include "shadow.shader"
+#include "pbr_common.shader"
+
+invariant gl_Position;
 
 void main() 
 {	
@@ -19,6 +24,13 @@ void main()
 		local_pos += i.position;
 	}
 
-	gl_Position = directional_light_ubo.proj_views[pc.cascade_idx] * pc.model * vec4(local_pos, 1.0f);
+	if (depth_prepass) {
+		// has to be computed exactly like in pbr.vert, the shading tests for equal depth
+		gl_Position = ubo.proj * ubo.view * pc.model * vec4(local_pos, 1.0f);
+	}
+	else {
+		gl_Position = directional_light_ubo.proj_views[pc.cascade_idx] * pc.model * vec4(local_pos, 1.0f);
+	}
 	outUV = vec2(v.uv_x, v.uv_y);
+	outMaterial = draw_materials[gl_DrawIDARB];
 }
\ No newline at end of file
@@ -15,7 +15,9 @@ layout(location = 4) in float model_height;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    vec3 obj_normal = normalize(texture(normal_map, inUV).rgb * 2 - 1);
+    // normal map only stores xy (see Tex_Normal), z always points up
+    vec2 normal_xy = texture(normal_map, inUV).rg * 2 - 1;
+    vec3 obj_normal = normalize(vec3(normal_xy, sqrt(max(0, 1 - dot(normal_xy, normal_xy)))));
     vec3 world_normal = normalize(mat3(transpose(pc.model)) * obj_normal); // normals are in object space not tangent space
     world_normal.y *= -1;
 
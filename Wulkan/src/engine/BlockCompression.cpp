@@ -0,0 +1,560 @@
+#include "common.h"
+#include "BlockCompression.h"
+
+#include <cstring>
+#include <cfloat>
+
+#include "glm/gtc/packing.hpp"
+
+// 4x4 pixels of a block, always rgba
+struct PixelBlock {
+	float pixels[16][4];
+};
+
+// pixels outside of the image replicate the last row / column
+static void load_block(const uint8_t* pixels, unsigned int width, unsigned int height, unsigned int channels, unsigned int block_x, unsigned int block_y, PixelBlock& block)
+{
+	for (unsigned int y = 0; y < 4; y++) {
+		unsigned int py = std::min(block_y * 4 + y, height - 1);
+
+		for (unsigned int x = 0; x < 4; x++) {
+			unsigned int px = std::min(block_x * 4 + x, width - 1);
+			const uint8_t* p = pixels + (static_cast<size_t>(py) * width + px) * channels;
+
+			for (unsigned int c = 0; c < 4; c++) {
+				block.pixels[y * 4 + x][c] = c < channels ? p[c] : (c == 3 ? 255.0f : 0.0f);
+			}
+		}
+	}
+}
+
+// fits a line through the first N channels of the block (principal axis by power iteration)
+// and returns the extreme points of the projected pixels (clamped to [0, max_value]) as endpoints
+template <int N>
+static void fit_endpoints(const PixelBlock& block, float start[N], float end[N], float max_value = 255.0f)
+{
+	float mean[N] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < N; c++) {
+			mean[c] += block.pixels[i][c] / 16.0f;
+		}
+	}
+
+	float covariance[N][N] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int a = 0; a < N; a++) {
+			for (int b = 0; b < N; b++) {
+				covariance[a][b] += (block.pixels[i][a] - mean[a]) * (block.pixels[i][b] - mean[b]);
+			}
+		}
+	}
+
+	float axis[N];
+	for (int c = 0; c < N; c++) {
+		axis[c] = 1.0f;
+	}
+
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[N] = {};
+		float length = 0.0f;
+		for (int a = 0; a < N; a++) {
+			for (int b = 0; b < N; b++) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length = std::max(length, std::abs(next[a]));
+		}
+
+		// constant block
+		if (length < 1e-6f) {
+			for (int c = 0; c < N; c++) {
+				start[c] = end[c] = mean[c];
+			}
+			return;
+		}
+
+		for (int c = 0; c < N; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	float axis_length_sq = 0.0f;
+	for (int c = 0; c < N; c++) {
+		axis_length_sq += axis[c] * axis[c];
+	}
+
+	float min_t = FLT_MAX, max_t = -FLT_MAX;
+	for (int i = 0; i < 16; i++) {
+		float t = 0.0f;
+		for (int c = 0; c < N; c++) {
+			t += (block.pixels[i][c] - mean[c]) * axis[c];
+		}
+		min_t = std::min(min_t, t / axis_length_sq);
+		max_t = std::max(max_t, t / axis_length_sq);
+	}
+
+	for (int c = 0; c < N; c++) {
+		start[c] = std::clamp(mean[c] + min_t * axis[c], 0.0f, max_value);
+		end[c] = std::clamp(mean[c] + max_t * axis[c], 0.0f, max_value);
+	}
+}
+
+// ----- BC1 -----
+
+static uint16_t pack_565(const float color[3])
+{
+	uint16_t r = static_cast<uint16_t>(std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+	uint16_t g = static_cast<uint16_t>(std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+	uint16_t b = static_cast<uint16_t>(std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+	return (r << 11) | (g << 5) | b;
+}
+
+static void unpack_565(uint16_t packed, float color[3])
+{
+	uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	color[0] = static_cast<float>((r << 3) | (r >> 2));
+	color[1] = static_cast<float>((g << 2) | (g >> 4));
+	color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// selects the nearest of the 4 palette colors for each pixel, returns squared error
+// requires color_0 > color_1 (4 color mode)
+static float select_bc1_indices(const PixelBlock& block, uint16_t color_0, uint16_t color_1, uint32_t& indices)
+{
+	float palette[4][3];
+	unpack_565(color_0, palette[0]);
+	unpack_565(color_1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+		palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+	}
+
+	indices = 0;
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		float best_error = FLT_MAX;
+		uint32_t best = 0;
+		for (uint32_t k = 0; k < 4; k++) {
+			float dr = block.pixels[i][0] - palette[k][0];
+			float dg = block.pixels[i][1] - palette[k][1];
+			float db = block.pixels[i][2] - palette[k][2];
+			float e = dr * dr + dg * dg + db * db;
+			if (e < best_error) {
+				best_error = e;
+				best = k;
+			}
+		}
+		indices |= best << (2 * i);
+		error += best_error;
+	}
+	return error;
+}
+
+static void encode_bc1(const PixelBlock& block, std::byte* out)
+{
+	float start[3], end[3];
+	fit_endpoints<3>(block, start, end);
+
+	uint16_t color_0 = pack_565(end);
+	uint16_t color_1 = pack_565(start);
+	if (color_0 < color_1) {
+		std::swap(color_0, color_1);
+	}
+
+	uint32_t indices = 0;
+	if (color_0 != color_1) {
+		float error = select_bc1_indices(block, color_0, color_1, indices);
+
+		// least squares fit of the endpoints for the selected indices
+		constexpr float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // weight of color_0 per index
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++) {
+			float a = weights[(indices >> (2 * i)) & 3];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 3; c++) {
+				ax[c] += a * block.pixels[i][c];
+				bx[c] += b * block.pixels[i][c];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) > 1e-6f) {
+			float refined_0[3], refined_1[3];
+			for (int c = 0; c < 3; c++) {
+				refined_0[c] = (ax[c] * bb - bx[c] * ab) / det;
+				refined_1[c] = (bx[c] * aa - ax[c] * ab) / det;
+			}
+
+			uint16_t refined_color_0 = pack_565(refined_0);
+			uint16_t refined_color_1 = pack_565(refined_1);
+			if (refined_color_0 < refined_color_1) {
+				std::swap(refined_color_0, refined_color_1);
+			}
+
+			uint32_t refined_indices;
+			if (refined_color_0 != refined_color_1 && select_bc1_indices(block, refined_color_0, refined_color_1, refined_indices) < error) {
+				color_0 = refined_color_0;
+				color_1 = refined_color_1;
+				indices = refined_indices;
+			}
+		}
+	}
+
+	std::memcpy(out, &color_0, 2);
+	std::memcpy(out + 2, &color_1, 2);
+	std::memcpy(out + 4, &indices, 4);
+}
+
+// ----- BC4 / BC5 -----
+
+static void encode_bc4(const PixelBlock& block, unsigned int channel, std::byte* out)
+{
+	float min_value = 255.0f, max_value = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		min_value = std::min(min_value, block.pixels[i][channel]);
+		max_value = std::max(max_value, block.pixels[i][channel]);
+	}
+
+	// 8 value mode (red_0 > red_1), palette goes from red_0 (index 0) over 6 interpolated values (2 to 7) to red_1 (index 1)
+	uint8_t red_0 = static_cast<uint8_t>(std::lround(max_value));
+	uint8_t red_1 = static_cast<uint8_t>(std::lround(min_value));
+
+	uint64_t indices = 0;
+	if (red_0 > red_1) {
+		float scale = 7.0f / (red_0 - red_1);
+		for (int i = 0; i < 16; i++) {
+			uint64_t step = static_cast<uint64_t>(std::lround((red_0 - block.pixels[i][channel]) * scale));
+			step = std::min<uint64_t>(step, 7);
+
+			uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+			indices |= index << (3 * i);
+		}
+	}
+
+	out[0] = static_cast<std::byte>(red_0);
+	out[1] = static_cast<std::byte>(red_1);
+	std::memcpy(out + 2, &indices, 6); // little endian, 48 bits
+}
+
+// ----- BC7 (mode 6) -----
+
+// writes bits starting from the least significant bit of the block
+struct BitWriter {
+	std::byte* out;
+	uint32_t position = 0;
+
+	void write(uint32_t value, uint32_t bit_count) {
+		for (uint32_t i = 0; i < bit_count; i++, position++) {
+			if ((value >> i) & 1) {
+				out[position >> 3] |= static_cast<std::byte>(1 << (position & 7));
+			}
+		}
+	}
+};
+
+// quantizes an endpoint to 7 bits per channel with a shared p bit, returns the reconstructed 8 bit value
+static void quantize_bc7_endpoint(const float endpoint[4], uint32_t quantized[4], uint32_t& p_bit, float reconstructed[4])
+{
+	float best_error = FLT_MAX;
+	for (uint32_t p = 0; p < 2; p++) {
+		uint32_t q[4];
+		float error = 0.0f;
+		for (int c = 0; c < 4; c++) {
+			q[c] = static_cast<uint32_t>(std::clamp(std::lround((endpoint[c] - p) / 2.0f), 0l, 127l));
+			float diff = static_cast<float>((q[c] << 1) | p) - endpoint[c];
+			error += diff * diff;
+		}
+
+		if (error < best_error) {
+			best_error = error;
+			p_bit = p;
+			for (int c = 0; c < 4; c++) {
+				quantized[c] = q[c];
+				reconstructed[c] = static_cast<float>((q[c] << 1) | p);
+			}
+		}
+	}
+}
+
+static void encode_bc7(const PixelBlock& block, std::byte* out)
+{
+	constexpr uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float start[4], end[4];
+	fit_endpoints<4>(block, start, end);
+
+	uint32_t quantized[2][4], p_bits[2];
+	float endpoints[2][4];
+	quantize_bc7_endpoint(start, quantized[0], p_bits[0], endpoints[0]);
+	quantize_bc7_endpoint(end, quantized[1], p_bits[1], endpoints[1]);
+
+	float palette[16][4];
+	for (int k = 0; k < 16; k++) {
+		for (int c = 0; c < 4; c++) {
+			uint32_t e0 = static_cast<uint32_t>(endpoints[0][c]), e1 = static_cast<uint32_t>(endpoints[1][c]);
+			palette[k][c] = static_cast<float>(((64 - weights[k]) * e0 + weights[k] * e1 + 32) >> 6);
+		}
+	}
+
+	uint32_t indices[16];
+	for (int i = 0; i < 16; i++) {
+		float best_error = FLT_MAX;
+		for (uint32_t k = 0; k < 16; k++) {
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++) {
+				float diff = block.pixels[i][c] - palette[k][c];
+				error += diff * diff;
+			}
+			if (error < best_error) {
+				best_error = error;
+				indices[i] = k;
+			}
+		}
+	}
+
+	// the most significant bit of the first index is implicitly 0, swap endpoints otherwise
+	if (indices[0] & 8) {
+		std::swap(quantized[0], quantized[1]);
+		std::swap(p_bits[0], p_bits[1]);
+		for (uint32_t& index : indices) {
+			index = 15 - index;
+		}
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.write(1 << 6, 7); // mode 6
+	for (int c = 0; c < 4; c++) {
+		writer.write(quantized[0][c], 7);
+		writer.write(quantized[1][c], 7);
+	}
+	writer.write(p_bits[0], 1);
+	writer.write(p_bits[1], 1);
+
+	writer.write(indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		writer.write(indices[i], 4);
+	}
+}
+
+// ----- BC6H (mode 11) -----
+
+// BC6H interpolates the bits of half floats (scaled to 16 bit, see finish_unquantize in the spec), so the block is fit in that space
+// negative values are not representable in the unsigned format and clamped to 0
+static void load_hdr_block(const float* pixels, unsigned int width, unsigned int height, unsigned int block_x, unsigned int block_y, PixelBlock& block)
+{
+	for (unsigned int y = 0; y < 4; y++) {
+		unsigned int py = std::min(block_y * 4 + y, height - 1);
+
+		for (unsigned int x = 0; x < 4; x++) {
+			unsigned int px = std::min(block_x * 4 + x, width - 1);
+			const float* p = pixels + (static_cast<size_t>(py) * width + px) * 4;
+
+			for (unsigned int c = 0; c < 3; c++) {
+				uint16_t half = glm::packHalf1x16(std::clamp(p[c], 0.0f, 65504.0f));
+				block.pixels[y * 4 + x][c] = half * 64.0f / 31.0f;
+			}
+			block.pixels[y * 4 + x][3] = 0.0f;
+		}
+	}
+}
+
+static uint32_t unquantize_bc6h(uint32_t value)
+{
+	if (value == 0) {
+		return 0;
+	}
+	if (value == 1023) {
+		return 0xFFFF;
+	}
+	return ((value << 16) + 0x8000) >> 10;
+}
+
+// 10 bit endpoint with the closest unquantized value
+static uint32_t quantize_bc6h(float value)
+{
+	uint32_t low = std::min(static_cast<uint32_t>(value / 64.0f), 1022u);
+	float low_error = std::abs(unquantize_bc6h(low) - value);
+	float high_error = std::abs(unquantize_bc6h(low + 1) - value);
+	return low_error <= high_error ? low : low + 1;
+}
+
+// mode 11: single region, 10 bit endpoints without deltas and 4 bit indices
+static void encode_bc6h(const PixelBlock& block, std::byte* out)
+{
+	constexpr uint32_t weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	float start[3], end[3];
+	fit_endpoints<3>(block, start, end, 65535.0f);
+
+	uint32_t quantized[2][3];
+	for (int c = 0; c < 3; c++) {
+		quantized[0][c] = quantize_bc6h(start[c]);
+		quantized[1][c] = quantize_bc6h(end[c]);
+	}
+
+	float palette[16][3];
+	for (int k = 0; k < 16; k++) {
+		for (int c = 0; c < 3; c++) {
+			uint32_t e0 = unquantize_bc6h(quantized[0][c]), e1 = unquantize_bc6h(quantized[1][c]);
+			palette[k][c] = static_cast<float>(((64 - weights[k]) * e0 + weights[k] * e1 + 32) >> 6);
+		}
+	}
+
+	uint32_t indices[16];
+	for (int i = 0; i < 16; i++) {
+		float best_error = FLT_MAX;
+		for (uint32_t k = 0; k < 16; k++) {
+			float error = 0.0f;
+			for (int c = 0; c < 3; c++) {
+				float diff = block.pixels[i][c] - palette[k][c];
+				error += diff * diff;
+			}
+			if (error < best_error) {
+				best_error = error;
+				indices[i] = k;
+			}
+		}
+	}
+
+	// the most significant bit of the first index is implicitly 0, swap endpoints otherwise
+	if (indices[0] & 8) {
+		std::swap(quantized[0], quantized[1]);
+		for (uint32_t& index : indices) {
+			index = 15 - index;
+		}
+	}
+
+	std::memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.write(0x03, 5); // mode 11
+	for (int e = 0; e < 2; e++) {
+		for (int c = 0; c < 3; c++) {
+			writer.write(quantized[e][c], 10);
+		}
+	}
+
+	writer.write(indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		writer.write(indices[i], 4);
+	}
+}
+
+bool is_block_compressed(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+VkDeviceSize get_block_size(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		return 16;
+	default:
+		throw NotImplementedException(fmt::format("No block compression for format {:x}", static_cast<int>(format)), __FILE__, __LINE__);
+	}
+}
+
+VkDeviceSize get_compressed_size(VkFormat format, unsigned int width, unsigned int height)
+{
+	return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * get_block_size(format);
+}
+
+void compress_image(VkFormat format, const uint8_t* pixels, unsigned int width, unsigned int height, unsigned int channels, std::byte* blocks, ThreadPool* thread_pool)
+{
+	ZoneScoped;
+
+	unsigned int blocks_x = (width + 3) / 4;
+	unsigned int blocks_y = (height + 3) / 4;
+	VkDeviceSize block_size = get_block_size(format);
+
+	auto compress_row = [&](size_t block_y) {
+		PixelBlock block;
+		for (unsigned int block_x = 0; block_x < blocks_x; block_x++) {
+			load_block(pixels, width, height, channels, block_x, static_cast<unsigned int>(block_y), block);
+
+			std::byte* out = blocks + (block_y * blocks_x + block_x) * block_size;
+			switch (format)
+			{
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+				encode_bc1(block, out);
+				break;
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				encode_bc4(block, 0, out);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				encode_bc4(block, 0, out);
+				encode_bc4(block, 1, out + 8);
+				break;
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+				encode_bc7(block, out);
+				break;
+			default:
+				break;
+			}
+		}
+	};
+
+	if (thread_pool && blocks_y > 1) {
+		thread_pool->parallel_for(blocks_y, compress_row);
+	}
+	else {
+		for (unsigned int block_y = 0; block_y < blocks_y; block_y++) {
+			compress_row(block_y);
+		}
+	}
+}
+
+void compress_hdr_image(VkFormat format, const float* pixels, unsigned int width, unsigned int height, std::byte* blocks, ThreadPool* thread_pool)
+{
+	ZoneScoped;
+
+	if (format != VK_FORMAT_BC6H_UFLOAT_BLOCK) {
+		throw NotImplementedException(fmt::format("No hdr block compression for format {:x}", static_cast<int>(format)), __FILE__, __LINE__);
+	}
+
+	unsigned int blocks_x = (width + 3) / 4;
+	unsigned int blocks_y = (height + 3) / 4;
+
+	auto compress_row = [&](size_t block_y) {
+		PixelBlock block;
+		for (unsigned int block_x = 0; block_x < blocks_x; block_x++) {
+			load_hdr_block(pixels, width, height, block_x, static_cast<unsigned int>(block_y), block);
+			encode_bc6h(block, blocks + (block_y * blocks_x + block_x) * 16);
+		}
+	};
+
+	if (thread_pool && blocks_y > 1) {
+		thread_pool->parallel_for(blocks_y, compress_row);
+	}
+	else {
+		for (unsigned int block_y = 0; block_y < blocks_y; block_y++) {
+			compress_row(block_y);
+		}
+	}
+}
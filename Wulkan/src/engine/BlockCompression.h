@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <cstddef>
+
+// CPU encoders for the BCn block compressed formats used for LDR textures
+//  BC1: RGB (sRGB or linear), 8 bytes per 4x4 block
+//  BC4: single channel, 8 bytes per block
+//  BC5: two channels (i.e. normal maps with reconstructed z), 16 bytes per block
+//  BC7: RGBA (sRGB or linear), 16 bytes per block, only mode 6 (single subset with 4 bit indices) is used
+//  BC6H: unsigned half float RGB, 16 bytes per block, only mode 11 (single region with 10 bit endpoints) is used
+// Encoders are fast single pass fits (principal axis + one least squares refinement for BC1), not exhaustive searches
+
+bool is_block_compressed(VkFormat format);
+
+// bytes per 4x4 block of a block compressed format
+VkDeviceSize get_block_size(VkFormat format);
+
+// size of one image in format with width x height texels, partial blocks at the borders are padded
+VkDeviceSize get_compressed_size(VkFormat format, unsigned int width, unsigned int height);
+
+// compresses tightly packed 8 bit pixels with channels channels into blocks (row major, see get_compressed_size)
+// BC1 reads rgb, BC4 r, BC5 rg and BC7 rgba (alpha is set to opaque if channels < 4)
+// rows of blocks are compressed in parallel if a thread pool is given
+void compress_image(VkFormat format, const uint8_t* pixels, unsigned int width, unsigned int height, unsigned int channels, std::byte* blocks, ThreadPool* thread_pool = nullptr);
+
+// compresses tightly packed rgba float pixels into blocks, alpha is ignored
+// only VK_FORMAT_BC6H_UFLOAT_BLOCK is supported
+void compress_hdr_image(VkFormat format, const float* pixels, unsigned int width, unsigned int height, std::byte* blocks, ThreadPool* thread_pool = nullptr);
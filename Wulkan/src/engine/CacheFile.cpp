@@ -0,0 +1,76 @@
+#include "common.h"
+#include "CacheFile.h"
+
+#include <fstream>
+#include <thread>
+
+bool read_cache_sources(std::span<const VKW_Path> paths, CacheSources& sources)
+{
+	sources = {};
+	sources.hash = 14695981039346656037ull;
+
+	uint64_t write_time = 0;
+	for (const VKW_Path& path : paths) {
+		MappedFile file;
+		std::error_code ec;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(path, ec);
+		if (ec || !file.open(path)) {
+			return false;
+		}
+
+		sources.size += file.size();
+		write_time += static_cast<uint64_t>(time.time_since_epoch().count());
+		sources.hash = hash_bytes(file.bytes(), sources.hash);
+	}
+	sources.write_time = static_cast<int64_t>(write_time);
+
+	return true;
+}
+
+bool are_cache_sources_unchanged(std::span<const VKW_Path> paths, const CacheSources& sources)
+{
+	uint64_t size = 0;
+	uint64_t write_time = 0;
+	for (const VKW_Path& path : paths) {
+		std::error_code ec;
+		size += std::filesystem::file_size(path, ec);
+		if (ec) {
+			return false;
+		}
+		write_time += static_cast<uint64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+		if (ec) {
+			return false;
+		}
+	}
+
+	if (size != sources.size) {
+		return false;
+	}
+
+	if (static_cast<int64_t>(write_time) != sources.write_time) {
+		CacheSources current;
+		if (!read_cache_sources(paths, current) || current.hash != sources.hash) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void write_cache_file(const VKW_Path& path, std::span<const char> data)
+{
+	VKW_Path tmp_path = VKW_Path(path).concat(fmt::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id())));
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file.write(data.data(), data.size())) {
+			throw IOException(fmt::format("Failed to write cache {}", tmp_path), __FILE__, __LINE__);
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp_path, path, ec);
+	if (ec) {
+		std::filesystem::remove(tmp_path, ec);
+		throw IOException(fmt::format("Failed to write cache {}", path), __FILE__, __LINE__);
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <span>
+#include <vector>
+
+// Helpers shared by the binary caches (MeshCache, TextureCache and VKW_PipelineCache)
+
+// size, write time and hash of the files a cache was created from, combined over all of them
+struct CacheSources {
+	uint64_t size = 0;
+	int64_t write_time = 0; // sum of the write times, changes if any of them changes
+	uint64_t hash = 0;      // hash of all files chained in order
+};
+
+// offset rounded up to alignment, which has to be a power of two
+inline uint64_t align_up(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// reads all paths, returns false if one of them could not be read
+bool read_cache_sources(std::span<const VKW_Path> paths, CacheSources& sources);
+// false if any of paths changed since sources were read
+// the files are only hashed again if the write time changed, the content might still be the same (i.e. after a checkout)
+bool are_cache_sources_unchanged(std::span<const VKW_Path> paths, const CacheSources& sources);
+
+// writes data into a temporary file next to path first and renames it, such that a partially written cache is never picked up
+// the temporary file is unique per thread, so the same cache can be written by multiple workers at once. Throws IOException on failure
+void write_cache_file(const VKW_Path& path, std::span<const char> data);
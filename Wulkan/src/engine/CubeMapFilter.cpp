@@ -0,0 +1,240 @@
+#include "common.h"
+#include "CubeMapFilter.h"
+
+// GGX samples per texel of a prefiltered level
+constexpr uint32_t PREFILTER_SAMPLE_COUNT = 64;
+
+// direction through the center of texel (x, y) of face, inverse of the cube map face selection of the vulkan spec
+static glm::vec3 texel_direction(uint32_t face, unsigned int x, unsigned int y, unsigned int size)
+{
+	float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+	float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+
+	switch (face)
+	{
+	case 0:
+		return glm::normalize(glm::vec3(1, -tc, -sc));
+	case 1:
+		return glm::normalize(glm::vec3(-1, -tc, sc));
+	case 2:
+		return glm::normalize(glm::vec3(sc, 1, tc));
+	case 3:
+		return glm::normalize(glm::vec3(sc, -1, -tc));
+	case 4:
+		return glm::normalize(glm::vec3(sc, -tc, 1));
+	default:
+		return glm::normalize(glm::vec3(-sc, -tc, -1));
+	}
+}
+
+// face and coordinates in [0, 1] of a direction, see the cube map face selection of the vulkan spec
+static uint32_t direction_to_face(const glm::vec3& dir, float& u, float& v)
+{
+	glm::vec3 abs_dir = glm::abs(dir);
+
+	uint32_t face;
+	float sc, tc, major;
+	if (abs_dir.x >= abs_dir.y && abs_dir.x >= abs_dir.z) {
+		major = abs_dir.x;
+		face = dir.x > 0 ? 0 : 1;
+		sc = dir.x > 0 ? -dir.z : dir.z;
+		tc = -dir.y;
+	}
+	else if (abs_dir.y >= abs_dir.z) {
+		major = abs_dir.y;
+		face = dir.y > 0 ? 2 : 3;
+		sc = dir.x;
+		tc = dir.y > 0 ? dir.z : -dir.z;
+	}
+	else {
+		major = abs_dir.z;
+		face = dir.z > 0 ? 4 : 5;
+		sc = dir.z > 0 ? dir.x : -dir.x;
+		tc = -dir.y;
+	}
+
+	u = 0.5f * (sc / major + 1.0f);
+	v = 0.5f * (tc / major + 1.0f);
+	return face;
+}
+
+static glm::vec2 hammersley(uint32_t i, uint32_t count)
+{
+	uint32_t bits = i;
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return { static_cast<float>(i) / count, bits * 2.3283064365386963e-10f };
+}
+
+// box filtered mip chain of the source cube map, used as input of the convolution
+class CubeMipChain
+{
+public:
+	CubeMipChain(std::vector<glm::vec4> source, unsigned int size)
+	{
+		m_sizes.push_back(size);
+		m_levels.push_back(std::move(source));
+
+		while (m_sizes.back() > 1) {
+			unsigned int src_size = m_sizes.back();
+			unsigned int dst_size = src_size / 2;
+			const std::vector<glm::vec4>& src = m_levels.back();
+
+			std::vector<glm::vec4> dst(6 * static_cast<size_t>(dst_size) * dst_size);
+			for (uint32_t face = 0; face < 6; face++) {
+				const glm::vec4* src_face = src.data() + face * static_cast<size_t>(src_size) * src_size;
+				glm::vec4* dst_face = dst.data() + face * static_cast<size_t>(dst_size) * dst_size;
+
+				for (unsigned int y = 0; y < dst_size; y++) {
+					for (unsigned int x = 0; x < dst_size; x++) {
+						dst_face[y * dst_size + x] = 0.25f * (
+							src_face[(2 * y) * src_size + 2 * x] + src_face[(2 * y) * src_size + 2 * x + 1] +
+							src_face[(2 * y + 1) * src_size + 2 * x] + src_face[(2 * y + 1) * src_size + 2 * x + 1]
+						);
+					}
+				}
+			}
+
+			m_sizes.push_back(dst_size);
+			m_levels.push_back(std::move(dst));
+		}
+	}
+
+	// trilinear lookup, bilinear filtering is clamped at the face edges
+	glm::vec4 sample(const glm::vec3& dir, float lod) const
+	{
+		lod = std::clamp(lod, 0.0f, static_cast<float>(m_levels.size() - 1));
+
+		uint32_t level = static_cast<uint32_t>(lod);
+		uint32_t next_level = std::min(level + 1, static_cast<uint32_t>(m_levels.size() - 1));
+		float t = lod - level;
+
+		float u, v;
+		uint32_t face = direction_to_face(dir, u, v);
+		return glm::mix(sample_level(level, face, u, v), sample_level(next_level, face, u, v), t);
+	}
+
+	inline const std::vector<glm::vec4>& get_level(uint32_t level) const { return m_levels[level]; };
+private:
+	std::vector<std::vector<glm::vec4>> m_levels;
+	std::vector<unsigned int> m_sizes;
+
+	glm::vec4 sample_level(uint32_t level, uint32_t face, float u, float v) const
+	{
+		int size = static_cast<int>(m_sizes[level]);
+		const glm::vec4* texels = m_levels[level].data() + face * static_cast<size_t>(size) * size;
+
+		float x = u * size - 0.5f;
+		float y = v * size - 0.5f;
+		int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+		float fx = x - x0, fy = y - y0;
+
+		int x1 = std::clamp(x0 + 1, 0, size - 1), y1 = std::clamp(y0 + 1, 0, size - 1);
+		x0 = std::clamp(x0, 0, size - 1);
+		y0 = std::clamp(y0, 0, size - 1);
+
+		glm::vec4 top = glm::mix(texels[y0 * size + x0], texels[y0 * size + x1], fx);
+		glm::vec4 bottom = glm::mix(texels[y1 * size + x0], texels[y1 * size + x1], fx);
+		return glm::mix(top, bottom, fy);
+	}
+};
+
+// GGX sample around n = (0,0,1), identical for all texels of a level
+struct PrefilterSample {
+	glm::vec3 direction;
+	float weight; // n dot l
+	float lod;    // of the source mip chain
+};
+
+static std::vector<PrefilterSample> create_prefilter_samples(float roughness, unsigned int source_size)
+{
+	// same remapping as eval_D in pbr_common.shader
+	float alpha = roughness * roughness;
+	float alpha_sq = alpha * alpha;
+
+	float texel_solid_angle = 4.0f * static_cast<float>(M_PI) / (6.0f * source_size * source_size);
+
+	std::vector<PrefilterSample> samples{};
+	for (uint32_t i = 0; i < PREFILTER_SAMPLE_COUNT; i++) {
+		glm::vec2 xi = hammersley(i, PREFILTER_SAMPLE_COUNT);
+
+		float phi = 2.0f * static_cast<float>(M_PI) * xi.x;
+		float cos_theta = std::sqrt((1.0f - xi.y) / (1.0f + (alpha_sq - 1.0f) * xi.y));
+		float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+		glm::vec3 h = { sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta };
+
+		// reflect v = n around h
+		glm::vec3 l = 2.0f * h.z * h - glm::vec3(0, 0, 1);
+		if (l.z <= 0.0f) {
+			continue;
+		}
+
+		// pdf of l is D * (n dot h) / (4 * (v dot h)), which simplifies to D / 4 as n = v
+		float temp = 1.0f + (alpha_sq - 1.0f) * cos_theta * cos_theta;
+		float pdf = std::max(alpha_sq / (static_cast<float>(M_PI) * temp * temp) / 4.0f, 1e-6f);
+
+		float sample_solid_angle = 1.0f / (PREFILTER_SAMPLE_COUNT * pdf);
+		float lod = std::max(0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1.0f, 0.0f);
+
+		samples.push_back({ l, l.z, lod });
+	}
+	return samples;
+}
+
+std::vector<std::vector<glm::vec4>> prefilter_cube_map(std::vector<glm::vec4> source, unsigned int size, uint32_t mip_levels, ThreadPool* thread_pool)
+{
+	ZoneScoped;
+
+	CubeMipChain chain(std::move(source), size);
+
+	std::vector<std::vector<glm::vec4>> levels{};
+	levels.push_back(chain.get_level(0));
+
+	for (uint32_t level = 1; level < mip_levels; level++) {
+		ZoneScopedN("Prefilter level");
+
+		unsigned int level_size = std::max(1u, size >> level);
+		float roughness = static_cast<float>(level) / (mip_levels - 1);
+		std::vector<PrefilterSample> samples = create_prefilter_samples(roughness, size);
+
+		std::vector<glm::vec4>& texels = levels.emplace_back(6 * static_cast<size_t>(level_size) * level_size);
+
+		// one job per row of a face
+		auto filter_row = [&](size_t row) {
+			uint32_t face = static_cast<uint32_t>(row / level_size);
+			unsigned int y = static_cast<unsigned int>(row % level_size);
+
+			for (unsigned int x = 0; x < level_size; x++) {
+				glm::vec3 n = texel_direction(face, x, y, level_size);
+				glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0, 0, 1) : glm::vec3(1, 0, 0);
+				glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+				glm::vec3 bitangent = glm::cross(n, tangent);
+
+				glm::vec3 radiance(0.0f);
+				float weight = 0.0f;
+				for (const PrefilterSample& sample : samples) {
+					glm::vec3 l = sample.direction.x * tangent + sample.direction.y * bitangent + sample.direction.z * n;
+					radiance += glm::vec3(chain.sample(l, sample.lod)) * sample.weight;
+					weight += sample.weight;
+				}
+
+				texels[row * level_size + x] = glm::vec4(radiance / std::max(weight, 1e-6f), 1.0f);
+			}
+		};
+
+		size_t rows = 6 * static_cast<size_t>(level_size);
+		if (thread_pool) {
+			thread_pool->parallel_for(rows, filter_row);
+		}
+		else {
+			for (size_t row = 0; row < rows; row++) {
+				filter_row(row);
+			}
+		}
+	}
+
+	return levels;
+}
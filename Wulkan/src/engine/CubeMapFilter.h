@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <vector>
+
+// number of mip levels of prefiltered environment maps, level i holds the radiance for roughness i / (ENVIRONMENT_ROUGHNESS_LEVELS - 1)
+constexpr uint32_t ENVIRONMENT_ROUGHNESS_LEVELS = 6;
+
+// Prefilters the radiance of a cube map for specular image based lighting (split sum approximation, see Karis 2013)
+// source holds the 6 faces (size x size, rgba) in vulkan layer order, the returned levels hold all 6 faces of each level after each other
+// level 0 is the source itself, every further level halves the face size and is convolved with the GGX lobe of its roughness (assuming n = v = r)
+// samples are taken from a box filtered mip chain of the source based on their pdf, so few samples are needed without aliasing
+std::vector<std::vector<glm::vec4>> prefilter_cube_map(std::vector<glm::vec4> source, unsigned int size, uint32_t mip_levels, ThreadPool* thread_pool = nullptr);
@@ -58,7 +58,7 @@ void DirectionalLight::init(const VKW_Device* vkw_device, const std::array<VKW_C
 	}
 }
 
-void DirectionalLight::init_debug_lines(const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass)
+void DirectionalLight::init_debug_lines(GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass)
 {
 	if (!cast_shadows) {
 		throw SetupException("Tried to initialize debug lines of shadow casting for a directional light not casting shadows", __FILE__, __LINE__);
@@ -69,7 +69,7 @@ void DirectionalLight::init_debug_lines(const VKW_CommandPool& transfer_pool, VK
 		Line& camera_frustums = splitted_camera_frustums.at(i);
 		camera_frustums.init(
 			*device,
-			transfer_pool,
+			geometry,
 			descriptor_pool,
 			render_pass,
 			// data is overwriten anyways (but size needs to be correct)
@@ -88,7 +88,7 @@ void DirectionalLight::init_debug_lines(const VKW_CommandPool& transfer_pool, VK
 		Frustum& shadow_frustum = shadow_camera_frustums.at(i);
 		shadow_frustum.init(
 			*device,
-			transfer_pool,
+			geometry,
 			descriptor_pool,
 			render_pass,
 			glm::mat4(1), // is overwritten anyways
@@ -197,6 +197,10 @@ void DirectionalLight::set_uniforms(const Camera& camera, int nr_current_cascade
 
 		uniform.proj_view[cascade_idx] = ortho_proj * shadow_view_mat;
 
+		// objects between the light and the cascade still cast shadows into it, so the near plane is dropped
+		caster_planes[cascade_idx] = Frustum::extract_planes(uniform.proj_view[cascade_idx]);
+		caster_planes[cascade_idx][4] = glm::vec4(0.0f);
+
 		if (initialized_debug_lines) {
 			splitted_camera_frustums.at(cascade_idx).update_vertices(camera_frustum_points);
 			shadow_camera_frustums.at(cascade_idx).set_camera_matrix(uniform.proj_view[cascade_idx]);
@@ -11,6 +11,7 @@
 #include "Frustum.h"
 
 constexpr int MAX_CASCADE_COUNT = 4; // the default init in the shader cannot be lower than the max used
+static_assert(MAX_INSTANCE_VIEWS == 1 + MAX_CASCADE_COUNT, "Every cascade needs its own instance view");
 
 enum ShadowMode {
 	NoShadows,
@@ -45,7 +46,7 @@ public:
 	// sets camera's position to destination + direction * distance
 	void init(const VKW_Device* vkw_device, const std::array<VKW_CommandPool, MAX_FRAMES_IN_FLIGHT>& graphics_pools, glm::vec3 destination, glm::vec3 direction, float distance, uint32_t shadow_res_x, uint32_t shadow_res_y, float orthographic_height,float near_plane, float far_plane);
 	
-	void init_debug_lines(const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass);
+	void init_debug_lines(GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass);
 
 	static VKW_DescriptorSetLayout create_shadow_descriptor_layout(const VKW_Device& device);
 
@@ -91,6 +92,8 @@ private:
 
 	std::array<Line, MAX_CASCADE_COUNT> splitted_camera_frustums;
 	std::array<Frustum, MAX_CASCADE_COUNT> shadow_camera_frustums;
+	// frustum of each cascade extended towards the light, updated by set_uniforms
+	std::array<FrustumPlanes, MAX_CASCADE_COUNT> caster_planes{};
 public:
 	void set_uniforms(const Camera& camera, int nr_cascades, int current_frame);
 	
@@ -101,6 +104,7 @@ public:
 	Texture& get_texture() { return depth_rt; };
 	const std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT>& get_uniform_buffers() const { return uniform_buffers; };
 	VkSemaphore get_shadow_pass_semaphore(int current_frame) const { return shadow_semaphores.at(current_frame); };
+	const FrustumPlanes& get_caster_planes(int cascade_idx) const { return caster_planes.at(cascade_idx); };
 
 	inline void set_direction(glm::vec3 direction);
 	void set_lambda(float l) { lambda = l; };
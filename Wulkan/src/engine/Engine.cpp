@@ -22,10 +22,16 @@ void Engine::init(unsigned int w, unsigned int h)
 #ifndef NDEBUG
 		spdlog::info("Debugging");
 #endif
+	STARTUP_SCOPE("Engine::init");
+
+	// leave one core for the main thread
+	thread_pool.init(std::max(2u, std::thread::hardware_concurrency()) - 1, "Worker");
+	cleanup_queue.add(&thread_pool);
 
 	init_glfw();
 	init_vulkan();
 
+	STARTUP_SCOPE("GUI");
 	camera = Camera( glm::vec3(0.0, 60.0, 25.0), glm::vec3(0.0, 10.0, 8.0), res_x, res_y, glm::radians(45.0f), 0.1f, 100.0f );
 	camera_controller = CameraController(window, &camera);
 	gui.init(window, instance, device, graphics_queue, imgui_descriptor_pool, &swapchain, &camera_controller, &glfw_input_mutex);
@@ -85,7 +91,12 @@ void Engine::render_thread_func()
 	spdlog::info("Start rendering");
 
 	try {
+		bool first_frame = true;
 		while (!should_window_close.load()) {
+			if (first_frame) {
+				StartupProfiler::begin("First frame");
+			}
+
 			if (aquire_image()) {
 				update();
 
@@ -102,6 +113,11 @@ void Engine::render_thread_func()
 			}
 
 			FrameMark;
+
+			if (first_frame) {
+				finish_startup();
+				first_frame = false;
+			}
 		}
 	} catch (const std::exception& e) {
 		spdlog::error(e.what());
@@ -112,10 +128,28 @@ void Engine::render_thread_func()
 	vkDeviceWaitIdle(device);
 }
 
+void Engine::finish_startup()
+{
+	if (StartupProfiler::is_enabled()) {
+		// include the gpu time of the first frame
+		StartupWaitScope wait_scope{};
+		vkDeviceWaitIdle(device);
+	}
+	StartupProfiler::end();
+	StartupProfiler::finish();
+
+	if (exit_after_startup) {
+		glfwSetWindowShouldClose(window, true);
+	}
+}
+
 void Engine::update()
 {
 	ZoneScoped;
 
+	// render fence of current frame was waited on, so its descriptor sets can be updated
+	texture_streamer.update(current_frame);
+
 	{
 		ZoneScopedN("IO");
 
@@ -200,10 +234,47 @@ void Engine::update()
 		if (gui_input.draw_trees) {
 			lod_mesh.set_camera_info(camera.get_virtual_pos(), camera.get_virtual_dir(), camera.get_near_plane(), camera.get_far_plane());
 			lod_mesh.set_visualization_mode(gui_input.pbr_vis_mode);
-			lod_mesh.set_lod_ratios(std::vector<float>{gui_input.lod_ratios[0], gui_input.lod_ratios[1], gui_input.lod_ratios[2], 1});
+			// the last tree lod is kept up to the far plane without impostors
+			float impostor_ratio = gui_input.tree_impostors ? gui_input.lod_ratios[3] : 1.0f;
+			std::array<float, 5> lod_ratios{ gui_input.lod_ratios[0], gui_input.lod_ratios[1], gui_input.lod_ratios[2], impostor_ratio, 1 };
+			lod_mesh.set_lod_ratios(lod_ratios);
+			// the virtual camera can be frozen to inspect the culling
+			lod_mesh.set_frustum_planes(gui_input.cull_trees ? Frustum::extract_planes(camera.generate_projection_mat() * camera.generate_virtual_view_mat()) : FrustumPlanes{});
+
+			// the shadow casters of each cascade are culled separately, without culling the cascades draw the camera's instances
+			std::array<FrustumPlanes, MAX_CASCADE_COUNT> caster_planes{};
+			int nr_caster_cascades = (gui_input.cull_trees && gui_input.shadow_mode != ShadowMode::NoShadows) ? gui_input.nr_shadow_cascades : 0;
+			for (int i = 0; i < nr_caster_cascades; i++) {
+				caster_planes[i] = directional_light.get_caster_planes(i);
+			}
+			lod_mesh.set_cascade_frustum_planes(std::span(caster_planes.data(), nr_caster_cascades));
+
+			lod_mesh.set_gpu_culling(gui_input.gpu_cull_trees);
+
+			// the hi-z pyramid is built from the rendered camera, not the virtual one
+			glfw_input_mutex.lock();
+			glm::mat4 view_proj = camera.generate_projection_mat();
+			view_proj[1][1] *= -1;
+			view_proj = view_proj * camera.generate_view_mat();
+			glfw_input_mutex.unlock();
+			lod_mesh.set_occlusion_culling(gui_input.cull_trees && gui_input.gpu_cull_trees && gui_input.occlusion_cull_trees, view_proj);
+
+			lod_mesh.update(current_frame, &thread_pool);
+		}
 
-			lod_mesh.update(current_frame);
+		// the render fence of current_frame was waited on, so its timestamps are final
+		const uint32_t first_timestamp = current_frame * TREE_TIMESTAMP_COUNT;
+		std::array<uint64_t, TREE_TIMESTAMP_COUNT> timestamps{};
+		tree_prepass_ms = 0.0f;
+		tree_pass_ms = 0.0f;
+		if (tree_prepass_timed[current_frame] && tree_timestamps.get_timestamps(first_timestamp + TREE_PREPASS_BEGIN, 2, &timestamps[TREE_PREPASS_BEGIN])) {
+			tree_prepass_ms = tree_timestamps.get_duration_ms(timestamps[TREE_PREPASS_BEGIN], timestamps[TREE_PREPASS_END]);
+		}
+		if (tree_pass_timed[current_frame] && tree_timestamps.get_timestamps(first_timestamp + TREE_PASS_BEGIN, 2, &timestamps[TREE_PASS_BEGIN])) {
+			tree_pass_ms = tree_timestamps.get_duration_ms(timestamps[TREE_PASS_BEGIN], timestamps[TREE_PASS_END]);
 		}
+
+		gui.set_stats({ gui_input.draw_trees ? lod_mesh.get_occluded_count() : 0, tree_prepass_ms, tree_pass_ms });
 	}
 
 	update_uniforms();
@@ -213,86 +284,189 @@ void Engine::draw()
 {
 	ZoneScoped;
 
-	// shadow pass		
 	get_current_graphics_pool().reset();
 
-	{
-		// TODO: Use camera controllers active camera
-		int nr_cascades = gui_input.nr_shadow_cascades;
+	// all passes are added first, then recorded into secondary command buffers on the workers and executed in order below
+	// they only read engine state and get the cascade per draw, so they can be recorded at once
+	// (secondary command buffers don't inherit any state, so every pass binds the index buffer of the geometry pool itself)
+	parallel_recorder.begin_frame(current_frame, gui_input.parallel_recording);
+	const bool secondary_contents = parallel_recorder.is_parallel();
+
+	// TODO: Use camera controllers active camera
+	const int nr_cascades = gui_input.nr_shadow_cascades;
+	const bool draw_shadows = gui_input.shadow_mode != ShadowMode::NoShadows;
+	const bool occlusion_cull_trees = gui_input.draw_trees && gui_input.cull_trees && gui_input.gpu_cull_trees && gui_input.occlusion_cull_trees;
+	const bool tree_depth_prepass = gui_input.draw_trees && gui_input.tree_depth_prepass;
+	const VkExtent2D shadow_extent = directional_light.get_texture().get_extent();
+	const VkExtent2D extent = swapchain.get_extent();
+
+	// one pass per cascade, draws using depth only pipelines
+	std::array<size_t, MAX_CASCADE_COUNT> shadow_passes{};
+	if (draw_shadows) {
+		for (int i = 0; i < nr_cascades; i++) {
+			shadow_passes[i] = parallel_recorder.add(terrain_depth_render_pass.get_inheritance_rendering_info(), [this, i, shadow_extent](const VKW_CommandBuffer& cmd) {
+				geometry_pool.bind_index_buffer(cmd);
+
+				terrain_depth_render_pass.bind(cmd, shadow_extent, gui_input.depth_bias, gui_input.slope_depth_bias);
+				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_depth_render_pass.get_pipeline_layout(), 0);
+				shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_depth_render_pass.get_pipeline_layout(), 1);
+
+				terrain.draw(cmd, current_frame, i);
+
+				// same attachments, so the meshes are drawn in the same rendering
+				pbr_depth_pass.bind(cmd, shadow_extent, gui_input.depth_bias, gui_input.slope_depth_bias);
+				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_pass.get_pipeline_layout(), 0);
+				shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_pass.get_pipeline_layout(), 1);
+
+				meshes[0].draw(cmd, current_frame, i);
+				/*
+				for (size_t j = 0; j < 4; j++) {
+					meshes[j].draw(cmd, current_frame, i);
+				}
+				*/
+
+				if (gui_input.draw_trees) {
+					lod_mesh.draw_cascade(cmd, current_frame, i);
+
+					impostor_depth_pass.bind(cmd, shadow_extent, gui_input.depth_bias, gui_input.slope_depth_bias);
+					view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, impostor_depth_pass.get_pipeline_layout(), 0);
+					shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, impostor_depth_pass.get_pipeline_layout(), 1);
+
+					lod_mesh.draw_impostors_cascade(cmd, current_frame, i);
+				}
+			});
+		}
+	}
+
+	size_t environment_pass = parallel_recorder.add(environment_render_pass.get_inheritance_rendering_info(), [this, extent](const VKW_CommandBuffer& cmd) {
+		geometry_pool.bind_index_buffer(cmd);
+
+		environment_render_pass.bind(cmd, extent);
+		view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, environment_render_pass.get_pipeline_layout(), 0);
+
+		environment_map.draw(cmd, current_frame);
+	});
+
+	// draws with the default variant until the requested one is compiled in the background
+	TerrainPipelineKey terrain_key{ gui_input.terrain_wireframe_mode, gui_input.nr_shadow_cascades };
+	RenderPass<TerrainPushConstants, 3>& terrain_render_pass = terrain_render_passes.get(terrain_key, default_terrain_pipeline);
+
+	// the cascade slider usually moves by one step, so its neighbours are compiled ahead of time
+	if (terrain_key.nr_shadow_cascades > 1) {
+		terrain_render_passes.request({ terrain_key.wireframe, terrain_key.nr_shadow_cascades - 1 });
+	}
+	if (terrain_key.nr_shadow_cascades < MAX_CASCADE_COUNT) {
+		terrain_render_passes.request({ terrain_key.wireframe, terrain_key.nr_shadow_cascades + 1 });
+	}
+
+	size_t terrain_pass = parallel_recorder.add(terrain_render_pass.get_inheritance_rendering_info(), [this, extent, &terrain_render_pass](const VKW_CommandBuffer& cmd) {
+		geometry_pool.bind_index_buffer(cmd);
+
+		terrain_render_pass.bind(cmd, extent);
+		view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_render_pass.get_pipeline_layout(), 0);
+		shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_render_pass.get_pipeline_layout(), 1);
+
+		terrain.draw(cmd, current_frame);
+	});
 
+	size_t pbr_pass = parallel_recorder.add(pbr_render_pass.get_inheritance_rendering_info(), [this, extent](const VKW_CommandBuffer& cmd) {
+		geometry_pool.bind_index_buffer(cmd);
+
+		pbr_render_pass.bind(cmd, extent);
+		view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_pass.get_pipeline_layout(), 0);
+		shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_pass.get_pipeline_layout(), 1);
+
+		meshes[0].draw(cmd, current_frame);
+		/*
+		for (size_t i = 0; i < 4; i++)
+			meshes[i].draw(cmd, current_frame);
+		*/
+	});
+
+	// the alpha tested trees disable early depth tests, with the prepass their shading runs once per pixel instead of for every layer of leaves
+	size_t tree_prepass = 0;
+	if (tree_depth_prepass) {
+		tree_prepass = parallel_recorder.add(pbr_depth_prepass.get_inheritance_rendering_info(), [this, extent](const VKW_CommandBuffer& cmd) {
+			geometry_pool.bind_index_buffer(cmd);
+
+			pbr_depth_prepass.bind(cmd, extent);
+			view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_prepass.get_pipeline_layout(), 0);
+			shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_prepass.get_pipeline_layout(), 1);
+
+			lod_mesh.draw(cmd, current_frame);
+		});
+	}
+
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& pbr_trees_pass = tree_depth_prepass ? pbr_prepassed_double_sided_pass : pbr_render_double_sided_pass;
+	size_t pbr_double_sided_pass = parallel_recorder.add(pbr_trees_pass.get_inheritance_rendering_info(), [this, extent, &pbr_trees_pass](const VKW_CommandBuffer& cmd) {
+		geometry_pool.bind_index_buffer(cmd);
+
+		pbr_trees_pass.bind(cmd, extent);
+		view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_trees_pass.get_pipeline_layout(), 0);
+		shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_trees_pass.get_pipeline_layout(), 1);
+
+		if (gui_input.draw_trees) {
+			lod_mesh.draw(cmd, current_frame);
+
+			// the impostors write their own depth, so they are not part of the prepass
+			impostor_render_pass.bind(cmd, extent);
+			view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, impostor_render_pass.get_pipeline_layout(), 0);
+			shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, impostor_render_pass.get_pipeline_layout(), 1);
+
+			lod_mesh.draw_impostors(cmd, current_frame);
+		}
+	});
+
+	size_t line_pass = parallel_recorder.add(line_render_pass.get_inheritance_rendering_info(), [this, extent](const VKW_CommandBuffer& cmd) {
+		geometry_pool.bind_index_buffer(cmd);
+
+		line_render_pass.bind(cmd, extent);
+		view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, line_render_pass.get_pipeline_layout(), 0);
+
+		if (gui_input.shadow_draw_debug_frustums)
+			directional_light.draw_debug_lines(cmd, current_frame, gui_input.nr_shadow_cascades);
+	});
+
+	parallel_recorder.record();
+
+	{
 		const VKW_CommandBuffer& shadow_cmd = directional_light.begin_depth_pass(current_frame);
+
+		// the shadow commands are submitted first, so the culled instances are ready for the shadow and the main passes
+		if (gui_input.draw_trees) {
+			TracyVkZone(get_current_tracy_context(), shadow_cmd, "Tree culling");
+			shadow_cmd.begin_debug_zone("Tree culling");
+			lod_mesh.record_culling(shadow_cmd, current_frame);
+			shadow_cmd.end_debug_zone();
+		}
+
 		{
-			// draw using depth only pipelines
-			if (gui_input.shadow_mode != ShadowMode::NoShadows)
+			if (draw_shadows)
 			{
 
 				TracyVkZone(get_current_tracy_context(), shadow_cmd, "Shadow [Depth Only]");
 				shadow_cmd.begin_debug_zone("Shadow [Depth Only]");
 				
 				for (int i = 0; i < nr_cascades; i++) {
-					{
-						TracyVkZone(get_current_tracy_context(), shadow_cmd, "Terrain Depth");
-
-						terrain_depth_render_pass.begin(
-							shadow_cmd,
-							directional_light.get_texture().get_extent(),
-							VK_NULL_HANDLE, // don't attach a color image view
-							directional_light.get_texture().get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, i, 1),
-							VK_NULL_HANDLE,				// color resolve
-							VK_NULL_HANDLE,				// depth resolve
-							false,                      // don't clear color
-							{ 1,0,1,1 },                // ignore
-							true,                       // clear depth
-							1.0,		                // clear to far value
-							gui_input.depth_bias,       // const depth bias
-							gui_input.slope_depth_bias  // slope depth bias
-						);
-
-						view_descriptor_sets[current_frame].bind(shadow_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_depth_render_pass.get_pipeline_layout(), 0);
-						shadow_descriptor_sets[current_frame].bind(shadow_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, terrain_depth_render_pass.get_pipeline_layout(), 1);
-
-						terrain.set_cascade_idx(i);
-						terrain.draw(shadow_cmd, current_frame);
-					
-						terrain_depth_render_pass.end(shadow_cmd);
-					}
-
-					{
-						TracyVkZone(get_current_tracy_context(), shadow_cmd, "PBR Depth");
-					
-						pbr_depth_pass.begin(
-							shadow_cmd,
-							directional_light.get_texture().get_extent(),
-							VK_NULL_HANDLE, // don't attach a color image view
-							directional_light.get_texture().get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, i, 1),
-							VK_NULL_HANDLE,				// color resolve
-							VK_NULL_HANDLE,				// depth resolve
-							false,                      // don't clear color
-							{ 1,0,1,1 },                // ignore
-							false,                      // clear depth
-							0.0,		                // ignore
-							gui_input.depth_bias,       // const depth bias
-							gui_input.slope_depth_bias  // slope depth bias
-						);
-						view_descriptor_sets[current_frame].bind(shadow_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_pass.get_pipeline_layout(), 0);
-						shadow_descriptor_sets[current_frame].bind(shadow_cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_depth_pass.get_pipeline_layout(), 1);
-
-						meshes[0].set_cascade_idx(i);
-						meshes[0].draw(shadow_cmd, current_frame);
-						/*
-						for (size_t j = 0; j < 4; j++) {
-							meshes[j].set_cascade_idx(i);
-							meshes[j].draw(shadow_cmd, current_frame);
-						}
-						*/
-
-						if (gui_input.draw_trees) {
-							lod_mesh.set_cascade_idx(i);
-							lod_mesh.draw(shadow_cmd, current_frame);
-						}
-
-						pbr_depth_pass.end(shadow_cmd);
-					}
+					TracyVkZone(get_current_tracy_context(), shadow_cmd, "Cascade Depth");
+
+					terrain_depth_render_pass.begin_rendering(
+						shadow_cmd,
+						secondary_contents,
+						shadow_extent,
+						VK_NULL_HANDLE, // don't attach a color image view
+						directional_light.get_texture().get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, i, 1),
+						VK_NULL_HANDLE,				// color resolve
+						VK_NULL_HANDLE,				// depth resolve
+						false,                      // don't clear color
+						{ 1,0,1,1 },                // ignore
+						true,                       // clear depth
+						1.0		                    // clear to far value
+					);
+
+					parallel_recorder.execute(shadow_cmd, shadow_passes[i]);
+
+					terrain_depth_render_pass.end(shadow_cmd);
 				}
 
 				shadow_cmd.end_debug_zone();
@@ -304,8 +478,15 @@ void Engine::draw()
 	{
 		const VKW_CommandBuffer& cmd = get_current_command_buffer();
 
-		// begin command buffer
 		cmd.begin();
+
+		// the timestamps wait for all previous commands, so each pair measures its pass alone
+		const uint32_t first_timestamp = current_frame * TREE_TIMESTAMP_COUNT;
+		tree_prepass_timed[current_frame] = tree_timestamps_supported && tree_depth_prepass;
+		tree_pass_timed[current_frame] = tree_timestamps_supported;
+		if (tree_timestamps_supported) {
+			tree_timestamps.reset(cmd, first_timestamp, TREE_TIMESTAMP_COUNT);
+		}
 	
 		{
 			Texture& color_rt = (use_msaa) ? color_render_target : color_resolve_target;
@@ -319,9 +500,10 @@ void Engine::draw()
 				TracyVkZone(get_current_tracy_context(), cmd, "Environment map");
 				cmd.begin_debug_zone("Environment map");
 				
-				environment_render_pass.begin(
+				environment_render_pass.begin_rendering(
 					cmd,
-					swapchain.get_extent(),
+					secondary_contents,
+					extent,
 					color_rt.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT),
 					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT),
 					VK_NULL_HANDLE,
@@ -332,9 +514,7 @@ void Engine::draw()
 					1.0f                          // depth value
 				);
 
-				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, environment_render_pass.get_pipeline_layout(), 0);
-
-				environment_map.draw(cmd, current_frame);
+				parallel_recorder.execute(cmd, environment_pass);
 
 				environment_render_pass.end(cmd);
 
@@ -346,20 +526,31 @@ void Engine::draw()
 				TracyVkZone(get_current_tracy_context(), cmd, "Terrain");
 				cmd.begin_debug_zone("Terrain pass");
 
-				RenderPass<TerrainPushConstants, 3>& render_pass = (gui_input.terrain_wireframe_mode) ? terrain_wireframe_render_passes.at(gui_input.nr_shadow_cascades - 1) : terrain_render_passes.at(gui_input.nr_shadow_cascades - 1);
-				render_pass.begin(
+				terrain_render_pass.begin_rendering(
 					cmd,
-					swapchain.get_extent(),
+					secondary_contents,
+					extent,
 					color_rt.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT),
 					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT)
 				);
 
-				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, render_pass.get_pipeline_layout(), 0);
-				shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, render_pass.get_pipeline_layout(), 1);
+				parallel_recorder.execute(cmd, terrain_pass);
 
-				terrain.draw(cmd, current_frame);
+				terrain_render_pass.end(cmd);
 
-				render_pass.end(cmd);
+				cmd.end_debug_zone();
+			}
+
+			// the trees are occlusion culled against the terrain, before any of them is drawn
+			if (occlusion_cull_trees) {
+				TracyVkZone(get_current_tracy_context(), cmd, "Hi-Z occlusion culling");
+				cmd.begin_debug_zone("Hi-Z occlusion culling");
+
+				Texture::transition_layout(cmd, depth_render_target, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+				hi_z.record(cmd);
+				Texture::transition_layout(cmd, depth_render_target, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+				lod_mesh.record_occlusion_culling(cmd, current_frame);
 
 				cmd.end_debug_zone();
 			}
@@ -369,45 +560,69 @@ void Engine::draw()
 				TracyVkZone(get_current_tracy_context(), cmd, "PBR Meshes");
 				cmd.begin_debug_zone("PBR pass");
 
-				pbr_render_pass.begin(
+				pbr_render_pass.begin_rendering(
 					cmd,
-					swapchain.get_extent(),
+					secondary_contents,
+					extent,
 					color_rt.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT),
 					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT)
 				);
-				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_pass.get_pipeline_layout(), 0);
-				shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_pass.get_pipeline_layout(), 1);
 
-				meshes[0].draw(cmd, current_frame);
-				/*
-				for (size_t i = 0; i < 4; i++)
-					meshes[i].draw(cmd, current_frame);
-				*/
+				parallel_recorder.execute(cmd, pbr_pass);
 
 				pbr_render_pass.end(cmd);
 
 				cmd.end_debug_zone();
 			}
 
+			if (tree_depth_prepass) {
+				TracyVkZone(get_current_tracy_context(), cmd, "Tree depth prepass");
+				cmd.begin_debug_zone("Tree depth prepass");
+				if (tree_prepass_timed[current_frame]) {
+					tree_timestamps.write_timestamp(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, first_timestamp + TREE_PREPASS_BEGIN);
+				}
+
+				pbr_depth_prepass.begin_rendering(
+					cmd,
+					secondary_contents,
+					extent,
+					VK_NULL_HANDLE, // depth only
+					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT)
+				);
+
+				parallel_recorder.execute(cmd, tree_prepass);
+
+				pbr_depth_prepass.end(cmd);
+
+				if (tree_prepass_timed[current_frame]) {
+					tree_timestamps.write_timestamp(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, first_timestamp + TREE_PREPASS_END);
+				}
+				cmd.end_debug_zone();
+			}
+
 			{
+				// compare both zones with and without the prepass
 				TracyVkZone(get_current_tracy_context(), cmd, "PBR Meshes Double sided");
 				cmd.begin_debug_zone("PBR pass Double sided");
+				if (tree_pass_timed[current_frame]) {
+					tree_timestamps.write_timestamp(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, first_timestamp + TREE_PASS_BEGIN);
+				}
 
-				pbr_render_double_sided_pass.begin(
+				pbr_trees_pass.begin_rendering(
 					cmd,
-					swapchain.get_extent(),
+					secondary_contents,
+					extent,
 					color_rt.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT),
 					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT)
 				);
-				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_double_sided_pass.get_pipeline_layout(), 0);
-				shadow_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbr_render_double_sided_pass.get_pipeline_layout(), 1);
 
-				if (gui_input.draw_trees) {
-					lod_mesh.draw(cmd, current_frame);
-				}
+				parallel_recorder.execute(cmd, pbr_double_sided_pass);
 
-				pbr_render_double_sided_pass.end(cmd);
+				pbr_trees_pass.end(cmd);
 
+				if (tree_pass_timed[current_frame]) {
+					tree_timestamps.write_timestamp(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, first_timestamp + TREE_PASS_END);
+				}
 				cmd.end_debug_zone();
 			}
 			// draw lines (and resolve msaa)
@@ -419,18 +634,16 @@ void Engine::draw()
 				TracyVkZone(get_current_tracy_context(), cmd, "Debug Lines");
 				cmd.begin_debug_zone("Line pass");
 				
-				line_render_pass.begin(
+				line_render_pass.begin_rendering(
 					cmd,
-					swapchain.get_extent(),
+					secondary_contents,
+					extent,
 					color_rt.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT),
 					depth_render_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT),
 					use_msaa ? color_resolve_target.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT) : VK_NULL_HANDLE
 				);
-				view_descriptor_sets[current_frame].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, line_render_pass.get_pipeline_layout(), 0);
-				
-				if (gui_input.shadow_draw_debug_frustums)
-					directional_light.draw_debug_lines(cmd, current_frame, gui_input.nr_shadow_cascades);
-				
+
+				parallel_recorder.execute(cmd, line_pass);
 
 				line_render_pass.end(cmd);
 				cmd.end_debug_zone();
@@ -451,6 +664,9 @@ void Engine::draw()
 			Texture::transition_layout(cmd, color_resolve_target, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 			Texture::transition_layout(cmd, swapchain.images_at(current_swapchain_image_idx), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
+			// tone mapping and imgui are recorded directly, executing secondary command buffers leaves the index buffer unbound
+			geometry_pool.bind_index_buffer(cmd);
+
 			// THIS IS CURSED
 			{
 				tone_mapper.begin(cmd,
@@ -532,6 +748,8 @@ void Engine::init_logger()
 
 void Engine::init_glfw()
 {
+	STARTUP_SCOPE("init_glfw");
+
 	if (!glfwInit()) {
 		throw SetupException("GLFW Initilization failed", __FILE__, __LINE__);
 	}
@@ -558,18 +776,32 @@ void Engine::init_glfw()
 
 void Engine::init_vulkan()
 {
-	VK_CHECK_ET(volkInitialize(), RuntimeException, "Failed to initialize volk");
+	STARTUP_SCOPE("init_vulkan");
 
-	init_instance();
-	create_surface();
-	create_device();
-	create_queues();
+	{
+		STARTUP_SCOPE("Instance and device");
+		VK_CHECK_ET(volkInitialize(), RuntimeException, "Failed to initialize volk");
+
+		init_instance();
+		create_surface();
+		create_device();
+		create_queues();
+	}
 
 	create_swapchain();
 	
 	create_command_structs();
 	create_sync_structs();
 
+	texture_streamer.init(&device, &transfer_queue, &graphics_queue, &thread_pool, "Texture streamer");
+	cleanup_queue.add(&texture_streamer);
+
+	uploader.init(&device, &transfer_queue, &graphics_queue, 64 * 1024 * 1024, "Init uploader");
+	cleanup_queue.add(&uploader);
+
+	geometry_pool.init(&device, &uploader, 2 * 1024 * 1024, 8 * 1024 * 1024, "Geometry pool");
+	cleanup_queue.add(&geometry_pool);
+
 	create_texture_samplers();
 
 	create_uniform_buffers();
@@ -604,6 +836,10 @@ void Engine::create_device()
 
 	spdlog::info("Selected GPU: {}", device.get_device_properties().deviceName);
 	spdlog::info("Tesselation limit: {}", device.get_device_properties().limits.maxTessellationGenerationLevel);
+
+	// written back on shutdown
+	pipeline_cache.init(&device, "pipeline_cache.bin", "Pipeline cache");
+	cleanup_queue.add(&pipeline_cache);
 }
 
 void Engine::create_queues()
@@ -621,6 +857,12 @@ void Engine::init_descriptor_set_layouts()
 		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 
 		VK_SHADER_STAGE_ALL
 	);
+	// prefiltered environment map for image based lighting
+	view_desc_set_layout.add_binding(
+		1,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_SHADER_STAGE_FRAGMENT_BIT
+	);
 	view_desc_set_layout.init(&device, "Shared view resource set layout");
 	cleanup_queue.add(&view_desc_set_layout);
 
@@ -645,11 +887,14 @@ void Engine::init_descriptor_set_layouts()
 
 void Engine::init_data()
 {
+	STARTUP_SCOPE("init_data");
+
 	std::array<VKW_CommandPool, MAX_FRAMES_IN_FLIGHT> graphic_pools;
 	for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		graphic_pools.at(i) = command_structs.at(i).graphics_command_pool;
 	}
 
+	StartupProfiler::begin("Directional light");
 	directional_light.init(
 		&device,
 		graphic_pools,
@@ -666,22 +911,26 @@ void Engine::init_data()
 
 	// can toggle debug drawings of cascade frustums
 	directional_light.init_debug_lines(
-		get_current_transfer_pool(),
+		geometry_pool,
 		descriptor_pool,
 		line_render_pass
 	);
 
 	cleanup_queue.add(&directional_light);
+	StartupProfiler::end();
 
 	// terrain needs directional light to be initiated due to it relying on it's uniform buffer
 	// try manticorp.github.io/unrealheightmap
+	StartupProfiler::begin("Terrain");
 	terrain.init(
 		device,
 		get_current_graphics_pool(),
-		get_current_transfer_pool(),
+		pipeline_cache,
+		uploader,
+		geometry_pool,
 		descriptor_pool,
 		&mirror_texture_sampler,
-		terrain_render_passes[2],
+		terrain_render_passes.get_blocking(default_terrain_pipeline),
 
 		"textures/terrain/heightmap.png", // height map
 		"textures/terrain/texture.png",   // albedo
@@ -690,22 +939,26 @@ void Engine::init_data()
 	);
 	terrain.set_descriptor_bindings();
 	cleanup_queue.add(&terrain);
+	StartupProfiler::end();
 
+	StartupProfiler::begin("Environment map");
 	environment_map.init(
 		device,
-		get_current_graphics_pool(),
-		get_current_transfer_pool(),
+		uploader,
+		geometry_pool,
 		descriptor_pool,
 		environment_render_pass,
 
-		"textures/environment_maps/day_cube_map_%.exr"
+		"textures/environment_maps/day_cube_map_%.exr",
+		&thread_pool
 	);
 	environment_map.set_descriptor_bindings(linear_texture_sampler);
 	cleanup_queue.add(&environment_map);
+	StartupProfiler::end();
 
 	texture_not_found = create_texture_from_path(
 		&device,
-		&get_current_graphics_pool(),
+		uploader,
 		"textures/texture_not_found.png",
 		Texture_Type::Tex_RGB,
 		"Texture Not Found fallback"
@@ -713,28 +966,30 @@ void Engine::init_data()
 	cleanup_queue.add(&texture_not_found);
 
 	{
-		
-		meshes[0].init(device, get_current_graphics_pool(), get_current_transfer_pool(), descriptor_pool, pbr_render_pass, "models/baloon.obj");
+		STARTUP_SCOPE("Meshes");
+		meshes[0].init(device, texture_streamer, geometry_pool, descriptor_pool, thread_pool, pbr_render_pass, "models/baloon.obj");
 		meshes[0].set_descriptor_bindings(texture_not_found, linear_texture_sampler);
 		cleanup_queue.add(&meshes[0]);
 
 		/*
-		meshes[1].init(device, get_current_graphics_pool(), get_current_transfer_pool(), descriptor_pool, pbr_render_pass, "models/plane.obj");
+		meshes[1].init(device, texture_streamer, geometry_pool, descriptor_pool, thread_pool, pbr_render_pass, "models/plane.obj");
 		meshes[1].set_descriptor_bindings(texture_not_found, linear_texture_sampler);
 		cleanup_queue.add(&meshes[1]);
 
-		meshes[2].init(device, get_current_graphics_pool(), get_current_transfer_pool(), descriptor_pool, pbr_render_pass, "models/material_tests/mitsuba_texture.obj");
+		meshes[2].init(device, texture_streamer, geometry_pool, descriptor_pool, thread_pool, pbr_render_pass, "models/material_tests/mitsuba_texture.obj");
 		meshes[2].set_descriptor_bindings(texture_not_found, linear_texture_sampler);
 		cleanup_queue.add(&meshes[2]);
 
-		meshes[3].init(device, get_current_graphics_pool(), get_current_transfer_pool(), dyn_descriptor_pool, pbr_render_pass, "models/trees/Tree0.obj");
-		//meshes[3].init(device, get_current_graphics_pool(), get_current_transfer_pool(), dyn_descriptor_pool, pbr_render_pass, "models/sponza/sponza.obj");
+		meshes[3].init(device, texture_streamer, geometry_pool, dyn_descriptor_pool, thread_pool, pbr_render_pass, "models/trees/Tree0.obj");
+		//meshes[3].init(device, texture_streamer, geometry_pool, dyn_descriptor_pool, thread_pool, pbr_render_pass, "models/sponza/sponza.obj");
 		meshes[3].set_descriptor_bindings(texture_not_found, linear_texture_sampler);
 		cleanup_queue.add(&meshes[3]);
 		*/
 	}
 
 	{
+		STARTUP_SCOPE("Tree placement");
+
 		// procedural tree placement (height cut off and not on green)
 		std::default_random_engine generator{};
 		std::uniform_real_distribution<float> distribution{ 0, 1};
@@ -747,11 +1002,14 @@ void Engine::init_data()
 			uv_samples.push_back({ distribution(generator), distribution(generator) });
 		}
 
+		// samples are read on the graphics queue after the terrain textures
+		uploader.flush();
+
 		std::vector<glm::vec4> height_res{};
-		terrain.get_height_map().cpu_texture_samples(get_current_graphics_pool(), descriptor_pool, cpu_text_sample_set_layout, linear_texture_sampler, uv_samples, height_res);
+		terrain.get_height_map().cpu_texture_samples(get_current_graphics_pool(), pipeline_cache, descriptor_pool, cpu_text_sample_set_layout, linear_texture_sampler, uv_samples, height_res);
 
 		std::vector<glm::vec4> albedo_res{};
-		terrain.get_albedo().cpu_texture_samples(get_current_graphics_pool(), descriptor_pool, cpu_text_sample_set_layout, linear_texture_sampler, uv_samples, albedo_res);
+		terrain.get_albedo().cpu_texture_samples(get_current_graphics_pool(), pipeline_cache, descriptor_pool, cpu_text_sample_set_layout, linear_texture_sampler, uv_samples, albedo_res);
 
 		std::vector<InstanceData> per_instance_data{};
 		per_instance_data.reserve(nr_instances);
@@ -769,41 +1027,44 @@ void Engine::init_data()
 			}
 		}
 
-		std::vector <InstancedShape<ObjMesh>> meshes{};
-		std::vector<VKW_Path> mesh_path{ "models/trees/Tree0.obj", "models/trees/Tree1.obj", "models/trees/Tree2.obj", "models/trees/Tree3.obj" };
+		// lod 0 is the tree itself, the others are simplified to these ratios of its triangles (see simplify_mesh)
+		// the instances are sorted into a grid over the terrain, which is queried when culling (see InstanceGrid)
+		const VKW_Path tree_path = "models/trees/Tree0.obj";
+		const std::array<float, 3> tree_lod_ratios{ 0.5f, 0.2f, 0.05f };
+		lod_mesh.init_obj(
+			device, uploader, texture_streamer, geometry_pool, descriptor_pool, thread_pool, pbr_render_pass,
+			texture_not_found, linear_texture_sampler,
+			tree_path, tree_lod_ratios,
+			per_instance_data
+		);
 
-		for (const VKW_Path& path : mesh_path) {
-			ObjMesh mesh{};
-			mesh.init(
-				device, get_current_graphics_pool(), get_current_transfer_pool(), descriptor_pool, pbr_render_pass,
-				path
-			);
-			mesh.set_descriptor_bindings(texture_not_found, linear_texture_sampler);
-			
-			InstancedShape<ObjMesh> instanced_mesh{};
-			instanced_mesh.init(device, get_current_transfer_pool(),
-				std::move(mesh),
-				nr_instances,
-				{},
-				true
-			);
-			
-			meshes.push_back(instanced_mesh);
-		}
+		// baked from the highest lod on the first start up
+		Impostor impostor{};
+		impostor.init(
+			device, get_current_graphics_pool(), pipeline_cache, uploader, texture_streamer, geometry_pool, descriptor_pool, thread_pool, impostor_render_pass,
+			texture_not_found, linear_texture_sampler, tree_path
+		);
 
-		lod_mesh.init(
-			std::move(meshes),
-			per_instance_data
+		InstancedShape<Impostor> instanced_impostor{};
+		instanced_impostor.init(device, uploader,
+			std::move(impostor),
+			nr_instances,
+			{},
+			true
 		);
+		lod_mesh.init_impostor(std::move(instanced_impostor));
+		hi_z.init(&device, get_current_graphics_pool(), descriptor_pool, pipeline_cache, depth_render_target, nearest_texture_sampler);
+		cleanup_queue.add(&hi_z);
+
+		lod_mesh.init_gpu_culling(device, uploader, pipeline_cache, hi_z);
 		cleanup_queue.add(&lod_mesh);
 	}
 
+	// pipeline was created in create_render_passes
 	tone_mapper.init(
 		device, 
-		get_current_transfer_pool(),
-		descriptor_pool,
-		{view_desc_set_layout, tone_mapper_desc_set_layout}, // TODO tone mapper desc set layout
-		swapchain.get_format() // will write to swapchain
+		geometry_pool,
+		descriptor_pool
 	);
 
 	// needs to also be called whenever we recreate our images due to resize
@@ -812,10 +1073,20 @@ void Engine::init_data()
 		linear_texture_sampler
 	);
 	cleanup_queue.add(&tone_mapper);
+
+	{
+		STARTUP_SCOPE("Wait for uploads");
+		uploader.wait_all();
+	}
+	spdlog::info("Uploaded {:.2f} MiB in {} copies with {} submissions and {} waits", uploader.get_uploaded_size() / (1024.0 * 1024.0),
+		uploader.get_upload_count(), uploader.get_submit_count(), uploader.get_wait_count());
+	spdlog::info("Geometry pool holds {} vertices and {} indices", geometry_pool.get_vertex_count(), geometry_pool.get_index_count());
 }
 
 void Engine::init_descriptor_sets()
 {
+	STARTUP_SCOPE("init_descriptor_sets");
+
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		VKW_DescriptorSet& view_desc_set = view_descriptor_sets[i];
 		view_desc_set.init(
@@ -825,6 +1096,7 @@ void Engine::init_descriptor_sets()
 			fmt::format("View Desc Set ({})", i)
 		);
 		view_desc_set.update(0, uniform_buffers.at(i));
+		view_desc_set.update(1, environment_map.get_cube_map().get_image_view(VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_CUBE, 0, 6), linear_texture_sampler);
 		cleanup_queue.add(&view_desc_set);
 
 		VKW_DescriptorSet& shadow_desc_set = shadow_descriptor_sets[i];
@@ -878,8 +1150,10 @@ void Engine::create_descriptor_set_pool()
 	descriptor_pool.add_layout(tone_mapper_desc_set_layout, MAX_FRAMES_IN_FLIGHT);
 	descriptor_pool.add_type(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1); // precompute curvature
 	descriptor_pool.add_type(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1); // precompute curvature
+	descriptor_pool.add_type(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, HiZPyramid::SAMPLED_IMAGE_COUNT);
+	descriptor_pool.add_type(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, HiZPyramid::STORAGE_IMAGE_COUNT);
 
-	descriptor_pool.init(&device, MAX_FRAMES_IN_FLIGHT*(5 + 12*4 + 2 * MAX_CASCADE_COUNT) + 1, "General descriptor pool");
+	descriptor_pool.init(&device, MAX_FRAMES_IN_FLIGHT*(5 + 12*4 + 2 * MAX_CASCADE_COUNT) + 1 + HiZPyramid::DESCRIPTOR_SET_COUNT, "General descriptor pool");
 	cleanup_queue.add(&descriptor_pool);
 
 	dyn_descriptor_pool.add_layout(view_desc_set_layout, MAX_FRAMES_IN_FLIGHT );
@@ -944,7 +1218,7 @@ void Engine::init_render_targets()
 		swapchain.get_extent().width,
 		swapchain.get_extent().height,
 		Texture::find_format(device, Texture_Type::Tex_D),
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // sampled to build the hi-z pyramid
 		sharing_exlusive(),
 		"Depth render target",
 		1, // mip layers
@@ -955,67 +1229,120 @@ void Engine::init_render_targets()
 
 void Engine::create_render_passes()
 {
-	// have different specialized render passes for different cascade counts (specialization constants)
+	STARTUP_SCOPE("create_render_passes");
+
 	std::array<VKW_DescriptorSetLayout, 3> descriptor_set_layouts{ view_desc_set_layout, shadow_desc_set_layout, terrain_desc_set_layout };
+
+	// have different specialized render passes for different cascade counts (specialization constants)
+	// only the default variant is built at startup, the others once they are requested (all share the same pipeline layout)
+	terrain_render_passes.init(
+		&thread_pool,
+		[this, descriptor_set_layouts](const TerrainPipelineKey& key) {
+			return Terrain::create_render_pass(
+				&device,
+				pipeline_cache,
+				descriptor_set_layouts,
+				color_render_target,
+				depth_render_target,
+				sample_count,
+				false, // not depth only
+				key.wireframe,
+				false, // not bias depth
+				key.nr_shadow_cascades
+			);
+		},
+		"Terrain render passes"
+	);
 	
-	for (int i = 0; i < MAX_CASCADE_COUNT; i++) {
-		terrain_render_passes.at(i) = Terrain::create_render_pass(
-			&device,
-			descriptor_set_layouts,
-			color_render_target,
-			depth_render_target,
-			sample_count,
-			false, // not depth only
-			false, // not wireframe
-			false, // not bias depth
-			i + 1
-		);
-		cleanup_queue.add(&terrain_render_passes.at(i));
+	// every pipeline (including loading its shaders) is an independent job, compiled in parallel on the workers
+	// vkCreate*Pipelines is free threaded and the pipeline cache is synchronized internally
+	std::vector<std::function<void()>> jobs{};
+
+	jobs.push_back([this]() {
+		terrain_render_passes.get_blocking(default_terrain_pipeline);
+	});
 
-		terrain_wireframe_render_passes.at(i) = Terrain::create_render_pass(
+	jobs.push_back([this, &descriptor_set_layouts]() {
+		terrain_depth_render_pass = Terrain::create_render_pass(
 			&device,
+			pipeline_cache,
 			descriptor_set_layouts, 
 			color_render_target,
 			depth_render_target,
-			sample_count,
-			false, // not depth only
-			true,  // wireframe
-			false, // not bias depth
-			i + 1
+			VK_SAMPLE_COUNT_1_BIT,
+			true,  // depth only
+			false, // not wireframe
+			true   // bias depth
 		);
-		cleanup_queue.add(&terrain_wireframe_render_passes.at(i));
-	}
+	});
+
+	jobs.push_back([this]() {
+		environment_render_pass = EnvironmentMap::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, environment_desc_set_layout}, color_render_target, depth_render_target, sample_count);
+	});
+
+	jobs.push_back([this]() {
+		line_render_pass = Line::create_render_pass(&device, pipeline_cache, { view_desc_set_layout }, color_render_target, depth_render_target, sample_count);
+	});
+
+	jobs.push_back([this]() {
+		pbr_render_pass = ObjMesh::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count);
+	});
+
+	jobs.push_back([this]() {
+		pbr_render_double_sided_pass = ObjMesh::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count, false, false, false);
+	});
+
+	jobs.push_back([this]() {
+		pbr_depth_pass = ObjMesh::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, VK_SAMPLE_COUNT_1_BIT, true, true);
+	});
+
+	jobs.push_back([this]() {
+		pbr_depth_prepass = ObjMesh::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count, true, false, false, true);
+	});
+
+	jobs.push_back([this]() {
+		pbr_prepassed_double_sided_pass = ObjMesh::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count, false, false, false, true);
+	});
+
+	jobs.push_back([this]() {
+		impostor_render_pass = Impostor::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count);
+	});
+
+	jobs.push_back([this]() {
+		impostor_depth_pass = Impostor::create_render_pass(&device, pipeline_cache, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, VK_SAMPLE_COUNT_1_BIT, true, true);
+	});
+
+	// rest of the tone mapper is initialized with the scene data
+	jobs.push_back([this]() {
+		tone_mapper.init_pipeline(
+			device,
+			pipeline_cache,
+			{ view_desc_set_layout, tone_mapper_desc_set_layout }, // TODO tone mapper desc set layout
+			swapchain.get_format() // will write to swapchain
+		);
+	});
 
-	terrain_depth_render_pass = Terrain::create_render_pass(
-		&device,
-		descriptor_set_layouts, 
-		color_render_target,
-		depth_render_target,
-		VK_SAMPLE_COUNT_1_BIT,
-		true,  // depth only
-		false, // not wireframe
-		true   // bias depth
-	);
-	cleanup_queue.add(&terrain_depth_render_pass);
+	// joins all jobs, rethrows the first failure
+	thread_pool.parallel_for(jobs.size(), [&jobs](size_t i) { jobs[i](); });
 
-	environment_render_pass = EnvironmentMap::create_render_pass(&device, { view_desc_set_layout, environment_desc_set_layout}, color_render_target, depth_render_target, sample_count);
+	// cleanup queue is not thread safe
+	cleanup_queue.add(&terrain_render_passes);
+	cleanup_queue.add(&terrain_depth_render_pass);
 	cleanup_queue.add(&environment_render_pass);
-
-	line_render_pass = Line::create_render_pass(&device, { view_desc_set_layout }, color_render_target, depth_render_target, sample_count);
 	cleanup_queue.add(&line_render_pass);
-
-	pbr_render_pass = ObjMesh::create_render_pass(&device, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count);
 	cleanup_queue.add(&pbr_render_pass);
-
-	pbr_render_double_sided_pass = ObjMesh::create_render_pass(&device, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, sample_count, false, false, false);
 	cleanup_queue.add(&pbr_render_double_sided_pass);
-
-	pbr_depth_pass = ObjMesh::create_render_pass(&device, { view_desc_set_layout, shadow_desc_set_layout, pbr_desc_set_layout }, color_render_target, depth_render_target, VK_SAMPLE_COUNT_1_BIT, true, true);
 	cleanup_queue.add(&pbr_depth_pass);
+	cleanup_queue.add(&pbr_depth_prepass);
+	cleanup_queue.add(&pbr_prepassed_double_sided_pass);
+	cleanup_queue.add(&impostor_render_pass);
+	cleanup_queue.add(&impostor_depth_pass);
 }
 
 void Engine::create_swapchain()
 {
+	STARTUP_SCOPE("create_swapchain");
+
 	swapchain.init(window, device, &present_queue, "Swapchain");
 	cleanup_queue.add(&swapchain);
 
@@ -1039,6 +1366,7 @@ void Engine::recreate_swapchain()
 	swapchain.recreate(window, device);
 
 	recreate_render_targets();
+	hi_z.set_depth_target(get_current_graphics_pool(), depth_render_target);
 
 	// needs to be called whenever we recreate our images due to resize
 	tone_mapper.set_descriptor_bindings(
@@ -1087,6 +1415,17 @@ void Engine::create_command_structs()
 		command_structs.at(i).graphics_queue_tracy_context = TracyVkContextCalibrated(device.get_physical_device(), device, graphics_queue, command_structs.at(i).graphics_command_buffer, vkGetPhysicalDeviceCalibrateableTimeDomainsEXT, vkGetCalibratedTimestampsEXT);
 		TracyVkContextName(command_structs.at(i).graphics_queue_tracy_context, "Graphics Context", sizeof("Graphics Context"));
 	}
+
+	// secondary command buffers have their own pools per thread and frame in flight
+	parallel_recorder.init(&device, &graphics_queue, &thread_pool, "Parallel recorder");
+	cleanup_queue.add(&parallel_recorder);
+
+	// the tree passes are only timed if the graphics queue supports timestamps
+	tree_timestamps_supported = device.get_device_properties().limits.timestampComputeAndGraphics;
+	if (tree_timestamps_supported) {
+		tree_timestamps.init(&device, TREE_TIMESTAMP_COUNT * MAX_FRAMES_IN_FLIGHT, "Tree timestamps");
+		cleanup_queue.add(&tree_timestamps);
+	}
 }
 
 void Engine::create_sync_structs()
@@ -1117,7 +1456,10 @@ bool Engine::aquire_image()
 
 	// Wait such that we are not still drawing into this frame (but we might not have presented it properly)
 	VkFence render_fence = get_current_render_fence();
-	VK_CHECK_E(vkWaitForFences(device, 1, &render_fence, VK_TRUE, UINT64_MAX), RuntimeException);
+	{
+		StartupWaitScope wait_scope{};
+		VK_CHECK_E(vkWaitForFences(device, 1, &render_fence, VK_TRUE, UINT64_MAX), RuntimeException);
+	}
 	
 	VkResult aquire_image_result = vkAcquireNextImageKHR(
 		device, 
@@ -1198,14 +1540,21 @@ Required_Device_Features Engine::get_required_device_features()
 	features.rf.fillModeNonSolid = true;
 	features.rf.tessellationShader = true;
 	features.rf.shaderInt64 = true;
+	features.rf.multiDrawIndirect = true; // one indirect draw for all materials of a mesh, see PBRMesh
+	// 1.1 features
+	features.rf11.shaderDrawParameters = true; // gl_DrawID
 	// 1.2 features
 	features.rf12.bufferDeviceAddress = true;
 	features.rf12.descriptorIndexing = true;
+	features.rf12.shaderSampledImageArrayNonUniformIndexing = true; // diffuse textures indexed by material
 	features.rf12.uniformBufferStandardLayout = true; // enable std430 for uniform buffers
+	features.rf12.timelineSemaphore = true; // hand off uploads from the transfer queue, see UploadBatcher
 	// 1.3 features
 	features.rf13.dynamicRendering = true;
 	features.rf13.synchronization2 = true;
 	features.rf13.shaderDemoteToHelperInvocation = true; // for discard in some shaders
+	// optional
+	features.optional.textureCompressionBC = true; // compressed textures if supported, see Texture::find_compressed_format
 
 	return features;
 }
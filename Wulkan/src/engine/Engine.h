@@ -27,6 +27,8 @@
 #include "vk_wrap/VKW_PushConstants.h"
 #include "vk_wrap/VKW_Sampler.h"
 #include "vk_wrap/VKW_GraphicsPipeline.h"
+#include "vk_wrap/VKW_PipelineCache.h"
+#include "vk_wrap/VKW_QueryPool.h"
 
 #include "DeletionQueue.h"
 #include "Texture.h"
@@ -38,7 +40,15 @@
 #include "DirectionalLight.h"
 #include "ObjMesh.h"
 #include "InstancedLODShape.h"
+#include "HiZPyramid.h"
 #include "ToneMapper.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+#include "UploadBatcher.h"
+#include "GeometryPool.h"
+#include "StartupProfiler.h"
+#include "RenderPassVariants.h"
+#include "ParallelRecorder.h"
 
 #include "Gui.h"
 
@@ -62,6 +72,15 @@ struct SyncStructs {
 	VkFence render_fence;
 };
 
+// timestamps written around the tree passes, TREE_TIMESTAMP_COUNT per frame in flight
+enum TreeTimestamp : uint32_t {
+	TREE_PREPASS_BEGIN = 0,
+	TREE_PREPASS_END,
+	TREE_PASS_BEGIN,
+	TREE_PASS_END,
+	TREE_TIMESTAMP_COUNT
+};
+
 class Engine
 {
 public:
@@ -69,7 +88,12 @@ public:
 	void init(unsigned int res_x, unsigned int res_y);
 	~Engine();
 	void run();
+
+	// closes the window once the first frame is done (and the startup trace is written)
+	void set_exit_after_startup(bool exit) { exit_after_startup = exit; };
 private:
+	bool exit_after_startup = false;
+
 	struct GLFWwindow* window;
 	unsigned int res_x, res_y;
 
@@ -88,6 +112,7 @@ private:
 	void draw();
 	void present();
 	void late_update(); // executed after draw
+	void finish_startup(); // ends the startup trace after the first frame
 
 	bool resize_window = false; // will execute resize to avoid issues with resources 
 
@@ -128,6 +153,8 @@ private:
 	VKW_Instance instance;
 	VKW_Surface surface;
 	VKW_Device device;
+	// shared by all graphics and compute pipelines, persisted between launches
+	VKW_PipelineCache pipeline_cache;
 
 	VKW_Queue graphics_queue;
 	VKW_Queue present_queue;
@@ -142,10 +169,10 @@ private:
 	Texture depth_render_target;
 
 
-	// mostly for debugging reasons
-	std::array<RenderPass<TerrainPushConstants, 3>, MAX_CASCADE_COUNT> terrain_render_passes;
+	// variants for different cascade counts and wireframe mode (mostly for debugging reasons), compiled once they are first used
+	RenderPassVariants<TerrainPipelineKey, TerrainPushConstants, 3> terrain_render_passes;
+	const TerrainPipelineKey default_terrain_pipeline{};
 	RenderPass<TerrainPushConstants, 3>  terrain_depth_render_pass;
-	std::array<RenderPass<TerrainPushConstants, 3>, MAX_CASCADE_COUNT> terrain_wireframe_render_passes;
 
 	RenderPass<EnvironmentMapPushConstants, 2> environment_render_pass;
 
@@ -154,6 +181,12 @@ private:
 	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> pbr_render_pass;
 	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> pbr_render_double_sided_pass;
 	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> pbr_depth_pass;
+	// alpha tested trees: camera depth first, then shading with early depth tests
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> pbr_depth_prepass;
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> pbr_prepassed_double_sided_pass;
+	// farthest lod of the trees, see Impostor
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> impostor_render_pass;
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> impostor_depth_pass;
 
 	// general sampler for texture (Linear sampling, repeat address mode)
 	VKW_Sampler nearest_texture_sampler;
@@ -197,6 +230,15 @@ private:
 	Texture texture_not_found;
 	std::array<ObjMesh, 4> meshes;
 	InstancedLODShape<ObjMesh> lod_mesh;
+	HiZPyramid hi_z; // of the terrain's depth, occlusion culls the trees
+
+	// gpu times of the tree depth prepass and the tree pass, read back once the render fence of their frame was waited on
+	VKW_QueryPool tree_timestamps;
+	bool tree_timestamps_supported = false;
+	std::array<bool, MAX_FRAMES_IN_FLIGHT> tree_prepass_timed{};
+	std::array<bool, MAX_FRAMES_IN_FLIGHT> tree_pass_timed{};
+	float tree_prepass_ms = 0.0f;
+	float tree_pass_ms = 0.0f;
 
 	ToneMapper tone_mapper;
 
@@ -211,6 +253,17 @@ private:
 	unsigned int current_swapchain_image_idx;
 	DeletionQueue cleanup_queue;
 
+	// workers for cpu heavy loading tasks
+	ThreadPool thread_pool;
+	// records the passes of a frame into secondary command buffers on the workers
+	ParallelRecorder parallel_recorder;
+	// decodes material textures on the workers and uploads them while rendering
+	TextureStreamer texture_streamer;
+	// batches the buffer and texture uploads during init_data
+	UploadBatcher uploader;
+	// vertices and indices of all meshes
+	GeometryPool geometry_pool;
+
 	std::recursive_mutex glfw_input_mutex; // needs to be locked to read/write to Camera and Camera Controller
 	CameraController camera_controller;
 	Camera camera;
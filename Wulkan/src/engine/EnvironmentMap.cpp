@@ -1,11 +1,11 @@
 #include "common.h"
 #include "EnvironmentMap.h"
 
-void EnvironmentMap::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<EnvironmentMapPushConstants, 2>& render_pass, const VKW_Path& path)
+void EnvironmentMap::init(const VKW_Device& device, UploadBatcher& uploader, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<EnvironmentMapPushConstants, 2>& render_pass, const VKW_Path& path, ThreadPool* thread_pool)
 {
 	material.init(device, descriptor_pool, render_pass, { EnvironmentMap::descriptor_set_layout }, {1}, "Environment map Material");
 
-	cube_map = create_cube_map_from_path(&device, &graphics_pool, path, Tex_HDR_RGBA, "Environment map");
+	cube_map = create_cube_map_from_path(&device, uploader, path, Tex_HDR_RGB, "Environment map", thread_pool);
 
 	// does not have correct normals or uv's as those are not used in the environment map shader
 	std::vector<Vertex> cube_vertices = {
@@ -41,7 +41,7 @@ void EnvironmentMap::init(const VKW_Device& device, const VKW_CommandPool& graph
 
 	};
 
-	Mesh::init(device, transfer_pool, cube_vertices, cube_indices);
+	Mesh::init(geometry, cube_vertices, cube_indices);
 }
 
 void EnvironmentMap::set_descriptor_bindings(const VKW_Sampler& texture_sampler)
@@ -53,7 +53,7 @@ void EnvironmentMap::set_descriptor_bindings(const VKW_Sampler& texture_sampler)
 	}
 }
 
-RenderPass<EnvironmentMapPushConstants, 2> EnvironmentMap::create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 2>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count)
+RenderPass<EnvironmentMapPushConstants, 2> EnvironmentMap::create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 2>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count)
 {
 	RenderPass<EnvironmentMapPushConstants, 2> render_pass{};
 
@@ -84,7 +84,7 @@ RenderPass<EnvironmentMapPushConstants, 2> EnvironmentMap::create_render_pass(co
 
 	graphics_pipeline.set_sample_count(sample_count);
 
-	graphics_pipeline.init(device, "Environment graphics pipeline");
+	graphics_pipeline.init(device, "Environment graphics pipeline", &pipeline_cache);
 
 	vert_shader.del();
 	frag_shader.del();
@@ -4,6 +4,7 @@
 #include "Shape.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "ThreadPool.h"
 #include "vk_wrap/VKW_Sampler.h"
 
 #include "vk_wrap/VKW_GraphicsPipeline.h"
@@ -17,14 +18,17 @@ class EnvironmentMap : public Mesh
 {
 public:
 	EnvironmentMap() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<EnvironmentMapPushConstants, 2>& render_pass, const VKW_Path& path);
+	void init(const VKW_Device& device, UploadBatcher& uploader, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<EnvironmentMapPushConstants, 2>& render_pass, const VKW_Path& path, ThreadPool* thread_pool);
 	void set_descriptor_bindings(const VKW_Sampler& texture_sampler);
 	void del() override;
 
-	static RenderPass<EnvironmentMapPushConstants, 2> create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 2>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count);
+	static RenderPass<EnvironmentMapPushConstants, 2> create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 2>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count);
 	static VKW_DescriptorSetLayout create_descriptor_set_layout(const VKW_Device& device);
 
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
+
+	// mip levels are prefiltered for specular image based lighting, see prefilter_cube_map
+	inline const Texture& get_cube_map() const { return cube_map; };
 private:
 	Texture cube_map;
 	VKW_Sampler sampler;
@@ -33,7 +37,7 @@ private:
 	MaterialInstance< EnvironmentMapPushConstants, 1> material;
 };
 
-inline void EnvironmentMap::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void EnvironmentMap::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int)
 {
 	material.bind(
 		command_buffer,
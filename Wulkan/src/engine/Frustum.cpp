@@ -1,7 +1,7 @@
 #include "common.h"
 #include "Frustum.h"
 
-void Frustum::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass , glm::mat4 proj_view_mat, glm::vec4 color)
+void Frustum::init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass , glm::mat4 proj_view_mat, glm::vec4 color)
 {
 	points.resize(8);
 	
@@ -23,7 +23,7 @@ void Frustum::init(const VKW_Device& device, const VKW_CommandPool& transfer_poo
 		color,
 	};
 
-	Line::init(device, transfer_pool, descriptor_pool, render_pass, points, indices, colors);
+	Line::init(device, geometry, descriptor_pool, render_pass, points, indices, colors);
 	set_camera_matrix(proj_view_mat);
 }
 
@@ -40,3 +40,24 @@ void Frustum::set_camera_matrix(glm::mat4 proj_view_mat)
 
 	update_vertices(points);
 }
+
+FrustumPlanes Frustum::extract_planes(const glm::mat4& proj_view_mat)
+{
+	// rows of the matrix, glm is column major
+	glm::mat4 m = glm::transpose(proj_view_mat);
+
+	FrustumPlanes planes = {
+		m[3] + m[0], // left:   -w <= x
+		m[3] - m[0], // right:   x <= w
+		m[3] + m[1], // bottom: -w <= y
+		m[3] - m[1], // top:     y <= w
+		m[2],        // near:    0 <= z
+		m[3] - m[2], // far:     z <= w
+	};
+
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
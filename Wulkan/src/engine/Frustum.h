@@ -2,12 +2,17 @@
 
 #include "Line.h"
 
+// planes of a view volume in world space, xyz is the normal (pointing inside) and w the distance
+// order: left, right, bottom, top, near, far. All zero planes contain everything
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
 // visualize a camera's frustum
+
 class Frustum : public Line
 {
 public:
 	Frustum() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, glm::mat4 proj_view_mat, glm::vec4 color);
+	void init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, glm::mat4 proj_view_mat, glm::vec4 color);
 private:
 	const glm::vec3 frustum_NDC[8] = {
 		glm::vec3(-1.0f,  1.0f, 0.0f),
@@ -23,5 +28,8 @@ private:
 	std::vector<glm::vec3> points;
 public:
 	void set_camera_matrix(glm::mat4 proj_view_mat);
+
+	// extracts the normalized planes of a perspective or orthographic proj_view_mat with depth in [0, 1] (Gribb and Hartmann)
+	static FrustumPlanes extract_planes(const glm::mat4& proj_view_mat);
 };
 
@@ -0,0 +1,252 @@
+#include "common.h"
+#include "GPUInstanceCulling.h"
+
+static VkDeviceAddress get_buffer_address(const VKW_Device& device, const VKW_Buffer& buffer)
+{
+	VkBufferDeviceAddressInfo address_info{};
+	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	address_info.buffer = buffer;
+	return vkGetBufferDeviceAddress(device, &address_info);
+}
+
+void GPUInstanceCulling::init(const VKW_Device* vkw_device, UploadBatcher& uploader, const VKW_PipelineCache& pipeline_cache, const HiZPyramid& hiz, std::span<const InstanceData> instances, std::span<const VkDrawIndexedIndirectCommand> draws, std::span<const uint32_t> lod_draw_counts)
+{
+	device = vkw_device;
+	m_hiz = &hiz;
+
+	if (instances.empty() || lod_draw_counts.empty() || lod_draw_counts.size() > MAX_GPU_CULLING_LODS) {
+		throw RuntimeException(fmt::format("Tried to initialize GPUInstanceCulling with {} instances and {} lods", instances.size(), lod_draw_counts.size()), __FILE__, __LINE__);
+	}
+
+	m_instance_count = static_cast<uint32_t>(instances.size());
+	m_lod_count = static_cast<uint32_t>(lod_draw_counts.size());
+	m_draw_count = static_cast<uint32_t>(draws.size());
+
+	std::vector<GPUCullingDraw> culling_draws{};
+	m_lod_first_draws.clear();
+	for (uint32_t lod = 0; lod < m_lod_count; lod++) {
+		m_lod_first_draws.push_back(static_cast<uint32_t>(culling_draws.size()));
+		for (uint32_t i = 0; i < lod_draw_counts[lod]; i++) {
+			const VkDrawIndexedIndirectCommand& draw = draws[culling_draws.size()];
+			culling_draws.push_back({ draw.indexCount, draw.firstIndex, lod });
+		}
+	}
+	assert(culling_draws.size() == draws.size() && "lod_draw_counts have to add up to the number of draws");
+
+	m_instance_buffer.init(
+		device,
+		sizeof(InstanceData) * instances.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		sharing_exlusive(),
+		Mapping::NotMapped,
+		"GPU culling instance buffer"
+	);
+	uploader.upload(m_instance_buffer, instances.data(), sizeof(InstanceData) * instances.size());
+
+	m_draw_buffer.init(
+		device,
+		sizeof(GPUCullingDraw) * culling_draws.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		sharing_exlusive(),
+		Mapping::NotMapped,
+		"GPU culling draw buffer"
+	);
+	uploader.upload(m_draw_buffer, culling_draws.data(), sizeof(GPUCullingDraw) * culling_draws.size());
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_param_buffers[i].init(
+			device,
+			sizeof(GPUCullingParams),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			sharing_exlusive(),
+			Mapping::Persistent,
+			fmt::format("GPU culling param buffer {}", i)
+		);
+
+		m_counter_buffers[i].init(
+			device,
+			sizeof(uint32_t) * (OCCLUDED_COUNTER + 1),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			sharing_exlusive(),
+			Mapping::NotMapped,
+			fmt::format("GPU culling counter buffer {}", i)
+		);
+
+		m_culled_instance_buffers[i].init(
+			device,
+			sizeof(InstanceData) * m_instance_count * m_lod_count * MAX_INSTANCE_VIEWS,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			sharing_exlusive(),
+			Mapping::NotMapped,
+			fmt::format("GPU culling culled instance buffer {}", i)
+		);
+
+		m_command_buffers[i].init(
+			device,
+			sizeof(VkDrawIndexedIndirectCommand) * m_draw_count * MAX_INSTANCE_VIEWS,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			sharing_exlusive(),
+			Mapping::NotMapped,
+			fmt::format("GPU culling command buffer {}", i)
+		);
+
+		m_readback_buffers[i].init(
+			device,
+			sizeof(uint32_t),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			sharing_exlusive(),
+			Mapping::Mapped,
+			fmt::format("GPU culling readback buffer {}", i)
+		);
+		m_occlusion_recorded[i] = false;
+
+		m_push_constants[i] = {
+			get_buffer_address(*device, m_param_buffers[i]),
+			get_buffer_address(*device, m_instance_buffer),
+			get_buffer_address(*device, m_counter_buffers[i]),
+			get_buffer_address(*device, m_culled_instance_buffers[i]),
+			get_buffer_address(*device, m_draw_buffer),
+			get_buffer_address(*device, m_command_buffers[i]),
+			0,
+			0
+		};
+	}
+
+	m_push_constant.init(VK_SHADER_STAGE_COMPUTE_BIT);
+
+	// the hi-z pyramid has to be bound for every dispatch, as the shader reads it
+	m_cull_pipeline.add_descriptor_sets({ hiz.get_descriptor_set_layout() });
+	m_cull_pipeline.add_push_constant(m_push_constant);
+	m_cull_pipeline.init(device, "shaders/culling/instance_cull_comp.spv", "Instance culling pipeline", &pipeline_cache);
+
+	m_command_pipeline.add_push_constant(m_push_constant);
+	m_command_pipeline.init(device, "shaders/culling/write_draw_commands_comp.spv", "Culled draw commands pipeline", &pipeline_cache);
+}
+
+void GPUInstanceCulling::del()
+{
+	m_command_pipeline.del();
+	m_cull_pipeline.del();
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_readback_buffers[i].del();
+		m_command_buffers[i].del();
+		m_culled_instance_buffers[i].del();
+		m_counter_buffers[i].del();
+		m_param_buffers[i].del();
+	}
+
+	m_draw_buffer.del();
+	m_instance_buffer.del();
+}
+
+void GPUInstanceCulling::update(uint32_t current_frame, const CullingParams& params, float bounding_radius, std::span<const FrustumPlanes> cascade_planes, const glm::mat4* occlusion_view_proj)
+{
+	assert(cascade_planes.size() < MAX_INSTANCE_VIEWS && "More cascades than instance views");
+	assert(params.lod_ratios.size() == m_lod_count && "Needs one ratio per lod");
+
+	// the render fence of current_frame was waited on, so its counters are final
+	if (m_occlusion_recorded[current_frame]) {
+		m_readback_buffers[current_frame].copy_from(&m_occluded_count, sizeof(uint32_t));
+	}
+	else {
+		m_occluded_count = 0;
+	}
+
+	m_view_count = static_cast<uint32_t>(cascade_planes.size()) + 1;
+	m_occlusion = occlusion_view_proj != nullptr;
+	m_occlusion_recorded[current_frame] = m_occlusion;
+
+	GPUCullingParams gpu_params{};
+	std::copy(params.planes.begin(), params.planes.end(), gpu_params.planes);
+	for (size_t i = 0; i < cascade_planes.size(); i++) {
+		std::copy(cascade_planes[i].begin(), cascade_planes[i].end(), gpu_params.planes + 6 * (i + 1));
+	}
+	gpu_params.offset = glm::vec4(params.offset, bounding_radius);
+	gpu_params.camera_position = glm::vec4(params.camera_position, params.near_plane);
+	gpu_params.camera_direction = glm::vec4(params.camera_direction, params.far_plane);
+	std::copy(params.lod_ratios.begin(), params.lod_ratios.end(), gpu_params.lod_ratios);
+	gpu_params.view_count = m_view_count;
+	gpu_params.lod_count = m_lod_count;
+	gpu_params.instance_count = m_instance_count;
+	gpu_params.draw_count = m_draw_count;
+	if (m_occlusion) {
+		gpu_params.occlusion_view_proj = *occlusion_view_proj;
+		gpu_params.hiz_size = { m_hiz->get_extent().width, m_hiz->get_extent().height };
+		gpu_params.hiz_levels = m_hiz->get_levels();
+		gpu_params.occlusion = 1;
+	}
+
+	m_param_buffers[current_frame].copy_into(&gpu_params, sizeof(GPUCullingParams));
+}
+
+void GPUInstanceCulling::record(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const
+{
+	// all buffers written here are per frame, their last use was waited on with the frame's fence
+	vkCmdFillBuffer(command_buffer, m_counter_buffers[current_frame], 0, VK_WHOLE_SIZE, 0);
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+	);
+
+	// with occlusion culling the camera is culled in record_occlusion, its counters stay zero until then
+	uint32_t first_view = m_occlusion ? 1 : 0;
+	if (first_view < m_view_count) {
+		record_views(command_buffer, current_frame, first_view, m_view_count - first_view);
+	}
+
+	// barriers also order later submissions to the same queue, so this covers the draws of all passes
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	);
+}
+
+void GPUInstanceCulling::record_occlusion(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const
+{
+	if (!m_occlusion) {
+		return;
+	}
+
+	record_views(command_buffer, current_frame, 0, 1);
+
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT
+	);
+
+	VkBufferCopy copy_region{};
+	copy_region.srcOffset = sizeof(uint32_t) * OCCLUDED_COUNTER;
+	copy_region.dstOffset = 0;
+	copy_region.size = sizeof(uint32_t);
+	vkCmdCopyBuffer(command_buffer, m_counter_buffers[current_frame], m_readback_buffers[current_frame], 1, &copy_region);
+
+	// read on the host after the render fence
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT
+	);
+}
+
+void GPUInstanceCulling::record_views(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, uint32_t first_view, uint32_t view_count) const
+{
+	GPUCullingPushConstants push_constants = m_push_constants[current_frame];
+	push_constants.first_view = first_view;
+	push_constants.view_count = view_count;
+
+	m_cull_pipeline.bind(command_buffer);
+	m_hiz->get_descriptor_set().bind(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline.get_layout());
+	m_push_constant.push(command_buffer, m_cull_pipeline.get_layout(), push_constants);
+	m_cull_pipeline.dispatch(command_buffer, (m_instance_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// final counts
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	);
+
+	m_command_pipeline.bind(command_buffer);
+	m_push_constant.push(command_buffer, m_command_pipeline.get_layout(), push_constants);
+	m_command_pipeline.dispatch(command_buffer, (view_count * m_draw_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_Buffer.h"
+#include "vk_wrap/VKW_CommandBuffer.h"
+#include "vk_wrap/VKW_ComputePipeline.h"
+#include "vk_wrap/VKW_PushConstants.h"
+#include "vk_wrap/VKW_PipelineCache.h"
+
+#include "InstanceCulling.h"
+#include "HiZPyramid.h"
+#include "UploadBatcher.h"
+
+#include <span>
+
+// has to match culling_common.shader
+constexpr uint32_t MAX_GPU_CULLING_LODS = 8;
+// counter after the instance counts of all lods and views
+constexpr uint32_t OCCLUDED_COUNTER = MAX_GPU_CULLING_LODS * MAX_INSTANCE_VIEWS;
+
+// written every frame, read by the culling shaders through its address
+struct GPUCullingParams {
+	alignas(16) glm::vec4 planes[MAX_INSTANCE_VIEWS * 6];
+	alignas(16) glm::vec4 offset;           // w: bounding radius
+	alignas(16) glm::vec4 camera_position;  // w: near plane
+	alignas(16) glm::vec4 camera_direction; // w: far plane
+	alignas(4) float lod_ratios[MAX_GPU_CULLING_LODS];
+	alignas(4) uint32_t view_count;
+	alignas(4) uint32_t lod_count;
+	alignas(4) uint32_t instance_count;
+	alignas(4) uint32_t draw_count;
+	alignas(16) glm::mat4 occlusion_view_proj; // camera the hi-z pyramid was rendered with
+	alignas(8) glm::uvec2 hiz_size;
+	alignas(4) uint32_t hiz_levels;
+	alignas(4) uint32_t occlusion;             // tests view 0 against the hi-z pyramid if not 0
+};
+
+// indirect command of one draw of a lod, without its instance count
+struct GPUCullingDraw {
+	alignas(4) uint32_t index_count;
+	alignas(4) uint32_t first_index;
+	alignas(4) uint32_t lod;
+};
+
+struct GPUCullingPushConstants {
+	alignas(8) VkDeviceAddress params;
+	alignas(8) VkDeviceAddress instances;
+	alignas(8) VkDeviceAddress counters;
+	alignas(8) VkDeviceAddress culled_instances;
+	alignas(8) VkDeviceAddress draws;
+	alignas(8) VkDeviceAddress commands;
+	alignas(4) uint32_t first_view; // views handled by a dispatch
+	alignas(4) uint32_t view_count;
+};
+
+// Culls static instances and selects their lod in compute shaders (see shaders/culling), the gpu counterpart of cull_instances
+// The visible instances of each lod and view (see MAX_INSTANCE_VIEWS) are compacted into their own range of the culled instances with atomics,
+// then the indirect commands of every lod and view are written with the resulting instance counts.
+// The instances are uploaded once, per frame only the parameters are written, so the cpu cost does not depend on the instance count.
+// With occlusion culling the camera's instances are culled later, after the hi-z pyramid of the frame was built (see record_occlusion).
+class GPUInstanceCulling : public VKW_Object
+{
+public:
+	GPUInstanceCulling() = default;
+	// draws holds the indirect commands of all lods after each other, lod_draw_counts how many each lod has (see PBRMesh::get_draw_commands)
+	void init(const VKW_Device* vkw_device, UploadBatcher& uploader, const VKW_PipelineCache& pipeline_cache, const HiZPyramid& hiz, std::span<const InstanceData> instances, std::span<const VkDrawIndexedIndirectCommand> draws, std::span<const uint32_t> lod_draw_counts);
+	void del() override;
+
+	// params.planes cull view 0 (the camera), cascade_planes the views after it
+	// view 0 is also occlusion culled if occlusion_view_proj (the camera the hi-z pyramid is rendered with) is given, then record_occlusion has to be recorded as well
+	void update(uint32_t current_frame, const CullingParams& params, float bounding_radius, std::span<const FrustumPlanes> cascade_planes, const glm::mat4* occlusion_view_proj = nullptr);
+
+	// records the culling, has to be submitted to the queue drawing the instances before the draws
+	void record(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const;
+	// records the occlusion culling of view 0 after the hi-z pyramid, has to come before the draws of view 0. Records nothing without occlusion culling
+	void record_occlusion(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const;
+private:
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+	const VKW_Device* device = nullptr;
+	const HiZPyramid* m_hiz = nullptr;
+
+	uint32_t m_instance_count = 0;
+	uint32_t m_lod_count = 0;
+	uint32_t m_draw_count = 0;
+	uint32_t m_view_count = 1;
+	bool m_occlusion = false;
+	// of the last frame read back
+	uint32_t m_occluded_count = 0;
+	std::array<bool, MAX_FRAMES_IN_FLIGHT> m_occlusion_recorded{};
+	std::vector<uint32_t> m_lod_first_draws;
+
+	VKW_Buffer m_instance_buffer;
+	VKW_Buffer m_draw_buffer; // GPUCullingDraw of every draw
+
+	// written by the culling of a frame
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_param_buffers;
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_counter_buffers;          // instance count per lod and view, then the occluded instances
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_culled_instance_buffers;  // m_instance_count instances per lod and view
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_command_buffers;          // VkDrawIndexedIndirectCommand of every draw per view
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_readback_buffers;         // occluded instances, read once the frame is done
+	std::array<GPUCullingPushConstants, MAX_FRAMES_IN_FLIGHT> m_push_constants{};
+
+	VKW_PushConstant<GPUCullingPushConstants> m_push_constant;
+	VKW_ComputePipeline m_cull_pipeline;
+	VKW_ComputePipeline m_command_pipeline;
+
+	// culls and writes the commands of the views [first_view, first_view + view_count)
+	void record_views(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, uint32_t first_view, uint32_t view_count) const;
+public:
+	// commands of lod drawing its instances of view, the number of commands is the lod's draw count
+	inline VkBuffer get_command_buffer(uint32_t current_frame) const { return m_command_buffers[current_frame]; };
+	inline VkDeviceSize get_command_offset(uint32_t lod, uint32_t view) const { return sizeof(VkDrawIndexedIndirectCommand) * (view * m_draw_count + m_lod_first_draws[lod]); };
+	inline VkDeviceAddress get_instance_address(uint32_t current_frame, uint32_t lod, uint32_t view) const { return m_push_constants[current_frame].culled_instances + sizeof(InstanceData) * m_instance_count * (lod * MAX_INSTANCE_VIEWS + view); };
+	// instances culled by the hi-z pyramid MAX_FRAMES_IN_FLIGHT frames ago (the last finished one), 0 without occlusion culling
+	inline uint32_t get_occluded_count() const { return m_occluded_count; };
+};
@@ -0,0 +1,157 @@
+#include "common.h"
+#include "GeometryPool.h"
+
+#include "Mesh.h"
+
+void FreeListAllocator::init(uint32_t capacity)
+{
+	m_capacity = capacity;
+	m_used = 0;
+	m_free_blocks.clear();
+	if (capacity > 0) {
+		m_free_blocks[0] = capacity;
+	}
+}
+
+bool FreeListAllocator::allocate(uint32_t count, uint32_t& offset)
+{
+	if (count == 0) {
+		offset = 0;
+		return true;
+	}
+
+	for (auto it = m_free_blocks.begin(); it != m_free_blocks.end(); it++) {
+		if (it->second < count) {
+			continue;
+		}
+
+		offset = it->first;
+		uint32_t remaining = it->second - count;
+		m_free_blocks.erase(it);
+		if (remaining > 0) {
+			m_free_blocks[offset + count] = remaining;
+		}
+
+		m_used += count;
+		return true;
+	}
+	return false;
+}
+
+void FreeListAllocator::free(uint32_t offset, uint32_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	assert(offset + count <= m_capacity && "Tried to free range outside of free list");
+	m_used -= count;
+
+	auto next = m_free_blocks.lower_bound(offset);
+	assert((next == m_free_blocks.end() || offset + count <= next->first) && "Tried to free range that is already free");
+
+	// merge with the following block
+	if (next != m_free_blocks.end() && offset + count == next->first) {
+		count += next->second;
+		next = m_free_blocks.erase(next);
+	}
+
+	// merge with the preceding block
+	if (next != m_free_blocks.begin()) {
+		auto prev = std::prev(next);
+		assert(prev->first + prev->second <= offset && "Tried to free range that is already free");
+		if (prev->first + prev->second == offset) {
+			prev->second += count;
+			return;
+		}
+	}
+
+	m_free_blocks[offset] = count;
+}
+
+void GeometryPool::init(const VKW_Device* vkw_device, UploadBatcher* uploader, uint32_t vertex_capacity, uint32_t index_capacity, const std::string& obj_name)
+{
+	device = vkw_device;
+	m_uploader = uploader;
+	m_name = obj_name;
+
+	m_vertex_buffer.init(
+		device,
+		sizeof(Vertex) * static_cast<VkDeviceSize>(vertex_capacity),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		sharing_exlusive(),
+		Mapping::NotMapped,
+		fmt::format("{} vertex buffer", m_name)
+	);
+
+	m_index_buffer.init(
+		device,
+		sizeof(uint32_t) * static_cast<VkDeviceSize>(index_capacity),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		sharing_exlusive(),
+		Mapping::NotMapped,
+		fmt::format("{} index buffer", m_name)
+	);
+
+	VkBufferDeviceAddressInfo address_info{};
+	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	address_info.buffer = m_vertex_buffer;
+	m_vertex_buffer_address = vkGetBufferDeviceAddress(*device, &address_info);
+
+	m_vertex_allocator.init(vertex_capacity);
+	m_index_allocator.init(index_capacity);
+}
+
+void GeometryPool::del()
+{
+	m_vertex_buffer.del();
+	m_index_buffer.del();
+	m_vertex_buffer_address = 0;
+}
+
+GeometryRange GeometryPool::add_vertices(std::span<const Vertex> vertices)
+{
+	GeometryRange range{ 0, static_cast<uint32_t>(vertices.size()) };
+	if (!m_vertex_allocator.allocate(range.count, range.offset)) {
+		throw RuntimeException(fmt::format("{} is out of vertex memory ({} of {} vertices used, {} requested)",
+			m_name, m_vertex_allocator.get_used(), m_vertex_allocator.get_capacity(), range.count), __FILE__, __LINE__);
+	}
+
+	if (range.count > 0) {
+		m_uploader->upload(m_vertex_buffer, vertices.data(), sizeof(Vertex) * vertices.size(), sizeof(Vertex) * static_cast<VkDeviceSize>(range.offset));
+	}
+	return range;
+}
+
+GeometryRange GeometryPool::add_indices(std::span<const uint32_t> indices)
+{
+	GeometryRange range{ 0, static_cast<uint32_t>(indices.size()) };
+	if (!m_index_allocator.allocate(range.count, range.offset)) {
+		throw RuntimeException(fmt::format("{} is out of index memory ({} of {} indices used, {} requested)",
+			m_name, m_index_allocator.get_used(), m_index_allocator.get_capacity(), range.count), __FILE__, __LINE__);
+	}
+
+	if (range.count > 0) {
+		m_uploader->upload(m_index_buffer, indices.data(), sizeof(uint32_t) * indices.size(), sizeof(uint32_t) * static_cast<VkDeviceSize>(range.offset));
+	}
+	return range;
+}
+
+void GeometryPool::free_vertices(const GeometryRange& range)
+{
+	m_vertex_allocator.free(range.offset, range.count);
+}
+
+void GeometryPool::free_indices(const GeometryRange& range)
+{
+	m_index_allocator.free(range.offset, range.count);
+}
+
+void GeometryPool::bind_index_buffer(const VKW_CommandBuffer& command_buffer) const
+{
+	vkCmdBindIndexBuffer(command_buffer, m_index_buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+VkDeviceAddress GeometryPool::get_vertex_address(const GeometryRange& vertices) const
+{
+	return m_vertex_buffer_address + sizeof(Vertex) * static_cast<VkDeviceSize>(vertices.offset);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_CommandBuffer.h"
+#include "vk_wrap/VKW_Buffer.h"
+
+#include "UploadBatcher.h"
+
+#include <map>
+#include <span>
+
+struct Vertex;
+
+// range of elements (vertices or indices) inside one of the buffers of a GeometryPool
+struct GeometryRange {
+	uint32_t offset = 0;
+	uint32_t count = 0;
+};
+
+// first fit free list over a range of elements, neighbouring free blocks are merged again when freed
+class FreeListAllocator
+{
+public:
+	FreeListAllocator() = default;
+	void init(uint32_t capacity);
+
+	// false if there is no free block large enough
+	bool allocate(uint32_t count, uint32_t& offset);
+	void free(uint32_t offset, uint32_t count);
+private:
+	std::map<uint32_t, uint32_t> m_free_blocks; // offset -> count
+	uint32_t m_capacity = 0;
+	uint32_t m_used = 0;
+public:
+	inline uint32_t get_capacity() const { return m_capacity; };
+	inline uint32_t get_used() const { return m_used; };
+};
+
+// One device local vertex and one index buffer shared by all meshes of the scene
+// Meshes only keep their ranges: vertices are addressed through get_vertex_address (vertex pulling) and the indices of a mesh
+// start at its first index in the shared index buffer, which is bound once per command buffer (see bind_index_buffer).
+// Data is uploaded through the uploader, so it is usable once that is flushed (see UploadBatcher).
+// Ranges must not be freed while they might still be used by the GPU. Not thread safe
+class GeometryPool : public VKW_Object
+{
+public:
+	GeometryPool() = default;
+	void init(const VKW_Device* vkw_device, UploadBatcher* uploader, uint32_t vertex_capacity, uint32_t index_capacity, const std::string& obj_name);
+	void del() override;
+
+	// allocates a range and records the upload of the data, throws a RuntimeException if the pool is full
+	GeometryRange add_vertices(std::span<const Vertex> vertices);
+	GeometryRange add_indices(std::span<const uint32_t> indices);
+
+	void free_vertices(const GeometryRange& range);
+	void free_indices(const GeometryRange& range);
+
+	// indices of all meshes are uint32 relative to the vertex address of their mesh
+	void bind_index_buffer(const VKW_CommandBuffer& command_buffer) const;
+	VkDeviceAddress get_vertex_address(const GeometryRange& vertices) const;
+private:
+	const VKW_Device* device = nullptr;
+	UploadBatcher* m_uploader = nullptr;
+	std::string m_name;
+
+	VKW_Buffer m_vertex_buffer;
+	VKW_Buffer m_index_buffer;
+	VkDeviceAddress m_vertex_buffer_address = 0;
+
+	FreeListAllocator m_vertex_allocator;
+	FreeListAllocator m_index_allocator;
+public:
+	inline const VKW_Buffer& get_vertex_buffer() const { return m_vertex_buffer; };
+	inline const VKW_Buffer& get_index_buffer() const { return m_index_buffer; };
+	inline uint32_t get_vertex_count() const { return m_vertex_allocator.get_used(); };
+	inline uint32_t get_index_count() const { return m_index_allocator.get_used(); };
+};
@@ -142,6 +142,13 @@ void GUI::draw_gui(const VKW_CommandBuffer& cmd)
 			ImGui::SliderFloat("Sun Intensity", &m_data.sun_intensity, 0.1f, 25.0f);
 
 			ImGui::Checkbox("Draw Trees", &m_data.draw_trees);
+			ImGui::Checkbox("Cull Trees", &m_data.cull_trees);
+			ImGui::Checkbox("Cull Trees on GPU", &m_data.gpu_cull_trees);
+			ImGui::Checkbox("Occlusion Cull Trees", &m_data.occlusion_cull_trees);
+			ImGui::Checkbox("Depth Prepass for Trees", &m_data.tree_depth_prepass);
+			ImGui::SameLine();
+			ImGui::Text("prepass %.3f ms, trees %.3f ms", m_stats.tree_prepass_ms, m_stats.tree_pass_ms);
+			ImGui::Checkbox("Tree Impostors", &m_data.tree_impostors);
 
 			if (ImGui::TreeNode("Tone mapper")) {
 				constexpr const char* tone_mapper_modes[] = { "None", "Rheinhard", "Extended Rheinhard", "Uncharted", "ACES", "AgX"};
@@ -186,12 +193,16 @@ void GUI::draw_gui(const VKW_CommandBuffer& cmd)
 			if (ImGui::TreeNode("LOD")) {
 				ImGui::SliderFloat("Distance ratio LOD 0", &m_data.lod_ratios[0], 0, m_data.lod_ratios[1]);
 				ImGui::SliderFloat("Distance ratio LOD 1", &m_data.lod_ratios[1], m_data.lod_ratios[0], m_data.lod_ratios[2]);
-				ImGui::SliderFloat("Distance ratio LOD 2", &m_data.lod_ratios[2], m_data.lod_ratios[1], 1);
+				ImGui::SliderFloat("Distance ratio LOD 2", &m_data.lod_ratios[2], m_data.lod_ratios[1], m_data.lod_ratios[3]);
+				ImGui::SliderFloat("Distance ratio LOD 3", &m_data.lod_ratios[3], m_data.lod_ratios[2], 1);
 				ImGui::TreePop();
 			}
 		}
 
+		ImGui::Checkbox("Parallel command recording", &m_data.parallel_recording);
+
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		ImGui::Text("Occlusion culled trees: %u", m_stats.occluded_trees);
 	}
 	ImGui::End();
 
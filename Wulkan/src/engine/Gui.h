@@ -50,14 +50,29 @@ struct GUI_Input {
 	VisualizationMode pbr_vis_mode = VisualizationMode::Shaded;
 	ShadowMode shadow_mode = ShadowMode::SoftShadows;
 
-	std::array<float, 3> lod_ratios{0.25, 0.5, 0.75};
+	std::array<float, 4> lod_ratios{0.25, 0.5, 0.75, 0.9};
 
 	bool draw_trees = true;
+	bool cull_trees = true; // frustum culling of the tree instances, shadow casters are culled per cascade
+	bool gpu_cull_trees = true; // culls and selects the lods of the trees in compute shaders instead of on the cpu
+	bool occlusion_cull_trees = true; // additionally culls the trees hidden by the terrain, only on the gpu
+	bool tree_depth_prepass = true; // draws the depth of the alpha tested trees first, so they are shaded once per pixel
+	bool tree_impostors = true; // replaces the trees beyond the last distance ratio by billboards of their baked views
+
+	bool parallel_recording = true; // records passes into secondary command buffers on the workers
 
 	ToneMapperMode tone_mapper_mode = ToneMapperMode::Rheinhard;
 	float luminance_white_point = 1.0;
 };
 
+// shown by the gui, written by the engine
+struct GUI_Stats {
+	uint32_t occluded_trees = 0;
+	// gpu times of the last finished frame
+	float tree_prepass_ms = 0.0f;
+	float tree_pass_ms = 0.0f;
+};
+
 class GUI : public VKW_Object
 {
 public:
@@ -73,9 +88,11 @@ private:
 	std::recursive_mutex* m_camera_recursive_mutex = nullptr;
 
 	GUI_Input m_data;
+	GUI_Stats m_stats;
 
 	void draw_gui(const VKW_CommandBuffer& cmd);
 public:
 	inline const GUI_Input& get_input() const { return m_data; };
+	inline void set_stats(const GUI_Stats& stats) { m_stats = stats; };
 };
 
@@ -0,0 +1,136 @@
+#include "common.h"
+#include "HiZPyramid.h"
+
+#include <bit>
+
+void HiZPyramid::init(const VKW_Device* vkw_device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool, const VKW_PipelineCache& pipeline_cache, const Texture& depth_target, const VKW_Sampler& sampler)
+{
+	device = vkw_device;
+	m_sampler = &sampler;
+
+	// source (depth target or previous level)
+	m_reduce_layout.add_binding(
+		0,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_SHADER_STAGE_COMPUTE_BIT
+	);
+	// level to write
+	m_reduce_layout.add_binding(
+		1,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		VK_SHADER_STAGE_COMPUTE_BIT
+	);
+	m_reduce_layout.init(device, "Hi-Z reduce desc layout");
+
+	m_descriptor_set_layout.add_binding(
+		0,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_SHADER_STAGE_COMPUTE_BIT
+	);
+	m_descriptor_set_layout.init(device, "Hi-Z desc layout");
+
+	for (uint32_t i = 0; i < MAX_LEVELS; i++) {
+		m_reduce_sets[i].init(device, &descriptor_pool, m_reduce_layout, fmt::format("Hi-Z reduce desc set {}", i));
+	}
+	m_descriptor_set.init(device, &descriptor_pool, m_descriptor_set_layout, "Hi-Z desc set");
+
+	m_push_constant.init(VK_SHADER_STAGE_COMPUTE_BIT);
+
+	// multisampled depth targets are read with a sampler2DMS
+	VKW_Path depth_shader = depth_target.get_samples() != VK_SAMPLE_COUNT_1_BIT ? "shaders/culling/hiz_depth_ms_comp.spv" : "shaders/culling/hiz_depth_comp.spv";
+	m_depth_pipeline.add_descriptor_sets({ m_reduce_layout });
+	m_depth_pipeline.add_push_constant(m_push_constant);
+	m_depth_pipeline.init(device, depth_shader, "Hi-Z depth pipeline", &pipeline_cache);
+
+	m_reduce_pipeline.add_descriptor_sets({ m_reduce_layout });
+	m_reduce_pipeline.add_push_constant(m_push_constant);
+	m_reduce_pipeline.init(device, "shaders/culling/hiz_reduce_comp.spv", "Hi-Z reduce pipeline", &pipeline_cache);
+
+	create_pyramid(graphics_pool, depth_target);
+}
+
+void HiZPyramid::del()
+{
+	m_reduce_pipeline.del();
+	m_depth_pipeline.del();
+
+	m_pyramid.del();
+
+	m_descriptor_set.del();
+	for (VKW_DescriptorSet& set : m_reduce_sets) {
+		set.del();
+	}
+	m_descriptor_set_layout.del();
+	m_reduce_layout.del();
+}
+
+void HiZPyramid::set_depth_target(const VKW_CommandPool& graphics_pool, const Texture& depth_target)
+{
+	m_pyramid.del();
+	// clears the cached image views
+	m_pyramid = {};
+
+	create_pyramid(graphics_pool, depth_target);
+}
+
+void HiZPyramid::create_pyramid(const VKW_CommandPool& graphics_pool, const Texture& depth_target)
+{
+	m_extent = depth_target.get_extent();
+	m_levels = static_cast<uint32_t>(std::bit_width(std::max(m_extent.width, m_extent.height)));
+
+	if (m_levels > MAX_LEVELS) {
+		throw RuntimeException(fmt::format("Depth target of {}x{} needs more than {} hi-z levels", m_extent.width, m_extent.height, MAX_LEVELS), __FILE__, __LINE__);
+	}
+
+	// full precision, so the farthest depth is not rounded towards the camera
+	m_pyramid.init(
+		device,
+		m_extent.width,
+		m_extent.height,
+		VK_FORMAT_R32_SFLOAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		sharing_exlusive(),
+		"Hi-Z pyramid",
+		m_levels
+	);
+	// descriptors of the pyramid are valid from now on, even before it is recorded the first time
+	m_pyramid.transition_layout(&graphics_pool, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+	m_reduce_sets[0].update(0, depth_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT), *m_sampler, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+	m_reduce_sets[0].update(1, m_pyramid.get_mip_image_view(VK_IMAGE_ASPECT_COLOR_BIT, 0), VK_IMAGE_LAYOUT_GENERAL);
+	for (uint32_t level = 1; level < m_levels; level++) {
+		m_reduce_sets[level].update(0, m_pyramid.get_mip_image_view(VK_IMAGE_ASPECT_COLOR_BIT, level - 1), *m_sampler, VK_IMAGE_LAYOUT_GENERAL);
+		m_reduce_sets[level].update(1, m_pyramid.get_mip_image_view(VK_IMAGE_ASPECT_COLOR_BIT, level), VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	m_descriptor_set.update(0, m_pyramid.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), *m_sampler, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+void HiZPyramid::record(const VKW_CommandBuffer& command_buffer) const
+{
+	// the previous contents are not needed, but the reads of the last frame have to be done
+	Texture::transition_layout(command_buffer, m_pyramid, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+	for (uint32_t level = 0; level < m_levels; level++) {
+		const VKW_ComputePipeline& pipeline = level == 0 ? m_depth_pipeline : m_reduce_pipeline;
+		VkExtent2D src_extent = level_extent(m_extent, level == 0 ? 0 : level - 1);
+		VkExtent2D dst_extent = level_extent(m_extent, level);
+
+		if (level > 0) {
+			command_buffer.memory_barrier(
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+			);
+		}
+
+		pipeline.bind(command_buffer);
+		m_reduce_sets[level].bind(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.get_layout());
+		m_push_constant.push(command_buffer, pipeline.get_layout(), { { src_extent.width, src_extent.height }, { dst_extent.width, dst_extent.height } });
+		pipeline.dispatch(command_buffer, (dst_extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (dst_extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+	}
+
+	command_buffer.memory_barrier(
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+	);
+}
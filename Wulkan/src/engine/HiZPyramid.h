@@ -0,0 +1,76 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_CommandBuffer.h"
+#include "vk_wrap/VKW_CommandPool.h"
+#include "vk_wrap/VKW_ComputePipeline.h"
+#include "vk_wrap/VKW_DescriptorPool.h"
+#include "vk_wrap/VKW_DescriptorSet.h"
+#include "vk_wrap/VKW_PushConstants.h"
+#include "vk_wrap/VKW_PipelineCache.h"
+#include "vk_wrap/VKW_Sampler.h"
+
+#include "Texture.h"
+
+struct HiZPushConstants {
+	alignas(8) glm::uvec2 src_size;
+	alignas(8) glm::uvec2 dst_size;
+};
+
+// Hierarchical depth (hi-z) pyramid of the depth rendered so far, for occlusion culling in compute shaders (see GPUInstanceCulling)
+// Level 0 has the resolution of the depth target and holds the farthest depth of each pixel (over all of its samples), every other
+// level the farthest depth of the 2x2 texels below. Odd sizes are rounded up, so texel x of level l covers exactly the pixels
+// [x * 2^l, (x + 1) * 2^l) and anything closer than a texel is in front of everything drawn in its pixels.
+// The pyramid stays in VK_IMAGE_LAYOUT_GENERAL and is rebuilt from scratch every time it is recorded.
+class HiZPyramid : public VKW_Object
+{
+public:
+	// enough for depth targets up to 32768 pixels wide
+	static constexpr uint32_t MAX_LEVELS = 16;
+	// descriptors to reserve in the descriptor pool
+	static constexpr uint32_t DESCRIPTOR_SET_COUNT = MAX_LEVELS + 1;
+	static constexpr uint32_t SAMPLED_IMAGE_COUNT = MAX_LEVELS + 1;
+	static constexpr uint32_t STORAGE_IMAGE_COUNT = MAX_LEVELS;
+
+	HiZPyramid() = default;
+	// the depth target needs VK_IMAGE_USAGE_SAMPLED_BIT, sampler is only used for texel fetches
+	void init(const VKW_Device* vkw_device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool, const VKW_PipelineCache& pipeline_cache, const Texture& depth_target, const VKW_Sampler& sampler);
+	void del() override;
+
+	// recreates the pyramid for a resized depth target of the same sample count, expects none of its commands to be in flight
+	void set_depth_target(const VKW_CommandPool& graphics_pool, const Texture& depth_target);
+
+	// builds the pyramid, expects the depth target to be in VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+	// compute shaders recorded afterwards can read it through get_descriptor_set
+	void record(const VKW_CommandBuffer& command_buffer) const;
+private:
+	static constexpr uint32_t WORKGROUP_SIZE = 8;
+
+	const VKW_Device* device = nullptr;
+	const VKW_Sampler* m_sampler = nullptr;
+
+	Texture m_pyramid;
+	VkExtent2D m_extent{};
+	uint32_t m_levels = 0;
+
+	// set i reads the depth target (i = 0) or level i - 1 and writes level i
+	VKW_DescriptorSetLayout m_reduce_layout;
+	std::array<VKW_DescriptorSet, MAX_LEVELS> m_reduce_sets;
+	// all levels for sampling
+	VKW_DescriptorSetLayout m_descriptor_set_layout;
+	VKW_DescriptorSet m_descriptor_set;
+
+	VKW_PushConstant<HiZPushConstants> m_push_constant;
+	VKW_ComputePipeline m_depth_pipeline;
+	VKW_ComputePipeline m_reduce_pipeline;
+
+	void create_pyramid(const VKW_CommandPool& graphics_pool, const Texture& depth_target);
+	inline static VkExtent2D level_extent(VkExtent2D extent, uint32_t level) { return { ((extent.width - 1) >> level) + 1, ((extent.height - 1) >> level) + 1 }; };
+public:
+	// binding 0: the pyramid with all its levels, to be read with texelFetch
+	inline const VKW_DescriptorSetLayout& get_descriptor_set_layout() const { return m_descriptor_set_layout; };
+	inline const VKW_DescriptorSet& get_descriptor_set() const { return m_descriptor_set; };
+	inline VkExtent2D get_extent() const { return m_extent; };
+	inline uint32_t get_levels() const { return m_levels; };
+};
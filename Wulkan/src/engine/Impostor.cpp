@@ -0,0 +1,555 @@
+#include "common.h"
+#include "Impostor.h"
+#include "ObjMesh.h"
+#include "TextureCache.h"
+
+#include "spdlog/spdlog.h"
+
+#include <chrono>
+
+// offsets of the IMPOSTOR_MIP_LEVELS levels of an rgba8 atlas, returns the size of all levels
+static VkDeviceSize compute_atlas_level_offsets(std::vector<VkDeviceSize>& offsets)
+{
+	offsets.clear();
+	VkDeviceSize size = 0;
+	for (uint32_t i = 0; i < IMPOSTOR_MIP_LEVELS; i++) {
+		offsets.push_back(size);
+		VkDeviceSize extent = IMPOSTOR_ATLAS_SIZE >> i;
+		size += extent * extent * 4;
+	}
+	return size;
+}
+
+// box filters the levels of both atlases, weighted by the coverage (albedo alpha) such that the empty texels around the mesh do not bleed in
+// the albedo is filtered in sRGB, the same as the bake writes it
+static void generate_atlas_levels(std::vector<std::byte>& albedo, std::vector<std::byte>& normal, const std::vector<VkDeviceSize>& offsets)
+{
+	for (uint32_t level = 1; level < IMPOSTOR_MIP_LEVELS; level++) {
+		const uint8_t* src_albedo = reinterpret_cast<const uint8_t*>(albedo.data() + offsets[level - 1]);
+		const uint8_t* src_normal = reinterpret_cast<const uint8_t*>(normal.data() + offsets[level - 1]);
+		uint8_t* dst_albedo = reinterpret_cast<uint8_t*>(albedo.data() + offsets[level]);
+		uint8_t* dst_normal = reinterpret_cast<uint8_t*>(normal.data() + offsets[level]);
+
+		uint32_t src_extent = IMPOSTOR_ATLAS_SIZE >> (level - 1);
+		uint32_t dst_extent = IMPOSTOR_ATLAS_SIZE >> level;
+
+		for (uint32_t y = 0; y < dst_extent; y++) {
+			for (uint32_t x = 0; x < dst_extent; x++) {
+				glm::vec4 albedo_sum{ 0.0f }, normal_sum{ 0.0f }, normal_plain_sum{ 0.0f };
+				float coverage = 0.0f;
+
+				for (uint32_t i = 0; i < 4; i++) {
+					size_t src = 4 * ((2 * y + i / 2) * src_extent + 2 * x + i % 2);
+					float alpha = src_albedo[src + 3] / 255.0f;
+					glm::vec4 n{ src_normal[src], src_normal[src + 1], src_normal[src + 2], src_normal[src + 3] };
+
+					albedo_sum += alpha * glm::vec4{ src_albedo[src], src_albedo[src + 1], src_albedo[src + 2], 0.0f };
+					normal_sum += alpha * n;
+					normal_plain_sum += n;
+					coverage += alpha;
+				}
+
+				glm::vec4 albedo_texel = coverage > 0.0f ? albedo_sum / coverage : glm::vec4{ 0.0f };
+				albedo_texel.a = 255.0f * coverage / 4.0f;
+				glm::vec4 normal_texel = coverage > 0.0f ? normal_sum / coverage : normal_plain_sum / 4.0f;
+
+				size_t dst = 4 * (y * dst_extent + x);
+				for (uint32_t c = 0; c < 4; c++) {
+					dst_albedo[dst + c] = static_cast<uint8_t>(std::lround(albedo_texel[c]));
+					dst_normal[dst + c] = static_cast<uint8_t>(std::lround(normal_texel[c]));
+				}
+			}
+		}
+	}
+}
+
+void Impostor::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, Texture& fallback, const VKW_Sampler& sampler, const VKW_Path& obj_path)
+{
+	ZoneScoped;
+
+	const std::string name = fmt::format("{} impostor", obj_path.filename().string());
+
+	// usually cached by the ObjMesh of a higher lod
+	MeshCache cache;
+	MeshData data;
+	std::span<const Vertex> vertices;
+	std::vector<std::span<const uint32_t>> indices;
+	std::vector<MeshCacheMaterial> materials;
+	if (cache.open(obj_path)) {
+		vertices = cache.get_vertices();
+		for (size_t i = 0; i < cache.get_material_count(); i++) {
+			indices.push_back(cache.get_indices(i));
+			materials.push_back(cache.get_material(i));
+		}
+	}
+	else {
+		std::vector<VKW_Path> dependencies;
+		ObjMesh::parse(thread_pool, obj_path, "", data, dependencies);
+		vertices = data.vertices;
+		indices.assign(data.indices.begin(), data.indices.end());
+		materials = data.materials;
+	}
+
+	if (vertices.empty() || materials.empty()) {
+		throw RuntimeException(fmt::format("Can not create an impostor of {} without vertices or materials", obj_path), __FILE__, __LINE__);
+	}
+
+	// the frames are fitted to the bounding sphere around the center of the bounding box
+	glm::vec3 min_pos = vertices[0].position, max_pos = vertices[0].position;
+	for (const Vertex& vertex : vertices) {
+		min_pos = glm::min(min_pos, vertex.position);
+		max_pos = glm::max(max_pos, vertex.position);
+	}
+	glm::vec3 center = 0.5f * (min_pos + max_pos);
+	float radius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		radius = std::max(radius, glm::length(vertex.position - center));
+	}
+	glm::vec4 bounds{ center, radius };
+
+	// same lookup as PBRMaterial
+	std::vector<VKW_Path> diffuse_paths(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		VKW_Path diffuse_path = materials[i].diffuse_texname;
+		if (diffuse_path != "" && !diffuse_path.is_absolute()) {
+			diffuse_path = find_first_existing({ obj_path.parent_path() / diffuse_path, "textures" / diffuse_path });
+		}
+		diffuse_paths[i] = diffuse_path;
+	}
+
+	// the mesh cache is rewritten whenever the obj or its mtl change
+	std::vector<VKW_Path> sources{ obj_path };
+	if (std::filesystem::exists(MeshCache::get_cache_path(obj_path))) {
+		sources.push_back(MeshCache::get_cache_path(obj_path));
+	}
+	for (const VKW_Path& path : diffuse_paths) {
+		if (path != "") {
+			sources.push_back(path);
+		}
+	}
+
+	const VkFormat albedo_format = VK_FORMAT_R8G8B8A8_SRGB;
+	const VkFormat normal_format = VK_FORMAT_R8G8B8A8_UNORM;
+	const VKW_Path albedo_cache_path = TextureCache::get_cache_path(obj_path.string() + ".impostor_albedo");
+	const VKW_Path normal_cache_path = TextureCache::get_cache_path(obj_path.string() + ".impostor_normal");
+
+	std::vector<VkDeviceSize> level_offsets;
+	VkDeviceSize atlas_size = compute_atlas_level_offsets(level_offsets);
+	std::vector<std::byte> albedo_levels, normal_levels;
+
+	// cached atlases are only used if both were baked with the current settings
+	auto load_cached = [&](const VKW_Path& cache_path, VkFormat format, std::vector<std::byte>& levels) {
+		TextureCache atlas_cache;
+		if (!atlas_cache.open(sources, cache_path, format)) {
+			return false;
+		}
+
+		std::span<const std::byte> cached = atlas_cache.get_data();
+		bool fits = atlas_cache.get_width() == IMPOSTOR_ATLAS_SIZE && atlas_cache.get_height() == IMPOSTOR_ATLAS_SIZE &&
+			atlas_cache.get_mip_levels() == IMPOSTOR_MIP_LEVELS && cached.size() >= atlas_size &&
+			std::equal(level_offsets.begin(), level_offsets.end(), atlas_cache.get_level_offsets().begin());
+		if (fits) {
+			levels.assign(cached.begin(), cached.begin() + atlas_size);
+		}
+		return fits;
+	};
+
+	if (!load_cached(albedo_cache_path, albedo_format, albedo_levels) || !load_cached(normal_cache_path, normal_format, normal_levels)) {
+		spdlog::info("Baking impostor of {}", name);
+		auto start_time = std::chrono::high_resolution_clock::now();
+
+		bake(device, graphics_pool, pipeline_cache, uploader, fallback, sampler, vertices, indices, materials, diffuse_paths, bounds, albedo_levels, normal_levels);
+
+		albedo_levels.resize(atlas_size);
+		normal_levels.resize(atlas_size);
+		generate_atlas_levels(albedo_levels, normal_levels, level_offsets);
+
+		std::chrono::duration<float, std::milli> bake_time = std::chrono::high_resolution_clock::now() - start_time;
+		spdlog::info("Baked {} in {:.2f}ms", name, bake_time.count());
+
+		try {
+			TextureCache::write(sources, albedo_cache_path, albedo_format, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 1, albedo_levels, level_offsets);
+			TextureCache::write(sources, normal_cache_path, normal_format, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 1, normal_levels, level_offsets);
+		}
+		catch (const IOException& e) {
+			// not being able to cache only slows down the next start up
+			spdlog::warn("Failed to write impostor cache for {}: {}", obj_path, e.what());
+		}
+	}
+
+	auto upload_atlas = [&](Texture& atlas, VkFormat format, const std::vector<std::byte>& levels, const std::string& atlas_name) {
+		atlas.init(
+			&device,
+			IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE,
+			format,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			sharing_exlusive(),
+			atlas_name,
+			IMPOSTOR_MIP_LEVELS
+		);
+
+		MipmappedTextureData atlas_data{};
+		atlas_data.format = format;
+		atlas_data.width = IMPOSTOR_ATLAS_SIZE;
+		atlas_data.height = IMPOSTOR_ATLAS_SIZE;
+		atlas_data.mip_levels = IMPOSTOR_MIP_LEVELS;
+		atlas_data.staging_buffer = create_staging_buffer(&device, levels.size(), levels.data(), levels.size(), "Impostor staging buffer");
+		atlas_data.staging_offsets = level_offsets;
+		atlas_data.uncompressed_size = levels.size();
+
+		uploader.upload(atlas, std::move(atlas_data));
+	};
+	upload_atlas(m_albedo_atlas, albedo_format, albedo_levels, fmt::format("{} albedo", name));
+	upload_atlas(m_normal_atlas, normal_format, normal_levels, fmt::format("{} normal", name));
+
+	// one quad, its corners in position.xy and the bounds in the color of every vertex (see impostor.vert)
+	std::array<Vertex, 4> quad{};
+	std::array<glm::vec2, 4> corners{ glm::vec2{ -1, -1 }, glm::vec2{ 1, -1 }, glm::vec2{ 1, 1 }, glm::vec2{ -1, 1 } };
+	for (size_t i = 0; i < quad.size(); i++) {
+		quad[i].position = glm::vec3(corners[i], 0.0f);
+		quad[i].uv_x = corners[i].x * 0.5f + 0.5f;
+		quad[i].uv_y = corners[i].y * 0.5f + 0.5f;
+		quad[i].normal = glm::vec3(0, 0, 1);
+		quad[i].color = bounds;
+	}
+	std::array<uint32_t, 6> quad_indices{ 0, 1, 2, 0, 2, 3 };
+
+	m_geometry = &geometry;
+	m_vertices = geometry.add_vertices(quad);
+	m_meshes = std::vector<Mesh>(1);
+	m_meshes[0].init(geometry, m_vertices, quad_indices);
+
+	// same bounds as the ObjMesh, the quads reach further out but are transparent there
+	m_bounding_radius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		m_bounding_radius = std::max(m_bounding_radius, glm::length(vertex.position));
+	}
+
+	// shaded with the parameters of the first material, always reading the albedo atlas
+	PBRUniform uniform = materials[0].uniform;
+	uniform.configuration |= 1 << 0;
+	m_materials.push_back({});
+	m_materials[0].init(texture_streamer, uniform, obj_path.parent_path(), "", name);
+
+	init_draws(device, descriptor_pool, render_pass, name);
+
+	for (uint32_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+		const VKW_DescriptorSet& set = m_material_instance.get_descriptor_set(frame_idx, 0);
+
+		set.update(0, m_material_buffers[frame_idx]);
+		set.update(2, m_draw_buffer);
+
+		set.update(1, m_albedo_atlas.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0);
+		set.update(1, m_normal_atlas.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+		for (uint32_t tex_idx = 2; tex_idx < MAX_PBR_MATERIALS; tex_idx++) {
+			set.update(1, fallback.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, tex_idx);
+		}
+	}
+}
+
+void Impostor::bake(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, Texture& fallback, const VKW_Sampler& sampler, std::span<const Vertex> vertices, const std::vector<std::span<const uint32_t>>& indices, const std::vector<MeshCacheMaterial>& materials, const std::vector<VKW_Path>& diffuse_paths, const glm::vec4& bounds, std::vector<std::byte>& albedo, std::vector<std::byte>& normal)
+{
+	ZoneScoped;
+
+	// diffuse textures are needed right away, so they are not streamed
+	std::vector<Texture> diffuse_textures(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		if (diffuse_paths[i] != "") {
+			diffuse_textures[i] = create_texture_from_path(
+				&device,
+				uploader,
+				diffuse_paths[i],
+				diffuse_paths[i].extension() == ".exr" ? Texture_Type::Tex_HDR_RGBA : Texture_Type::Tex_RGBA,
+				fmt::format("{} impostor bake texture", materials[i].name)
+			);
+		}
+	}
+	uploader.flush();
+
+	// mesh in host visible buffers, it is only drawn once
+	VkDeviceSize vertex_size = sizeof(Vertex) * vertices.size();
+	VKW_Buffer vertex_buffer{};
+	vertex_buffer.init(
+		&device,
+		vertex_size,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		sharing_exlusive(),
+		Mapping::Persistent,
+		"Impostor bake vertex buffer"
+	);
+	vertex_buffer.copy_into(vertices.data(), vertex_size);
+
+	VkBufferDeviceAddressInfo address_info{};
+	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+	address_info.buffer = vertex_buffer;
+	VkDeviceAddress vertex_address = vkGetBufferDeviceAddress(device, &address_info);
+
+	std::vector<uint32_t> first_indices{};
+	size_t index_count = 0;
+	for (const std::span<const uint32_t>& material_indices : indices) {
+		first_indices.push_back(static_cast<uint32_t>(index_count));
+		index_count += material_indices.size();
+	}
+
+	VKW_Buffer index_buffer{};
+	index_buffer.init(
+		&device,
+		sizeof(uint32_t) * std::max<size_t>(index_count, 1),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		sharing_exlusive(),
+		Mapping::Persistent,
+		"Impostor bake index buffer"
+	);
+	for (size_t i = 0; i < indices.size(); i++) {
+		index_buffer.copy_into(indices[i].data(), sizeof(uint32_t) * indices[i].size(), sizeof(uint32_t) * first_indices[i]);
+	}
+
+	// diffuse texture of each material
+	VKW_DescriptorSetLayout descriptor_set_layout{};
+	descriptor_set_layout.add_binding(
+		0,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		VK_SHADER_STAGE_FRAGMENT_BIT
+	);
+	descriptor_set_layout.init(&device, "Impostor bake desc layout");
+
+	uint32_t material_count = static_cast<uint32_t>(materials.size());
+	VKW_DescriptorPool descriptor_pool{};
+	descriptor_pool.add_layout(descriptor_set_layout, material_count);
+	descriptor_pool.init(&device, material_count, "Impostor bake descriptor pool");
+
+	std::vector<VKW_DescriptorSet> descriptor_sets(materials.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		Texture& diffuse = diffuse_paths[i] != "" ? diffuse_textures[i] : fallback;
+
+		descriptor_sets[i].init(&device, &descriptor_pool, descriptor_set_layout, fmt::format("Impostor bake desc set {}", i));
+		descriptor_sets[i].update(0, diffuse.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), sampler);
+	}
+
+	// render targets, the depth is shared by both passes
+	Texture albedo_target{};
+	albedo_target.init(&device, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, sharing_exlusive(), "Impostor albedo target");
+	Texture normal_target{};
+	normal_target.init(&device, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, sharing_exlusive(), "Impostor normal target");
+	Texture depth_target{};
+	depth_target.init(&device, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, Texture::find_format(device, Tex_D), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, sharing_exlusive(), "Impostor depth target");
+
+	VKW_PushConstant<ImpostorBakePushConstants> push_constant{};
+	push_constant.init(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	// one pipeline per atlas, as pipelines have a single color attachment
+	auto create_pipeline = [&](VkFormat format, bool bake_normals) {
+		VKW_SpecializationConstants<VkBool32, 1> specialization_const{};
+		specialization_const.init({ bake_normals }, { 0 });
+
+		VKW_Shader vert_shader{};
+		vert_shader.init(&device, "shaders/impostor/impostor_bake_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "Impostor bake vertex shader");
+		VKW_Shader frag_shader{};
+		frag_shader.init(&device, "shaders/impostor/impostor_bake_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "Impostor bake fragment shader", "main", specialization_const.get_info());
+
+		VKW_GraphicsPipeline pipeline{};
+		// leaves are double sided
+		pipeline.enable_depth_test();
+		pipeline.enable_depth_write();
+		pipeline.add_shader_stages({ vert_shader, frag_shader });
+		pipeline.add_descriptor_sets({ descriptor_set_layout });
+		pipeline.add_push_constant(push_constant);
+		pipeline.set_color_attachment_format(format);
+		pipeline.set_depth_attachment_format(depth_target.get_format());
+		// the coverage is stored in alpha
+		pipeline.enable_alpha_write();
+		pipeline.init(&device, bake_normals ? "Impostor normal bake pipeline" : "Impostor albedo bake pipeline", &pipeline_cache);
+
+		vert_shader.del();
+		frag_shader.del();
+		return pipeline;
+	};
+	VKW_GraphicsPipeline albedo_pipeline = create_pipeline(albedo_target.get_format(), false);
+	VKW_GraphicsPipeline normal_pipeline = create_pipeline(normal_target.get_format(), true);
+
+	VkDeviceSize level_size = static_cast<VkDeviceSize>(IMPOSTOR_ATLAS_SIZE) * IMPOSTOR_ATLAS_SIZE * 4;
+	VKW_Buffer readback_buffer{};
+	readback_buffer.init(
+		&device,
+		2 * level_size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		sharing_exlusive(),
+		Mapping::Persistent,
+		"Impostor readback buffer"
+	);
+
+	VKW_CommandBuffer command_buffer{};
+	command_buffer.init(&device, &graphics_pool, true, "Impostor bake CMD");
+	command_buffer.begin_single_use();
+	{
+		Texture::transition_layout(command_buffer, albedo_target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		Texture::transition_layout(command_buffer, normal_target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		Texture::transition_layout(command_buffer, depth_target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+		auto record_pass = [&](VKW_GraphicsPipeline& pipeline, const Texture& target) {
+			pipeline.set_render_size({ IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE });
+			pipeline.set_color_attachment(target.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), true, { { 0, 0, 0, 0 } });
+			pipeline.set_depth_attachment(depth_target.get_image_view(VK_IMAGE_ASPECT_DEPTH_BIT), true, 1.0f);
+
+			pipeline.begin_rendering(command_buffer);
+			pipeline.bind(command_buffer);
+			vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+			for (uint32_t frame = 0; frame < IMPOSTOR_FRAMES * IMPOSTOR_FRAMES; frame++) {
+				// each frame is rendered into its own tile
+				VkViewport viewport{};
+				viewport.x = static_cast<float>(frame % IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE);
+				viewport.y = static_cast<float>(frame / IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE);
+				viewport.width = static_cast<float>(IMPOSTOR_FRAME_SIZE);
+				viewport.height = static_cast<float>(IMPOSTOR_FRAME_SIZE);
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				VkRect2D scissor{ { static_cast<int32_t>(viewport.x), static_cast<int32_t>(viewport.y) }, { IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE } };
+				vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+				vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+				for (size_t i = 0; i < materials.size(); i++) {
+					if (indices[i].empty()) {
+						continue;
+					}
+
+					const PBRUniform& uniform = materials[i].uniform;
+					descriptor_sets[i].bind(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.get_layout());
+					push_constant.push(command_buffer, pipeline.get_layout(), {
+						bounds,
+						glm::vec4(uniform.diffuse, (uniform.configuration & 1) != 0 && diffuse_paths[i] != "" ? 1.0f : 0.0f),
+						vertex_address,
+						frame
+					});
+
+					vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices[i].size()), 1, first_indices[i], 0, 0);
+				}
+			}
+
+			pipeline.end_rendering(command_buffer);
+		};
+
+		record_pass(albedo_pipeline, albedo_target);
+		// the second pass clears the depth of the first one
+		command_buffer.memory_barrier(
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		);
+		record_pass(normal_pipeline, normal_target);
+
+		// read back level 0 of both atlases
+		Texture::transition_layout(command_buffer, albedo_target, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		Texture::transition_layout(command_buffer, normal_target, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+		VkBufferImageCopy image_copy{};
+		image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_copy.imageSubresource.layerCount = 1;
+		image_copy.imageExtent = { IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 1 };
+
+		vkCmdCopyImageToBuffer(command_buffer, albedo_target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer, 1, &image_copy);
+		image_copy.bufferOffset = level_size;
+		vkCmdCopyImageToBuffer(command_buffer, normal_target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer, 1, &image_copy);
+
+		command_buffer.memory_barrier(VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+	}
+	command_buffer.submit_single_use();
+
+	std::vector<std::byte> readback(2 * level_size);
+	readback_buffer.copy_from(readback.data(), readback.size());
+	albedo.assign(readback.begin(), readback.begin() + level_size);
+	normal.assign(readback.begin() + level_size, readback.end());
+
+	albedo_pipeline.del();
+	normal_pipeline.del();
+	readback_buffer.del();
+	albedo_target.del();
+	normal_target.del();
+	depth_target.del();
+	for (VKW_DescriptorSet& set : descriptor_sets) {
+		set.del();
+	}
+	descriptor_pool.del();
+	descriptor_set_layout.del();
+	index_buffer.del();
+	vertex_buffer.del();
+	for (size_t i = 0; i < materials.size(); i++) {
+		if (diffuse_paths[i] != "") {
+			diffuse_textures[i].del();
+		}
+	}
+}
+
+void Impostor::del()
+{
+	for (Mesh& mesh : m_meshes) {
+		mesh.del();
+	}
+
+	del_draws();
+
+	if (m_geometry) {
+		m_geometry->free_vertices(m_vertices);
+		m_vertices = {};
+	}
+
+	m_albedo_atlas.del();
+	m_normal_atlas.del();
+}
+
+RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> Impostor::create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only, bool bias_depth)
+{
+	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> render_pass{};
+
+	// Push constants
+	VKW_PushConstant<PushConstants> push_constant{};
+	push_constant.init(VK_SHADER_STAGE_VERTEX_BIT);
+
+	// Graphics pipeline
+	VKW_GraphicsPipeline graphics_pipeline{};
+
+	VKW_Shader vert_shader{};
+	VKW_Shader frag_shader{};
+	if (!depth_only) {
+		vert_shader.init(device, "shaders/impostor/impostor_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "Impostor vertex shader");
+		frag_shader.init(device, "shaders/impostor/impostor_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "Impostor fragment shader");
+	}
+	else {
+		vert_shader.init(device, "shaders/impostor/impostor_depth_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "Impostor depth vertex shader");
+		frag_shader.init(device, "shaders/impostor/impostor_depth_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "Impostor depth fragment shader");
+	}
+
+	// quads face the camera or the light, so they are never culled
+	graphics_pipeline.enable_depth_test();
+	graphics_pipeline.enable_depth_write();
+
+	graphics_pipeline.add_shader_stages({ vert_shader, frag_shader });
+
+	graphics_pipeline.add_descriptor_sets(layouts);
+	graphics_pipeline.add_push_constants({ push_constant.get_range() });
+
+	if (!depth_only) {
+		graphics_pipeline.set_color_attachment_format(color_rt.get_format());
+	}
+	graphics_pipeline.set_depth_attachment_format(depth_rt.get_format());
+
+	if (depth_only && bias_depth) {
+		graphics_pipeline.enable_dynamic_depth_bias();
+	}
+
+	graphics_pipeline.set_sample_count(sample_count);
+
+	graphics_pipeline.init(device, depth_only ? "Impostor DEPTH graphics pipeline" : "Impostor graphics pipeline", &pipeline_cache);
+
+	vert_shader.del();
+	frag_shader.del();
+
+	// end graphics pipeline
+
+	render_pass.init(
+		std::move(graphics_pipeline),
+		layouts,
+		push_constant
+	);
+
+	return render_pass;
+}
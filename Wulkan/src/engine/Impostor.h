@@ -0,0 +1,57 @@
+#pragma once
+
+#include "PBRMesh.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "UploadBatcher.h"
+
+// frames per side of the atlas, has to match IMPOSTOR_FRAMES in impostor_common.shader
+constexpr uint32_t IMPOSTOR_FRAMES = 8;
+// texels per side of a frame
+constexpr uint32_t IMPOSTOR_FRAME_SIZE = 128;
+constexpr uint32_t IMPOSTOR_ATLAS_SIZE = IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE;
+// the mip chain stops while frames are still 16 texels wide, as smaller levels would blend neighbouring frames
+constexpr uint32_t IMPOSTOR_MIP_LEVELS = 4;
+
+// push constants of the bake, see impostor_bake_common.shader
+struct ImpostorBakePushConstants {
+	alignas(16) glm::vec4 bounds;  // xyz: center, w: radius
+	alignas(16) glm::vec4 diffuse; // w: 1 if the diffuse texture is used
+	alignas(8) VkDeviceAddress vertex_buffer;
+	alignas(4) uint32_t frame;
+};
+
+// Octahedral impostor of an obj, the farthest lod of an InstancedLODShape: each instance is a single quad
+// The mesh is rendered orthographically from IMPOSTOR_FRAMES^2 directions of the upper hemisphere (hemi octahedral mapping) into two atlases,
+// one with the albedo and coverage and one with the normal and the depth inside the bounding sphere of the mesh.
+// Per instance the quad faces the frame closest to the camera (or the light in shadow passes), the baked normals are shaded like a PBRMesh
+// and the depth moves the fragments back onto the baked surface.
+// The atlases are baked on the first run and cached next to the obj (see TextureCache).
+// Draws like a PBRMesh with a single mesh and material, material 0 samples the albedo atlas and the normal atlas is the second diffuse texture.
+class Impostor : public PBRMesh
+{
+public:
+	Impostor() = default;
+	// loads the mesh from its cache (see ObjMesh), bakes the atlases if they are not cached yet and uploads them
+	// fallback is bound for materials of obj without diffuse texture and for the unused elements of the texture array
+	// baking waits for the graphics queue to be idle, so do not call while rendering
+	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, Texture& fallback, const VKW_Sampler& sampler, const VKW_Path& obj_path);
+	void del() override;
+
+	// uses the same descriptor set layouts as PBRMesh::create_render_pass
+	// in depth_only mode the quads face the light and keep their depth, such that bias_depth works
+	static RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only = false, bool bias_depth = false);
+
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
+private:
+	Texture m_albedo_atlas;
+	Texture m_normal_atlas;
+
+	// renders the albedo and the normal atlas (level 0) and reads them back, waits for the graphics queue (see init)
+	static void bake(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, Texture& fallback, const VKW_Sampler& sampler, std::span<const Vertex> vertices, const std::vector<std::span<const uint32_t>>& indices, const std::vector<MeshCacheMaterial>& materials, const std::vector<VKW_Path>& diffuse_paths, const glm::vec4& bounds, std::vector<std::byte>& albedo, std::vector<std::byte>& normal);
+};
+
+inline void Impostor::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
+{
+	draw_view(command_buffer, current_frame, cascade_idx, 0);
+}
@@ -0,0 +1,135 @@
+#include "common.h"
+#include "InstanceCulling.h"
+
+#include <cstring>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+void CullingInstances::assign(std::span<const InstanceData> instances, float bounding_radius)
+{
+	count = instances.size();
+	size_t padded = (count + LANES - 1) / LANES * LANES;
+
+	x.assign(padded, 0.0f);
+	y.assign(padded, 0.0f);
+	z.assign(padded, 0.0f);
+	radius.assign(padded, -1.0f);
+
+	for (size_t i = 0; i < count; i++) {
+		x[i] = instances[i].position.x;
+		y[i] = instances[i].position.y;
+		z[i] = instances[i].position.z;
+		radius[i] = bounding_radius;
+	}
+}
+
+#ifdef __AVX__
+void cull_instances(const CullingInstances& instances, const CullingParams& params, size_t first, size_t count, uint8_t* lod_levels)
+{
+	assert(first % 8 == 0 && count % 8 == 0 && "cull_instances expects full vectors of instances");
+
+	const float inv_range = 1.0f / (params.far_plane - params.near_plane);
+	const uint32_t lod_levels_count = static_cast<uint32_t>(params.lod_ratios.size());
+
+	for (size_t i = first; i < first + count; i += 8) {
+		__m256 x = _mm256_add_ps(_mm256_loadu_ps(&instances.x[i]), _mm256_set1_ps(params.offset.x));
+		__m256 y = _mm256_add_ps(_mm256_loadu_ps(&instances.y[i]), _mm256_set1_ps(params.offset.y));
+		__m256 z = _mm256_add_ps(_mm256_loadu_ps(&instances.z[i]), _mm256_set1_ps(params.offset.z));
+		__m256 radius = _mm256_loadu_ps(&instances.radius[i]);
+		__m256 neg_radius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+		// padding has a negative radius
+		__m256 visible = _mm256_cmp_ps(radius, _mm256_setzero_ps(), _CMP_GE_OQ);
+		for (const glm::vec4& plane : params.planes) {
+			__m256 distance = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+				_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w))
+			);
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+		}
+
+		// distance along the view direction, negative distances are treated as far away
+		__m256 view_distance = _mm256_add_ps(
+			_mm256_add_ps(
+				_mm256_mul_ps(_mm256_sub_ps(x, _mm256_set1_ps(params.camera_position.x)), _mm256_set1_ps(params.camera_direction.x)),
+				_mm256_mul_ps(_mm256_sub_ps(y, _mm256_set1_ps(params.camera_position.y)), _mm256_set1_ps(params.camera_direction.y))
+			),
+			_mm256_mul_ps(_mm256_sub_ps(z, _mm256_set1_ps(params.camera_position.z)), _mm256_set1_ps(params.camera_direction.z))
+		);
+		view_distance = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), view_distance);
+		view_distance = _mm256_min_ps(_mm256_max_ps(view_distance, _mm256_set1_ps(params.near_plane)), _mm256_set1_ps(params.far_plane));
+		__m256 distance_01 = _mm256_mul_ps(_mm256_sub_ps(view_distance, _mm256_set1_ps(params.near_plane)), _mm256_set1_ps(inv_range));
+
+		// level is the number of ratios below the distance, capped at the last level
+		__m256 lod = _mm256_setzero_ps();
+		for (uint32_t level = 0; level + 1 < lod_levels_count; level++) {
+			__m256 further = _mm256_cmp_ps(distance_01, _mm256_set1_ps(params.lod_ratios[level]), _CMP_GT_OQ);
+			lod = _mm256_add_ps(lod, _mm256_and_ps(further, _mm256_set1_ps(1.0f)));
+		}
+		lod = _mm256_blendv_ps(_mm256_set1_ps(static_cast<float>(CULLED_INSTANCE)), lod, visible);
+
+		// AVX has no 256 bit integer packing, so the halves are packed with SSE2
+		__m256i lod_i = _mm256_cvttps_epi32(lod);
+		__m128i lod_16 = _mm_packs_epi32(_mm256_castsi256_si128(lod_i), _mm256_extractf128_si256(lod_i, 1));
+		__m128i lod_8 = _mm_packus_epi16(lod_16, lod_16);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(lod_levels + i), lod_8);
+	}
+}
+#else
+void cull_instances(const CullingInstances& instances, const CullingParams& params, size_t first, size_t count, uint8_t* lod_levels)
+{
+	assert(first % 4 == 0 && count % 4 == 0 && "cull_instances expects full vectors of instances");
+
+	const float inv_range = 1.0f / (params.far_plane - params.near_plane);
+	const uint32_t lod_levels_count = static_cast<uint32_t>(params.lod_ratios.size());
+
+	for (size_t i = first; i < first + count; i += 4) {
+		__m128 x = _mm_add_ps(_mm_loadu_ps(&instances.x[i]), _mm_set1_ps(params.offset.x));
+		__m128 y = _mm_add_ps(_mm_loadu_ps(&instances.y[i]), _mm_set1_ps(params.offset.y));
+		__m128 z = _mm_add_ps(_mm_loadu_ps(&instances.z[i]), _mm_set1_ps(params.offset.z));
+		__m128 radius = _mm_loadu_ps(&instances.radius[i]);
+		__m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+		// padding has a negative radius
+		__m128 visible = _mm_cmpge_ps(radius, _mm_setzero_ps());
+		for (const glm::vec4& plane : params.planes) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w))
+			);
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, neg_radius));
+		}
+
+		// distance along the view direction, negative distances are treated as far away
+		__m128 view_distance = _mm_add_ps(
+			_mm_add_ps(
+				_mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(params.camera_position.x)), _mm_set1_ps(params.camera_direction.x)),
+				_mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(params.camera_position.y)), _mm_set1_ps(params.camera_direction.y))
+			),
+			_mm_mul_ps(_mm_sub_ps(z, _mm_set1_ps(params.camera_position.z)), _mm_set1_ps(params.camera_direction.z))
+		);
+		view_distance = _mm_andnot_ps(_mm_set1_ps(-0.0f), view_distance);
+		view_distance = _mm_min_ps(_mm_max_ps(view_distance, _mm_set1_ps(params.near_plane)), _mm_set1_ps(params.far_plane));
+		__m128 distance_01 = _mm_mul_ps(_mm_sub_ps(view_distance, _mm_set1_ps(params.near_plane)), _mm_set1_ps(inv_range));
+
+		// level is the number of ratios below the distance, capped at the last level
+		// compare masks are -1 as integers, so subtracting them counts
+		__m128i lod = _mm_setzero_si128();
+		for (uint32_t level = 0; level + 1 < lod_levels_count; level++) {
+			__m128 further = _mm_cmpgt_ps(distance_01, _mm_set1_ps(params.lod_ratios[level]));
+			lod = _mm_sub_epi32(lod, _mm_castps_si128(further));
+		}
+		__m128i culled = _mm_andnot_si128(_mm_castps_si128(visible), _mm_set1_epi32(CULLED_INSTANCE));
+		lod = _mm_or_si128(_mm_and_si128(_mm_castps_si128(visible), lod), culled);
+
+		__m128i lod_16 = _mm_packs_epi32(lod, lod);
+		__m128i lod_8 = _mm_packus_epi16(lod_16, lod_16);
+		int32_t packed = _mm_cvtsi128_si32(lod_8);
+		std::memcpy(lod_levels + i, &packed, sizeof(packed));
+	}
+}
+#endif
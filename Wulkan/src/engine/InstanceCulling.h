@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Frustum.h"
+#include "InstancedShape.h"
+
+#include <span>
+#include <vector>
+
+// lod level written for instances outside of the frustum
+constexpr uint8_t CULLED_INSTANCE = 0xFF;
+
+// Instance positions and bounding radii as structure of arrays, such that the culling kernel loads full vectors of instances
+// arrays are padded to a multiple of LANES, padded instances have a negative radius and are always culled
+struct CullingInstances {
+	static constexpr size_t LANES = 8;
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+	size_t count = 0; // without padding
+
+	void assign(std::span<const InstanceData> instances, float bounding_radius);
+	inline size_t padded_size() const { return x.size(); };
+};
+
+struct CullingParams {
+	FrustumPlanes planes;
+	glm::vec3 offset; // added to all instance positions (i.e. translation of the model matrix)
+
+	// lod selection (see LODShape::get_lod_level)
+	glm::vec3 camera_position;
+	glm::vec3 camera_direction;
+	float near_plane;
+	float far_plane;
+	std::span<const float> lod_ratios; // ascending, last one is 1
+};
+
+// Frustum culls and selects the lod level of the instances [first, first + count) in one pass
+// first and count have to be multiples of CullingInstances::LANES, lod_levels[i] is set to the level of instance i or CULLED_INSTANCE
+// uses AVX if compiled with it (/arch:AVX), otherwise SSE2 which every x64 cpu supports
+void cull_instances(const CullingInstances& instances, const CullingParams& params, size_t first, size_t count, uint8_t* lod_levels);
@@ -0,0 +1,106 @@
+#include "common.h"
+#include "InstanceGrid.h"
+
+void InstanceGrid::build(std::vector<InstanceData>& instances, float bounding_radius)
+{
+	ZoneScoped;
+
+	Bounds bounds{};
+	for (const InstanceData& instance : instances) {
+		bounds.min = glm::min(bounds.min, instance.position);
+		bounds.max = glm::max(bounds.max, instance.position);
+	}
+
+	// square cells, as many as needed for INSTANCES_PER_CELL
+	glm::vec2 extent = instances.empty() ? glm::vec2(0.0f) : glm::vec2(bounds.max - bounds.min);
+	float cell_count = std::max(1.0f, static_cast<float>(instances.size()) / INSTANCES_PER_CELL);
+	float cell_size = std::sqrt(std::max(extent.x * extent.y, 1e-6f) / cell_count);
+	m_cells_x = std::clamp(static_cast<uint32_t>(std::ceil(extent.x / cell_size)), 1u, MAX_CELLS_PER_AXIS);
+	m_cells_y = std::clamp(static_cast<uint32_t>(std::ceil(extent.y / cell_size)), 1u, MAX_CELLS_PER_AXIS);
+
+	glm::vec2 cell_scale = glm::vec2(m_cells_x, m_cells_y) / glm::max(extent, glm::vec2(1e-6f));
+	auto get_cell = [&](const glm::vec3& position) {
+		glm::vec2 cell = (glm::vec2(position) - glm::vec2(bounds.min)) * cell_scale;
+		uint32_t x = std::min(static_cast<uint32_t>(cell.x), m_cells_x - 1);
+		uint32_t y = std::min(static_cast<uint32_t>(cell.y), m_cells_y - 1);
+		return y * m_cells_x + x;
+	};
+
+	// counting sort, keeps the order of the instances inside a cell
+	const size_t cells = static_cast<size_t>(m_cells_x) * m_cells_y;
+	m_cell_offsets.assign(cells + 1, 0);
+	m_cell_bounds.assign(cells, Bounds{});
+	for (const InstanceData& instance : instances) {
+		uint32_t cell = get_cell(instance.position);
+		m_cell_offsets[cell + 1]++;
+
+		Bounds& cell_bounds = m_cell_bounds[cell];
+		cell_bounds.min = glm::min(cell_bounds.min, instance.position - bounding_radius);
+		cell_bounds.max = glm::max(cell_bounds.max, instance.position + bounding_radius);
+	}
+	for (size_t i = 0; i < cells; i++) {
+		m_cell_offsets[i + 1] += m_cell_offsets[i];
+	}
+
+	std::vector<InstanceData> sorted(instances.size());
+	std::vector<uint32_t> next(m_cell_offsets.begin(), m_cell_offsets.end() - 1);
+	for (const InstanceData& instance : instances) {
+		sorted[next[get_cell(instance.position)]++] = instance;
+	}
+	instances = std::move(sorted);
+
+	m_row_bounds.assign(m_cells_y, Bounds{});
+	for (uint32_t y = 0; y < m_cells_y; y++) {
+		for (uint32_t x = 0; x < m_cells_x; x++) {
+			const Bounds& cell_bounds = m_cell_bounds[y * m_cells_x + x];
+			m_row_bounds[y].min = glm::min(m_row_bounds[y].min, cell_bounds.min);
+			m_row_bounds[y].max = glm::max(m_row_bounds[y].max, cell_bounds.max);
+		}
+	}
+}
+
+template<typename F>
+void InstanceGrid::query(const F& intersects, std::vector<InstanceRange>& ranges) const
+{
+	ranges.clear();
+
+	for (uint32_t y = 0; y < m_cells_y; y++) {
+		// rows without instances have inverted bounds
+		const Bounds& row_bounds = m_row_bounds[y];
+		if (row_bounds.min.x > row_bounds.max.x || !intersects(row_bounds)) {
+			continue;
+		}
+
+		for (uint32_t cell = y * m_cells_x; cell < (y + 1) * m_cells_x; cell++) {
+			uint32_t first = m_cell_offsets[cell];
+			uint32_t count = m_cell_offsets[cell + 1] - first;
+			if (count == 0 || !intersects(m_cell_bounds[cell])) {
+				continue;
+			}
+
+			// the cells are sorted, so consecutive cells in a row and the ends of rows can be merged
+			if (!ranges.empty() && ranges.back().first + ranges.back().count == first) {
+				ranges.back().count += count;
+			}
+			else {
+				ranges.push_back({ first, count });
+			}
+		}
+	}
+}
+
+void InstanceGrid::query_frustum(const FrustumPlanes& planes, const glm::vec3& offset, std::vector<InstanceRange>& ranges) const
+{
+	// the box is outside if its corner furthest along the normal is outside of a plane
+	query([&](const Bounds& bounds) {
+		glm::vec3 min = bounds.min + offset;
+		glm::vec3 max = bounds.max + offset;
+		for (const glm::vec4& plane : planes) {
+			glm::vec3 corner = glm::mix(min, max, glm::greaterThanEqual(glm::vec3(plane), glm::vec3(0.0f)));
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}, ranges);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Frustum.h"
+#include "InstancedShape.h"
+
+#include <span>
+#include <vector>
+
+// instances [first, first + count)
+struct InstanceRange {
+	uint32_t first;
+	uint32_t count;
+};
+
+// Static uniform grid over the x/y plane of the instances, which is the uv layout of the terrain they are placed on
+// build sorts the instances by cell (row major), so every cell and every row of cells is a contiguous range of instances
+// the query first tests the bounds of each row and only then the cells of the rows that intersect, it returns the ranges of all
+// intersecting cells with neighbouring ranges merged. Instances in the ranges still need to be tested on their own
+class InstanceGrid
+{
+public:
+	// reorders instances, bounding_radius is added around every instance
+	void build(std::vector<InstanceData>& instances, float bounding_radius);
+
+	// all cells that intersect the planes (see FrustumPlanes), offset is added to all instance positions
+	void query_frustum(const FrustumPlanes& planes, const glm::vec3& offset, std::vector<InstanceRange>& ranges) const;
+private:
+	// instances per cell the grid resolution aims for, few enough to cull cells tightly and many enough to keep the rows short
+	static constexpr uint32_t INSTANCES_PER_CELL = 256;
+	static constexpr uint32_t MAX_CELLS_PER_AXIS = 1024;
+
+	struct Bounds {
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+	};
+
+	uint32_t m_cells_x = 0;
+	uint32_t m_cells_y = 0;
+	// cell i holds the instances [m_cell_offsets[i], m_cell_offsets[i + 1]), row r the ones of its cells
+	std::vector<uint32_t> m_cell_offsets;
+	std::vector<Bounds> m_cell_bounds;
+	std::vector<Bounds> m_row_bounds;
+
+	// appends the ranges of all non empty cells whose bounds pass intersects, testing the bounds of their rows first
+	template<typename F>
+	void query(const F& intersects, std::vector<InstanceRange>& ranges) const;
+public:
+	inline uint32_t get_cells_x() const { return m_cells_x; };
+	inline uint32_t get_cells_y() const { return m_cells_y; };
+};
@@ -3,8 +3,14 @@
 #include "Shape.h"
 #include "InstancedShape.h"
 #include "LODShape.h"
+#include "InstanceCulling.h"
+#include "InstanceGrid.h"
+#include "GPUInstanceCulling.h"
+#include "Impostor.h"
+#include "ThreadPool.h"
 
 #include <type_traits>
+#include <span>
 
 template <typename T> requires std::is_base_of_v<Shape, T>
 class InstancedLODShape : public LODShape<InstancedShape<T>> {
@@ -13,13 +19,91 @@ public:
 	// before will need to have called set_descriptor_bindings
 	// if ratios are left empty (default) the LOD choice will be distributed equally in distance
 	void init(std::vector<InstancedShape<T>>&& shapes, const std::vector<InstanceData>& per_instance_data, std::vector<float> ratios = {});
+	// same as init with the lods of obj_path simplified to triangle_ratios (see ObjMesh::create_lods), so any obj can be drawn with lods
+	// the meshes get texture_fallback and general_sampler as descriptor bindings
+	void init_obj(const VKW_Device& device, UploadBatcher& uploader, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, Texture& texture_fallback, const VKW_Sampler& general_sampler, const VKW_Path& obj_path, std::span<const float> triangle_ratios, const std::vector<InstanceData>& per_instance_data, std::vector<float> ratios = {}) requires std::is_same_v<T, ObjMesh>;
+	// uploads the instances for culling them on the gpu instead (see set_gpu_culling), call after init
+	// the camera's instances can additionally be occlusion culled against hiz (see set_occlusion_culling)
+	void init_gpu_culling(const VKW_Device& device, UploadBatcher& uploader, const VKW_PipelineCache& pipeline_cache, const HiZPyramid& hiz);
+	// adds impostor as the farthest lod (after the shapes), call after init and before init_gpu_culling
+	// the impostors are drawn with their own render pass by draw_impostors, set_lod_ratios then expects a ratio for them as well
+	void init_impostor(InstancedShape<Impostor>&& impostor);
+	void del() override;
 
-	void update(uint32_t current_frame);
-	void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	// culls the instances against the frustum planes and sorts the remaining ones into their lod levels (see cull_instances)
+	// only instances in grid cells intersecting the planes are tested, so the cost scales with the visible instances
+	// the same is done for the shadow casters of each cascade, which keep the lod chosen for the camera
+	// large instance counts are split into chunks processed on the thread pool
+	// the instances are written straight into the mapped instance buffers of the lods and nothing is allocated once initialized
+	// with gpu culling only the culling parameters are written, the culling itself is recorded by record_culling
+	void update(uint32_t current_frame, ThreadPool* thread_pool = nullptr);
+	// records the gpu culling, has to be executed before any draw of current_frame. Records nothing when culling on the cpu
+	void record_culling(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const;
+	// records the occlusion culling of the camera's instances, after the hi-z pyramid and before draw. Records nothing without occlusion culling
+	void record_occlusion_culling(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const;
+	void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
+	// draws only the instances inside the caster planes of the cascade, all camera visible instances if none are set
+	void draw_cascade(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx);
+	// same as draw and draw_cascade for the impostor lod, records nothing without impostor
+	void draw_impostors(const VKW_CommandBuffer& command_buffer, uint32_t current_frame);
+	void draw_impostors_cascade(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx);
 private:
+	// instances culled per job
+	static constexpr size_t CULLING_CHUNK_SIZE = 16384;
+
 	std::vector<InstanceData> m_instance_data;
-	std::vector<std::vector<InstanceData>> m_per_lod_instance_data;
+
+	// m_instance_data is sorted by its cells
+	InstanceGrid m_grid;
+	CullingInstances m_culling_instances;
+	FrustumPlanes m_frustum_planes{};
+	std::array<FrustumPlanes, MAX_INSTANCE_VIEWS - 1> m_cascade_planes{};
+	uint32_t m_cascade_count = 0;
+	std::vector<uint8_t> m_instance_lods;
+	std::vector<InstanceRange> m_visible_ranges;
+	// visible ranges widened to full vectors of the culling kernel and split into jobs
+	std::vector<InstanceRange> m_chunks;
+	// per chunk and lod: first the number of instances, then the cursor into the lod's instances
+	std::vector<uint32_t> m_chunk_lod_counts;
+	// per lod: mapped instances of the current view and their count
+	std::vector<InstanceData*> m_lod_instances;
+	std::vector<uint32_t> m_lod_instance_counts;
+
+	float m_bounding_radius = 0.0f;
+	bool m_gpu_culling_initialized = false;
+	bool m_gpu_culling = false;
+	bool m_occlusion_culling = false;
+	glm::mat4 m_occlusion_view_proj{ 1.0f };
+	GPUInstanceCulling m_gpu_culler;
+
+	// lod m_lod_levels if m_has_impostor
+	InstancedShape<Impostor> m_impostor;
+	bool m_has_impostor = false;
+
+	// number of lods including the impostor
+	uint32_t get_lod_count() const { return this->m_lod_levels + (m_has_impostor ? 1 : 0); };
+	inline InstanceData* get_mapped_lod_instances(uint32_t lod, uint32_t current_frame, uint32_t view);
+	inline void commit_lod_instances(uint32_t lod, uint32_t current_frame, uint32_t view, uint32_t count);
+
+	// culls against params.planes and writes the remaining instances into view of the lods (camera is view 0, then the cascades)
+	void cull_view(uint32_t view, const CullingParams& params, uint32_t current_frame, ThreadPool* thread_pool);
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
+public:
+	// one ratio per lod, including the impostor
+	void set_lod_ratios(std::span<const float> ratios);
+	void set_model_matrix(const glm::mat4& m) override;
+	void set_visualization_mode(VisualizationMode mode) override;
+
+	// instances outside of the planes are not drawn, all zero planes (default) disable culling
+	void set_frustum_planes(const FrustumPlanes& planes) { m_frustum_planes = planes; };
+	// one set of planes per shadow cascade (see DirectionalLight::get_caster_planes), cascades without planes draw the camera's instances
+	inline void set_cascade_frustum_planes(std::span<const FrustumPlanes> planes);
+	// switches between culling on the gpu and on the cpu, requires init_gpu_culling to enable
+	inline void set_gpu_culling(bool enabled);
+	// tests the camera's instances against the hi-z pyramid rendered with view_proj (including the flip of y), only with gpu culling
+	void set_occlusion_culling(bool enabled, const glm::mat4& view_proj) { m_occlusion_culling = enabled; m_occlusion_view_proj = view_proj; };
+	// instances hidden by the hi-z pyramid in the last finished frame
+	uint32_t get_occluded_count() const { return m_gpu_culling ? m_gpu_culler.get_occluded_count() : 0; };
 };
 
 template<typename T> requires std::is_base_of_v<Shape, T>
@@ -28,35 +112,391 @@ inline void InstancedLODShape<T>::init(std::vector<InstancedShape<T>>&& shapes,
 	LODShape<InstancedShape<T>>::init(std::move(shapes), ratios);
 
 	m_instance_data = per_instance_data;
-	m_per_lod_instance_data.resize(this->m_lod_levels);
+
+	// bounds of the largest lod
+	m_bounding_radius = 0.0f;
+	for (const InstancedShape<T>& shape : this->m_shapes) {
+		m_bounding_radius = std::max(m_bounding_radius, shape.get_bounding_radius());
+	}
+	m_grid.build(m_instance_data, m_bounding_radius);
+	m_culling_instances.assign(m_instance_data, m_bounding_radius);
+	m_instance_lods.resize(m_culling_instances.padded_size());
+
+	// worst cases, every cell is a range that ends a chunk
+	size_t max_ranges = static_cast<size_t>(m_grid.get_cells_x()) * m_grid.get_cells_y();
+	size_t max_chunks = max_ranges + m_culling_instances.padded_size() / CULLING_CHUNK_SIZE + 1;
+	m_visible_ranges.reserve(max_ranges);
+	m_chunks.reserve(max_chunks);
+	m_chunk_lod_counts.reserve(max_chunks * this->m_lod_levels);
+	m_lod_instances.resize(this->m_lod_levels);
+	m_lod_instance_counts.resize(this->m_lod_levels);
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::init_obj(const VKW_Device& device, UploadBatcher& uploader, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, Texture& texture_fallback, const VKW_Sampler& general_sampler, const VKW_Path& obj_path, std::span<const float> triangle_ratios, const std::vector<InstanceData>& per_instance_data, std::vector<float> ratios) requires std::is_same_v<T, ObjMesh>
+{
+	std::vector<ObjMesh> lods = ObjMesh::create_lods(device, texture_streamer, geometry, descriptor_pool, thread_pool, render_pass, obj_path, triangle_ratios);
+
+	std::vector<InstancedShape<ObjMesh>> shapes{};
+	shapes.reserve(lods.size());
+	for (ObjMesh& mesh : lods) {
+		mesh.set_descriptor_bindings(texture_fallback, general_sampler);
+
+		// dynamic, update writes the visible instances every frame
+		InstancedShape<ObjMesh> instanced_mesh{};
+		instanced_mesh.init(device, uploader, std::move(mesh), static_cast<uint32_t>(per_instance_data.size()), {}, true);
+		shapes.push_back(instanced_mesh);
+	}
+
+	init(std::move(shapes), per_instance_data, std::move(ratios));
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::init_gpu_culling(const VKW_Device& device, UploadBatcher& uploader, const VKW_PipelineCache& pipeline_cache, const HiZPyramid& hiz)
+{
+	std::vector<VkDrawIndexedIndirectCommand> draws{};
+	std::vector<uint32_t> lod_draw_counts{};
+	for (const InstancedShape<T>& shape : this->m_shapes) {
+		size_t first_draw = draws.size();
+		shape.get_draw_commands(draws);
+		lod_draw_counts.push_back(static_cast<uint32_t>(draws.size() - first_draw));
+	}
+	if (m_has_impostor) {
+		size_t first_draw = draws.size();
+		m_impostor.get_draw_commands(draws);
+		lod_draw_counts.push_back(static_cast<uint32_t>(draws.size() - first_draw));
+	}
+
+	// the grid sorted instances keep nearby instances close in memory for the gpu as well
+	m_gpu_culler.init(&device, uploader, pipeline_cache, hiz, m_instance_data, draws, lod_draw_counts);
+	m_gpu_culling_initialized = true;
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::init_impostor(InstancedShape<Impostor>&& impostor)
+{
+	assert(!m_gpu_culling_initialized && "The impostor has to be added before init_gpu_culling");
+
+	m_impostor = std::move(impostor);
+	m_impostor.set_lod_level(static_cast<int>(this->m_lod_levels));
+	m_has_impostor = true;
+
+	// the previous last lod keeps a ratio of 1, so impostors are only used once its ratio is lowered
+	this->m_ratios.push_back(1.0f);
+
+	m_chunk_lod_counts.reserve(m_chunk_lod_counts.capacity() / this->m_lod_levels * get_lod_count());
+	m_lod_instances.resize(get_lod_count());
+	m_lod_instance_counts.resize(get_lod_count());
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::del()
+{
+	if (m_gpu_culling_initialized) {
+		m_gpu_culler.del();
+		m_gpu_culling_initialized = false;
+	}
+	if (m_has_impostor) {
+		m_impostor.del();
+		m_has_impostor = false;
+	}
+	LODShape<InstancedShape<T>>::del();
 }
 
 
 template<typename T> requires std::is_base_of_v<Shape, T>
-inline void InstancedLODShape<T>::update(uint32_t current_frame)
+inline void InstancedLODShape<T>::update(uint32_t current_frame, ThreadPool* thread_pool)
 {
+	ZoneScoped;
+
 	// needs explicit this due to templated base class
-	for (uint32_t i = 0; i < m_instance_data.size(); i++) {
-		InstanceData data = m_instance_data[i];
-		uint32_t lod_level = this->get_lod_level(i);
-		m_per_lod_instance_data[lod_level].push_back({ data });
+	CullingParams params{
+		m_frustum_planes,
+		glm::vec3(this->m_model[3]),
+		this->m_camera_position,
+		this->m_camera_direction,
+		this->m_near_plane,
+		this->m_far_plane,
+		this->m_ratios
+	};
+
+	if (m_gpu_culling) {
+		m_gpu_culler.update(current_frame, params, m_bounding_radius, std::span(m_cascade_planes.data(), m_cascade_count), m_occlusion_culling ? &m_occlusion_view_proj : nullptr);
+		return;
+	}
+
+	// view 0 resets the counts of all views, so it has to come first
+	cull_view(0, params, current_frame, thread_pool);
+
+	for (uint32_t cascade = 0; cascade < m_cascade_count; cascade++) {
+		params.planes = m_cascade_planes[cascade];
+		cull_view(cascade + 1, params, current_frame, thread_pool);
+	}
+
+	for (uint32_t i = 0; i < this->m_lod_levels; i++) {
+		this->m_shapes[i].update_draw_commands(current_frame);
+	}
+	if (m_has_impostor) {
+		m_impostor.update_draw_commands(current_frame);
+	}
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::cull_view(uint32_t view, const CullingParams& params, uint32_t current_frame, ThreadPool* thread_pool)
+{
+	ZoneScoped;
+
+	const uint32_t lod_levels = get_lod_count();
+
+	const uint32_t padded_size = static_cast<uint32_t>(m_culling_instances.padded_size());
+	const uint32_t lanes = static_cast<uint32_t>(CullingInstances::LANES);
+
+	m_grid.query_frustum(params.planes, params.offset, m_visible_ranges);
+
+	// widened ranges can overlap the previous one, which was already extended up to its end
+	m_chunks.clear();
+	uint32_t chunked_end = 0;
+	for (const InstanceRange& range : m_visible_ranges) {
+		uint32_t first = std::max(range.first / lanes * lanes, chunked_end);
+		uint32_t last = std::min((range.first + range.count + lanes - 1) / lanes * lanes, padded_size);
+
+		while (first < last) {
+			// continue the previous chunk if it ends right before
+			if (m_chunks.empty() || m_chunks.back().first + m_chunks.back().count != first || m_chunks.back().count == CULLING_CHUNK_SIZE) {
+				m_chunks.push_back({ first, 0 });
+			}
+			uint32_t count = std::min(last - first, static_cast<uint32_t>(CULLING_CHUNK_SIZE) - m_chunks.back().count);
+			m_chunks.back().count += count;
+			first += count;
+		}
+		chunked_end = std::max(chunked_end, last);
+	}
+
+	const size_t chunk_count = m_chunks.size();
+	m_chunk_lod_counts.assign(chunk_count * lod_levels, 0);
+
+	auto for_each_chunk = [&](const std::function<void(size_t)>& func) {
+		if (thread_pool && chunk_count > 1) {
+			thread_pool->parallel_for(chunk_count, func);
+		}
+		else {
+			for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+				func(chunk);
+			}
+		}
+	};
+
+	// captures are kept small, such that std::function does not allocate
+	// cull, select the lod and count the instances per lod of each chunk
+	for_each_chunk([this, &params, lod_levels](size_t chunk) {
+		size_t first = m_chunks[chunk].first;
+		size_t count = m_chunks[chunk].count;
+		cull_instances(m_culling_instances, params, first, count, m_instance_lods.data());
+
+		uint32_t* counts = &m_chunk_lod_counts[chunk * lod_levels];
+		for (size_t i = first; i < first + count; i++) {
+			if (m_instance_lods[i] != CULLED_INSTANCE) {
+				counts[m_instance_lods[i]]++;
+			}
+		}
+	});
+
+	// each chunk writes its instances of a lod behind the ones of the previous chunks, keeping the order of the instances
+	for (uint32_t lod = 0; lod < lod_levels; lod++) {
+		uint32_t total = 0;
+		for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+			uint32_t count = m_chunk_lod_counts[chunk * lod_levels + lod];
+			m_chunk_lod_counts[chunk * lod_levels + lod] = total;
+			total += count;
+		}
+		m_lod_instances[lod] = get_mapped_lod_instances(lod, current_frame, view);
+		m_lod_instance_counts[lod] = total;
+	}
+
+	// every chunk bumps its own cursors, so all writes into the mapped memory are sequential per chunk and lod
+	for_each_chunk([this, lod_levels](size_t chunk) {
+		size_t first = m_chunks[chunk].first;
+		size_t last = first + m_chunks[chunk].count;
+
+		uint32_t* cursors = &m_chunk_lod_counts[chunk * lod_levels];
+		for (size_t i = first; i < last; i++) {
+			uint8_t lod = m_instance_lods[i];
+			if (lod != CULLED_INSTANCE) {
+				m_lod_instances[lod][cursors[lod]++] = m_instance_data[i];
+			}
+		}
+	});
+
+	for (uint32_t lod = 0; lod < lod_levels; lod++) {
+		commit_lod_instances(lod, current_frame, view, m_lod_instance_counts[lod]);
+	}
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::record_culling(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const
+{
+	if (m_gpu_culling) {
+		m_gpu_culler.record(command_buffer, current_frame);
+	}
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::record_occlusion_culling(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) const
+{
+	if (m_gpu_culling) {
+		m_gpu_culler.record_occlusion(command_buffer, current_frame);
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
+{
+	if (m_gpu_culling) {
+		for (uint32_t i = 0; i < this->m_lod_levels; i++) {
+			this->m_shapes[i].draw_indirect(
+				command_buffer,
+				current_frame,
+				cascade_idx,
+				m_gpu_culler.get_command_buffer(current_frame),
+				m_gpu_culler.get_command_offset(i, 0),
+				m_gpu_culler.get_instance_address(current_frame, i, 0)
+			);
+		}
+		return;
 	}
 
 	for (uint32_t i = 0; i < this->m_lod_levels; i++) {
-		this->m_shapes[i].update_instance_data(m_per_lod_instance_data[i], current_frame);
-		// clear for next frame's draw
-		m_per_lod_instance_data[i].clear();
+		this->m_shapes[i].draw(command_buffer, current_frame, cascade_idx);	
 	}
 }
 
 template<typename T>  requires std::is_base_of_v<Shape, T>
-inline void InstancedLODShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void InstancedLODShape<T>::draw_cascade(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
 {
+	uint32_t view = static_cast<uint32_t>(cascade_idx) < m_cascade_count ? cascade_idx + 1 : 0;
 	for (uint32_t i = 0; i < this->m_lod_levels; i++) {
-		this->m_shapes[i].draw(command_buffer, current_frame);	
+		if (m_gpu_culling) {
+			this->m_shapes[i].draw_indirect(
+				command_buffer,
+				current_frame,
+				cascade_idx,
+				m_gpu_culler.get_command_buffer(current_frame),
+				m_gpu_culler.get_command_offset(i, view),
+				m_gpu_culler.get_instance_address(current_frame, i, view)
+			);
+		}
+		else {
+			this->m_shapes[i].draw_view(command_buffer, current_frame, cascade_idx, view);
+		}
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::draw_impostors(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+{
+	if (!m_has_impostor) {
+		return;
+	}
+
+	if (m_gpu_culling) {
+		m_impostor.draw_indirect(
+			command_buffer,
+			current_frame,
+			0,
+			m_gpu_culler.get_command_buffer(current_frame),
+			m_gpu_culler.get_command_offset(this->m_lod_levels, 0),
+			m_gpu_culler.get_instance_address(current_frame, this->m_lod_levels, 0)
+		);
+	}
+	else {
+		m_impostor.draw(command_buffer, current_frame);
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::draw_impostors_cascade(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
+{
+	if (!m_has_impostor) {
+		return;
+	}
+
+	uint32_t view = static_cast<uint32_t>(cascade_idx) < m_cascade_count ? cascade_idx + 1 : 0;
+	if (m_gpu_culling) {
+		m_impostor.draw_indirect(
+			command_buffer,
+			current_frame,
+			cascade_idx,
+			m_gpu_culler.get_command_buffer(current_frame),
+			m_gpu_culler.get_command_offset(this->m_lod_levels, view),
+			m_gpu_culler.get_instance_address(current_frame, this->m_lod_levels, view)
+		);
+	}
+	else {
+		m_impostor.draw_view(command_buffer, current_frame, cascade_idx, view);
 	}
 }
 
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline InstanceData* InstancedLODShape<T>::get_mapped_lod_instances(uint32_t lod, uint32_t current_frame, uint32_t view)
+{
+	if (lod < this->m_lod_levels) {
+		return this->m_shapes[lod].get_mapped_instances(current_frame, view);
+	}
+	return m_impostor.get_mapped_instances(current_frame, view);
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::commit_lod_instances(uint32_t lod, uint32_t current_frame, uint32_t view, uint32_t count)
+{
+	if (lod < this->m_lod_levels) {
+		this->m_shapes[lod].commit_instances(current_frame, view, count);
+	}
+	else {
+		m_impostor.commit_instances(current_frame, view, count);
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::set_lod_ratios(std::span<const float> ratios)
+{
+	assert(ratios.size() == get_lod_count() && "Incorrect number of ratios for set_lod_ratios");
+	// same size, so this does not allocate
+	this->m_ratios.assign(ratios.begin(), ratios.end());
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::set_model_matrix(const glm::mat4& m)
+{
+	LODShape<InstancedShape<T>>::set_model_matrix(m);
+	if (m_has_impostor) {
+		m_impostor.set_model_matrix(m);
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::set_visualization_mode(VisualizationMode mode)
+{
+	LODShape<InstancedShape<T>>::set_visualization_mode(mode);
+	if (m_has_impostor) {
+		m_impostor.set_visualization_mode(mode);
+	}
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::set_cascade_frustum_planes(std::span<const FrustumPlanes> planes)
+{
+	assert(planes.size() <= m_cascade_planes.size() && "More cascades than instance views");
+	std::copy(planes.begin(), planes.end(), m_cascade_planes.begin());
+	m_cascade_count = static_cast<uint32_t>(planes.size());
+}
+
+template<typename T>  requires std::is_base_of_v<Shape, T>
+inline void InstancedLODShape<T>::set_gpu_culling(bool enabled)
+{
+	assert((!enabled || m_gpu_culling_initialized) && "Call init_gpu_culling before enabling gpu culling");
+	m_gpu_culling = enabled;
+}
+
 template<typename T>  requires std::is_base_of_v<Shape, T>
 inline glm::vec3 InstancedLODShape<T>::get_instance_position(uint32_t instance)
 {
@@ -12,51 +12,68 @@ class InstancedShape : public Shape
 {
 public:
 	// before will need to have called set_descriptor_bindings
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, T&& shape, uint32_t instance_count, const std::vector<InstanceData>& per_instance_data, bool dynamic = false);
+	void init(const VKW_Device& device, UploadBatcher& uploader, T&& shape, uint32_t instance_count, const std::vector<InstanceData>& per_instance_data, bool dynamic = false);
 	void del() override;
 
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
+	// draws the instances of view, shapes without views draw all instances (see MAX_INSTANCE_VIEWS)
+	inline void draw_view(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, uint32_t view);
 protected:
 	T m_shape;
-	std::vector<InstanceData> m_instance_data;
+	std::vector<InstanceData> m_instance_data; // empty for dynamic shapes, their instances are only written into the mapped buffers
 public:
 	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_instance_buffers;
 protected:
 	bool m_dynamic;
 	uint32_t m_max_instance_count; // the number of instances m_instance_buffer supports. Current instance_count can be lower 
+	// dynamic shapes with views reserve m_max_instance_count instances per view in the instance buffers
+	static constexpr bool has_views = requires (T& shape) { shape.set_view_instance_count(0u, 0u); };
+	uint32_t m_view_count = 1;
 public:
-	void update_instance_data(const std::vector<InstanceData>& per_instance_data, uint32_t current_frame);
+	// the m_max_instance_count instances of view in the mapped buffer of current_frame, write sequentially and finish with commit_instances
+	inline InstanceData* get_mapped_instances(uint32_t current_frame, uint32_t view = 0);
+	// makes the first count written instances visible, view 0 also sets the instance count of all other views
+	// they are drawn once update_draw_commands was called after committing all views
+	void commit_instances(uint32_t current_frame, uint32_t view, uint32_t count);
+	inline void update_draw_commands(uint32_t current_frame);
+
+	// for instances culled on the gpu (see GPUInstanceCulling)
+	void get_draw_commands(std::vector<VkDrawIndexedIndirectCommand>& commands) const requires has_views { m_shape.get_draw_commands(commands); };
+	inline void draw_indirect(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, VkBuffer indirect_buffer, VkDeviceSize offset, VkDeviceAddress instance_address) requires has_views
+	{
+		m_shape.draw_indirect(command_buffer, current_frame, cascade_idx, indirect_buffer, offset, instance_address);
+	};
 
 	void set_model_matrix(const glm::mat4& m) override { m_shape.set_model_matrix(m); };
-	void set_cascade_idx(int idx) override { m_shape.set_cascade_idx( idx); };
 	void set_lod_level(int lod_level) override { m_shape.set_lod_level(lod_level); };
 
 	inline void set_visualization_mode(VisualizationMode mode) { m_shape.set_visualization_mode(mode); };
 	inline virtual virtual void set_instance_count(uint32_t count) override;
 	virtual void set_instance_buffer_address(const std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT>& addresses) { m_shape.set_instance_buffer_address(addresses); };
+	// only for static shapes, dynamic ones don't keep their instances on the cpu
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
+	float get_bounding_radius() const override { return m_shape.get_bounding_radius(); };
 };
 
 template<typename T>  requires std::is_base_of_v<Shape, T>
-inline void InstancedShape<T>::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, T&& shape, uint32_t instance_count, const std::vector<InstanceData>& per_instance_data, bool dynamic)
+inline void InstancedShape<T>::init(const VKW_Device& device, UploadBatcher& uploader, T&& shape, uint32_t instance_count, const std::vector<InstanceData>& per_instance_data, bool dynamic)
 {
 	m_shape = shape;
 	m_instance_data = per_instance_data;
 	m_max_instance_count = instance_count;
 	m_dynamic = dynamic;
+	m_view_count = (has_views && dynamic) ? MAX_INSTANCE_VIEWS : 1;
 
 	if (!(m_instance_data.empty() && dynamic) || m_instance_data.size() == m_max_instance_count) {
 		throw RuntimeException(fmt::format("Tried to initialize InstancedShape with {} many instances but {} per_instance_data", instance_count, per_instance_data.size()), __FILE__, __LINE__);
 	}
 
-	VkDeviceSize instance_buffer_size = sizeof(InstanceData) * m_max_instance_count;
+	VkDeviceSize instance_buffer_size = sizeof(InstanceData) * m_max_instance_count * m_view_count;
 	std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT> addresses{};
 
 	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 		if (!m_instance_data.empty()) {
 			// copy per instance data into a buffer
-			VKW_Buffer instance_staging_buffer = create_staging_buffer(&device, instance_buffer_size, m_instance_data.data(), instance_buffer_size, "Instance staging buffer");
-
 			m_instance_buffers[i].init(
 				&device,
 				instance_buffer_size,
@@ -66,8 +83,7 @@ inline void InstancedShape<T>::init(const VKW_Device& device, const VKW_CommandP
 				fmt::format("Instance buffer {}", i)
 			);
 
-			m_instance_buffers[i].copy_into(&transfer_pool, instance_staging_buffer);
-			instance_staging_buffer.del();
+			uploader.upload(m_instance_buffers[i], m_instance_data.data(), instance_buffer_size);
 		}
 		else {
 			// m_mappable guaranteed to be true
@@ -89,32 +105,65 @@ inline void InstancedShape<T>::init(const VKW_Device& device, const VKW_CommandP
 		addresses[i] = vkGetBufferDeviceAddress(device, &address_info);
 	}
 
-	// guaramteed to be of size m_max_instance_count
-	if (m_instance_data.empty()) {
-		m_instance_data.resize(m_max_instance_count);
-	}
-
 	set_instance_buffer_address(addresses);
 	set_instance_count(m_max_instance_count);
+	if constexpr (has_views) {
+		m_shape.set_instance_view_stride(m_view_count > 1 ? sizeof(InstanceData) * m_max_instance_count : 0);
+	}
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		update_draw_commands(i);
+	}
 }
 
 // overhead cost of virtual function call
 template<typename T> requires std::is_base_of_v<Shape, T>
-inline void InstancedShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void InstancedShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
+{
+	m_shape.draw(command_buffer, current_frame, cascade_idx);
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedShape<T>::draw_view(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, uint32_t view)
+{
+	if constexpr (has_views) {
+		m_shape.draw_view(command_buffer, current_frame, cascade_idx, view < m_view_count ? view : 0);
+	}
+	else {
+		m_shape.draw(command_buffer, current_frame, cascade_idx);
+	}
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline InstanceData* InstancedShape<T>::get_mapped_instances(uint32_t current_frame, uint32_t view)
 {
-	m_shape.draw(command_buffer, current_frame);
+	assert(m_dynamic && "InstancedShape needs to be initalized with mappable=true to call get_mapped_instances");
+	assert(view < m_view_count && "InstancedShape was initialized without views");
+
+	return static_cast<InstanceData*>(m_instance_buffers[current_frame].get_mapped_address()) + static_cast<size_t>(m_max_instance_count) * view;
 }
 
 template<typename T> requires std::is_base_of_v<Shape, T>
-inline void InstancedShape<T>::update_instance_data(const std::vector<InstanceData>& per_instance_data, uint32_t current_frame)
+inline void InstancedShape<T>::commit_instances(uint32_t current_frame, uint32_t view, uint32_t count)
 {
-	assert(m_dynamic && "InstancedShape needs to be initalized with mappable=true to call update_instance_data");
-	assert(per_instance_data.size() <= m_max_instance_count && "Can support only m_max_instance_count data");
-	
-	// copy into m_instance_data, which is guaranteed to be of size m_max_instance_count
-	memcpy_s(m_instance_data.data(), sizeof(InstanceData) * m_instance_data.size(), per_instance_data.data(), sizeof(InstanceData) * per_instance_data.size());
-	m_instance_buffers[current_frame].copy_into(m_instance_data.data(), sizeof(InstanceData) * per_instance_data.size());
-	set_instance_count(per_instance_data.size());
+	assert(count <= m_max_instance_count && "Can support only m_max_instance_count data");
+
+	m_instance_buffers[current_frame].flush(sizeof(InstanceData) * m_max_instance_count * view, sizeof(InstanceData) * count);
+	if (view == 0) {
+		set_instance_count(count);
+	}
+	else if constexpr (has_views) {
+		m_shape.set_view_instance_count(view, count);
+	}
+}
+
+template<typename T> requires std::is_base_of_v<Shape, T>
+inline void InstancedShape<T>::update_draw_commands(uint32_t current_frame)
+{
+	// shapes drawn indirectly keep the instance count in per frame draw commands (see PBRMesh)
+	if constexpr (requires { m_shape.update_draw_commands(current_frame); }) {
+		m_shape.update_draw_commands(current_frame);
+	}
 }
 
 template<typename T> requires std::is_base_of_v<Shape, T>
@@ -127,6 +176,7 @@ inline void InstancedShape<T>::set_instance_count(uint32_t count)
 template<typename T> requires std::is_base_of_v<Shape, T>
 inline glm::vec3 InstancedShape<T>::get_instance_position(uint32_t instance)
 {
+	assert(!m_dynamic && "Dynamic InstancedShape does not keep its instances on the cpu");
 	assert(instance < m_instance_count && "Attempt to get position with invalid instance");
 	return glm::vec3(m_model[3]) + m_instance_data[instance].position; 
 }
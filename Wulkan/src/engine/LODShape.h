@@ -1,6 +1,7 @@
 #pragma once
 #include "Shape.h"
 #include <type_traits>
+#include <span>
 #include "InstancedLODShape.h"
 
 template <typename T> requires std::is_base_of_v<Shape, T>
@@ -15,7 +16,7 @@ public:
 	void init(std::vector<T >&& shapes, std::vector<float> ratios = {});
 	void del() override;
 
-	virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
 protected:
 	std::vector<T> m_shapes;
 	std::vector<float> m_ratios;
@@ -29,10 +30,9 @@ protected:
 	uint32_t get_lod_level(uint32_t instance = 0);
 public:
 	inline void set_camera_info(const glm::vec3& pos, const glm::vec3& dir, float near_plane, float far_plane);
-	void set_lod_ratios(const std::vector<float>& ratios);
+	void set_lod_ratios(std::span<const float> ratios);
 
 	inline void set_model_matrix(const glm::mat4& m) override;
-	void set_cascade_idx(int idx) override;
 	inline void set_visualization_mode(VisualizationMode mode) override;
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
 
@@ -78,9 +78,9 @@ inline void LODShape<T>::del()
 }
 
 template<typename T> requires std::is_base_of_v<Shape, T>
-inline void LODShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void LODShape<T>::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
 {	
-	m_shapes[get_lod_level()].draw(command_buffer, current_frame);
+	m_shapes[get_lod_level()].draw(command_buffer, current_frame, cascade_idx);
 }
 
 template<typename T> requires std::is_base_of_v<Shape, T>
@@ -120,18 +120,12 @@ inline void LODShape<T>::set_model_matrix(const glm::mat4& m)
 		s.set_model_matrix(m);
 }
 
-template <typename T> requires std::is_base_of_v<Shape, T>
-inline void LODShape<T>::set_cascade_idx(int idx)
-{
-	for (T& s : m_shapes)
-		s.set_cascade_idx(idx);
-}
-
 template<typename T> requires std::is_base_of_v<Shape, T>
-inline void LODShape<T>::set_lod_ratios(const std::vector<float>& ratios)
+inline void LODShape<T>::set_lod_ratios(std::span<const float> ratios)
 {
 	assert(ratios.size() == m_shapes.size() && "Incorrect number of ratios for set_lod_ratios");
-	m_ratios = ratios;
+	// same size, so this does not allocate
+	m_ratios.assign(ratios.begin(), ratios.end());
 }
 
 template <typename T> requires std::is_base_of_v<Shape, T>
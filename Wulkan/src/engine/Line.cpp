@@ -1,13 +1,13 @@
 #include "common.h"
 #include "Line.h"
 
-void Line::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const glm::vec4 color)
+void Line::init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const glm::vec4 color)
 {
 	std::vector<glm::vec4> colors{ points.size(), color };
-	init(device, transfer_pool, descriptor_pool, render_pass, points, indices, colors);
+	init(device, geometry, descriptor_pool, render_pass, points, indices, colors);
 }
 
-void Line::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const std::vector<glm::vec4>& colors) {
+void Line::init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const std::vector<glm::vec4>& colors) {
 	material.init(device, descriptor_pool, render_pass, {}, {}, "Line material");
 
 	vertices.resize(points.size());
@@ -29,20 +29,8 @@ void Line::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool,
 	);
 	vertex_buffer.copy_into(vertices.data(), vertex_buffer_size);
 
-	VkDeviceSize index_buffer_size = sizeof(uint32_t) * indices.size();
-	VKW_Buffer index_staging_buffer = create_staging_buffer(&device, index_buffer_size, indices.data(), index_buffer_size, "Index staging buffer");
-
-	index_buffer.init(
-		&device,
-		index_buffer_size,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		sharing_exlusive(),
-		Mapping::NotMapped,
-		"Mesh index buffer"
-	);
-
-	index_buffer.copy_into(&transfer_pool, index_staging_buffer);
-	index_staging_buffer.del();
+	geometry_pool = &geometry;
+	index_range = geometry.add_indices(indices);
 
 	// get device address
 	VkBufferDeviceAddressInfo address_info{};
@@ -50,8 +38,6 @@ void Line::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool,
 	address_info.buffer = vertex_buffer;
 
 	vertex_address = vkGetBufferDeviceAddress(device, &address_info);
-
-	nr_indices = static_cast<uint32_t>(indices.size());
 }
 
 void Line::update_vertices(const std::vector<glm::vec3>& points)
@@ -68,7 +54,7 @@ void Line::update_vertices(const std::vector<glm::vec3>& points)
 	vertex_buffer.copy_into(vertices.data(), vertex_buffer_size);
 }
 
-RenderPass<PushConstants, 1> Line::create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 1>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count)
+RenderPass<PushConstants, 1> Line::create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 1>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count)
 {
 	RenderPass<PushConstants, 1> render_pass{};
 
@@ -101,7 +87,7 @@ RenderPass<PushConstants, 1> Line::create_render_pass(const VKW_Device* device,
 
 	graphics_pipeline.set_sample_count(sample_count);
 
-	graphics_pipeline.init(device, "Line graphics pipeline");
+	graphics_pipeline.init(device, "Line graphics pipeline", &pipeline_cache);
 
 	vert_shader.del();
 	frag_shader.del();
@@ -118,7 +104,10 @@ RenderPass<PushConstants, 1> Line::create_render_pass(const VKW_Device* device,
 void Line::del()
 {
 	vertex_buffer.del();
-	index_buffer.del();
+	if (geometry_pool) {
+		geometry_pool->free_indices(index_range);
+		index_range = {};
+	}
 
 	material.del();
 }
\ No newline at end of file
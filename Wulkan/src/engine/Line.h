@@ -7,15 +7,15 @@ class Line : public Shape
 {
 public:
 	Line() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const glm::vec4 color);
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const std::vector<glm::vec4>& colors);
+	void init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const glm::vec4 color);
+	void init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, 1>& render_pass, const std::vector<glm::vec3>& points, const std::vector<uint32_t>& indices, const std::vector<glm::vec4>& colors);
 	
 	// creates singleton render pass, needs to be deleted by caller of function
-	static RenderPass<PushConstants, 1> create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 1>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count);
+	static RenderPass<PushConstants, 1> create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 1>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count);
 
 	void del() override;
 
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
 protected:
 	std::vector<Vertex> vertices;
 	VKW_Buffer vertex_buffer;
@@ -23,22 +23,22 @@ protected:
 
 	MaterialInstance<PushConstants, 0> material;
 
-	VKW_Buffer index_buffer;
-	uint32_t nr_indices = 0;
+	// indices are static, so they live in the geometry pool
+	GeometryPool* geometry_pool = nullptr;
+	GeometryRange index_range;
 public:
 	// update vertex position. Needs to be the same length as original vertices
 	void update_vertices(const std::vector<glm::vec3>& points);
 
 	void set_lod_level(int lod_level) override { m_lod_level = lod_level; };
 	void set_model_matrix(const glm::mat4& m) override { m_model = m; };
-	void set_cascade_idx(int idx) override { m_cascade_idx = idx; };
 	inline void set_visualization_mode(VisualizationMode mode) override;
 	void set_instance_count(uint32_t count) { m_instance_count = count; };
 	inline  void set_instance_buffer_address(const std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT>& addresses) override;
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
 };
 
-inline void Line::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void Line::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
 {
 	material.bind(
 		command_buffer,
@@ -48,14 +48,13 @@ inline void Line::draw(const VKW_CommandBuffer& command_buffer, uint32_t current
 			m_inv_model,
 			vertex_address,
 			m_instance_buffer_addresses[current_frame],
-			m_cascade_idx,
+			cascade_idx,
 			m_lod_level
 		}
 	);
 
-	// bind index buffer and draw
-	vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
-	vkCmdDrawIndexed(command_buffer, nr_indices, m_instance_count, 0, 0, 0);
+	// index buffer of the geometry pool is expected to be bound
+	vkCmdDrawIndexed(command_buffer, index_range.count, m_instance_count, index_range.offset, 0, 0);
 }
 
 inline void Line::set_visualization_mode(VisualizationMode mode)
@@ -0,0 +1,101 @@
+#include "common.h"
+#include "MappedFile.h"
+#include "StartupProfiler.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		close();
+
+		m_file_handle = std::exchange(other.m_file_handle, nullptr);
+		m_mapping_handle = std::exchange(other.m_mapping_handle, nullptr);
+		m_data = std::exchange(other.m_data, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+	}
+	return *this;
+}
+
+bool MappedFile::open(const VKW_Path& path)
+{
+	close();
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	// empty files can't be mapped
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file_handle = file;
+	m_mapping_handle = mapping;
+	m_data = static_cast<const std::byte*>(view);
+	m_size = static_cast<size_t>(file_size.QuadPart);
+
+	// counts the whole file, even if only parts of the mapping are touched
+	StartupProfiler::add_read(m_size);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mapping_handle) {
+		CloseHandle(m_mapping_handle);
+		m_mapping_handle = nullptr;
+	}
+	if (m_file_handle) {
+		CloseHandle(m_file_handle);
+		m_file_handle = nullptr;
+	}
+	m_size = 0;
+}
+
+uint64_t hash_bytes(std::span<const std::byte> bytes, uint64_t seed)
+{
+	uint64_t hash = seed;
+	for (std::byte b : bytes) {
+		hash ^= static_cast<uint64_t>(b);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
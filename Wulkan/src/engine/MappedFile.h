@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Path.h"
+
+#include <cstddef>
+#include <span>
+
+// Read only memory mapping of a file, unmapped once closed or destroyed
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// maps the whole file, returns false if the file does not exist or could not be mapped
+	bool open(const VKW_Path& path);
+	void close();
+private:
+	void* m_file_handle = nullptr;
+	void* m_mapping_handle = nullptr;
+
+	const std::byte* m_data = nullptr;
+	size_t m_size = 0;
+public:
+	inline bool is_open() const { return m_data != nullptr; };
+	inline const std::byte* data() const { return m_data; };
+	inline size_t size() const { return m_size; };
+	inline std::span<const std::byte> bytes() const { return { m_data, m_size }; };
+};
+
+// 64 bit FNV-1a hash, used to detect changes in source files of caches
+uint64_t hash_bytes(std::span<const std::byte> bytes, uint64_t seed = 14695981039346656037ull);
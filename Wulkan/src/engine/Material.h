@@ -24,6 +24,7 @@ private:
 public:
 	// can be bound also when using a different RenderPass is currently bound (i.e. use one Instance for both the normal shading of terrain as well as a depth only pass)
 	// as long as same Pipeline Layout ?
+	// does not modify the instance, so the same material can be recorded by multiple threads at once
 	void bind(const VKW_CommandBuffer& cmd, uint32_t current_frame, const T& push_val);
 	VKW_DescriptorSet& get_descriptor_set(size_t frame_idx, size_t set_idx) { return m_descriptor_sets[frame_idx][set_idx]; };
 };
@@ -56,8 +57,7 @@ inline void MaterialInstance<T, N>::bind(const VKW_CommandBuffer& cmd, uint32_t
 	for (size_t i = 0; i < N; i++) {
 		m_descriptor_sets[current_frame][i].bind(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, m_set_slots[i]);
 	}
-	m_push_constant->update(push_val);
-	m_push_constant->push(cmd, m_pipeline_layout);
+	m_push_constant->push(cmd, m_pipeline_layout, push_val);
 }
 
 template<typename T, size_t N>
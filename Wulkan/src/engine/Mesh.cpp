@@ -1,70 +1,30 @@
 #include "common.h"
 #include "Mesh.h"
 
-void Mesh::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+void Mesh::init(GeometryPool& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices)
 {
-	
-	vertex_buffer = std::optional<VKW_Buffer>{VKW_Buffer{}};
-	
-	VkDeviceAddress address;
-	create_vertex_buffer(device, transfer_pool, vertices, *vertex_buffer, address);
+	GeometryRange range = geometry.add_vertices(vertices);
+	init(geometry, range, indices);
 
-	init(device, transfer_pool, address, indices);
+	vertex_range = range;
 }
 
-void Mesh::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VkDeviceAddress vert_addr, const std::vector<uint32_t>& indices)
+void Mesh::init(GeometryPool& geometry, const GeometryRange& vertices, std::span<const uint32_t> indices)
 {
-	vertex_address = vert_addr;
+	geometry_pool = &geometry;
+	vertex_address = geometry.get_vertex_address(vertices);
 
-	// create gpu side buffer storing indices
-	VkDeviceSize index_buffer_size = sizeof(uint32_t) * indices.size();
-	VKW_Buffer index_staging_buffer = create_staging_buffer(&device, index_buffer_size, indices.data(), index_buffer_size, "Index staging buffer");
-
-	index_buffer.init(
-		&device,
-		index_buffer_size,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		sharing_exlusive(),
-		Mapping::NotMapped,
-		"Mesh index buffer"
-	);
-
-	index_buffer.copy_into(&transfer_pool, index_staging_buffer);
-	index_staging_buffer.del();
-
-	nr_indices = static_cast<uint32_t>(indices.size());
+	index_range = geometry.add_indices(indices);
 }
 
 void Mesh::del()
 {
-	if (vertex_buffer.has_value()) {
-		vertex_buffer->del();
+	if (vertex_range.has_value()) {
+		geometry_pool->free_vertices(*vertex_range);
+		vertex_range.reset();
+	}
+	if (geometry_pool) {
+		geometry_pool->free_indices(index_range);
+		index_range = {};
 	}
-	index_buffer.del();
-}
-
-void create_vertex_buffer(const VKW_Device& device, const VKW_CommandPool& transfer_pool, const std::vector<Vertex>& vertices, VKW_Buffer& vertex_buffer, VkDeviceAddress& vertex_address)
-{
-	// create gpu side buffer storing vertices
-	VkDeviceSize vertex_buffer_size = sizeof(Vertex) * vertices.size();
-	VKW_Buffer vertex_staging_buffer = create_staging_buffer(&device, vertex_buffer_size, vertices.data(), vertex_buffer_size, "Vertex staging buffer");
-
-	vertex_buffer.init(
-		&device,
-		vertex_buffer_size,
-		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		sharing_exlusive(),
-		Mapping::NotMapped,
-		"Mesh vertex buffer"
-	);
-
-	vertex_buffer.copy_into(&transfer_pool, vertex_staging_buffer);
-	vertex_staging_buffer.del();
-
-	// get device address
-	VkBufferDeviceAddressInfo address_info{};
-	address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
-	address_info.buffer = vertex_buffer;
-
-	vertex_address = vkGetBufferDeviceAddress(device, &address_info);
 }
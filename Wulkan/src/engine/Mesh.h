@@ -6,9 +6,12 @@
 #include "vk_wrap/VKW_CommandBuffer.h"
 #include "vk_wrap/VKW_Buffer.h"
 
+#include "GeometryPool.h"
+
 #include <glm/glm.hpp>
 
 #include <optional>
+#include <span>
 
 // uv interleaved due to GPU allignment 
 struct Vertex {
@@ -23,25 +26,27 @@ class Mesh : public Shape
 {
 public:
 	Mesh() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
-	// can also be initialized without owning the vertex buffer (i.e. shared between multiple meshes)
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VkDeviceAddress vert_addr, const std::vector<uint32_t>& indices);
+	// vertices and indices are sub-allocated from the geometry pool
+	void init(GeometryPool& geometry, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+	// can also be initialized without owning the vertices (i.e. shared between multiple meshes)
+	void init(GeometryPool& geometry, const GeometryRange& vertices, std::span<const uint32_t> indices);
 	void del() override;
 
-	// binds the indices and calls vkCmdDrawIndexed, expects to be in active command buffer
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	// calls vkCmdDrawIndexed, expects to be in active command buffer with the index buffer of the geometry pool bound
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
 protected:
-	std::optional<VKW_Buffer> vertex_buffer;
+	GeometryPool* geometry_pool = nullptr;
+
+	std::optional<GeometryRange> vertex_range; // only set if the vertices are owned
 	VkDeviceAddress vertex_address{};
 
-	VKW_Buffer index_buffer;
-	uint32_t nr_indices = 0;
+	GeometryRange index_range;
 public:
-	void set_vertex_address(VkDeviceAddress address) { vertex_address = address; };
 	VkDeviceAddress get_vertex_address() const { return vertex_address; };
+	uint32_t get_first_index() const { return index_range.offset; };
+	uint32_t get_index_count() const { return index_range.count; };
 
 	void set_model_matrix(const glm::mat4& m) override { m_model = m; };
-	void set_cascade_idx(int idx) override { m_cascade_idx = idx; };
 	void set_lod_level(int lod_level) override { m_lod_level = lod_level; };
 	inline void set_visualization_mode(VisualizationMode mode) override;
 	void set_instance_count(uint32_t count) { m_instance_count = count; };
@@ -49,12 +54,9 @@ public:
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
 };
 
-inline void Mesh::draw(const VKW_CommandBuffer& command_buffer, uint32_t)
+inline void Mesh::draw(const VKW_CommandBuffer& command_buffer, uint32_t, int)
 {
-	// bind index buffer
-	vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT32);
-
-	vkCmdDrawIndexed(command_buffer, nr_indices, m_instance_count, 0, 0, 0);
+	vkCmdDrawIndexed(command_buffer, index_range.count, m_instance_count, index_range.offset, 0, 0);
 }
 
 inline void Mesh::set_visualization_mode(VisualizationMode mode)
@@ -72,6 +74,3 @@ inline glm::vec3 Mesh::get_instance_position(uint32_t instance)
 	assert(instance < m_instance_count && "Attempt to get position with invalid instance");
 	return glm::vec3(m_model[3]);
 }
-
-// initializes a vertex buffer and also sets it's device address
-void create_vertex_buffer(const VKW_Device& device, const VKW_CommandPool& transfer_pool, const std::vector<Vertex>& vertices, VKW_Buffer& vertex_buffer, VkDeviceAddress& vertex_address);
@@ -0,0 +1,275 @@
+#include "common.h"
+#include "MeshCache.h"
+#include "CacheFile.h"
+
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+constexpr char MESH_CACHE_MAGIC[4] = { 'W', 'M', 'S', 'H' };
+
+bool MeshCache::open(const VKW_Path& source_path)
+{
+	ZoneScoped;
+	close();
+
+	if (!m_file.open(get_cache_path(source_path))) {
+		return false;
+	}
+
+	if (m_file.size() < sizeof(Header)) {
+		close();
+		return false;
+	}
+
+	m_header = reinterpret_cast<const Header*>(m_file.data());
+
+	if (std::memcmp(m_header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+		m_header->version != MESH_CACHE_VERSION ||
+		m_header->vertex_size != sizeof(Vertex) ||
+		m_header->uniform_size != sizeof(PBRUniform) ||
+		m_header->source_offset + m_header->source_count * sizeof(SourceEntry) > m_file.size() ||
+		m_header->material_offset + m_header->material_count * sizeof(MaterialEntry) > m_file.size() ||
+		m_header->lod_offset + m_header->lod_count * sizeof(LodEntry) > m_file.size() ||
+		m_header->vertex_offset + m_header->vertex_count * sizeof(Vertex) > m_file.size()
+	) {
+		spdlog::info("Mesh cache of {} has an incompatible format", source_path);
+		close();
+		return false;
+	}
+
+	m_sources = { reinterpret_cast<const SourceEntry*>(m_file.data() + m_header->source_offset), m_header->source_count };
+	m_materials = { reinterpret_cast<const MaterialEntry*>(m_file.data() + m_header->material_offset), m_header->material_count };
+	m_lods = { reinterpret_cast<const LodEntry*>(m_file.data() + m_header->lod_offset), m_header->lod_count };
+
+	if (!is_valid(source_path)) {
+		spdlog::info("Mesh cache of {} is outdated", source_path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshCache::close()
+{
+	m_file.close();
+	m_header = nullptr;
+	m_sources = {};
+	m_materials = {};
+	m_lods = {};
+}
+
+bool MeshCache::is_valid(const VKW_Path& source_path) const
+{
+	const VKW_Path directory = source_path.parent_path();
+
+	for (const SourceEntry& source : m_sources) {
+		if (static_cast<uint64_t>(source.path_offset) + source.path_length > m_file.size()) {
+			return false;
+		}
+
+		VKW_Path path = directory / VKW_Path(get_string(source.path_offset, source.path_length));
+		if (!are_cache_sources_unchanged({ &path, 1 }, { source.size, source.write_time, source.hash })) {
+			return false;
+		}
+	}
+
+	for (const MaterialEntry& material : m_materials) {
+		if (material.index_offset + material.index_count * sizeof(uint32_t) > m_file.size() ||
+			static_cast<uint64_t>(material.name_offset) + material.name_length > m_file.size() ||
+			static_cast<uint64_t>(material.diffuse_offset) + material.diffuse_length > m_file.size()
+		) {
+			return false;
+		}
+	}
+
+	for (const LodEntry& lod : m_lods) {
+		if (lod.vertex_offset + lod.vertex_count * sizeof(Vertex) > m_file.size() ||
+			lod.index_range_offset + m_materials.size() * sizeof(IndexRange) > m_file.size()
+		) {
+			return false;
+		}
+
+		const IndexRange* ranges = reinterpret_cast<const IndexRange*>(m_file.data() + lod.index_range_offset);
+		for (size_t i = 0; i < m_materials.size(); i++) {
+			if (ranges[i].offset + ranges[i].count * sizeof(uint32_t) > m_file.size()) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void MeshCache::write(const VKW_Path& source_path, const std::vector<VKW_Path>& dependencies, const MeshData& data, float parse_time_ms)
+{
+	ZoneScoped;
+
+	std::vector<VKW_Path> sources = { source_path };
+	sources.insert(sources.end(), dependencies.begin(), dependencies.end());
+
+	// collect strings first, such that their offsets can be computed once the table sizes are known
+	std::string strings;
+	auto add_string = [&strings](const std::string& s) {
+		uint32_t offset = static_cast<uint32_t>(strings.size());
+		strings += s;
+		return std::pair<uint32_t, uint32_t>{ offset, static_cast<uint32_t>(s.size()) };
+	};
+
+	std::vector<SourceEntry> source_entries(sources.size());
+	std::vector<std::pair<uint32_t, uint32_t>> source_strings(sources.size());
+	for (size_t i = 0; i < sources.size(); i++) {
+		const VKW_Path& path = sources[i];
+
+		CacheSources source{};
+		if (!read_cache_sources({ &path, 1 }, source)) {
+			throw IOException(fmt::format("Failed to read {} for mesh cache of {}", path, source_path), __FILE__, __LINE__);
+		}
+
+		source_entries[i].size = source.size;
+		source_entries[i].write_time = source.write_time;
+		source_entries[i].hash = source.hash;
+		source_strings[i] = add_string(std::filesystem::relative(path, source_path.parent_path()).generic_string());
+	}
+
+	for (const MeshLod& lod : data.lods) {
+		if (lod.indices.size() != data.materials.size()) {
+			throw RuntimeException(fmt::format("Lod of {} has {} index lists for {} materials", source_path, lod.indices.size(), data.materials.size()), __FILE__, __LINE__);
+		}
+	}
+
+	std::vector<MaterialEntry> material_entries(data.materials.size());
+	std::vector<std::array<std::pair<uint32_t, uint32_t>, 2>> material_strings(data.materials.size());
+	for (size_t i = 0; i < data.materials.size(); i++) {
+		material_entries[i].uniform = data.materials[i].uniform;
+		material_entries[i].index_count = data.indices[i].size();
+		material_strings[i] = { add_string(data.materials[i].name), add_string(data.materials[i].diffuse_texname) };
+	}
+
+	// compute layout
+	Header header{};
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.vertex_size = sizeof(Vertex);
+	header.uniform_size = sizeof(PBRUniform);
+	header.source_count = static_cast<uint32_t>(source_entries.size());
+	header.material_count = static_cast<uint32_t>(material_entries.size());
+	header.vertex_count = data.vertices.size();
+	header.lod_count = static_cast<uint32_t>(data.lods.size());
+	header.parse_time_ms = parse_time_ms;
+
+	header.source_offset = align_up(sizeof(Header), 16);
+	header.material_offset = align_up(header.source_offset + sizeof(SourceEntry) * source_entries.size(), 16);
+	header.lod_offset = align_up(header.material_offset + sizeof(MaterialEntry) * material_entries.size(), 16);
+	uint64_t index_range_offset = header.lod_offset + sizeof(LodEntry) * data.lods.size();
+	uint64_t string_offset = index_range_offset + sizeof(IndexRange) * data.lods.size() * material_entries.size();
+	header.vertex_offset = align_up(string_offset + strings.size(), 16);
+
+	// vertices of all lods first, then all indices
+	std::vector<LodEntry> lod_entries(data.lods.size());
+	std::vector<IndexRange> index_ranges(data.lods.size() * material_entries.size());
+	uint64_t offset = header.vertex_offset + sizeof(Vertex) * data.vertices.size();
+	for (size_t lod = 0; lod < lod_entries.size(); lod++) {
+		lod_entries[lod].triangle_ratio = data.lods[lod].triangle_ratio;
+		lod_entries[lod].error = data.lods[lod].error;
+		lod_entries[lod].vertex_count = data.lods[lod].vertices.size();
+		lod_entries[lod].vertex_offset = offset;
+		lod_entries[lod].index_range_offset = index_range_offset + sizeof(IndexRange) * lod * material_entries.size();
+		offset += sizeof(Vertex) * data.lods[lod].vertices.size();
+	}
+
+	for (size_t i = 0; i < material_entries.size(); i++) {
+		material_entries[i].index_offset = offset;
+		offset += sizeof(uint32_t) * material_entries[i].index_count;
+	}
+	for (size_t lod = 0; lod < lod_entries.size(); lod++) {
+		for (size_t i = 0; i < material_entries.size(); i++) {
+			IndexRange& range = index_ranges[lod * material_entries.size() + i];
+			range.count = data.lods[lod].indices[i].size();
+			range.offset = offset;
+			offset += sizeof(uint32_t) * range.count;
+		}
+	}
+
+	for (size_t i = 0; i < source_entries.size(); i++) {
+		source_entries[i].path_offset = static_cast<uint32_t>(string_offset + source_strings[i].first);
+		source_entries[i].path_length = source_strings[i].second;
+	}
+	for (size_t i = 0; i < material_entries.size(); i++) {
+		material_entries[i].name_offset = static_cast<uint32_t>(string_offset + material_strings[i][0].first);
+		material_entries[i].name_length = material_strings[i][0].second;
+		material_entries[i].diffuse_offset = static_cast<uint32_t>(string_offset + material_strings[i][1].first);
+		material_entries[i].diffuse_length = material_strings[i][1].second;
+	}
+
+	// assemble file in memory and write it at once
+	std::vector<char> file_data(offset);
+	std::memcpy(file_data.data(), &header, sizeof(Header));
+	std::memcpy(file_data.data() + header.source_offset, source_entries.data(), sizeof(SourceEntry) * source_entries.size());
+	std::memcpy(file_data.data() + header.material_offset, material_entries.data(), sizeof(MaterialEntry) * material_entries.size());
+	std::memcpy(file_data.data() + header.lod_offset, lod_entries.data(), sizeof(LodEntry) * lod_entries.size());
+	std::memcpy(file_data.data() + index_range_offset, index_ranges.data(), sizeof(IndexRange) * index_ranges.size());
+	std::memcpy(file_data.data() + string_offset, strings.data(), strings.size());
+	std::memcpy(file_data.data() + header.vertex_offset, data.vertices.data(), sizeof(Vertex) * data.vertices.size());
+	for (size_t i = 0; i < material_entries.size(); i++) {
+		std::memcpy(file_data.data() + material_entries[i].index_offset, data.indices[i].data(), sizeof(uint32_t) * data.indices[i].size());
+	}
+	for (size_t lod = 0; lod < lod_entries.size(); lod++) {
+		const MeshLod& mesh_lod = data.lods[lod];
+		std::memcpy(file_data.data() + lod_entries[lod].vertex_offset, mesh_lod.vertices.data(), sizeof(Vertex) * mesh_lod.vertices.size());
+		for (size_t i = 0; i < material_entries.size(); i++) {
+			const IndexRange& range = index_ranges[lod * material_entries.size() + i];
+			std::memcpy(file_data.data() + range.offset, mesh_lod.indices[i].data(), sizeof(uint32_t) * mesh_lod.indices[i].size());
+		}
+	}
+
+	write_cache_file(get_cache_path(source_path), file_data);
+}
+
+VKW_Path MeshCache::get_cache_path(const VKW_Path& source_path)
+{
+	return VKW_Path(source_path).concat(".cache");
+}
+
+std::string_view MeshCache::get_string(uint32_t offset, uint32_t length) const
+{
+	return { reinterpret_cast<const char*>(m_file.data()) + offset, length };
+}
+
+std::span<const Vertex> MeshCache::get_vertices(size_t lod) const
+{
+	assert(m_header && "Tried to read from mesh cache that is not open");
+	assert(lod < get_lod_count() && "Tried to read lod that is not in the mesh cache");
+	if (lod > 0) {
+		return { reinterpret_cast<const Vertex*>(m_file.data() + m_lods[lod - 1].vertex_offset), m_lods[lod - 1].vertex_count };
+	}
+	return { reinterpret_cast<const Vertex*>(m_file.data() + m_header->vertex_offset), m_header->vertex_count };
+}
+
+std::span<const uint32_t> MeshCache::get_indices(size_t material_idx, size_t lod) const
+{
+	assert(lod < get_lod_count() && "Tried to read lod that is not in the mesh cache");
+	if (lod > 0) {
+		const IndexRange& range = reinterpret_cast<const IndexRange*>(m_file.data() + m_lods[lod - 1].index_range_offset)[material_idx];
+		return { reinterpret_cast<const uint32_t*>(m_file.data() + range.offset), range.count };
+	}
+	const MaterialEntry& material = m_materials[material_idx];
+	return { reinterpret_cast<const uint32_t*>(m_file.data() + material.index_offset), material.index_count };
+}
+
+MeshCacheMaterial MeshCache::get_material(size_t material_idx) const
+{
+	const MaterialEntry& material = m_materials[material_idx];
+	return {
+		material.uniform,
+		std::string(get_string(material.name_offset, material.name_length)),
+		std::string(get_string(material.diffuse_offset, material.diffuse_length))
+	};
+}
+
+float MeshCache::get_parse_time() const
+{
+	assert(m_header && "Tried to read from mesh cache that is not open");
+	return m_header->parse_time_ms;
+}
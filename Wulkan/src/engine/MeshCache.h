@@ -0,0 +1,124 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "PBRMaterial.h"
+
+#include <span>
+
+// increase if the layout of the cache (or of Vertex / PBRUniform) or the import processing changes, old caches will be rebuilt
+constexpr uint32_t MESH_CACHE_VERSION = 4;
+
+struct MeshCacheMaterial {
+	PBRUniform uniform;
+	std::string name;
+	std::string diffuse_texname;
+};
+
+// simplified version of a mesh (see simplify_mesh), uses the materials of the mesh
+struct MeshLod {
+	float triangle_ratio; // of the triangles of the mesh
+	float error;          // of the most expensive collapse
+	std::vector<Vertex> vertices;
+	std::vector<std::vector<uint32_t>> indices; // one index list per material
+};
+
+// cpu side data of a mesh in the layout used by the gpu buffers
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<std::vector<uint32_t>> indices; // one index list per material
+	std::vector<MeshCacheMaterial> materials;
+	std::vector<MeshLod> lods; // optional, lowest definition last
+};
+
+// Binary cache of a parsed mesh stored next to its source file (at source_path + ".cache")
+// Vertex and index data are memory mapped and can be copied directly into staging buffers
+// The cache stores size, write time and hash of all source files (obj and mtl) and is rejected if any of them changed
+// Simplified lods of the mesh are stored with their own vertices and indices, lod 0 is the mesh itself
+class MeshCache
+{
+public:
+	MeshCache() = default;
+
+	// maps the cache of source_path, returns false if there is none or if it is outdated
+	bool open(const VKW_Path& source_path);
+	void close();
+
+	// writes the cache of source_path, dependencies are additional files the data was created from (i.e. mtl files)
+	// parse_time is stored such that later loads can be compared against it
+	static void write(const VKW_Path& source_path, const std::vector<VKW_Path>& dependencies, const MeshData& data, float parse_time_ms);
+	static VKW_Path get_cache_path(const VKW_Path& source_path);
+private:
+	// file layout: Header | SourceEntry[] | MaterialEntry[] | LodEntry[] | IndexRange[] | strings | vertices | indices
+	// all offsets are in bytes from the beginning of the file, sections are aligned to 16 bytes
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t vertex_size; // sizeof(Vertex) and sizeof(PBRUniform) at time of writing
+		uint32_t uniform_size;
+
+		uint32_t source_count;
+		uint32_t material_count;
+		uint64_t source_offset;
+		uint64_t material_offset;
+
+		uint64_t vertex_count;
+		uint64_t vertex_offset;
+
+		uint32_t lod_count; // without the mesh itself
+		uint64_t lod_offset;
+
+		float parse_time_ms;
+	};
+
+	// source file the cache was created from, path is relative to the directory of the first source
+	struct SourceEntry {
+		uint64_t size;
+		int64_t write_time;
+		uint64_t hash;
+		uint32_t path_offset;
+		uint32_t path_length;
+	};
+
+	struct MaterialEntry {
+		PBRUniform uniform;
+		uint64_t index_count;
+		uint64_t index_offset;
+		uint32_t name_offset;
+		uint32_t name_length;
+		uint32_t diffuse_offset;
+		uint32_t diffuse_length;
+	};
+
+	struct IndexRange {
+		uint64_t count;
+		uint64_t offset;
+	};
+
+	struct LodEntry {
+		float triangle_ratio;
+		float error;
+		uint64_t vertex_count;
+		uint64_t vertex_offset;
+		uint64_t index_range_offset; // one IndexRange per material
+	};
+
+	MappedFile m_file;
+
+	const Header* m_header = nullptr;
+	std::span<const SourceEntry> m_sources;
+	std::span<const MaterialEntry> m_materials;
+	std::span<const LodEntry> m_lods;
+
+	bool is_valid(const VKW_Path& source_path) const;
+	std::string_view get_string(uint32_t offset, uint32_t length) const;
+public:
+	// lod 0 is the mesh itself, lod i > 0 is MeshData::lods[i - 1] at the time of writing
+	size_t get_lod_count() const { return m_lods.size() + 1; };
+	float get_lod_triangle_ratio(size_t lod) const { return lod == 0 ? 1.0f : m_lods[lod - 1].triangle_ratio; };
+	std::span<const Vertex> get_vertices(size_t lod = 0) const;
+	size_t get_material_count() const { return m_materials.size(); };
+	std::span<const uint32_t> get_indices(size_t material_idx, size_t lod = 0) const;
+	MeshCacheMaterial get_material(size_t material_idx) const;
+	float get_parse_time() const;
+};
@@ -0,0 +1,379 @@
+#include "common.h"
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "spdlog/spdlog.h"
+
+// vertices are welded if they are bitwise identical
+struct VertexHash {
+	size_t operator()(const Vertex& v) const
+	{
+		uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+		std::memcpy(words, &v, sizeof(Vertex));
+
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t w : words) {
+			hash = (hash ^ w) * 1099511628211ull;
+		}
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+};
+
+struct VertexEqual {
+	bool operator()(const Vertex& a, const Vertex& b) const
+	{
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+};
+
+// counts the vertex shader invocations of a FIFO cache
+// a vertex is in the cache if it was inserted less than cache_size insertions ago
+static size_t count_cache_misses(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size)
+{
+	std::vector<uint32_t> timestamps(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+
+	size_t misses = 0;
+	for (uint32_t idx : indices) {
+		if (time - timestamps[idx] > cache_size) {
+			timestamps[idx] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+static float compute_mesh_acmr(const MeshData& data)
+{
+	size_t misses = 0;
+	size_t triangles = 0;
+	for (const std::vector<uint32_t>& indices : data.indices) {
+		misses += count_cache_misses(indices, data.vertices.size(), 16);
+		triangles += indices.size() / 3;
+	}
+	return triangles > 0 ? static_cast<float>(misses) / static_cast<float>(triangles) : 0.0f;
+}
+
+void optimize_mesh(MeshData& data, const std::string& name)
+{
+	ZoneScoped;
+
+	size_t vertex_count_before = data.vertices.size();
+	float acmr_before = compute_mesh_acmr(data);
+
+	weld_vertices(data);
+
+	for (std::vector<uint32_t>& indices : data.indices) {
+		optimize_vertex_cache(indices, data.vertices.size());
+		optimize_overdraw(indices, data.vertices);
+	}
+
+	optimize_vertex_fetch(data);
+
+	spdlog::info(
+		"Optimized mesh {}: {} -> {} vertices, ACMR {:.3f} -> {:.3f}",
+		name, vertex_count_before, data.vertices.size(), acmr_before, compute_mesh_acmr(data)
+	);
+}
+
+void weld_vertices(MeshData& data)
+{
+	ZoneScoped;
+
+	std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique_vertices;
+	unique_vertices.reserve(data.vertices.size());
+
+	std::vector<Vertex> vertices;
+	vertices.reserve(data.vertices.size());
+
+	std::vector<uint32_t> remap(data.vertices.size());
+	for (size_t i = 0; i < data.vertices.size(); i++) {
+		auto [it, inserted] = unique_vertices.try_emplace(data.vertices[i], static_cast<uint32_t>(vertices.size()));
+		if (inserted) {
+			vertices.push_back(data.vertices[i]);
+		}
+		remap[i] = it->second;
+	}
+
+	for (std::vector<uint32_t>& indices : data.indices) {
+		for (uint32_t& idx : indices) {
+			idx = remap[idx];
+		}
+	}
+
+	data.vertices = std::move(vertices);
+}
+
+// simulated cache size for the optimization, larger than typical hardware caches as suggested by Forsyth
+constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+
+static inline float forsyth_vertex_score(int cache_position, uint32_t remaining_valence)
+{
+	// vertex is not used by any remaining triangle
+	if (remaining_valence == 0) {
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		// vertices of the last triangle get a fixed score, such that we don't just repeat the same edge
+		if (cache_position < 3) {
+			score = 0.75f;
+		}
+		else {
+			score = powf(1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+	}
+
+	// prefer vertices with few remaining triangles to get rid of them early
+	score += 2.0f * powf(static_cast<float>(remaining_valence), -0.5f);
+	return score;
+}
+
+void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertex_count)
+{
+	ZoneScoped;
+
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count <= 1) {
+		return;
+	}
+
+	// triangles adjacent to a vertex are stored in adjacency[adjacency_offset[v], adjacency_offset[v] + valence[v])
+	// emitted triangles are swapped to the end of this range such that only remaining triangles are visited
+	std::vector<uint32_t> valence(vertex_count, 0);
+	for (uint32_t idx : indices) {
+		valence[idx]++;
+	}
+
+	std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; v++) {
+		adjacency_offset[v + 1] = adjacency_offset[v] + valence[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (size_t t = 0; t < triangle_count; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				adjacency[fill[indices[3 * t + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++) {
+		vertex_score[v] = forsyth_vertex_score(-1, valence[v]);
+	}
+
+	auto triangle_score = [&](size_t t) {
+		return vertex_score[indices[3 * t + 0]] + vertex_score[indices[3 * t + 1]] + vertex_score[indices[3 * t + 2]];
+	};
+
+	std::vector<bool> emitted(triangle_count, false);
+
+	// start with the best triangle overall
+	int64_t best_triangle = 0;
+	float best_score = triangle_score(0);
+	for (size_t t = 1; t < triangle_count; t++) {
+		float score = triangle_score(t);
+		if (score > best_score) {
+			best_score = score;
+			best_triangle = static_cast<int64_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> new_cache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	size_t fallback_cursor = 0;
+	while (result.size() < indices.size()) {
+		if (best_triangle < 0) {
+			// no remaining triangle touches the cache, continue with the next one in input order
+			while (emitted[fallback_cursor]) {
+				fallback_cursor++;
+			}
+			best_triangle = static_cast<int64_t>(fallback_cursor);
+		}
+
+		size_t t = static_cast<size_t>(best_triangle);
+		emitted[t] = true;
+
+		const uint32_t tri[3] = { indices[3 * t + 0], indices[3 * t + 1], indices[3 * t + 2] };
+		result.insert(result.end(), tri, tri + 3);
+
+		// remove triangle from the remaining triangles of its vertices
+		for (uint32_t v : tri) {
+			auto begin = adjacency.begin() + adjacency_offset[v];
+			auto end = begin + valence[v];
+			auto it = std::find(begin, end, static_cast<uint32_t>(t));
+			assert(it != end && "Triangle is missing in vertex adjacency");
+			std::iter_swap(it, end - 1);
+			valence[v]--;
+		}
+
+		// vertices of the emitted triangle move to the front of the LRU cache
+		new_cache.assign(tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				new_cache.push_back(v);
+			}
+		}
+
+		// update scores, including the ones of evicted vertices
+		for (size_t i = 0; i < new_cache.size(); i++) {
+			uint32_t v = new_cache[i];
+			cache_position[v] = (i < FORSYTH_CACHE_SIZE) ? static_cast<int>(i) : -1;
+			vertex_score[v] = forsyth_vertex_score(cache_position[v], valence[v]);
+		}
+
+		if (new_cache.size() > FORSYTH_CACHE_SIZE) {
+			new_cache.resize(FORSYTH_CACHE_SIZE);
+		}
+		std::swap(cache, new_cache);
+
+		// next triangle is the best one touching the cache
+		best_triangle = -1;
+		best_score = -1.0f;
+		for (uint32_t v : cache) {
+			for (uint32_t a = adjacency_offset[v]; a < adjacency_offset[v] + valence[v]; a++) {
+				float score = triangle_score(adjacency[a]);
+				if (score > best_score) {
+					best_score = score;
+					best_triangle = adjacency[a];
+				}
+			}
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void optimize_overdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices)
+{
+	ZoneScoped;
+
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count <= 1) {
+		return;
+	}
+
+	// start a new cluster whenever a triangle misses the cache with all three vertices
+	// reordering at these points barely affects the cache efficiency
+	const uint32_t cache_size = 16;
+	std::vector<uint32_t> timestamps(vertices.size(), 0);
+	uint32_t time = cache_size + 1;
+
+	std::vector<size_t> cluster_starts;
+	for (size_t t = 0; t < triangle_count; t++) {
+		uint32_t misses = 0;
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t idx = indices[3 * t + k];
+			if (time - timestamps[idx] > cache_size) {
+				timestamps[idx] = time++;
+				misses++;
+			}
+		}
+
+		if (t == 0 || misses == 3) {
+			cluster_starts.push_back(t);
+		}
+	}
+	cluster_starts.push_back(triangle_count);
+
+	size_t cluster_count = cluster_starts.size() - 1;
+	if (cluster_count <= 1) {
+		return;
+	}
+
+	// area weighted centroids and normals
+	glm::vec3 mesh_centroid{ 0 };
+	float mesh_area = 0;
+
+	std::vector<glm::vec3> cluster_centroids(cluster_count, glm::vec3{ 0 });
+	std::vector<glm::vec3> cluster_normals(cluster_count, glm::vec3{ 0 });
+
+	for (size_t c = 0; c < cluster_count; c++) {
+		float cluster_area = 0;
+
+		for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; t++) {
+			const glm::vec3& p0 = vertices[indices[3 * t + 0]].position;
+			const glm::vec3& p1 = vertices[indices[3 * t + 1]].position;
+			const glm::vec3& p2 = vertices[indices[3 * t + 2]].position;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+			cluster_centroids[c] += centroid * area;
+			cluster_normals[c] += normal;
+			cluster_area += area;
+		}
+
+		mesh_centroid += cluster_centroids[c];
+		mesh_area += cluster_area;
+
+		if (cluster_area > 0) {
+			cluster_centroids[c] /= cluster_area;
+		}
+	}
+
+	if (mesh_area > 0) {
+		mesh_centroid /= mesh_area;
+	}
+
+	// clusters facing away from the center are likely to occlude others, so they are drawn first
+	std::vector<float> cluster_keys(cluster_count);
+	for (size_t c = 0; c < cluster_count; c++) {
+		float length = glm::length(cluster_normals[c]);
+		glm::vec3 normal = length > 0 ? cluster_normals[c] / length : glm::vec3{ 0 };
+		cluster_keys[c] = glm::dot(cluster_centroids[c] - mesh_centroid, normal);
+	}
+
+	std::vector<size_t> cluster_order(cluster_count);
+	for (size_t c = 0; c < cluster_count; c++) {
+		cluster_order[c] = c;
+	}
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [&cluster_keys](size_t a, size_t b) {
+		return cluster_keys[a] > cluster_keys[b];
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (size_t c : cluster_order) {
+		result.insert(result.end(), indices.begin() + 3 * cluster_starts[c], indices.begin() + 3 * cluster_starts[c + 1]);
+	}
+
+	indices = std::move(result);
+}
+
+void optimize_vertex_fetch(MeshData& data)
+{
+	ZoneScoped;
+
+	std::vector<uint32_t> remap(data.vertices.size(), std::numeric_limits<uint32_t>::max());
+
+	std::vector<Vertex> vertices;
+	vertices.reserve(data.vertices.size());
+
+	for (std::vector<uint32_t>& indices : data.indices) {
+		for (uint32_t& idx : indices) {
+			if (remap[idx] == std::numeric_limits<uint32_t>::max()) {
+				remap[idx] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(data.vertices[idx]);
+			}
+			idx = remap[idx];
+		}
+	}
+
+	data.vertices = std::move(vertices);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "MeshCache.h"
+
+#include <span>
+
+// Import stage for meshes, runs before meshes are written into the mesh cache
+// Welds identical vertices, reorders the index lists for vertex cache locality and overdraw and the vertices for fetch locality
+void optimize_mesh(MeshData& data, const std::string& name);
+
+// merges bitwise identical vertices and remaps all index lists
+void weld_vertices(MeshData& data);
+
+// reorders triangles for the post transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+// reorders clusters of cache optimized triangles such that outward facing clusters are drawn first
+// clusters are split where the vertex cache would be cold anyway, so the cache efficiency is mostly kept
+void optimize_overdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices);
+
+// reorders vertices in order of first use by the index lists and drops unused ones
+void optimize_vertex_fetch(MeshData& data);
@@ -0,0 +1,590 @@
+#include "common.h"
+#include "MeshSimplification.h"
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+// normal and uv of the vertices are kept by the attribute quadrics
+constexpr uint32_t SIMPLIFY_ATTRIBUTE_COUNT = 5;
+// the positions are scaled to a unit extent, normals vary more than uvs over a mesh so they are weighted less
+constexpr float SIMPLIFY_NORMAL_WEIGHT = 0.5f;
+constexpr float SIMPLIFY_UV_WEIGHT = 1.0f;
+// planes through open borders are weighted up, such that the outline of the mesh is kept
+constexpr float SIMPLIFY_BORDER_WEIGHT = 10.0f;
+// collapses of a pass may exceed the error of the collapse reaching the target by this factor, as many are skipped due to locked neighbourhoods
+constexpr float SIMPLIFY_PASS_ERROR_FACTOR = 1.5f;
+
+constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t MIXED_MATERIALS = NO_VERTEX - 1;
+
+using Attributes = std::array<float, SIMPLIFY_ATTRIBUTE_COUNT>;
+
+// decides along which edges a vertex can be collapsed
+enum class CollapseKind : uint8_t {
+	Manifold, // interior vertex at a unique position, collapses onto any neighbour
+	Border,   // on an open border, collapses along the border
+	Seam,     // one of the two vertices at a position splitting the attributes, collapses along the seam together with its twin
+	Locked,   // more complex topology or between materials, never collapses
+};
+
+// COLLAPSE_ALLOWED[from][to], border and seam vertices additionally only collapse along their border or seam
+constexpr bool COLLAPSE_ALLOWED[4][4] = {
+	{ true, true, true, true },
+	{ false, true, false, false },
+	{ false, false, true, false },
+	{ false, false, false, false },
+};
+
+struct EdgeCollapse {
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+// symmetric quadratic form p^T a p + 2 b^T p + c, summed over triangles weighted by their area
+struct Quadric {
+	glm::mat3 a{ 0.0f };
+	glm::vec3 b{ 0.0f };
+	float c = 0.0f;
+	float weight = 0.0f;
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		a += other.a;
+		b += other.b;
+		c += other.c;
+		weight += other.weight;
+		return *this;
+	}
+
+	float evaluate(const glm::vec3& p) const
+	{
+		return glm::dot(p, a * p) + 2.0f * glm::dot(b, p) + c;
+	}
+};
+
+// squared deviation sum_j (dot(g_j, p) + d_j - s_j)^2 of the attributes s_j from their linear interpolation over the triangles
+// the terms without s_j are part of the quadric, the gradients hold the area weighted (g_j, d_j) for the remaining ones
+struct AttributeQuadric {
+	Quadric quadric;
+	std::array<glm::vec4, SIMPLIFY_ATTRIBUTE_COUNT> gradients{};
+
+	AttributeQuadric& operator+=(const AttributeQuadric& other)
+	{
+		quadric += other.quadric;
+		for (uint32_t j = 0; j < SIMPLIFY_ATTRIBUTE_COUNT; j++) {
+			gradients[j] += other.gradients[j];
+		}
+		return *this;
+	}
+
+	float evaluate(const glm::vec3& p, const Attributes& attributes) const
+	{
+		float error = quadric.evaluate(p);
+		for (uint32_t j = 0; j < SIMPLIFY_ATTRIBUTE_COUNT; j++) {
+			float interpolated = glm::dot(glm::vec3(gradients[j]), p) + gradients[j].w;
+			error += attributes[j] * (attributes[j] * quadric.weight - 2.0f * interpolated);
+		}
+		return error;
+	}
+};
+
+// vertices are at the same position if their positions are bitwise identical
+struct PositionHash {
+	size_t operator()(const glm::vec3& p) const
+	{
+		uint32_t words[3];
+		std::memcpy(words, &p, sizeof(words));
+
+		uint64_t hash = 14695981039346656037ull;
+		for (uint32_t w : words) {
+			hash = (hash ^ w) * 1099511628211ull;
+		}
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+};
+
+struct PositionEqual {
+	bool operator()(const glm::vec3& a, const glm::vec3& b) const
+	{
+		return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+	}
+};
+
+static inline uint64_t edge_key(uint32_t from, uint32_t to)
+{
+	return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+static Attributes get_attributes(const Vertex& vertex)
+{
+	return {
+		vertex.normal.x * SIMPLIFY_NORMAL_WEIGHT,
+		vertex.normal.y * SIMPLIFY_NORMAL_WEIGHT,
+		vertex.normal.z * SIMPLIFY_NORMAL_WEIGHT,
+		vertex.uv_x * SIMPLIFY_UV_WEIGHT,
+		vertex.uv_y * SIMPLIFY_UV_WEIGHT
+	};
+}
+
+// squared distance to the plane dot(normal, p) + distance = 0
+static Quadric plane_quadric(const glm::vec3& normal, float distance, float weight)
+{
+	Quadric quadric;
+	quadric.a = weight * glm::outerProduct(normal, normal);
+	quadric.b = weight * distance * normal;
+	quadric.c = weight * distance * distance;
+	quadric.weight = weight;
+	return quadric;
+}
+
+// the gradient g_j of each attribute lies in the plane of the triangle and interpolates the attribute at its corners
+static AttributeQuadric attribute_quadric(const std::array<glm::vec3, 3>& p, const std::array<const Attributes*, 3>& attributes, float weight)
+{
+	glm::vec3 e1 = p[1] - p[0];
+	glm::vec3 e2 = p[2] - p[0];
+	float d11 = glm::dot(e1, e1);
+	float d12 = glm::dot(e1, e2);
+	float d22 = glm::dot(e2, e2);
+	float denominator = d11 * d22 - d12 * d12;
+	float inv_denominator = denominator == 0.0f ? 0.0f : 1.0f / denominator;
+
+	// solves dot(g, e1) = s_1 - s_0 and dot(g, e2) = s_2 - s_0 for g in the span of e1 and e2
+	glm::vec3 g1 = (d22 * e1 - d12 * e2) * inv_denominator;
+	glm::vec3 g2 = (d11 * e2 - d12 * e1) * inv_denominator;
+
+	AttributeQuadric result;
+	result.quadric.weight = weight;
+	for (uint32_t j = 0; j < SIMPLIFY_ATTRIBUTE_COUNT; j++) {
+		float s0 = (*attributes[0])[j];
+		glm::vec3 g = g1 * ((*attributes[1])[j] - s0) + g2 * ((*attributes[2])[j] - s0);
+		float d = s0 - glm::dot(g, p[0]);
+
+		result.quadric.a += weight * glm::outerProduct(g, g);
+		result.quadric.b += weight * d * g;
+		result.quadric.c += weight * d * d;
+		result.gradients[j] = weight * glm::vec4(g, d);
+	}
+	return result;
+}
+
+// drops triangles with two corners at the same position
+static void remove_degenerate_triangles(std::vector<uint32_t>& indices, std::vector<uint32_t>& triangle_materials, const std::vector<uint32_t>& remap)
+{
+	size_t kept = 0;
+	for (size_t t = 0; t < triangle_materials.size(); t++) {
+		uint32_t p0 = remap[indices[3 * t]];
+		uint32_t p1 = remap[indices[3 * t + 1]];
+		uint32_t p2 = remap[indices[3 * t + 2]];
+		if (p0 == p1 || p1 == p2 || p0 == p2) {
+			continue;
+		}
+
+		for (size_t c = 0; c < 3; c++) {
+			indices[3 * kept + c] = indices[3 * t + c];
+		}
+		triangle_materials[kept] = triangle_materials[t];
+		kept++;
+	}
+	indices.resize(3 * kept);
+	triangle_materials.resize(kept);
+}
+
+void simplify_mesh(const MeshData& data, float triangle_ratio, MeshLod& lod)
+{
+	ZoneScoped;
+
+	const uint32_t vertex_count = static_cast<uint32_t>(data.vertices.size());
+
+	// all materials are simplified together, each triangle remembers its material
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> triangle_materials;
+	for (size_t material = 0; material < data.indices.size(); material++) {
+		indices.insert(indices.end(), data.indices[material].begin(), data.indices[material].end());
+		triangle_materials.insert(triangle_materials.end(), data.indices[material].size() / 3, static_cast<uint32_t>(material));
+	}
+	const size_t target_index_count = 3 * std::max<size_t>(static_cast<size_t>(triangle_ratio * triangle_materials.size()), 1);
+
+	// scaled to a unit extent, such that the errors do not depend on the size of the mesh
+	glm::vec3 min_pos{ std::numeric_limits<float>::max() };
+	glm::vec3 max_pos{ std::numeric_limits<float>::lowest() };
+	for (const Vertex& vertex : data.vertices) {
+		min_pos = glm::min(min_pos, vertex.position);
+		max_pos = glm::max(max_pos, vertex.position);
+	}
+	glm::vec3 extent = max_pos - min_pos;
+	float max_extent = std::max({ extent.x, extent.y, extent.z });
+	float scale = max_extent > 0.0f ? 1.0f / max_extent : 1.0f;
+
+	std::vector<glm::vec3> positions(vertex_count);
+	std::vector<Attributes> attributes(vertex_count);
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		positions[i] = (data.vertices[i].position - min_pos) * scale;
+		attributes[i] = get_attributes(data.vertices[i]);
+	}
+
+	// remap points to the first vertex at the same position, wedge links all vertices at a position in a cycle
+	std::vector<uint32_t> remap(vertex_count);
+	std::vector<uint32_t> wedge(vertex_count);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> first_vertices;
+		first_vertices.reserve(vertex_count);
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			auto [it, inserted] = first_vertices.try_emplace(data.vertices[i].position, i);
+			remap[i] = it->second;
+			wedge[i] = i;
+			if (!inserted) {
+				wedge[i] = wedge[it->second];
+				wedge[it->second] = i;
+			}
+		}
+	}
+
+	remove_degenerate_triangles(indices, triangle_materials, remap);
+
+	// open edges have no opposite edge, loop follows them forward and loop_back backward
+	// NO_VERTEX without open edge and the vertex itself if it has several
+	std::vector<uint32_t> loop(vertex_count, NO_VERTEX);
+	std::vector<uint32_t> loop_back(vertex_count, NO_VERTEX);
+	{
+		std::unordered_set<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t t = 0; t < triangle_materials.size(); t++) {
+			for (size_t e = 0; e < 3; e++) {
+				edges.insert(edge_key(indices[3 * t + e], indices[3 * t + (e + 1) % 3]));
+			}
+		}
+
+		for (size_t t = 0; t < triangle_materials.size(); t++) {
+			for (size_t e = 0; e < 3; e++) {
+				uint32_t a = indices[3 * t + e];
+				uint32_t b = indices[3 * t + (e + 1) % 3];
+				if (!edges.contains(edge_key(b, a))) {
+					loop[a] = loop[a] == NO_VERTEX ? b : a;
+					loop_back[b] = loop_back[b] == NO_VERTEX ? a : b;
+				}
+			}
+		}
+	}
+
+	std::vector<uint32_t> vertex_materials(vertex_count, NO_VERTEX);
+	for (size_t t = 0; t < triangle_materials.size(); t++) {
+		for (size_t c = 0; c < 3; c++) {
+			uint32_t& material = vertex_materials[indices[3 * t + c]];
+			material = (material == NO_VERTEX || material == triangle_materials[t]) ? triangle_materials[t] : MIXED_MATERIALS;
+		}
+	}
+
+	// classified once per position, a single open edge in and out makes a border
+	// a seam has exactly two vertices, whose open edges run along the same positions in opposite directions
+	auto has_single_open_edge = [](uint32_t vertex, uint32_t next) { return next != NO_VERTEX && next != vertex; };
+	std::vector<CollapseKind> kinds(vertex_count, CollapseKind::Locked);
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		if (remap[i] != i) {
+			continue;
+		}
+
+		if (wedge[i] == i) {
+			if (loop[i] == NO_VERTEX && loop_back[i] == NO_VERTEX) {
+				kinds[i] = CollapseKind::Manifold;
+			}
+			else if (has_single_open_edge(i, loop[i]) && has_single_open_edge(i, loop_back[i])) {
+				kinds[i] = CollapseKind::Border;
+			}
+		}
+		else if (wedge[wedge[i]] == i) {
+			uint32_t twin = wedge[i];
+			bool single_edges = has_single_open_edge(i, loop[i]) && has_single_open_edge(i, loop_back[i]) &&
+				has_single_open_edge(twin, loop[twin]) && has_single_open_edge(twin, loop_back[twin]);
+			if (single_edges && remap[loop[i]] == remap[loop_back[twin]] && remap[loop_back[i]] == remap[loop[twin]]) {
+				kinds[i] = CollapseKind::Seam;
+			}
+		}
+	}
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		if (vertex_materials[i] == MIXED_MATERIALS) {
+			kinds[remap[i]] = CollapseKind::Locked;
+		}
+	}
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		kinds[i] = kinds[remap[i]];
+	}
+
+	// position quadrics are accumulated per position (at the remapped vertex), attribute quadrics per vertex
+	std::vector<Quadric> position_quadrics(vertex_count);
+	std::vector<AttributeQuadric> attribute_quadrics(vertex_count);
+	for (size_t t = 0; t < triangle_materials.size(); t++) {
+		std::array<uint32_t, 3> corners{ indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] };
+		std::array<glm::vec3, 3> p{ positions[corners[0]], positions[corners[1]], positions[corners[2]] };
+
+		glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		float length = glm::length(normal);
+		if (length == 0.0f) {
+			continue;
+		}
+		normal /= length;
+		float area = 0.5f * length;
+
+		Quadric plane = plane_quadric(normal, -glm::dot(normal, p[0]), area);
+		AttributeQuadric attribute = attribute_quadric(p, { &attributes[corners[0]], &attributes[corners[1]], &attributes[corners[2]] }, area);
+		for (uint32_t corner : corners) {
+			position_quadrics[remap[corner]] += plane;
+			attribute_quadrics[corner] += attribute;
+		}
+
+		// planes through the open edges, perpendicular to the triangle, keep borders and seams in place
+		for (size_t e = 0; e < 3; e++) {
+			uint32_t a = corners[e];
+			uint32_t b = corners[(e + 1) % 3];
+			if (loop[a] != b) {
+				continue;
+			}
+
+			glm::vec3 edge = positions[b] - positions[a];
+			float edge_length = glm::length(edge);
+			if (edge_length == 0.0f) {
+				continue;
+			}
+
+			glm::vec3 edge_normal = glm::normalize(glm::cross(edge, normal));
+			bool border = kinds[a] == CollapseKind::Border || kinds[b] == CollapseKind::Border;
+			Quadric edge_plane = plane_quadric(edge_normal, -glm::dot(edge_normal, positions[a]), edge_length * edge_length * (border ? SIMPLIFY_BORDER_WEIGHT : 1.0f));
+			position_quadrics[remap[a]] += edge_plane;
+			position_quadrics[remap[b]] += edge_plane;
+		}
+	}
+
+	// the seam runs in the opposite direction on the side of the twin, NO_VERTEX if it does not lead to the position of to
+	auto get_twin_target = [&](const EdgeCollapse& collapse) {
+		uint32_t twin = wedge[collapse.from];
+		uint32_t twin_to = loop[collapse.from] == collapse.to ? loop_back[twin] : loop[twin];
+		return twin_to != NO_VERTEX && remap[twin_to] == remap[collapse.to] ? twin_to : NO_VERTEX;
+	};
+
+	std::vector<EdgeCollapse> collapses;
+	std::vector<uint32_t> collapse_remap(vertex_count);
+	std::vector<bool> locked(vertex_count);
+	std::vector<uint32_t> triangle_offsets(vertex_count + 1);
+	std::vector<uint32_t> triangle_cursors(vertex_count);
+	std::vector<uint32_t> position_triangles;
+	std::vector<uint32_t> remapped_loop(vertex_count);
+	std::vector<uint32_t> from_neighbours;
+	std::vector<uint32_t> to_neighbours;
+	std::vector<uint32_t> edge_opposites;
+	float max_error = 0.0f;
+
+	// every pass collapses the cheapest edges whose neighbourhoods do not overlap, then removes the collapsed triangles
+	while (indices.size() > target_index_count) {
+		// triangles around each position
+		std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+		for (uint32_t index : indices) {
+			triangle_offsets[remap[index] + 1]++;
+		}
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			triangle_offsets[i + 1] += triangle_offsets[i];
+		}
+		std::copy(triangle_offsets.begin(), triangle_offsets.end() - 1, triangle_cursors.begin());
+		position_triangles.resize(indices.size());
+		for (size_t k = 0; k < indices.size(); k++) {
+			position_triangles[triangle_cursors[remap[indices[k]]]++] = static_cast<uint32_t>(k / 3);
+		}
+
+		collapses.clear();
+		for (size_t t = 0; t < triangle_materials.size(); t++) {
+			for (size_t e = 0; e < 3; e++) {
+				uint32_t a = indices[3 * t + e];
+				uint32_t b = indices[3 * t + (e + 1) % 3];
+				bool along_loop = loop[a] == b || loop[b] == a;
+
+				for (auto [from, to] : { std::pair{ a, b }, std::pair{ b, a } }) {
+					CollapseKind from_kind = kinds[from];
+					if (!COLLAPSE_ALLOWED[static_cast<size_t>(from_kind)][static_cast<size_t>(kinds[to])]) {
+						continue;
+					}
+					if ((from_kind == CollapseKind::Border || from_kind == CollapseKind::Seam) && !along_loop) {
+						continue;
+					}
+					collapses.push_back({ from, to, 0.0f });
+				}
+			}
+		}
+
+		// interior edges are found from both of their triangles
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return edge_key(a.from, a.to) < edge_key(b.from, b.to); });
+		collapses.erase(std::unique(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.from == b.from && a.to == b.to; }), collapses.end());
+
+		for (EdgeCollapse& collapse : collapses) {
+			const glm::vec3& target = positions[collapse.to];
+			float error = position_quadrics[remap[collapse.from]].evaluate(target) + attribute_quadrics[collapse.from].evaluate(target, attributes[collapse.to]);
+
+			// seams whose twin does not lead to the same position are marked invalid
+			if (kinds[collapse.from] == CollapseKind::Seam) {
+				uint32_t twin_to = get_twin_target(collapse);
+				error = twin_to == NO_VERTEX ? std::numeric_limits<float>::infinity() : error + attribute_quadrics[wedge[collapse.from]].evaluate(target, attributes[twin_to]);
+			}
+			// the quadrics are positive semi definite, negative values are rounding errors
+			collapse.error = std::abs(error);
+		}
+		// invalid collapses are dropped, such that neither they nor the error limit of the pass depend on them
+		std::erase_if(collapses, [](const EdgeCollapse& collapse) { return !std::isfinite(collapse.error); });
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.error < b.error; });
+
+		// manifold and seam collapses remove two triangles, border collapses one
+		const size_t triangle_goal = (indices.size() - target_index_count) / 3;
+		const size_t collapse_goal = triangle_goal / 2;
+		const float error_limit = collapse_goal < collapses.size() ? SIMPLIFY_PASS_ERROR_FACTOR * collapses[collapse_goal].error : std::numeric_limits<float>::max();
+
+		for (uint32_t i = 0; i < vertex_count; i++) {
+			collapse_remap[i] = i;
+		}
+		std::fill(locked.begin(), locked.end(), false);
+
+		size_t removed_triangles = 0;
+		for (const EdgeCollapse& collapse : collapses) {
+			if (removed_triangles >= triangle_goal || collapse.error > error_limit) {
+				break;
+			}
+
+			uint32_t from_position = remap[collapse.from];
+			uint32_t to_position = remap[collapse.to];
+			if (locked[from_position] || locked[to_position]) {
+				continue;
+			}
+
+			// triangles keeping the position of from must not flip when it moves
+			const glm::vec3& target = positions[collapse.to];
+			bool flips = false;
+			for (uint32_t k = triangle_offsets[from_position]; k < triangle_offsets[from_position + 1] && !flips; k++) {
+				uint32_t t = position_triangles[k];
+				std::array<glm::vec3, 3> before{};
+				std::array<glm::vec3, 3> after{};
+				bool removed = false;
+				for (size_t c = 0; c < 3; c++) {
+					uint32_t vertex = indices[3 * t + c];
+					removed = removed || remap[vertex] == to_position;
+					before[c] = positions[vertex];
+					after[c] = remap[vertex] == from_position ? target : before[c];
+				}
+
+				glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = !removed && glm::dot(normal_before, normal_after) <= 0.0f;
+			}
+			if (flips) {
+				continue;
+			}
+
+			// link condition: the only positions adjacent to both ends are opposite to the edge in its triangles
+			// otherwise the collapse pinches the surface (i.e. two borders or seams) into a non manifold edge
+			from_neighbours.clear();
+			to_neighbours.clear();
+			edge_opposites.clear();
+			for (uint32_t k = triangle_offsets[from_position]; k < triangle_offsets[from_position + 1]; k++) {
+				uint32_t t = position_triangles[k];
+				bool on_edge = false;
+				for (size_t c = 0; c < 3; c++) {
+					on_edge = on_edge || remap[indices[3 * t + c]] == to_position;
+				}
+				for (size_t c = 0; c < 3; c++) {
+					uint32_t position = remap[indices[3 * t + c]];
+					if (position != from_position && position != to_position) {
+						from_neighbours.push_back(position);
+						if (on_edge) {
+							edge_opposites.push_back(position);
+						}
+					}
+				}
+			}
+			for (uint32_t k = triangle_offsets[to_position]; k < triangle_offsets[to_position + 1]; k++) {
+				uint32_t t = position_triangles[k];
+				for (size_t c = 0; c < 3; c++) {
+					uint32_t position = remap[indices[3 * t + c]];
+					if (position != from_position && position != to_position) {
+						to_neighbours.push_back(position);
+					}
+				}
+			}
+			for (std::vector<uint32_t>* neighbour_list : { &from_neighbours, &to_neighbours, &edge_opposites }) {
+				std::sort(neighbour_list->begin(), neighbour_list->end());
+				neighbour_list->erase(std::unique(neighbour_list->begin(), neighbour_list->end()), neighbour_list->end());
+			}
+
+			// the opposites are common neighbours, so the counts only match if there are no others
+			size_t common_neighbours = 0;
+			for (uint32_t position : from_neighbours) {
+				common_neighbours += std::binary_search(to_neighbours.begin(), to_neighbours.end(), position) ? 1 : 0;
+			}
+			if (common_neighbours != edge_opposites.size()) {
+				continue;
+			}
+
+			collapse_remap[collapse.from] = collapse.to;
+			attribute_quadrics[collapse.to] += attribute_quadrics[collapse.from];
+			if (kinds[collapse.from] == CollapseKind::Seam) {
+				uint32_t twin = wedge[collapse.from];
+				uint32_t twin_to = get_twin_target(collapse);
+				collapse_remap[twin] = twin_to;
+				attribute_quadrics[twin_to] += attribute_quadrics[twin];
+			}
+			position_quadrics[to_position] += position_quadrics[from_position];
+
+			// adjacency and quadrics of this pass are outdated around the collapse
+			for (uint32_t k = triangle_offsets[from_position]; k < triangle_offsets[from_position + 1]; k++) {
+				uint32_t t = position_triangles[k];
+				for (size_t c = 0; c < 3; c++) {
+					locked[remap[indices[3 * t + c]]] = true;
+				}
+			}
+
+			removed_triangles += kinds[collapse.from] == CollapseKind::Border ? 1 : 2;
+			max_error = std::max(max_error, collapse.error);
+		}
+
+		if (removed_triangles == 0) {
+			break;
+		}
+
+		for (uint32_t& index : indices) {
+			index = collapse_remap[index];
+		}
+		remove_degenerate_triangles(indices, triangle_materials, remap);
+
+		// open edges leading to a collapsed vertex continue at its target
+		// written into a copy, such that every vertex reads the loops from before the pass
+		for (std::vector<uint32_t>* edges : { &loop, &loop_back }) {
+			remapped_loop.assign(edges->begin(), edges->end());
+			for (uint32_t i = 0; i < vertex_count; i++) {
+				uint32_t next = (*edges)[i];
+				if (next != NO_VERTEX) {
+					uint32_t target = collapse_remap[next];
+					// i is the target if the edge was collapsed against its direction
+					remapped_loop[i] = target == i ? (*edges)[next] : target;
+				}
+			}
+			edges->swap(remapped_loop);
+		}
+	}
+
+	// same ordering as the import stage of the mesh itself (see optimize_mesh)
+	MeshData simplified;
+	simplified.vertices = data.vertices;
+	simplified.indices.resize(data.indices.size());
+	for (size_t t = 0; t < triangle_materials.size(); t++) {
+		std::vector<uint32_t>& material_indices = simplified.indices[triangle_materials[t]];
+		material_indices.insert(material_indices.end(), indices.begin() + 3 * t, indices.begin() + 3 * t + 3);
+	}
+	for (std::vector<uint32_t>& material_indices : simplified.indices) {
+		optimize_vertex_cache(material_indices, simplified.vertices.size());
+		optimize_overdraw(material_indices, simplified.vertices);
+	}
+	optimize_vertex_fetch(simplified);
+
+	lod.triangle_ratio = triangle_ratio;
+	lod.error = max_error;
+	lod.vertices = std::move(simplified.vertices);
+	lod.indices = std::move(simplified.indices);
+}
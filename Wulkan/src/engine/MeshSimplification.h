@@ -0,0 +1,11 @@
+#pragma once
+
+#include "MeshCache.h"
+
+// Import stage for lods, simplifies a mesh by collapsing edges (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics")
+// The cost of collapsing a vertex onto a neighbour is the squared distance to the planes of the triangles merged into it,
+// plus the deviation of the normals and uvs interpolated over them (Hoppe, "New Quadric Metric for Simplifying Meshes with Appearance Attributes")
+// Vertices on open borders and uv seams only collapse along the border or seam, vertices between materials are kept
+// Edges are collapsed onto one of their vertices, so the lod uses a subset of the vertices of data and keeps their attributes
+// Collapses continue until triangle_ratio of the triangles are left or no edge can be collapsed without flipping triangles or pinching the surface
+void simplify_mesh(const MeshData& data, float triangle_ratio, MeshLod& lod);
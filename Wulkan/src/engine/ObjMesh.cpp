@@ -1,5 +1,8 @@
 #include "common.h"
 #include "ObjMesh.h"
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
+#include "ObjParser.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -8,9 +11,35 @@
 
 #include "spdlog/spdlog.h"
 
-void ObjMesh::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const VKW_Path& mtl_path)
+#include <chrono>
+
+void ObjMesh::init(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const VKW_Path& mtl_path)
 {
 	spdlog::info("Loading file {}", obj_path);
+
+	MeshCache cache;
+	MeshData data;
+	bool cached = load(thread_pool, obj_path, mtl_path, {}, cache, data);
+	init_lod(device, texture_streamer, geometry, descriptor_pool, render_pass, obj_path, cached ? &cache : nullptr, data, 0);
+}
+
+std::vector<ObjMesh> ObjMesh::create_lods(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, std::span<const float> triangle_ratios, const VKW_Path& mtl_path)
+{
+	spdlog::info("Loading file {} with {} simplified lods", obj_path, triangle_ratios.size());
+
+	MeshCache cache;
+	MeshData data;
+	bool cached = load(thread_pool, obj_path, mtl_path, triangle_ratios, cache, data);
+
+	std::vector<ObjMesh> lods(triangle_ratios.size() + 1);
+	for (size_t lod = 0; lod < lods.size(); lod++) {
+		lods[lod].init_lod(device, texture_streamer, geometry, descriptor_pool, render_pass, obj_path, cached ? &cache : nullptr, data, lod);
+	}
+	return lods;
+}
+
+bool ObjMesh::load(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, std::span<const float> triangle_ratios, MeshCache& cache, MeshData& data)
+{
 	// open file
 	if (obj_path.extension() != ".obj") {
 		throw IOException(
@@ -19,104 +48,92 @@ void ObjMesh::init(const VKW_Device& device, const VKW_CommandPool& graphics_poo
 		);
 	}
 
-	tinyobj::ObjReaderConfig reader_config;
-	reader_config.mtl_search_path = mtl_path.string(); // Path to material files
+	auto start_time = std::chrono::high_resolution_clock::now();
 
-	tinyobj::ObjReader reader;
+	// try to load from binary cache next to the obj, otherwise parse and (re)create the cache
+	if (cache.open(obj_path)) {
+		bool has_lods = triangle_ratios.empty() || cache.get_lod_count() == triangle_ratios.size() + 1;
+		for (size_t i = 0; has_lods && i < triangle_ratios.size(); i++) {
+			has_lods = cache.get_lod_triangle_ratio(i + 1) == triangle_ratios[i];
+		}
 
-	if (!reader.ParseFromFile(obj_path.string(), reader_config)) {
-		throw IOException(
-			fmt::format("Tried to open file {}, Error: {} ", obj_path, reader.Error()),
-			__FILE__, __LINE__
-		);
+		if (has_lods) {
+			std::chrono::duration<float, std::milli> load_time = std::chrono::high_resolution_clock::now() - start_time;
+			spdlog::info("Loaded {} from mesh cache in {:.2f}ms (text parse took {:.2f}ms)", obj_path, load_time.count(), cache.get_parse_time());
+			return true;
+		}
+
+		spdlog::info("Mesh cache of {} has different lods", obj_path);
+		cache.close();
 	}
 
-	if (!reader.Warning().empty()) {
-		// might be too strict in some cases, but for example is ok for current warning encountered (material file missing)
-		throw IOException(
-			fmt::format("Tried to open file {}, Error: {}", obj_path, reader.Warning()),
-			__FILE__, __LINE__
+	std::vector<VKW_Path> dependencies;
+	parse(thread_pool, obj_path, mtl_path, data, dependencies);
+	optimize_mesh(data, obj_path.filename().string());
+
+	// the lods only read the mesh, so they are simplified in parallel
+	data.lods.resize(triangle_ratios.size());
+	thread_pool.parallel_for(triangle_ratios.size(), [&data, &triangle_ratios](size_t lod) {
+		simplify_mesh(data, triangle_ratios[lod], data.lods[lod]);
+	});
+
+	auto count_triangles = [](const std::vector<std::vector<uint32_t>>& indices) {
+		size_t count = 0;
+		for (const std::vector<uint32_t>& material_indices : indices) {
+			count += material_indices.size() / 3;
+		}
+		return count;
+	};
+	for (const MeshLod& lod : data.lods) {
+		spdlog::info(
+			"Simplified {} to {} of {} triangles (ratio {:.2f}), error {:.3g}",
+			obj_path, count_triangles(lod.indices), count_triangles(data.indices), lod.triangle_ratio, lod.error
 		);
 	}
 
-	auto& attrib = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	auto& materials = reader.GetMaterials();
+	std::chrono::duration<float, std::milli> parse_time = std::chrono::high_resolution_clock::now() - start_time;
+	spdlog::info("Parsed and optimized {} in {:.2f}ms", obj_path, parse_time.count());
 
-	// process mesh data
-	m_meshes = std::vector<Mesh>(materials.size());
+	try {
+		MeshCache::write(obj_path, dependencies, data, parse_time.count());
+	}
+	catch (const IOException& e) {
+		// not being able to cache only slows down the next start up
+		spdlog::warn("Failed to write mesh cache for {}: {}", obj_path, e.what());
+	}
 
-	std::vector<Vertex> vertices;
-	std::vector<std::vector<uint32_t>> indices = std::vector<std::vector<uint32_t>>(materials.size());
-	//std::unordered_map<Vertex, uint32_t> unique_vertices;
-
-	// TODO: big buffers for position, normals etc shared between all shapes
-
-	// Loop over shapes
-	for (const tinyobj::shape_t& shape : shapes) {
-		size_t index_offset = 0;
-		// loop over faces
-		for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-			size_t fv = size_t(shape.mesh.num_face_vertices[f]);
-
-			if (size_t(shape.mesh.num_face_vertices[f]) != 3) {
-				throw RuntimeException(
-					fmt::format("Mesh {} failed to be triangulated. Contains faces with {} vertices", obj_path, fv),
-					__FILE__, __LINE__
-				);
-			}
-
-			size_t material_idx = shape.mesh.material_ids[f];
-
-			for (size_t v = 0; v < fv; v++) {
-				tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-
-				// asssemble vertex
-				glm::vec3 p = {
-						attrib.vertices[3 * size_t(idx.vertex_index) + 0],
-						attrib.vertices[3 * size_t(idx.vertex_index) + 1],
-						attrib.vertices[3 * size_t(idx.vertex_index) + 2]
-				};
-
-				glm::vec3 n = (idx.normal_index >= 0) ? glm::vec3{
-					attrib.normals[3 * size_t(idx.normal_index) + 0],
-					attrib.normals[3 * size_t(idx.normal_index) + 1],
-					attrib.normals[3 * size_t(idx.normal_index) + 2],
-				} : glm::vec3{0, 0, 0};
-
-				float uv_x = (idx.texcoord_index >= 0) ? attrib.texcoords[2 * size_t(idx.texcoord_index) + 0] : 0;
-				float uv_y = (idx.texcoord_index >= 0) ? attrib.texcoords[2 * size_t(idx.texcoord_index) + 1] : 0;
-
-				Vertex vert{
-					p,
-					uv_x,
-					n,
-					uv_y,
-					{1,0,1,1} // color
-				};
-
-				// add to vector for buffer
-				uint32_t i = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vert);
-
-				// insert index
-				indices[material_idx].push_back(i);
-			}
-
-			index_offset += fv;
+	return false;
+}
+
+void ObjMesh::init_lod(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const MeshCache* cache, const MeshData& data, size_t lod)
+{
+	if (cache) {
+		std::vector<std::span<const uint32_t>> indices(cache->get_material_count());
+		std::vector<MeshCacheMaterial> materials(cache->get_material_count());
+		for (size_t i = 0; i < cache->get_material_count(); i++) {
+			indices[i] = cache->get_indices(i, lod);
+			materials[i] = cache->get_material(i);
 		}
+
+		init_from_data(device, texture_streamer, geometry, descriptor_pool, render_pass, obj_path, cache->get_vertices(lod), indices, materials);
+		return;
 	}
 
-	// create vertex buffer
-	create_vertex_buffer(device, transfer_pool, vertices, m_vertex_buffer, m_vertex_buffer_address);
+	const std::vector<Vertex>& vertices = lod == 0 ? data.vertices : data.lods[lod - 1].vertices;
+	const std::vector<std::vector<uint32_t>>& lod_indices = lod == 0 ? data.indices : data.lods[lod - 1].indices;
+	std::vector<std::span<const uint32_t>> indices(lod_indices.begin(), lod_indices.end());
+	init_from_data(device, texture_streamer, geometry, descriptor_pool, render_pass, obj_path, vertices, indices, data.materials);
+}
 
-	// create meshes
-	for (size_t i = 0; i < m_meshes.size(); i++) {
-		m_meshes[i].init(device, transfer_pool, m_vertex_buffer_address, indices[i]);
-	}
+void ObjMesh::parse(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, MeshData& data, std::vector<VKW_Path>& dependencies)
+{
+	ZoneScoped;
 
-	// create material instances (with uniform buffers and textures)
-	m_materials.reserve(materials.size());
+	std::vector<tinyobj::material_t> materials;
+	parse_obj(thread_pool, obj_path, mtl_path, data.vertices, data.indices, materials, dependencies);
+
+	// collect material parameters
+	data.materials.reserve(materials.size());
 	for (size_t mat_idx = 0; mat_idx < materials.size(); mat_idx++) {
 		tinyobj::material_t mat = materials[mat_idx];
 
@@ -142,20 +159,46 @@ void ObjMesh::init(const VKW_Device& device, const VKW_CommandPool& graphics_poo
 			config
 		};
 
+		data.materials.push_back({ uniform, mat.name, mat.diffuse_texname });
+	}
+}
+
+void ObjMesh::init_from_data(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, std::span<const Vertex> vertices, const std::vector<std::span<const uint32_t>>& indices, const std::vector<MeshCacheMaterial>& materials)
+{
+	m_meshes = std::vector<Mesh>(materials.size());
+
+	// vertices are shared by all materials, each material has its own range of indices
+	m_geometry = &geometry;
+	m_vertices = geometry.add_vertices(vertices);
+
+	// instances are placed by their origin, so the bounds are centered there
+	m_bounding_radius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		m_bounding_radius = std::max(m_bounding_radius, glm::length(vertex.position));
+	}
+
+	// create meshes
+	for (size_t i = 0; i < m_meshes.size(); i++) {
+		m_meshes[i].init(geometry, m_vertices, indices[i]);
+	}
+
+	// create materials (textures are streamed in)
+	m_materials.reserve(materials.size());
+	for (size_t mat_idx = 0; mat_idx < materials.size(); mat_idx++) {
+		const MeshCacheMaterial& mat = materials[mat_idx];
+
 		m_materials.push_back({});
 		m_materials[mat_idx].init(
-			device, 
-			graphics_pool, 
-			descriptor_pool, 
-			render_pass, 
-			{ ObjMesh::descriptor_set_layout },
-			{ 2 },
-			uniform,
+			texture_streamer, 
+			mat.uniform,
 			obj_path.parent_path(),
 			mat.diffuse_texname,
 			mat.name
 		);
 	}
+
+	// one indirect draw per material
+	init_draws(device, descriptor_pool, render_pass, obj_path.filename().string());
 }
 
 void ObjMesh::del()
@@ -164,9 +207,10 @@ void ObjMesh::del()
 		mesh.del();
 	}
 
-	for (auto& mat : m_materials) {
-		mat.del();
-	}
+	del_draws();
 	
-	m_vertex_buffer.del();
+	if (m_geometry) {
+		m_geometry->free_vertices(m_vertices);
+		m_vertices = {};
+	}
 }
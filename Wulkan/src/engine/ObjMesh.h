@@ -1,36 +1,39 @@
 #pragma once
 
 #include "PBRMesh.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
 
 class ObjMesh : public PBRMesh
 {
 public:
 	ObjMesh() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const VKW_Path& mtl_path="");
+	void init(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const VKW_Path& mtl_path="");
 	void del() override;
 
-	// goes over all materials in obj and renders them, expects to be in active command buffer
+	// loads obj as lod 0, followed by one lod per ratio simplified to that ratio of its triangles (see simplify_mesh)
+	// the lods are stored in the mesh cache as well and only simplified again if the ratios change
+	static std::vector<ObjMesh> create_lods(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, ThreadPool& thread_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, std::span<const float> triangle_ratios, const VKW_Path& mtl_path="");
+
+	// parses obj (and mtl) file into vertices, per material indices and materials (in parallel on the thread pool)
+	// dependencies are set to the mtl files the obj referenced
+	static void parse(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, MeshData& data, std::vector<VKW_Path>& dependencies);
+
+	// renders all materials in obj with one indirect draw, expects to be in active command buffer
 	// TODO: Current assumption is that all materials in ObjMesh use the same pipeline
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
+private:
+	// opens the cache of obj_path if it is up to date and holds the lods of triangle_ratios (any lods if empty)
+	// otherwise parses and optimizes the obj into data, simplifies its lods and rewrites the cache. Returns true if the cache was opened
+	static bool load(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, std::span<const float> triangle_ratios, MeshCache& cache, MeshData& data);
+	// initializes from lod of the cache if it is set, otherwise of data
+	void init_lod(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, const MeshCache* cache, const MeshData& data, size_t lod);
+	// creates buffers and materials, data can either be freshly parsed or point into a mapped cache
+	void init_from_data(const VKW_Device& device, TextureStreamer& texture_streamer, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const VKW_Path& obj_path, std::span<const Vertex> vertices, const std::vector<std::span<const uint32_t>>& indices, const std::vector<MeshCacheMaterial>& materials);
 };
 
 
-inline void ObjMesh::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void ObjMesh::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
 {
-	for (size_t i = 0; i < m_materials.size(); i++) {
-		m_materials[i].bind(
-			command_buffer,
-			current_frame,
-			{
-				m_model,
-				m_inv_model,
-				m_meshes[i].get_vertex_address(),
-				m_instance_buffer_addresses[current_frame],
-				m_cascade_idx,
-				m_lod_level
-			}
-		);
-
-		m_meshes[i].draw(command_buffer, current_frame);
-	}
+	draw_view(command_buffer, current_frame, cascade_idx, 0);
 }
\ No newline at end of file
@@ -0,0 +1,549 @@
+#include "common.h"
+#include "ObjParser.h"
+
+#include "MappedFile.h"
+#include "StartupProfiler.h"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string_view>
+
+// minimal size of a chunk, smaller files are not worth splitting
+constexpr size_t OBJ_MIN_CHUNK_SIZE = 256 * 1024;
+
+// raw indices as written in the obj (1 based, negative for relative indices, 0 if not present)
+struct ObjCorner {
+	int v;
+	int vt;
+	int vn;
+};
+
+struct ObjFace {
+	uint32_t first_corner;
+	uint32_t corner_count;
+
+	// number of attributes read in this chunk before the face, needed to resolve relative indices
+	uint32_t nr_positions;
+	uint32_t nr_uvs;
+	uint32_t nr_normals;
+};
+
+struct ObjChunk {
+	std::string_view text;
+
+	// filled while tokenizing
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<float> normals;
+	std::vector<ObjCorner> corners;
+	std::vector<ObjFace> faces;
+	std::vector<std::pair<size_t, std::string>> material_switches; // usemtl applies from this face index on
+	std::vector<std::string> material_libraries;
+	size_t nr_triangles = 0;
+
+	// filled while merging
+	size_t position_offset = 0;
+	size_t uv_offset = 0;
+	size_t normal_offset = 0;
+	size_t vertex_offset = 0;
+	int start_material = -1;
+	std::vector<int> material_ids; // resolved ids of material_switches
+
+	// filled while assembling
+	std::vector<std::vector<uint32_t>> indices;
+};
+
+static inline bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void skip_space(const char*& ptr, const char* end)
+{
+	while (ptr < end && is_space(*ptr)) {
+		ptr++;
+	}
+}
+
+static inline std::string_view next_token(const char*& ptr, const char* end)
+{
+	skip_space(ptr, end);
+	const char* begin = ptr;
+	while (ptr < end && !is_space(*ptr)) {
+		ptr++;
+	}
+	return { begin, static_cast<size_t>(ptr - begin) };
+}
+
+static inline float parse_float(const char*& ptr, const char* end)
+{
+	skip_space(ptr, end);
+	if (ptr < end && *ptr == '+') {
+		ptr++;
+	}
+
+	float value = 0.0f;
+	auto [next, ec] = std::from_chars(ptr, end, value);
+	if (ec == std::errc()) {
+		ptr = next;
+	}
+	return value;
+}
+
+static inline int parse_int(const char*& ptr, const char* end)
+{
+	int value = 0;
+	auto [next, ec] = std::from_chars(ptr, end, value);
+	if (ec == std::errc()) {
+		ptr = next;
+	}
+	return value;
+}
+
+// parses v, v/vt, v//vn or v/vt/vn
+static inline ObjCorner parse_corner(std::string_view token)
+{
+	const char* ptr = token.data();
+	const char* end = token.data() + token.size();
+
+	ObjCorner corner{ 0, 0, 0 };
+	corner.v = parse_int(ptr, end);
+
+	if (ptr < end && *ptr == '/') {
+		ptr++;
+		if (ptr < end && *ptr != '/') {
+			corner.vt = parse_int(ptr, end);
+		}
+		if (ptr < end && *ptr == '/') {
+			ptr++;
+			corner.vn = parse_int(ptr, end);
+		}
+	}
+
+	return corner;
+}
+
+static inline std::string_view trim(std::string_view s)
+{
+	while (!s.empty() && is_space(s.front())) {
+		s.remove_prefix(1);
+	}
+	while (!s.empty() && is_space(s.back())) {
+		s.remove_suffix(1);
+	}
+	return s;
+}
+
+static void tokenize_chunk(ObjChunk& chunk)
+{
+	ZoneScopedN("Tokenize obj chunk");
+
+	const char* ptr = chunk.text.data();
+	const char* text_end = chunk.text.data() + chunk.text.size();
+
+	while (ptr < text_end) {
+		const char* line_end = static_cast<const char*>(std::memchr(ptr, '\n', text_end - ptr));
+		if (!line_end) {
+			line_end = text_end;
+		}
+
+		const char* p = ptr;
+		ptr = line_end + 1;
+
+		skip_space(p, line_end);
+		if (p >= line_end || *p == '#') {
+			continue;
+		}
+
+		std::string_view keyword = next_token(p, line_end);
+
+		if (keyword == "v") {
+			chunk.positions.push_back(parse_float(p, line_end));
+			chunk.positions.push_back(parse_float(p, line_end));
+			chunk.positions.push_back(parse_float(p, line_end));
+		}
+		else if (keyword == "vt") {
+			chunk.uvs.push_back(parse_float(p, line_end));
+			chunk.uvs.push_back(parse_float(p, line_end));
+		}
+		else if (keyword == "vn") {
+			chunk.normals.push_back(parse_float(p, line_end));
+			chunk.normals.push_back(parse_float(p, line_end));
+			chunk.normals.push_back(parse_float(p, line_end));
+		}
+		else if (keyword == "f") {
+			ObjFace face{
+				static_cast<uint32_t>(chunk.corners.size()),
+				0,
+				static_cast<uint32_t>(chunk.positions.size() / 3),
+				static_cast<uint32_t>(chunk.uvs.size() / 2),
+				static_cast<uint32_t>(chunk.normals.size() / 3)
+			};
+
+			std::string_view token;
+			while (!(token = next_token(p, line_end)).empty()) {
+				chunk.corners.push_back(parse_corner(token));
+				face.corner_count++;
+			}
+
+			if (face.corner_count >= 3) {
+				chunk.nr_triangles += face.corner_count - 2;
+			}
+			chunk.faces.push_back(face);
+		}
+		else if (keyword == "usemtl") {
+			chunk.material_switches.push_back({ chunk.faces.size(), std::string(trim({ p, static_cast<size_t>(line_end - p) })) });
+		}
+		else if (keyword == "mtllib") {
+			std::string_view token;
+			while (!(token = next_token(p, line_end)).empty()) {
+				chunk.material_libraries.push_back(std::string(token));
+			}
+		}
+		// groups, objects, smoothing groups, lines and points are ignored, all faces are flattened into one mesh
+	}
+}
+
+// resolves a raw obj index into a 0 based index into the merged stream, returns -1 if not present
+static inline int64_t resolve_index(int idx, uint32_t local_count, size_t chunk_offset, size_t total, const VKW_Path& obj_path)
+{
+	if (idx == 0) {
+		return -1;
+	}
+
+	int64_t resolved = (idx > 0) ? static_cast<int64_t>(idx) - 1 : static_cast<int64_t>(chunk_offset + local_count) + idx;
+
+	if (resolved < 0 || resolved >= static_cast<int64_t>(total)) {
+		throw RuntimeException(fmt::format("Mesh {} contains invalid index {}", obj_path, idx), __FILE__, __LINE__);
+	}
+	return resolved;
+}
+
+// point in polygon test (Franklin, "PNPOLY"), as used by tinyobj
+static bool is_inside_polygon(int corner_count, const float* xs, const float* ys, float x, float y)
+{
+	bool inside = false;
+	for (int i = 0, j = corner_count - 1; i < corner_count; j = i++) {
+		if (((ys[i] > y) != (ys[j] > y)) && (x < (xs[j] - xs[i]) * (y - ys[i]) / (ys[j] - ys[i]) + xs[i])) {
+			inside = !inside;
+		}
+	}
+	return inside;
+}
+
+// ear clipping of a polygon with more than 4 corners, ported from tinyobj (without mapbox earcut) such that the triangles match
+// the polygon is projected onto the two axes that span its first non degenerate corner
+// triangle is called with the corner indices of each ear, like tinyobj it gives up once no ear is found, leaving fewer than corner_count - 2 triangles
+template<typename F>
+static void triangulate_polygon(std::span<const glm::vec3> corners, const F& triangle)
+{
+	const uint32_t corner_count = static_cast<uint32_t>(corners.size());
+
+	// axes to work in
+	int axes[2] = { 1, 2 };
+	for (uint32_t k = 0; k < corner_count; k++) {
+		glm::vec3 e0 = corners[(k + 1) % corner_count] - corners[k];
+		glm::vec3 e1 = corners[(k + 2) % corner_count] - corners[(k + 1) % corner_count];
+		float cx = std::fabs(e0.y * e1.z - e0.z * e1.y);
+		float cy = std::fabs(e0.z * e1.x - e0.x * e1.z);
+		float cz = std::fabs(e0.x * e1.y - e0.y * e1.x);
+		const float epsilon = std::numeric_limits<float>::epsilon();
+		if (cx > epsilon || cy > epsilon || cz > epsilon) {
+			if (!(cx > cy && cx > cz)) {
+				axes[0] = 0;
+				if (cz > cx && cz > cy) {
+					axes[1] = 1;
+				}
+			}
+			break;
+		}
+	}
+
+	std::vector<uint32_t> remaining(corner_count);
+	for (uint32_t i = 0; i < corner_count; i++) {
+		remaining[i] = i;
+	}
+
+	uint32_t guess = 0;
+	// iterations left without clipping an ear, gives up on polygons without any
+	uint32_t remaining_iterations = corner_count;
+	uint32_t previous_remaining = corner_count;
+
+	while (remaining.size() > 3 && remaining_iterations > 0) {
+		uint32_t count = static_cast<uint32_t>(remaining.size());
+		if (guess >= count) {
+			guess -= count;
+		}
+
+		if (previous_remaining != count) {
+			previous_remaining = count;
+			remaining_iterations = count;
+		}
+		else {
+			remaining_iterations--;
+		}
+
+		uint32_t ear[3];
+		float xs[3];
+		float ys[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			ear[k] = remaining[(guess + k) % count];
+			xs[k] = corners[ear[k]][axes[0]];
+			ys[k] = corners[ear[k]][axes[1]];
+		}
+
+		// reflex corner (the area is that of tinyobj, which only uses the first edge)
+		float cross = (xs[1] - xs[0]) * (ys[2] - ys[1]) - (ys[1] - ys[0]) * (xs[2] - xs[1]);
+		float area = (xs[0] * ys[1] - ys[0] * xs[1]) * 0.5f;
+		if (cross * area < 0.0f) {
+			guess++;
+			continue;
+		}
+
+		// no other corner may lie inside the ear
+		bool overlap = false;
+		for (uint32_t other = 3; other < count; other++) {
+			const glm::vec3& corner = corners[remaining[(guess + other) % count]];
+			if (is_inside_polygon(3, xs, ys, corner[axes[0]], corner[axes[1]])) {
+				overlap = true;
+				break;
+			}
+		}
+		if (overlap) {
+			guess++;
+			continue;
+		}
+
+		triangle(ear[0], ear[1], ear[2]);
+		remaining.erase(remaining.begin() + (guess + 1) % count);
+	}
+
+	if (remaining.size() == 3) {
+		triangle(remaining[0], remaining[1], remaining[2]);
+	}
+}
+
+void parse_obj(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>>& indices, std::vector<tinyobj::material_t>& materials, std::vector<VKW_Path>& material_files)
+{
+	ZoneScoped;
+
+	MappedFile file;
+	if (!file.open(obj_path)) {
+		throw IOException(fmt::format("Tried to open file {}, but failed to map it", obj_path), __FILE__, __LINE__);
+	}
+
+	const std::string_view text{ reinterpret_cast<const char*>(file.data()), file.size() };
+
+	// split into line aligned chunks
+	size_t nr_chunks = std::clamp<size_t>(text.size() / OBJ_MIN_CHUNK_SIZE, 1, 4 * (static_cast<size_t>(thread_pool.size()) + 1));
+	std::vector<ObjChunk> chunks;
+	chunks.reserve(nr_chunks);
+	{
+		size_t begin = 0;
+		for (size_t c = 0; c < nr_chunks && begin < text.size(); c++) {
+			size_t end = (c + 1 == nr_chunks) ? text.size() : std::max(begin, text.size() * (c + 1) / nr_chunks);
+			end = text.find('\n', end);
+			end = (end == std::string_view::npos) ? text.size() : end + 1;
+
+			chunks.push_back({});
+			chunks.back().text = text.substr(begin, end - begin);
+			begin = end;
+		}
+	}
+
+	thread_pool.parallel_for(chunks.size(), [&chunks](size_t c) {
+		tokenize_chunk(chunks[c]);
+	});
+
+	// load materials of first mtl file which exists (as tinyobj does)
+	const VKW_Path mtl_directory = mtl_path.empty() ? obj_path.parent_path() : mtl_path;
+	std::map<std::string, int> material_map;
+	materials.clear();
+	material_files.clear();
+
+	std::vector<std::string> material_libraries;
+	for (const ObjChunk& chunk : chunks) {
+		material_libraries.insert(material_libraries.end(), chunk.material_libraries.begin(), chunk.material_libraries.end());
+	}
+
+	for (const std::string& library : material_libraries) {
+		VKW_Path path = mtl_directory / library;
+		std::ifstream mtl_stream(path);
+		if (!mtl_stream) {
+			continue;
+		}
+
+		std::error_code ec;
+		StartupProfiler::add_read(std::filesystem::file_size(path, ec));
+
+		std::string warning;
+		std::string error;
+		tinyobj::LoadMtl(&material_map, &materials, &mtl_stream, &warning, &error);
+
+		if (!warning.empty() || !error.empty()) {
+			// might be too strict in some cases, but keeps behaviour of the previous tinyobj::ObjReader import
+			throw IOException(fmt::format("Tried to open file {}, Error: {}{}", path, warning, error), __FILE__, __LINE__);
+		}
+
+		material_files.push_back(path);
+		break;
+	}
+
+	if (!material_libraries.empty() && material_files.empty()) {
+		throw IOException(fmt::format("Tried to open file {}, Error: none of the material files {} found", obj_path, material_libraries), __FILE__, __LINE__);
+	}
+
+	// merge chunks: prefix sums of attributes and vertices, materials active at the start of each chunk
+	size_t nr_positions = 0;
+	size_t nr_uvs = 0;
+	size_t nr_normals = 0;
+	size_t nr_vertices = 0;
+	int current_material = -1;
+
+	for (ObjChunk& chunk : chunks) {
+		chunk.position_offset = nr_positions;
+		chunk.uv_offset = nr_uvs;
+		chunk.normal_offset = nr_normals;
+		chunk.vertex_offset = nr_vertices;
+		chunk.start_material = current_material;
+
+		nr_positions += chunk.positions.size() / 3;
+		nr_uvs += chunk.uvs.size() / 2;
+		nr_normals += chunk.normals.size() / 3;
+		nr_vertices += 3 * chunk.nr_triangles;
+
+		for (const auto& [face_idx, name] : chunk.material_switches) {
+			auto it = material_map.find(name);
+			if (it == material_map.end()) {
+				throw IOException(fmt::format("Tried to open file {}, Error: material {} not found", obj_path, name), __FILE__, __LINE__);
+			}
+			chunk.material_ids.push_back(it->second);
+			current_material = it->second;
+		}
+	}
+
+	if (nr_vertices > std::numeric_limits<uint32_t>::max()) {
+		throw RuntimeException(fmt::format("Mesh {} has too many vertices for 32 bit indices", obj_path), __FILE__, __LINE__);
+	}
+
+	std::vector<float> positions(3 * nr_positions);
+	std::vector<float> uvs(2 * nr_uvs);
+	std::vector<float> normals(3 * nr_normals);
+
+	thread_pool.parallel_for(chunks.size(), [&](size_t c) {
+		const ObjChunk& chunk = chunks[c];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + 3 * chunk.position_offset);
+		std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + 2 * chunk.uv_offset);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + 3 * chunk.normal_offset);
+	});
+
+	// assemble vertices and per material indices of each chunk
+	vertices.resize(nr_vertices);
+
+	thread_pool.parallel_for(chunks.size(), [&](size_t c) {
+		ZoneScopedN("Assemble obj chunk");
+		ObjChunk& chunk = chunks[c];
+		chunk.indices.resize(materials.size());
+
+		int material = chunk.start_material;
+		size_t next_switch = 0;
+
+		uint32_t vertex_idx = static_cast<uint32_t>(chunk.vertex_offset);
+
+		for (size_t f = 0; f < chunk.faces.size(); f++) {
+			while (next_switch < chunk.material_switches.size() && chunk.material_switches[next_switch].first == f) {
+				material = chunk.material_ids[next_switch];
+				next_switch++;
+			}
+
+			const ObjFace& face = chunk.faces[f];
+			if (face.corner_count < 3) {
+				throw RuntimeException(fmt::format("Mesh {} contains degenerated face with {} vertices", obj_path, face.corner_count), __FILE__, __LINE__);
+			}
+			if (material < 0) {
+				throw RuntimeException(fmt::format("Mesh {} contains faces without material", obj_path), __FILE__, __LINE__);
+			}
+
+			auto assemble = [&](uint32_t corner_idx) {
+				const ObjCorner& corner = chunk.corners[face.first_corner + corner_idx];
+
+				int64_t p = resolve_index(corner.v, face.nr_positions, chunk.position_offset, nr_positions, obj_path);
+				int64_t t = resolve_index(corner.vt, face.nr_uvs, chunk.uv_offset, nr_uvs, obj_path);
+				int64_t n = resolve_index(corner.vn, face.nr_normals, chunk.normal_offset, nr_normals, obj_path);
+
+				if (p < 0) {
+					throw RuntimeException(fmt::format("Mesh {} contains face corner without position", obj_path), __FILE__, __LINE__);
+				}
+
+				vertices[vertex_idx] = Vertex{
+					glm::vec3{ positions[3 * p + 0], positions[3 * p + 1], positions[3 * p + 2] },
+					(t >= 0) ? uvs[2 * t + 0] : 0,
+					(n >= 0) ? glm::vec3{ normals[3 * n + 0], normals[3 * n + 1], normals[3 * n + 2] } : glm::vec3{ 0, 0, 0 },
+					(t >= 0) ? uvs[2 * t + 1] : 0,
+					{1,0,1,1} // color
+				};
+
+				chunk.indices[material].push_back(vertex_idx);
+				vertex_idx++;
+			};
+
+			auto triangle = [&](uint32_t a, uint32_t b, uint32_t c) {
+				assemble(a);
+				assemble(b);
+				assemble(c);
+			};
+
+			auto position = [&](uint32_t corner_idx) {
+				const ObjCorner& corner = chunk.corners[face.first_corner + corner_idx];
+				int64_t p = resolve_index(corner.v, face.nr_positions, chunk.position_offset, nr_positions, obj_path);
+				if (p < 0) {
+					throw RuntimeException(fmt::format("Mesh {} contains face corner without position", obj_path), __FILE__, __LINE__);
+				}
+				return glm::vec3{ positions[3 * p + 0], positions[3 * p + 1], positions[3 * p + 2] };
+			};
+
+			if (face.corner_count == 3) {
+				triangle(0, 1, 2);
+			}
+			else if (face.corner_count == 4) {
+				// split along the shorter diagonal (same as tinyobj)
+				glm::vec3 e02 = position(2) - position(0);
+				glm::vec3 e13 = position(3) - position(1);
+
+				if (glm::dot(e02, e02) < glm::dot(e13, e13)) {
+					triangle(0, 1, 2);
+					triangle(0, 2, 3);
+				}
+				else {
+					triangle(0, 1, 3);
+					triangle(1, 2, 3);
+				}
+			}
+			else {
+				// clipped triangles might be fewer than reserved for the face, the unused vertices are never indexed
+				std::vector<glm::vec3> corners(face.corner_count);
+				for (uint32_t i = 0; i < face.corner_count; i++) {
+					corners[i] = position(i);
+				}
+				triangulate_polygon(corners, triangle);
+			}
+		}
+	});
+
+	// concatenate index lists of all chunks per material
+	indices = std::vector<std::vector<uint32_t>>(materials.size());
+
+	thread_pool.parallel_for(materials.size(), [&](size_t m) {
+		size_t nr_indices = 0;
+		for (const ObjChunk& chunk : chunks) {
+			nr_indices += chunk.indices[m].size();
+		}
+
+		indices[m].reserve(nr_indices);
+		for (const ObjChunk& chunk : chunks) {
+			indices[m].insert(indices[m].end(), chunk.indices[m].begin(), chunk.indices[m].end());
+		}
+	});
+}
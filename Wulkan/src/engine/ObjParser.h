@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Path.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+#include "tiny_obj_loader.h"
+
+// Parallel obj parser, replaces tinyobj::ObjReader for the geometry (materials are still loaded with tinyobj::LoadMtl)
+// The file is memory mapped and split into line aligned chunks, which are tokenized on the thread pool.
+// Afterwards the attribute streams are merged and the vertices / per material indices are assembled per chunk in parallel.
+// Output matches the serial import: one vertex per face corner in file order, triangulated like tinyobj
+// (quads are split along the shorter diagonal, larger polygons are ear clipped)
+// material_files are set to the mtl files that were loaded
+void parse_obj(ThreadPool& thread_pool, const VKW_Path& obj_path, const VKW_Path& mtl_path, std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>>& indices, std::vector<tinyobj::material_t>& materials, std::vector<VKW_Path>& material_files);
@@ -3,34 +3,10 @@
 
 #include "Path.h"
 
-void PBRMaterial::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const std::array<VKW_DescriptorSetLayout, 1>& descriptor_layouts, const std::array<uint32_t, 1>& set_slots, const PBRUniform& uniform, const VKW_Path& parent_path, const VKW_Path& diffuse_path, const std::string& material_name)
+void PBRMaterial::init(TextureStreamer& texture_streamer, const PBRUniform& uniform, const VKW_Path& parent_path, const VKW_Path& diffuse_path, const std::string& material_name)
 {
-	MaterialInstance< PushConstants, 1>::init(
-		device,
-		descriptor_pool,
-		render_pass,
-		descriptor_layouts,
-		set_slots,
-		material_name
-	);
-
 	m_uniform = uniform;
-
-	// create and set uniform buffers
-	for (size_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
-		VKW_Buffer& uniform_buffer = m_uniform_buffers[frame_idx];
-
-		uniform_buffer.init(
-			&device,
-			sizeof(PBRUniform),
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			sharing_exlusive(),
-			Mapping::Persistent,
-			fmt::format("PBR Uniform {} ({})", material_name, frame_idx)
-		);
-
-		uniform_buffer.copy_into(&m_uniform, sizeof(PBRUniform));
-	}
+	m_texture_streamer = &texture_streamer;
 
 	if (diffuse_path != "") {
 		VKW_Path diffuse_p = diffuse_path;
@@ -42,25 +18,26 @@ void PBRMaterial::init(const VKW_Device& device, const VKW_CommandPool& graphics
 				});
 		}
 
-		m_diffuse_texture = std::optional<Texture>{ create_mipmapped_texture_from_path(
-				&device,
-				&graphics_pool,
-				diffuse_p,
-				Texture_Type::Tex_RGBA,
-				fmt::format("{} diffuse texture", material_name)
-		) };
+		// decoded and uploaded in the background
+		m_diffuse_texture = texture_streamer.request(
+			diffuse_p,
+			diffuse_p.extension() == ".exr" ? Texture_Type::Tex_HDR_RGBA : Texture_Type::Tex_RGBA,
+			fmt::format("{} diffuse texture", material_name)
+		);
 	}
 }
 
-void PBRMaterial::del()
+void PBRMaterial::set_diffuse_binding(MaterialInstance<PushConstants, 1>& mesh_material, uint32_t binding, uint32_t array_element, Texture& fallback, const VKW_Sampler& sampler)
 {
-	MaterialInstance< PushConstants, 1>::del();
-	
-	for (VKW_Buffer& uniform_buffer : m_uniform_buffers) {
-		uniform_buffer.del();
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> sets;
+	for (unsigned int frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+		const VKW_DescriptorSet& set = mesh_material.get_descriptor_set(frame_idx, 0);
+
+		set.update(binding, get_diffuse_texture(fallback).get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, array_element);
+		sets[frame_idx] = set;
 	}
 
 	if (m_diffuse_texture.has_value()) {
-		m_diffuse_texture.value().del();
+		m_texture_streamer->bind_when_resident(m_diffuse_texture.value(), sets, binding, sampler, array_element);
 	}
 }
\ No newline at end of file
@@ -1,10 +1,10 @@
 #pragma once
 
-#include "Material.h"
 #include "Path.h"
 #include "Renderpass.h"
 #include "Texture.h"
 #include "Shape.h"
+#include "TextureStreamer.h"
 
 struct PBRUniform {
 	alignas(16) glm::vec3 diffuse;
@@ -19,49 +19,60 @@ struct PBRUniform {
 };
 
 constexpr size_t PBR_MAT_DESC_SET_COUNT = 3;
-class PBRMaterial : public MaterialInstance< PushConstants, 1>{
+// size of the diffuse texture array of a PBRMesh, has to match MAX_PBR_MATERIALS in pbr_common.shader
+constexpr uint32_t MAX_PBR_MATERIALS = 64;
+
+// Parameters and diffuse texture of one material of a PBRMesh
+// all materials of a mesh share one descriptor set, the uniform is stored at the material's index in the mesh's material buffer
+class PBRMaterial {
 public:
 	PBRMaterial() = default;
 
-	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool,  RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const std::array<VKW_DescriptorSetLayout, 1>& descriptor_layouts, const std::array<uint32_t, 1>& set_slots, const PBRUniform& uniform, const VKW_Path& parent_path, const VKW_Path& diffuse_path, const std::string& material_name);
-
-	void del() override;
+	void init(TextureStreamer& texture_streamer, const PBRUniform& uniform, const VKW_Path& parent_path, const VKW_Path& diffuse_path, const std::string& material_name);
 private:
 	PBRUniform m_uniform;
-	VisualizationMode m_visualization_mode;
+	VisualizationMode m_visualization_mode = VisualizationMode::Shaded;
 
-	std::optional<Texture> m_diffuse_texture;
-	std::array< VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_uniform_buffers;
+	// diffuse texture is owned by the streamer, handle is empty if material has none
+	TextureStreamer* m_texture_streamer = nullptr;
+	std::optional<uint32_t> m_diffuse_texture;
 public:
-	inline const VKW_Buffer& get_uniform_buffer(uint32_t current_frame) const { return m_uniform_buffers[current_frame]; };
+	inline const PBRUniform& get_uniform() const { return m_uniform; };
+	// fallback is returned while the diffuse texture is not resident yet
 	inline Texture& get_diffuse_texture(Texture& fallback);
-	inline void set_visualization_mode(VisualizationMode mode);
+	// binds the diffuse texture at array_element of binding in the sets of the mesh's material instance for all frames
+	// fallback is bound until the streamer swaps in the texture
+	void set_diffuse_binding(MaterialInstance<PushConstants, 1>& mesh_material, uint32_t binding, uint32_t array_element, Texture& fallback, const VKW_Sampler& sampler);
+	// returns true if the uniform changed and has to be written again
+	inline bool set_visualization_mode(VisualizationMode mode);
 };
 
 Texture& PBRMaterial::get_diffuse_texture(Texture& fallback)
 {
+	Texture* texture = nullptr;
 	if (m_diffuse_texture.has_value()) {
-		return m_diffuse_texture.value();
+		texture = m_texture_streamer->get_texture(m_diffuse_texture.value());
+	}
+
+	if (texture) {
+		return *texture;
 	}
 	else {
 		return fallback;
 	}
 }
 
-inline void PBRMaterial::set_visualization_mode(VisualizationMode mode)
+inline bool PBRMaterial::set_visualization_mode(VisualizationMode mode)
 {
-	if (mode != m_visualization_mode) {
-		//spdlog::info("Old uniform config {:032b}", m_uniform.configuration);
-		// keep lower 16 bits as pervious
-		uint32_t conifg_kept = m_uniform.configuration & ((1 << 16) - 1);
-		m_uniform.configuration = conifg_kept | (static_cast<uint32_t>(mode) << 16);
-		
-		for (size_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
-			VKW_Buffer& uniform_buffer = m_uniform_buffers[frame_idx];
-
-			uniform_buffer.copy_into(&m_uniform, sizeof(PBRUniform));
-		}
-		
-		m_visualization_mode = mode;
+	if (mode == m_visualization_mode) {
+		return false;
 	}
+
+	//spdlog::info("Old uniform config {:032b}", m_uniform.configuration);
+	// keep lower 16 bits as pervious
+	uint32_t conifg_kept = m_uniform.configuration & ((1 << 16) - 1);
+	m_uniform.configuration = conifg_kept | (static_cast<uint32_t>(mode) << 16);
+
+	m_visualization_mode = mode;
+	return true;
 }
@@ -3,18 +3,155 @@
 
 void PBRMesh::set_descriptor_bindings(Texture& texture_fallback, const VKW_Sampler& general_sampler)
 {
-	for (size_t mat_idx = 0; mat_idx < m_materials.size(); mat_idx++) {
-		auto& mat = m_materials[mat_idx];
-		for (unsigned int frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
-			const VKW_DescriptorSet& set = mat.get_descriptor_set(frame_idx, 0);
+	for (unsigned int frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+		const VKW_DescriptorSet& set = m_material_instance.get_descriptor_set(frame_idx, 0);
 
-			set.update(0, m_materials[mat_idx].get_uniform_buffer(frame_idx));
-			set.update(1, m_materials[mat_idx].get_diffuse_texture(texture_fallback).get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), general_sampler);
+		set.update(0, m_material_buffers[frame_idx]);
+		set.update(2, m_draw_buffer);
+
+		// every element of the texture array has to be valid, even the ones without material
+		for (uint32_t mat_idx = static_cast<uint32_t>(m_materials.size()); mat_idx < MAX_PBR_MATERIALS; mat_idx++) {
+			set.update(1, texture_fallback.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT), general_sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mat_idx);
 		}
 	}
+
+	for (uint32_t mat_idx = 0; mat_idx < m_materials.size(); mat_idx++) {
+		// fallback until the diffuse texture is streamed in
+		m_materials[mat_idx].set_diffuse_binding(m_material_instance, 1, mat_idx, texture_fallback, general_sampler);
+	}
+}
+
+void PBRMesh::update_draw_commands(uint32_t current_frame)
+{
+	if (m_written_instance_counts[current_frame] != m_view_instance_counts) {
+		write_draw_commands(current_frame);
+	}
 }
 
-RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> PBRMesh::create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only, bool bias_depth, bool cull_backfaces)
+void PBRMesh::set_visualization_mode(VisualizationMode mode)
+{
+	bool changed = false;
+	for (PBRMaterial& mat : m_materials) {
+		changed |= mat.set_visualization_mode(mode);
+	}
+
+	if (changed) {
+		for (uint32_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+			write_material_buffer(frame_idx);
+		}
+	}
+}
+
+void PBRMesh::init_draws(const VKW_Device& device, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const std::string& name)
+{
+	if (m_materials.empty() || m_materials.size() > MAX_PBR_MATERIALS) {
+		throw RuntimeException(
+			fmt::format("{} has {} materials, only 1 to {} are supported", name, m_materials.size(), MAX_PBR_MATERIALS),
+			__FILE__, __LINE__
+		);
+	}
+
+	m_view_instance_counts.fill(m_instance_count);
+
+	m_material_instance.init(
+		device,
+		descriptor_pool,
+		render_pass,
+		{ descriptor_set_layout },
+		{ 2 },
+		name
+	);
+
+	// mesh i is drawn with material i
+	std::vector<PBRDraw> draws(m_meshes.size());
+	for (uint32_t draw_idx = 0; draw_idx < draws.size(); draw_idx++) {
+		draws[draw_idx].material_idx = draw_idx;
+	}
+
+	m_draw_buffer.init(
+		&device,
+		sizeof(PBRDraw) * draws.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		sharing_exlusive(),
+		Mapping::Persistent,
+		fmt::format("PBR Draws {}", name)
+	);
+	m_draw_buffer.copy_into(draws.data(), sizeof(PBRDraw) * draws.size());
+
+	for (uint32_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+		m_material_buffers[frame_idx].init(
+			&device,
+			sizeof(PBRUniform) * m_materials.size(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			sharing_exlusive(),
+			Mapping::Persistent,
+			fmt::format("PBR Materials {} ({})", name, frame_idx)
+		);
+		write_material_buffer(frame_idx);
+
+		// host visible, as the instance count can change every frame
+		m_indirect_buffers[frame_idx].init(
+			&device,
+			sizeof(VkDrawIndexedIndirectCommand) * m_meshes.size() * MAX_INSTANCE_VIEWS,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			sharing_exlusive(),
+			Mapping::Persistent,
+			fmt::format("PBR Indirect Draws {} ({})", name, frame_idx)
+		);
+		write_draw_commands(frame_idx);
+	}
+}
+
+void PBRMesh::del_draws()
+{
+	m_material_instance.del();
+	m_draw_buffer.del();
+
+	for (uint32_t frame_idx = 0; frame_idx < MAX_FRAMES_IN_FLIGHT; frame_idx++) {
+		m_material_buffers[frame_idx].del();
+		m_indirect_buffers[frame_idx].del();
+	}
+}
+
+void PBRMesh::write_material_buffer(uint32_t frame_idx)
+{
+	std::vector<PBRUniform> uniforms{};
+	uniforms.reserve(m_materials.size());
+	for (const PBRMaterial& mat : m_materials) {
+		uniforms.push_back(mat.get_uniform());
+	}
+
+	m_material_buffers[frame_idx].copy_into(uniforms.data(), sizeof(PBRUniform) * uniforms.size());
+}
+
+void PBRMesh::get_draw_commands(std::vector<VkDrawIndexedIndirectCommand>& commands) const
+{
+	for (const Mesh& mesh : m_meshes) {
+		commands.push_back({ mesh.get_index_count(), 0, mesh.get_first_index(), 0, 0 });
+	}
+}
+
+void PBRMesh::write_draw_commands(uint32_t frame_idx)
+{
+	// the draws of each view only differ in their instance count
+	// written in place, as this happens every frame the instance counts change
+	VkDrawIndexedIndirectCommand* commands = static_cast<VkDrawIndexedIndirectCommand*>(m_indirect_buffers[frame_idx].get_mapped_address());
+	for (uint32_t view = 0; view < MAX_INSTANCE_VIEWS; view++) {
+		for (size_t i = 0; i < m_meshes.size(); i++) {
+			VkDrawIndexedIndirectCommand& command = commands[view * m_meshes.size() + i];
+			command.indexCount = m_meshes[i].get_index_count();
+			command.instanceCount = m_view_instance_counts[view];
+			command.firstIndex = m_meshes[i].get_first_index();
+			command.vertexOffset = 0;
+			command.firstInstance = 0;
+		}
+	}
+
+	m_indirect_buffers[frame_idx].flush(0, sizeof(VkDrawIndexedIndirectCommand) * m_meshes.size() * MAX_INSTANCE_VIEWS);
+	m_written_instance_counts[frame_idx] = m_view_instance_counts;
+}
+
+RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> PBRMesh::create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only, bool bias_depth, bool cull_backfaces, bool depth_prepass)
 {
 	RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> render_pass{};
 
@@ -25,26 +162,36 @@ RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> PBRMesh::create_render_pass(co
 	// Graphics pipeline
 	VKW_GraphicsPipeline graphics_pipeline{};
 
+	// the discard of the shading is removed when the pipeline is compiled, so the early depth tests are not disabled
+	VKW_SpecializationConstants<VkBool32, 1> specialization_const{};
+	specialization_const.init({ depth_prepass }, { 1 });
+
 	VKW_Shader vert_shader{};
 	if (!depth_only) {
 		vert_shader.init(device, "shaders/pbr/pbr_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "PBR vertex shader");
 	}
 	else {
-		vert_shader.init(device, "shaders/pbr/pbr_depth_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "PBR vertex shader");
+		vert_shader.init(device, "shaders/pbr/pbr_depth_vert.spv", VK_SHADER_STAGE_VERTEX_BIT, "PBR vertex shader", "main", specialization_const.get_info());
 	}
 
 	VKW_Shader frag_shader{};
 	if (!depth_only) {
-		frag_shader.init(device, "shaders/pbr/pbr_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "PBR fragment shader");
+		frag_shader.init(device, "shaders/pbr/pbr_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "PBR fragment shader", "main", specialization_const.get_info());
 	}
 	else {
-		frag_shader.init(device, "shaders/pbr/pbr_depth_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "PBR fragment shader");
+		frag_shader.init(device, "shaders/pbr/pbr_depth_frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "PBR fragment shader", "main", specialization_const.get_info());
 	}
 	if (cull_backfaces) {
 		graphics_pipeline.set_culling_mode();
 	}
-	graphics_pipeline.enable_depth_test();
-	graphics_pipeline.enable_depth_write();
+	if (!depth_only && depth_prepass) {
+		// the depth is already complete
+		graphics_pipeline.enable_depth_test(VK_COMPARE_OP_EQUAL);
+	}
+	else {
+		graphics_pipeline.enable_depth_test();
+		graphics_pipeline.enable_depth_write();
+	}
 
 	graphics_pipeline.add_shader_stages({ vert_shader, frag_shader });
 
@@ -63,13 +210,19 @@ RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> PBRMesh::create_render_pass(co
 	graphics_pipeline.set_sample_count(sample_count);
 
 	std::string pipeline_name;
-	if (depth_only) {
+	if (depth_only && depth_prepass) {
+		pipeline_name = "PBR DEPTH PREPASS graphics pipeline";
+	}
+	else if (depth_only) {
 		pipeline_name = "PBR DEPTH graphics pipeline";
 	}
+	else if (depth_prepass) {
+		pipeline_name = "PBR graphics pipeline after depth prepass";
+	}
 	else {
 		pipeline_name = "PBR graphics pipeline";
 	}
-	graphics_pipeline.init(device, pipeline_name);
+	graphics_pipeline.init(device, pipeline_name, &pipeline_cache);
 
 	vert_shader.del();
 	frag_shader.del();
@@ -89,17 +242,26 @@ VKW_DescriptorSetLayout PBRMesh::create_descriptor_set_layout(const VKW_Device&
 {
 	descriptor_set_layout = VKW_DescriptorSetLayout{};
 
+	// uniforms of all materials
 	descriptor_set_layout.add_binding(
 		0,
-		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
 		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT
 	);
 
-	// diffuse texture
+	// diffuse texture of each material
 	descriptor_set_layout.add_binding(
 		1,
 		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT
+		VK_SHADER_STAGE_FRAGMENT_BIT,
+		MAX_PBR_MATERIALS
+	);
+
+	// material of each indirect draw
+	descriptor_set_layout.add_binding(
+		2,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_VERTEX_BIT
 	);
 
 	descriptor_set_layout.init(&device, "PBR Descriptor Set Layout");
@@ -5,6 +5,13 @@
 #include "Renderpass.h"
 #include "PBRMaterial.h"
 
+// data of one indirect draw of a PBRMesh, looked up through gl_DrawID (see pbr_common.shader)
+struct PBRDraw {
+	alignas(4) uint32_t material_idx;
+};
+
+// All meshes (one per material) are drawn with a single vkCmdDrawIndexedIndirect, so the recording cost does not depend on the number of materials
+// The materials share one descriptor set per frame: the uniforms of all materials, an array of their diffuse textures and the material of each draw
 class PBRMesh : public Shape {
 public:
 	void set_descriptor_bindings(Texture& texture_fallback, const VKW_Sampler& general_sampler) ;
@@ -12,41 +19,109 @@ public:
 
 	// TODO: could be kept seperate (Other file formats should use same render_pass types (different from eg terrain)
 	// bias_depth only works in depth_only mode
-	static RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only = false, bool bias_depth = false, bool cull_backfaces = true);
+	// depth_prepass: in depth_only mode the depth of the camera instead of a cascade, otherwise the shading after such a prepass (equal depth test without writes, no alpha discard)
+	static RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT> create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, PBR_MAT_DESC_SET_COUNT>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only = false, bool bias_depth = false, bool cull_backfaces = true, bool depth_prepass = false);
 	static VKW_DescriptorSetLayout create_descriptor_set_layout(const VKW_Device& device);
 
 	// goes over all materials in obj and renders them, expects to be in active command buffer
 	// TODO: Current assumption is that all materials in ObjMesh use the same pipeline
-	inline virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override = 0;
+	inline virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override = 0;
+	// draws the instances of view (see MAX_INSTANCE_VIEWS)
+	inline void draw_view(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, uint32_t view);
+	// draws with the commands at offset of indirect_buffer (one per mesh) and the instances at instance_address, e.g. written by GPUInstanceCulling
+	inline void draw_indirect(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, VkBuffer indirect_buffer, VkDeviceSize offset, VkDeviceAddress instance_address);
+
+	// writes the current instance counts into the indirect commands of current_frame if they changed
+	// call after the render fence of current_frame was waited on (see InstancedShape::commit_instances)
+	void update_draw_commands(uint32_t current_frame);
+	// appends the indirect command of each mesh, without instances
+	void get_draw_commands(std::vector<VkDrawIndexedIndirectCommand>& commands) const;
 protected:
-	std::vector<Mesh> m_meshes; // usually: one mesh per material
+	std::vector<Mesh> m_meshes; // usually: one mesh per material, mesh i is drawn with material i
 	std::vector<PBRMaterial> m_materials;
 
 	inline static VKW_DescriptorSetLayout descriptor_set_layout;
-	VKW_Buffer m_vertex_buffer;
+	// vertices shared by all meshes
+	GeometryPool* m_geometry = nullptr;
+	GeometryRange m_vertices;
 
-	VkDeviceAddress m_vertex_buffer_address = 0;
+	// shared by all materials
+	MaterialInstance<PushConstants, 1> m_material_instance;
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_material_buffers; // PBRUniform of each material
+	VKW_Buffer m_draw_buffer; // PBRDraw of each indirect command
+	std::array<VKW_Buffer, MAX_FRAMES_IN_FLIGHT> m_indirect_buffers; // VkDrawIndexedIndirectCommand of each mesh for each view
+	std::array<uint32_t, MAX_INSTANCE_VIEWS> m_view_instance_counts{};
+	std::array<std::array<uint32_t, MAX_INSTANCE_VIEWS>, MAX_FRAMES_IN_FLIGHT> m_written_instance_counts{};
+	// bytes between the instances of consecutive views in the instance buffer, 0 if all views share the instances
+	VkDeviceSize m_instance_view_stride = 0;
+
+	// creates the material instance and the buffers of the indirect draws, expects m_meshes and m_materials to be set
+	void init_draws(const VKW_Device& device, VKW_DescriptorPool& descriptor_pool, RenderPass<PushConstants, PBR_MAT_DESC_SET_COUNT>& render_pass, const std::string& name);
+	void del_draws();
+	void write_material_buffer(uint32_t frame_idx);
+	void write_draw_commands(uint32_t frame_idx);
 public:
 	void set_model_matrix(const glm::mat4& m) override { m_model = m; };
-	void set_cascade_idx(int idx) override { m_cascade_idx = idx; };
-	inline void set_visualization_mode(VisualizationMode mode) override;
+	void set_visualization_mode(VisualizationMode mode) override;
 	void set_lod_level(int lod_level) override { m_lod_level = lod_level; };
 
+	// the indirect commands are only updated by update_draw_commands, as the ones of the other frame might still be in use
+	// sets the count of all views
 	inline void set_instance_count(uint32_t count) override;
+	void set_view_instance_count(uint32_t view, uint32_t count) { m_view_instance_counts[view] = count; };
 	void set_instance_buffer_address(const std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT>& addresses) override { m_instance_buffer_addresses = addresses; };
+	void set_instance_view_stride(VkDeviceSize stride) { m_instance_view_stride = stride; };
 	glm::vec3 get_instance_position(uint32_t instance = 0) override;
 };
 
-inline void PBRMesh::set_visualization_mode(VisualizationMode mode)
+inline void PBRMesh::draw_view(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, uint32_t view)
 {
-	for (PBRMaterial& mat : m_materials) {
-		mat.set_visualization_mode(mode);
+	// shaders check for a null instance buffer
+	VkDeviceAddress instance_address = m_instance_buffer_addresses[current_frame];
+	if (instance_address != 0) {
+		instance_address += view * m_instance_view_stride;
 	}
+
+	draw_indirect(
+		command_buffer,
+		current_frame,
+		cascade_idx,
+		m_indirect_buffers[current_frame],
+		sizeof(VkDrawIndexedIndirectCommand) * m_meshes.size() * view,
+		instance_address
+	);
+}
+
+inline void PBRMesh::draw_indirect(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx, VkBuffer indirect_buffer, VkDeviceSize offset, VkDeviceAddress instance_address)
+{
+	// the material of each draw is read in the shaders, so only the per mesh state is bound
+	m_material_instance.bind(
+		command_buffer,
+		current_frame,
+		{
+			m_model,
+			m_inv_model,
+			m_geometry->get_vertex_address(m_vertices),
+			instance_address,
+			cascade_idx,
+			m_lod_level
+		}
+	);
+
+	uint32_t draw_count = static_cast<uint32_t>(m_meshes.size());
+	vkCmdDrawIndexedIndirect(
+		command_buffer,
+		indirect_buffer,
+		offset,
+		draw_count,
+		sizeof(VkDrawIndexedIndirectCommand)
+	);
 }
 
 inline void PBRMesh::set_instance_count(uint32_t count)
 {
 	m_instance_count = count;
+	m_view_instance_counts.fill(count);
 	for (Mesh& m : m_meshes)
 		m.set_instance_count(m_instance_count);
 }
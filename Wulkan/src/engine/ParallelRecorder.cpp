@@ -0,0 +1,97 @@
+#include "common.h"
+#include "ParallelRecorder.h"
+
+void ParallelRecorder::init(const VKW_Device* vkw_device, const VKW_Queue* graphics_queue, ThreadPool* thread_pool, const std::string& obj_name)
+{
+	device = vkw_device;
+	m_thread_pool = thread_pool;
+	m_name = obj_name;
+
+	// workers and the render thread, which also records during parallel_for
+	uint32_t nr_threads = m_thread_pool->size() + 1;
+
+	for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+		m_pools[frame].resize(nr_threads);
+		for (uint32_t thread = 0; thread < nr_threads; thread++) {
+			m_pools[frame][thread].pool.init(device, graphics_queue, fmt::format("{} pool (frame {}, thread {})", m_name, frame, thread));
+		}
+	}
+}
+
+void ParallelRecorder::del()
+{
+	// pools free their command buffers
+	for (auto& frame_pools : m_pools) {
+		for (ThreadCommandPool& thread_pool : frame_pools) {
+			thread_pool.pool.del();
+			thread_pool.command_buffers.clear();
+		}
+		frame_pools.clear();
+	}
+	m_passes.clear();
+}
+
+void ParallelRecorder::begin_frame(uint32_t current_frame, bool parallel)
+{
+	ZoneScoped;
+
+	m_current_frame = current_frame;
+	m_parallel = parallel;
+	m_passes.clear();
+
+	for (ThreadCommandPool& thread_pool : m_pools[m_current_frame]) {
+		if (thread_pool.used > 0) {
+			thread_pool.pool.reset();
+			thread_pool.used = 0;
+		}
+	}
+}
+
+size_t ParallelRecorder::add(const VkCommandBufferInheritanceRenderingInfo& rendering_info, RecordFunc&& record)
+{
+	m_passes.push_back({ rendering_info, std::move(record) });
+	return m_passes.size() - 1;
+}
+
+void ParallelRecorder::record()
+{
+	ZoneScoped;
+
+	if (!m_parallel) {
+		return;
+	}
+
+	m_thread_pool->parallel_for(m_passes.size(), [this](size_t i) {
+		ZoneScopedN("Record pass");
+
+		ThreadCommandPool& thread_pool = m_pools[m_current_frame].at(ThreadPool::get_thread_idx());
+		if (thread_pool.used == thread_pool.command_buffers.size()) {
+			thread_pool.command_buffers.emplace_back().init(
+				device,
+				&thread_pool.pool,
+				false,
+				fmt::format("{} secondary command buffer {} (frame {}, thread {})", m_name, thread_pool.used, m_current_frame, ThreadPool::get_thread_idx()),
+				VK_COMMAND_BUFFER_LEVEL_SECONDARY
+			);
+		}
+		const VKW_CommandBuffer& cmd = thread_pool.command_buffers[thread_pool.used++];
+
+		Pass& pass = m_passes[i];
+		cmd.begin_secondary(pass.rendering_info);
+		pass.record(cmd);
+		cmd.end();
+
+		pass.command_buffer = cmd;
+	});
+}
+
+void ParallelRecorder::execute(const VKW_CommandBuffer& cmd, size_t pass) const
+{
+	if (!m_parallel) {
+		m_passes.at(pass).record(cmd);
+		return;
+	}
+
+	assert(m_passes.at(pass).command_buffer != VK_NULL_HANDLE && "Tried to execute pass that was not recorded");
+	cmd.execute({ &m_passes[pass].command_buffer, 1 });
+}
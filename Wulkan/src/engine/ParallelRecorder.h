@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_Queue.h"
+#include "vk_wrap/VKW_CommandPool.h"
+#include "vk_wrap/VKW_CommandBuffer.h"
+
+#include "ThreadPool.h"
+
+// Records passes into secondary command buffers on the workers, which are then executed from the primary command buffer of the frame
+// Every thread has its own command pool per frame in flight, so recording needs no synchronization.
+// Per frame: begin_frame, add all passes, record and then execute every pass inside its rendering (see RenderPass::begin_rendering)
+// Without parallel recording the passes are recorded directly into the primary command buffer by execute instead (i.e. for comparison)
+// Everything but the record functions has to be called from the render thread
+class ParallelRecorder : public VKW_Object
+{
+public:
+	using RecordFunc = std::function<void(const VKW_CommandBuffer& cmd)>;
+
+	ParallelRecorder() = default;
+	void init(const VKW_Device* vkw_device, const VKW_Queue* graphics_queue, ThreadPool* thread_pool, const std::string& obj_name);
+	void del() override;
+
+	// resets the command pools of the frame, the previous submission of the frame has to be done
+	void begin_frame(uint32_t current_frame, bool parallel);
+
+	// record is called on any thread with a begun secondary command buffer, rendering_info has to match the rendering it is executed in
+	// record has to stay valid until record() returns and may only read shared state. Returns the index of the pass for execute
+	size_t add(const VkCommandBufferInheritanceRenderingInfo& rendering_info, RecordFunc&& record);
+
+	// records all added passes in parallel (the calling thread helps), rethrows the first failure
+	void record();
+
+	// executes the secondary command buffer of a recorded pass in the primary command buffer cmd
+	// or records the pass into cmd if parallel recording is disabled
+	void execute(const VKW_CommandBuffer& cmd, size_t pass) const;
+private:
+	struct ThreadCommandPool {
+		VKW_CommandPool pool;
+		std::vector<VKW_CommandBuffer> command_buffers; // allocated on demand, reused every frame after the pool reset
+		size_t used = 0;
+	};
+
+	struct Pass {
+		VkCommandBufferInheritanceRenderingInfo rendering_info;
+		RecordFunc record;
+		VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+	};
+
+	const VKW_Device* device = nullptr;
+	ThreadPool* m_thread_pool = nullptr;
+	std::string m_name;
+
+	// indexed by frame and ThreadPool::get_thread_idx
+	std::array<std::vector<ThreadCommandPool>, MAX_FRAMES_IN_FLIGHT> m_pools;
+	uint32_t m_current_frame = 0;
+	bool m_parallel = true;
+
+	std::vector<Pass> m_passes;
+public:
+	// renderings the passes are executed in need VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+	inline bool is_parallel() const { return m_parallel; };
+};
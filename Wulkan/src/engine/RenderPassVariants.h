@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Renderpass.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <future>
+#include <map>
+
+// Registry of pipeline variants of one render pass (i.e. different specialization constants or render state), compiled on first request
+// Key identifies a variant and needs to be ordered, the factory creates the render pass of a key and is called on the workers.
+// Variants are never moved once built, so materials can keep pointers to them (their pipeline layouts need to be compatible).
+// Should be used from a single thread (i.e. the render thread)
+template<typename Key, typename T, size_t N>
+class RenderPassVariants : public VKW_Object
+{
+public:
+	using Factory = std::function<RenderPass<T, N>(const Key& key)>;
+
+	RenderPassVariants() = default;
+	void init(ThreadPool* thread_pool, Factory&& factory, const std::string& name);
+	// waits for variants still being compiled
+	void del() override;
+
+	// returns the variant of key if it is built, otherwise starts compiling it and returns the variant of fallback instead
+	// fallback is built blocking if necessary
+	RenderPass<T, N>& get(const Key& key, const Key& fallback);
+	// builds the variant on the calling thread if necessary
+	RenderPass<T, N>& get_blocking(const Key& key);
+
+	// starts compiling a variant in the background (i.e. one predicted to be used soon)
+	void request(const Key& key);
+private:
+	struct Variant {
+		std::unique_ptr<RenderPass<T, N>> render_pass; // set once built
+		std::future<RenderPass<T, N>> pending;
+	};
+
+	ThreadPool* m_thread_pool = nullptr;
+	Factory m_factory;
+	std::string m_name;
+
+	std::map<Key, Variant> m_variants;
+
+	// moves finished background compiles into their variant, rethrows their exceptions
+	bool is_ready(Variant& variant);
+};
+
+template<typename Key, typename T, size_t N>
+inline void RenderPassVariants<Key, T, N>::init(ThreadPool* thread_pool, Factory&& factory, const std::string& name)
+{
+	m_thread_pool = thread_pool;
+	m_factory = std::move(factory);
+	m_name = name;
+}
+
+template<typename Key, typename T, size_t N>
+inline void RenderPassVariants<Key, T, N>::del()
+{
+	for (auto& [key, variant] : m_variants) {
+		if (variant.pending.valid()) {
+			try {
+				variant.render_pass = std::make_unique<RenderPass<T, N>>(variant.pending.get());
+			}
+			catch (...) {
+				// failures were never observed by anyone, nothing to clean up
+				continue;
+			}
+		}
+
+		if (variant.render_pass) {
+			variant.render_pass->del();
+		}
+	}
+	m_variants.clear();
+}
+
+template<typename Key, typename T, size_t N>
+inline RenderPass<T, N>& RenderPassVariants<Key, T, N>::get(const Key& key, const Key& fallback)
+{
+	Variant& variant = m_variants[key];
+	if (is_ready(variant)) {
+		return *variant.render_pass;
+	}
+
+	request(key);
+	return get_blocking(fallback);
+}
+
+template<typename Key, typename T, size_t N>
+inline RenderPass<T, N>& RenderPassVariants<Key, T, N>::get_blocking(const Key& key)
+{
+	Variant& variant = m_variants[key];
+	if (variant.pending.valid()) {
+		ZoneScopedN("Wait for pipeline variant");
+		variant.pending.wait();
+	}
+
+	if (!is_ready(variant)) {
+		ZoneScopedN("Compile pipeline variant");
+		variant.render_pass = std::make_unique<RenderPass<T, N>>(m_factory(key));
+	}
+	return *variant.render_pass;
+}
+
+template<typename Key, typename T, size_t N>
+inline void RenderPassVariants<Key, T, N>::request(const Key& key)
+{
+	Variant& variant = m_variants[key];
+	if (variant.render_pass || variant.pending.valid()) {
+		return;
+	}
+
+	// key is copied, the variant might already be gone once the job starts
+	variant.pending = m_thread_pool->submit([this, key]() {
+		ZoneScopedN("Compile pipeline variant");
+		return m_factory(key);
+	});
+}
+
+template<typename Key, typename T, size_t N>
+inline bool RenderPassVariants<Key, T, N>::is_ready(Variant& variant)
+{
+	if (variant.render_pass) {
+		return true;
+	}
+
+	if (variant.pending.valid() && variant.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		variant.render_pass = std::make_unique<RenderPass<T, N>>(variant.pending.get());
+		return true;
+	}
+	return false;
+}
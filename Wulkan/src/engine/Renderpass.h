@@ -20,12 +20,19 @@ public:
 	// pass in VK_NULL_HANDLE in color_rt or depth_rt to not set them in the pipeline
 	void begin(const VKW_CommandBuffer& cmd, VkExtent2D extent, VkImageView color_rt, VkImageView depth_rt, VkImageView color_rt_resolve = VK_NULL_HANDLE, VkImageView depth_rt_resolve = VK_NULL_HANDLE, bool do_clear_color = false, VkClearColorValue clear_color_value = { {1,0,1,1} }, bool do_clear_depth = false, float clear_depth_value = 0, float const_depth_bias = 0, float slope_depth_bias = 0);
 	void end(const VKW_CommandBuffer& cmd);
+
+	// split version of begin: begin_rendering only starts rendering into the attachments, bind binds the pipeline and its dynamic state
+	// with secondary_contents the draws have to be recorded into secondary command buffers (see get_inheritance_rendering_info)
+	void begin_rendering(const VKW_CommandBuffer& cmd, bool secondary_contents, VkExtent2D extent, VkImageView color_rt, VkImageView depth_rt, VkImageView color_rt_resolve = VK_NULL_HANDLE, VkImageView depth_rt_resolve = VK_NULL_HANDLE, bool do_clear_color = false, VkClearColorValue clear_color_value = { {1,0,1,1} }, bool do_clear_depth = false, float clear_depth_value = 0);
+	// does not modify the render pass, so it can be recorded by multiple threads at once
+	void bind(const VKW_CommandBuffer& cmd, VkExtent2D extent, float const_depth_bias = 0, float slope_depth_bias = 0) const;
 	
 protected:
 	VKW_GraphicsPipeline m_pipeline;
 	VKW_PushConstant<T> m_push_constant;
 public:
 	VkPipelineLayout get_pipeline_layout() const { return m_pipeline.get_layout(); };
+	VkCommandBufferInheritanceRenderingInfo get_inheritance_rendering_info() const { return m_pipeline.get_inheritance_rendering_info(); };
 };
 
 template<typename T, size_t N>
@@ -44,6 +51,13 @@ inline void RenderPass<T, N>::del()
 
 template<typename T, size_t N>
 inline void RenderPass<T, N>::begin(const VKW_CommandBuffer& cmd, VkExtent2D extent, VkImageView color_rt, VkImageView depth_rt, VkImageView color_rt_resolve, VkImageView depth_rt_resolve, bool do_clear_color, VkClearColorValue clear_color_value, bool do_clear_depth, float clear_depth_value, float const_depth_bias, float slope_depth_bias)
+{
+	begin_rendering(cmd, false, extent, color_rt, depth_rt, color_rt_resolve, depth_rt_resolve, do_clear_color, clear_color_value, do_clear_depth, clear_depth_value);
+	bind(cmd, extent, const_depth_bias, slope_depth_bias);
+}
+
+template<typename T, size_t N>
+inline void RenderPass<T, N>::begin_rendering(const VKW_CommandBuffer& cmd, bool secondary_contents, VkExtent2D extent, VkImageView color_rt, VkImageView depth_rt, VkImageView color_rt_resolve, VkImageView depth_rt_resolve, bool do_clear_color, VkClearColorValue clear_color_value, bool do_clear_depth, float clear_depth_value)
 {
 	m_pipeline.set_render_size(extent);
 
@@ -68,14 +82,18 @@ inline void RenderPass<T, N>::begin(const VKW_CommandBuffer& cmd, VkExtent2D ext
 		);
 	}
 
-	m_pipeline.begin_rendering(cmd);
+	m_pipeline.begin_rendering(cmd, secondary_contents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0);
+}
 
+template<typename T, size_t N>
+inline void RenderPass<T, N>::bind(const VKW_CommandBuffer& cmd, VkExtent2D extent, float const_depth_bias, float slope_depth_bias) const
+{
 	m_pipeline.bind(cmd);
 
-	m_pipeline.set_dynamic_state(cmd);
+	m_pipeline.set_dynamic_state(cmd, extent);
 
 	if (const_depth_bias != 0 || slope_depth_bias != 0)
-		m_pipeline.set_depth_bias(const_depth_bias, slope_depth_bias, cmd);
+		m_pipeline.set_dynamic_depth_bias(cmd, const_depth_bias, slope_depth_bias);
 }
 
 template<typename T, size_t N>
@@ -12,23 +12,28 @@ enum class VisualizationMode {
 	LODLevel,
 };
 
+// instanced shapes can keep separate instance lists for the camera (view 0) and each shadow cascade (view i + 1), see InstancedLODShape
+constexpr uint32_t MAX_INSTANCE_VIEWS = 5; // 1 + MAX_CASCADE_COUNT
+
 class Shape : public VKW_Object {
 public:
-	inline virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) = 0;
+	// cascade_idx is the shadow cascade rendered into by depth only passes, passed per draw such that cascades can be recorded in parallel
+	inline virtual void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) = 0;
 	virtual void del() override = 0;
 protected:
 	// one should use setter functions instead of writing directly to this
 	glm::mat4 m_model = glm::mat4(1);
 	glm::mat4 m_inv_model = glm::mat4(1);
-	int m_cascade_idx = 0;
 	int m_lod_level = 0;
 	std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT> m_instance_buffer_addresses = {0};
 
 	// should only be set by set_instance_count
 	uint32_t m_instance_count = 1;
+
+	// radius around the origin of the shape containing all vertices, 0 if unknown
+	float m_bounding_radius = 0.0f;
 public:
 	virtual void set_model_matrix(const glm::mat4& m) = 0;
-	virtual void set_cascade_idx(int idx) = 0;
 	virtual void set_lod_level(int lod_level) = 0;
 
 	virtual void set_visualization_mode(VisualizationMode mode) = 0;
@@ -37,6 +42,7 @@ public:
 	virtual void set_instance_count(uint32_t count) = 0;
 	virtual void set_instance_buffer_address(const std::array<VkDeviceAddress, MAX_FRAMES_IN_FLIGHT>& addresses) = 0;
 	virtual glm::vec3 get_instance_position(uint32_t instance = 0) = 0;
+	virtual float get_bounding_radius() const { return m_bounding_radius; };
 
 };
 
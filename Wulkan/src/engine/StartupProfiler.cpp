@@ -0,0 +1,167 @@
+#include "common.h"
+#include "StartupProfiler.h"
+
+#include <fstream>
+
+#include "spdlog/spdlog.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+// user and kernel time of all threads of the process (std::clock measures wall time with msvc)
+static std::chrono::nanoseconds get_process_cpu_time()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+		return std::chrono::nanoseconds(0);
+	}
+
+	auto to_ticks = [](const FILETIME& time) {
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	};
+	// FILETIME counts in 100 ns
+	return std::chrono::nanoseconds((to_ticks(kernel) + to_ticks(user)) * 100);
+}
+
+static inline double to_ms(std::chrono::nanoseconds duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static inline double to_mib(uint64_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// names are string literals of the engine, only quotes and backslashes would need escaping
+static std::string escape_json(const std::string& str)
+{
+	std::string escaped{};
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			escaped.push_back('\\');
+		}
+		escaped.push_back(c);
+	}
+	return escaped;
+}
+
+void StartupProfiler::enable(const VKW_Path& trace_path)
+{
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_trace_path = trace_path;
+	s_start = std::chrono::steady_clock::now();
+	s_steps.clear();
+	s_open_steps.clear();
+	s_enabled.store(true);
+}
+
+void StartupProfiler::begin(const char* name)
+{
+	if (!is_enabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	s_open_steps.push_back(s_steps.size());
+	s_steps.push_back({ name, static_cast<uint32_t>(s_open_steps.size() - 1), sample(), {} });
+}
+
+void StartupProfiler::end()
+{
+	if (!is_enabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	// finish might have closed the step already
+	if (s_open_steps.empty()) {
+		return;
+	}
+	s_steps[s_open_steps.back()].end = sample();
+	s_open_steps.pop_back();
+}
+
+void StartupProfiler::finish()
+{
+	if (!is_enabled()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	Counters now = sample();
+	for (size_t idx : s_open_steps) {
+		s_steps[idx].end = now;
+	}
+	s_open_steps.clear();
+	s_enabled.store(false);
+
+	log_summary();
+	write_trace();
+}
+
+StartupProfiler::Counters StartupProfiler::sample()
+{
+	return {
+		std::chrono::steady_clock::now(),
+		get_process_cpu_time(),
+		s_read_bytes.load(std::memory_order_relaxed),
+		s_uploaded_bytes.load(std::memory_order_relaxed),
+		s_queue_wait_ns.load(std::memory_order_relaxed)
+	};
+}
+
+void StartupProfiler::write_trace()
+{
+	std::ofstream file(s_trace_path, std::ios::trunc);
+	if (!file) {
+		spdlog::error("Failed to write startup trace {}", s_trace_path);
+		return;
+	}
+
+	auto to_us = [](std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+	};
+
+	// complete events on a single track, nesting is derived from the timestamps
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (size_t i = 0; i < s_steps.size(); i++) {
+		const Step& step = s_steps[i];
+		file << fmt::format(
+			"{{\"name\":\"{}\",\"cat\":\"startup\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":{},\"dur\":{},"
+			"\"args\":{{\"cpu_ms\":{:.3f},\"read_bytes\":{},\"uploaded_bytes\":{},\"queue_wait_ms\":{:.3f}}}}}{}\n",
+			escape_json(step.name),
+			to_us(step.begin.wall - s_start),
+			to_us(step.end.wall - step.begin.wall),
+			to_ms(step.end.cpu - step.begin.cpu),
+			step.end.read_bytes - step.begin.read_bytes,
+			step.end.uploaded_bytes - step.begin.uploaded_bytes,
+			to_ms(std::chrono::nanoseconds(step.end.queue_wait_ns - step.begin.queue_wait_ns)),
+			(i + 1 < s_steps.size()) ? "," : ""
+		);
+	}
+	file << "]}\n";
+
+	spdlog::info("Wrote startup trace to {}", s_trace_path);
+}
+
+void StartupProfiler::log_summary()
+{
+	// cpu time is of the whole process, so it can exceed the wall time while workers are busy
+	spdlog::info("{:<40} {:>10} {:>10} {:>10} {:>10} {:>10}", "Startup step", "wall ms", "cpu ms", "read MiB", "upload MiB", "wait ms");
+	for (const Step& step : s_steps) {
+		spdlog::info("{:<40} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f}",
+			std::string(2 * step.depth, ' ') + step.name,
+			to_ms(step.end.wall - step.begin.wall),
+			to_ms(step.end.cpu - step.begin.cpu),
+			to_mib(step.end.read_bytes - step.begin.read_bytes),
+			to_mib(step.end.uploaded_bytes - step.begin.uploaded_bytes),
+			to_ms(std::chrono::nanoseconds(step.end.queue_wait_ns - step.begin.queue_wait_ns))
+		);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Path.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Measures the init steps of the engine (and the first frame) without a tracy server attached
+// Steps are nested scopes (see STARTUP_SCOPE) on the thread currently initializing, they record wall and process cpu time.
+// Disk reads, uploads and queue waits can be counted from any thread, they are attributed to all steps active at the time.
+// Does nothing unless enabled, finish writes a chrome trace (chrome://tracing, ui.perfetto.dev) and logs a summary table.
+class StartupProfiler
+{
+public:
+	static void enable(const VKW_Path& trace_path);
+	static inline bool is_enabled() { return s_enabled.load(std::memory_order_relaxed); };
+
+	static void begin(const char* name);
+	static void end();
+
+	static inline void add_read(uint64_t bytes) { if (is_enabled()) s_read_bytes.fetch_add(bytes, std::memory_order_relaxed); };
+	static inline void add_upload(uint64_t bytes) { if (is_enabled()) s_uploaded_bytes.fetch_add(bytes, std::memory_order_relaxed); };
+	static inline void add_queue_wait(std::chrono::nanoseconds duration) { if (is_enabled()) s_queue_wait_ns.fetch_add(duration.count(), std::memory_order_relaxed); };
+
+	// closes all open steps, writes the report and disables the profiler
+	static void finish();
+private:
+	struct Counters {
+		std::chrono::steady_clock::time_point wall;
+		std::chrono::nanoseconds cpu;
+		uint64_t read_bytes;
+		uint64_t uploaded_bytes;
+		int64_t queue_wait_ns;
+	};
+
+	struct Step {
+		std::string name;
+		uint32_t depth;
+		Counters begin;
+		Counters end;
+	};
+
+	inline static std::atomic_bool s_enabled = false;
+	inline static std::atomic<uint64_t> s_read_bytes = 0;
+	inline static std::atomic<uint64_t> s_uploaded_bytes = 0;
+	inline static std::atomic<int64_t> s_queue_wait_ns = 0;
+
+	inline static std::mutex s_mutex;
+	inline static VKW_Path s_trace_path;
+	inline static std::chrono::steady_clock::time_point s_start;
+	inline static std::vector<Step> s_steps;
+	inline static std::vector<size_t> s_open_steps; // indices into s_steps
+
+	static Counters sample();
+	static void write_trace();
+	static void log_summary();
+};
+
+class StartupScope
+{
+public:
+	StartupScope(const char* name) { StartupProfiler::begin(name); };
+	~StartupScope() { StartupProfiler::end(); };
+
+	StartupScope(const StartupScope&) = delete;
+	StartupScope& operator=(const StartupScope&) = delete;
+};
+
+// measures a blocking wait on the gpu (queue / fence / semaphore waits)
+class StartupWaitScope
+{
+public:
+	StartupWaitScope() : m_begin(std::chrono::steady_clock::now()) {};
+	~StartupWaitScope() { StartupProfiler::add_queue_wait(std::chrono::steady_clock::now() - m_begin); };
+private:
+	std::chrono::steady_clock::time_point m_begin;
+};
+
+#define STARTUP_SCOPE_CONCAT_IMPL(a, b) a##b
+#define STARTUP_SCOPE_CONCAT(a, b) STARTUP_SCOPE_CONCAT_IMPL(a, b)
+// measures the rest of the enclosing scope as one step
+#define STARTUP_SCOPE(name) StartupScope STARTUP_SCOPE_CONCAT(startup_scope_, __LINE__)(name)
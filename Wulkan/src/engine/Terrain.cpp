@@ -3,17 +3,17 @@
 #include "vk_wrap/VKW_ComputePipeline.h"
 
 #include "DirectionalLight.h"
+#include "StartupProfiler.h"
 
-void Terrain::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, const VKW_Sampler* sampler, RenderPass<TerrainPushConstants, 3>& render_pass, const VKW_Path& height_path, const VKW_Path& albedo_path, const VKW_Path& normal_path, uint32_t mesh_res)
+void Terrain::init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, const VKW_Sampler* sampler, RenderPass<TerrainPushConstants, 3>& render_pass, const VKW_Path& height_path, const VKW_Path& albedo_path, const VKW_Path& normal_path, uint32_t mesh_res)
 {
 	material.init(device, descriptor_pool, render_pass, { Terrain::descriptor_set_layout }, { 2 }, "Terrain material");
 	texture_sampler = sampler;
 
 	// textures to be used
-	// todo check if we need graphics pool for create_texture_from_path
 	height_map = create_texture_from_path(
 		&device,
-		&graphics_pool,
+		uploader,
 		height_path,
 		Texture_Type::Tex_R_Linear,
 		"Terrain Height map"
@@ -29,23 +29,25 @@ void Terrain::init(const VKW_Device& device, const VKW_CommandPool& graphics_poo
 		"Terrain Curvature"
 	);
 
-	// Compute curvature as a preprocessing step
-	precompute_curvature(device, graphics_pool, descriptor_pool);
+	// Compute curvature as a preprocessing step, submitted after the height map upload on the same queue
+	uploader.flush();
+	precompute_curvature(device, graphics_pool, pipeline_cache, descriptor_pool);
 
-	// shading
-	albedo = create_texture_from_path(
+	// shading, block compressed if supported
+	albedo = create_mipmapped_texture_from_path(
 		&device,
-		&graphics_pool,
+		uploader,
 		albedo_path,
 		Texture_Type::Tex_RGB,
 		"Terrain Albedo"
 	);
 
-	normal_map = create_texture_from_path(
+	// only xy is stored, z is reconstructed in the shader
+	normal_map = create_mipmapped_texture_from_path(
 		&device,
-		&graphics_pool,
+		uploader,
 		normal_path,
-		Texture_Type::Tex_RGB_Linear,
+		Texture_Type::Tex_Normal,
 		"Terrain Normals"
 	);
 
@@ -74,7 +76,7 @@ void Terrain::init(const VKW_Device& device, const VKW_CommandPool& graphics_poo
 		}
 	}
 	
-	Mesh::init(device, transfer_pool, terrain_vertices, terrain_indices);
+	Mesh::init(geometry, terrain_vertices, terrain_indices);
 }
 
 void Terrain::set_descriptor_bindings()
@@ -90,8 +92,10 @@ void Terrain::set_descriptor_bindings()
 	}
 }
 
-void Terrain::precompute_curvature(const VKW_Device& device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool)
+void Terrain::precompute_curvature(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, VKW_DescriptorPool& descriptor_pool)
 {	
+	STARTUP_SCOPE("Curvature precompute");
+
 	VKW_DescriptorSetLayout curvature_descriptor_layout{};
 
 	// curvature precompute descriptor set layout
@@ -124,7 +128,7 @@ void Terrain::precompute_curvature(const VKW_Device& device, const VKW_CommandPo
 	// compute pipeline
 	VKW_ComputePipeline pipeline{};
 	pipeline.add_descriptor_sets({ curvature_descriptor_layout });
-	pipeline.init(&device, "shaders/terrain/curvature_comp.spv", "Curvature compute pipeline");
+	pipeline.init(&device, "shaders/terrain/curvature_comp.spv", "Curvature compute pipeline", &pipeline_cache);
 
 	VKW_CommandBuffer command_buffer{};
 	command_buffer.init(
@@ -151,7 +155,7 @@ void Terrain::precompute_curvature(const VKW_Device& device, const VKW_CommandPo
 	compute_desc_set.del();
 }
 
-RenderPass<TerrainPushConstants, 3> Terrain::create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 3>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only, bool wireframe_mode, bool bias_depth, int nr_shadow_cascades)
+RenderPass<TerrainPushConstants, 3> Terrain::create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 3>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only, bool wireframe_mode, bool bias_depth, int nr_shadow_cascades)
 {
 	RenderPass<TerrainPushConstants, 3> render_pass{};
 
@@ -221,7 +225,7 @@ RenderPass<TerrainPushConstants, 3> Terrain::create_render_pass(const VKW_Device
 
 	graphics_pipeline.set_sample_count(sample_count);
 
-	graphics_pipeline.init(device, "Terrain graphics pipeline");
+	graphics_pipeline.init(device, "Terrain graphics pipeline", &pipeline_cache);
 
 	terrain_vert_shader.del();
 	tess_ctrl_shader.del();
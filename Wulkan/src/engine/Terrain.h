@@ -29,20 +29,28 @@ struct TerrainPushConstants {
 	alignas(4) int cascade_idx;
 };
 
+// identifies a variant of the terrain color pass (see RenderPassVariants)
+struct TerrainPipelineKey {
+	bool wireframe = false;
+	int nr_shadow_cascades = 3; // specialization constant
+
+	auto operator<=>(const TerrainPipelineKey&) const = default;
+};
+
 class Terrain : public Mesh
 {
 public:
 	Terrain() = default;
-	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, const VKW_Sampler* sampler, RenderPass<TerrainPushConstants, 3>& render_pass, const VKW_Path& height_path, const VKW_Path& albedo_path, const VKW_Path& normal_path, uint32_t mesh_res);
+	void init(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, UploadBatcher& uploader, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool, const VKW_Sampler* sampler, RenderPass<TerrainPushConstants, 3>& render_pass, const VKW_Path& height_path, const VKW_Path& albedo_path, const VKW_Path& normal_path, uint32_t mesh_res);
 	void set_descriptor_bindings();
 	void del() override;
 
 	// creates singleton render pass, needs to be deleted by caller of function
 	// depth_bias only works in depth_only mode
-	static RenderPass<TerrainPushConstants, 3> create_render_pass(const VKW_Device* device, const std::array<VKW_DescriptorSetLayout, 3>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only = false, bool wireframe_mode = false, bool bias_depth = false, int nr_shadow_cascades = 3);
+	static RenderPass<TerrainPushConstants, 3> create_render_pass(const VKW_Device* device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 3>& layouts, Texture& color_rt, Texture& depth_rt, VkSampleCountFlagBits sample_count, bool depth_only = false, bool wireframe_mode = false, bool bias_depth = false, int nr_shadow_cascades = 3);
 	static VKW_DescriptorSetLayout create_descriptor_set_layout(const VKW_Device& device);
 
-	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame) override;
+	inline void draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx = 0) override;
 private:
 	const VKW_Sampler* texture_sampler = nullptr;
 	Texture height_map;
@@ -52,7 +60,7 @@ private:
 
 	Texture curvatue;
 	// precomputes the curvature from the height map using a compute shader
-	void precompute_curvature(const VKW_Device& device, const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool);
+	void precompute_curvature(const VKW_Device& device, const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, VKW_DescriptorPool& descriptor_pool);
 
 	float tesselation_strength;
 	float max_tesselation;
@@ -72,7 +80,7 @@ public:
 	const Texture& get_albedo() const { return albedo; };
 };
 
-inline void Terrain::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame)
+inline void Terrain::draw(const VKW_CommandBuffer& command_buffer, uint32_t current_frame, int cascade_idx)
 {
 	material.bind(
 		command_buffer,
@@ -84,7 +92,7 @@ inline void Terrain::draw(const VKW_CommandBuffer& command_buffer, uint32_t curr
 			max_tesselation,
 			texture_eps,
 			visualization_mode,
-			m_cascade_idx,
+			cascade_idx,
 		}
 	);
 
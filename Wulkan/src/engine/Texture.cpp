@@ -3,6 +3,11 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
 #include "Texture.h"
+#include "TextureCache.h"
+#include "BlockCompression.h"
+#include "CubeMapFilter.h"
+#include "UploadBatcher.h"
+#include "StartupProfiler.h"
 
 #define TINYEXR_IMPLEMENTATION
 #include <tinyexr.h>
@@ -11,6 +16,10 @@
 #include "vk_wrap/VKW_Sampler.h"
 
 #include "spdlog/spdlog.h"
+#include "glm/gtc/packing.hpp"
+
+#include <cstring>
+#include <numeric>
 
 struct CPUSamplePushConstant {
 	unsigned int size; // size of sample / result buffer
@@ -25,6 +34,7 @@ void Texture::init(const VKW_Device* vkw_device, unsigned int w, unsigned int h,
 	format = f;
 	name = obj_name;
 	m_mip_levels = mip_levels;
+	m_samples = samples;
 
 	VkImageCreateInfo image_info{};
 	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -90,7 +100,8 @@ void Texture::del()
 
 VkImageView Texture::get_image_view(VkImageAspectFlags aspect_flag, VkImageViewType type, uint32_t base_layer, uint32_t array_layers) const
 {
-	std::tuple<VkImageAspectFlags, VkImageViewType, int> tuple = std::make_tuple(aspect_flag, type, base_layer);
+	// views of all mip levels
+	std::tuple<VkImageAspectFlags, VkImageViewType, int, uint32_t> tuple = std::make_tuple(aspect_flag, type, base_layer, VK_REMAINING_MIP_LEVELS);
 	if (image_views.contains(tuple)) {
 		return image_views[tuple];
 	} else {
@@ -117,6 +128,35 @@ VkImageView Texture::get_image_view(VkImageAspectFlags aspect_flag, VkImageViewT
 	}
 }
 
+VkImageView Texture::get_mip_image_view(VkImageAspectFlags aspect_flag, uint32_t mip_level) const
+{
+	std::tuple<VkImageAspectFlags, VkImageViewType, int, uint32_t> tuple = std::make_tuple(aspect_flag, VK_IMAGE_VIEW_TYPE_2D, 0, mip_level);
+	if (image_views.contains(tuple)) {
+		return image_views[tuple];
+	}
+
+	assert(mip_level < m_mip_levels && "Tried to get view of a mip level the texture does not have");
+
+	VkImageViewCreateInfo view_info{};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = image;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = format;
+
+	view_info.subresourceRange.aspectMask = aspect_flag;
+	view_info.subresourceRange.baseMipLevel = mip_level;
+	view_info.subresourceRange.levelCount = 1;
+	view_info.subresourceRange.baseArrayLayer = 0;
+	view_info.subresourceRange.layerCount = 1;
+
+	VkImageView image_view;
+	VK_CHECK_ET(vkCreateImageView(*device, &view_info, nullptr, &image_view), RuntimeException, fmt::format("Failed to create image ({}) view of mip level {}", name, mip_level));
+	device->name_object((uint64_t)image_view, VK_OBJECT_TYPE_IMAGE_VIEW, fmt::format("{} view (mip {})", name, mip_level));
+
+	image_views[tuple] = image_view;
+	return image_view;
+}
+
 VKW_DescriptorSetLayout Texture::create_cpu_sample_descriptor_set_layout(const VKW_Device& device)
 {
 	// create descriptor layout
@@ -143,7 +183,7 @@ VKW_DescriptorSetLayout Texture::create_cpu_sample_descriptor_set_layout(const V
 	return descriptor_layout;
 }
 
-void Texture::cpu_texture_samples(const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool, const VKW_DescriptorSetLayout& descriptor_layout, const VKW_Sampler& sampler, const std::vector<glm::vec2>& samples, std::vector<glm::vec4>& results) const
+void Texture::cpu_texture_samples(const VKW_CommandPool& graphics_pool, const VKW_PipelineCache& pipeline_cache, VKW_DescriptorPool& descriptor_pool, const VKW_DescriptorSetLayout& descriptor_layout, const VKW_Sampler& sampler, const std::vector<glm::vec2>& samples, std::vector<glm::vec4>& results) const
 {
 	ZoneScoped;
 
@@ -197,7 +237,7 @@ void Texture::cpu_texture_samples(const VKW_CommandPool& graphics_pool, VKW_Desc
 	VKW_ComputePipeline compute_pipeline{};
 	compute_pipeline.add_descriptor_sets({ descriptor_layout });
 	compute_pipeline.add_push_constant(push_constant);
-	compute_pipeline.init(device, "shaders/texture_reads/cpu_texture_read_comp.spv", "CPU Texture Sample Compute Pass");
+	compute_pipeline.init(device, "shaders/texture_reads/cpu_texture_read_comp.spv", "CPU Texture Sample Compute Pass", &pipeline_cache);
 
 	// Command buffer (single use)
 	VKW_CommandBuffer command_buffer{};
@@ -246,6 +286,12 @@ void Texture::transition_layout(const VKW_CommandPool* command_pool, VkImageLayo
 	command_buffer.submit_single_use();
 }
 
+// stages only supported by queues with graphics capabilities
+constexpr VkPipelineStageFlags2 GRAPHICS_PIPELINE_STAGES = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT
+	| VK_PIPELINE_STAGE_2_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_2_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_2_GEOMETRY_SHADER_BIT
+	| VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT
+	| VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+
 void Texture::transition_layout(const VKW_CommandBuffer& command_buffer, VkImage image, VkImageLayout initial_layout, VkImageLayout new_layout, uint32_t old_ownership, uint32_t new_ownership, uint32_t mip_level, uint32_t level_count)
 {
 	VkImageMemoryBarrier2 barrier{};
@@ -266,7 +312,8 @@ void Texture::transition_layout(const VKW_CommandBuffer& command_buffer, VkImage
 	barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
 
 	VkImageAspectFlags aspect = 0;
-	if (new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || initial_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) {
+	if (new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || initial_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
+		|| new_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL || initial_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL) {
 		aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
 	}
 	else if (new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL || initial_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
@@ -352,11 +399,28 @@ void Texture::transition_layout(const VKW_CommandBuffer& command_buffer, VkImage
 		barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
 	}
+	else if (initial_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL) {
+		// read the depth rendered so far in a compute shader (see HiZPyramid), keeps the contents for later depth tests
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+		barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	}
+	else if (initial_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) {
+		// continue rendering into it, the compute reads only have to finish before
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+		barrier.srcAccessMask = VK_ACCESS_2_NONE;
+		barrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	}
 	else if (initial_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_GENERAL) {
 		// general layout supports all operations
 		// Note: This should however only be used in special purposes (eg texture is used in compute shader, otherwise try more specific approach)
 
-		barrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT;
+		// waits on earlier compute shaders, as images rewritten every frame are still read by the previous one
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
 		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
 
 		barrier.srcAccessMask = VK_ACCESS_2_NONE;
@@ -380,6 +444,26 @@ void Texture::transition_layout(const VKW_CommandBuffer& command_buffer, VkImage
 		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
 	}
 
+	// queue family ownership transfer: the same barrier is recorded on both queues,
+	// but the release only has the first and the acquire only the second synchronization scope
+	if (old_ownership != new_ownership) {
+		uint32_t family = command_buffer.get_queue()->get_queue_family();
+		if (family == old_ownership) {
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		}
+		else if (family == new_ownership) {
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+		}
+	}
+
+	// i.e. uploads on a dedicated transfer queue, which can only wait on its own stages
+	if (!command_buffer.get_queue()->has_graphics()) {
+		barrier.srcStageMask &= ~GRAPHICS_PIPELINE_STAGES;
+		barrier.dstStageMask &= ~GRAPHICS_PIPELINE_STAGES;
+	}
+
 	VkDependencyInfo depency_info{};
 	depency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
 
@@ -450,6 +534,9 @@ float* load_exr_image(const VKW_Path& path, int& width, int& height, int& channe
 		throw IOException(msg, __FILE__, __LINE__);
 	}
 
+	std::error_code ec;
+	StartupProfiler::add_read(std::filesystem::file_size(path, ec));
+
 	return rgba;
 }
 
@@ -464,6 +551,9 @@ stbi_uc* load_image(const VKW_Path& path, int& width, int& height, int& channels
 		throw IOException(fmt::format("Failed to load image ({}) at {}", reason, path), __FILE__, __LINE__);
 	}
 
+	std::error_code ec;
+	StartupProfiler::add_read(std::filesystem::file_size(path, ec));
+
 	return pixels;
 }
 
@@ -486,7 +576,7 @@ VkBufferImageCopy create_buffer_image_copy(VkDeviceSize buffer_offset, uint32_t
 }
 
 #include <spdlog/spdlog.h>
-Texture create_texture_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name) {
+Texture create_texture_from_path(const VKW_Device* device, UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name) {
 	VkFormat format = Texture::find_format(*device, type);
 
 	bool is_exr = path.extension().string() == ".exr";
@@ -523,366 +613,507 @@ Texture create_texture_from_path(const VKW_Device* device, const VKW_CommandPool
 		name
 	);
 
+	// a single level without layers
+	MipmappedTextureData data{};
+	data.format = format;
+	data.width = static_cast<unsigned int>(width);
+	data.height = static_cast<unsigned int>(height);
+	data.staging_buffer = staging_buffer;
+	data.staging_offsets = { 0 };
 
-	VKW_CommandBuffer command_buffer{};
-	command_buffer.init(
+	uploader.upload(texture, std::move(data));
+
+	return texture;
+}
+
+Texture create_cube_map_from_path(const VKW_Device* device, UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name, ThreadPool* thread_pool)
+{
+	MipmappedTextureData data = load_cube_map_data(device, path, type, thread_pool);
+	spdlog::info("Cube map {}: {:.2f} MiB ({:.2f} MiB as 32 bit float)", name, data.staging_buffer.size() / (1024.0 * 1024.0), data.uncompressed_size / (1024.0 * 1024.0));
+
+	Texture texture{};
+	texture.init(
 		device,
-		command_pool,
-		true,
-		"Image creation CMD"
+		data.width, data.height,
+		data.format,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		sharing_exlusive(), // exclusively owned by graphics queue
+		name,
+		data.mip_levels,		// mip levels
+		VK_SAMPLE_COUNT_1_BIT,  // sample count
+		6,					    // array layers
+		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
 	);
 
-	command_buffer.begin_single_use();
+	uploader.upload(texture, std::move(data));
 
-	// transfer layout 1
-	Texture::transition_layout(
-		command_buffer,
-		texture,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-	);
+	return texture;
+}
 
-	// copying
-	VkBufferImageCopy image_copy = create_buffer_image_copy(0, 0, 0, (unsigned int) width, (unsigned int) height);
+// size of one texel of the formats supported by create_mipmapped_texture_from_path
+static VkDeviceSize get_texel_size(VkFormat format)
+{
+	if (format == VK_FORMAT_R32G32B32A32_SFLOAT) {
+		return 4 * sizeof(float);
+	}
+	if (format == VK_FORMAT_R16G16B16A16_SFLOAT) {
+		return 4 * sizeof(uint16_t);
+	}
+	return Texture::get_stbi_channels(format) * sizeof(stbi_uc);
+}
 
-	vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
+static inline bool is_srgb(VkFormat format)
+{
+	return format == VK_FORMAT_R8_SRGB || format == VK_FORMAT_R8G8B8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
 
-	// transfer layout 2
-	Texture::transition_layout(
-		command_buffer,
-		texture,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+// 8 bit sRGB value to linear [0,1]
+static const std::array<float, 256>& get_srgb_to_linear_table()
+{
+	static const std::array<float, 256> table = []() {
+		std::array<float, 256> t{};
+		for (int i = 0; i < 256; i++) {
+			float c = i / 255.0f;
+			t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return t;
+	}();
+	return table;
+}
+
+static inline unsigned int mip_extent(unsigned int extent, uint32_t level)
+{
+	return std::max(1u, extent >> level);
+}
+
+// 2x2 box filter of src into dst (half the size), odd edges reuse the last row / column
+// decode / encode convert a channel to and from the space it is filtered in
+template <typename T, typename Decode, typename Encode>
+static void downsample(const T* src, unsigned int src_width, unsigned int src_height, T* dst, unsigned int dst_width, unsigned int dst_height, unsigned int channels, Decode decode, Encode encode)
+{
+	for (unsigned int y = 0; y < dst_height; y++) {
+		unsigned int y0 = std::min(2 * y, src_height - 1);
+		unsigned int y1 = std::min(2 * y + 1, src_height - 1);
+
+		for (unsigned int x = 0; x < dst_width; x++) {
+			unsigned int x0 = std::min(2 * x, src_width - 1);
+			unsigned int x1 = std::min(2 * x + 1, src_width - 1);
+
+			for (unsigned int c = 0; c < channels; c++) {
+				float sum =
+					decode(src[(y0 * src_width + x0) * channels + c], c) +
+					decode(src[(y0 * src_width + x1) * channels + c], c) +
+					decode(src[(y1 * src_width + x0) * channels + c], c) +
+					decode(src[(y1 * src_width + x1) * channels + c], c);
+
+				dst[(y * dst_width + x) * channels + c] = encode(0.25f * sum, c);
+			}
+		}
+	}
+}
+
+// generates level of pixels at level_offsets[level] from the previous level
+// sRGB colors are filtered in linear space, like blits of sRGB images do
+static void generate_mip_level(std::vector<std::byte>& pixels, const std::vector<VkDeviceSize>& level_offsets, uint32_t level, unsigned int width, unsigned int height, VkFormat format)
+{
+	unsigned int src_width = mip_extent(width, level - 1), src_height = mip_extent(height, level - 1);
+	unsigned int dst_width = mip_extent(width, level), dst_height = mip_extent(height, level);
+
+	const std::byte* src = pixels.data() + level_offsets[level - 1];
+	std::byte* dst = pixels.data() + level_offsets[level];
+
+	if (format == VK_FORMAT_R32G32B32A32_SFLOAT) {
+		downsample(
+			reinterpret_cast<const float*>(src), src_width, src_height,
+			reinterpret_cast<float*>(dst), dst_width, dst_height, 4,
+			[](float v, unsigned int) { return v; },
+			[](float v, unsigned int) { return v; }
+		);
+		return;
+	}
+
+	unsigned int channels = Texture::get_stbi_channels(format);
+
+	// alpha is always linear
+	unsigned int color_channels = 0;
+	if (is_srgb(format)) {
+		color_channels = channels == 4 ? 3 : channels;
+	}
+
+	const std::array<float, 256>& srgb_to_linear = get_srgb_to_linear_table();
+
+	downsample(
+		reinterpret_cast<const stbi_uc*>(src), src_width, src_height,
+		reinterpret_cast<stbi_uc*>(dst), dst_width, dst_height, channels,
+		[color_channels, &srgb_to_linear](stbi_uc v, unsigned int c) {
+			return c < color_channels ? srgb_to_linear[v] : v / 255.0f;
+		},
+		[color_channels](float v, unsigned int c) {
+			if (c < color_channels) {
+				v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+			}
+			return static_cast<stbi_uc>(std::clamp(v * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
 	);
+}
 
-	command_buffer.submit_single_use();
+// offsets of all levels for a texture in format, returns the size of all levels
+// the copy needs offsets that are multiples of 4 and of the texel / block size, so levels are aligned to the least common multiple (12 bytes for rgb)
+static VkDeviceSize compute_level_offsets(VkFormat format, unsigned int width, unsigned int height, uint32_t mip_levels, std::vector<VkDeviceSize>& offsets, uint32_t layers = 1)
+{
+	offsets.clear();
 
-	staging_buffer.del();
+	const VkDeviceSize element_size = is_block_compressed(format) ? get_block_size(format) : get_texel_size(format);
+	const VkDeviceSize alignment = std::lcm(element_size, VkDeviceSize(4));
 
-	return texture;
+	VkDeviceSize size = 0;
+	for (uint32_t i = 0; i < mip_levels; i++) {
+		offsets.push_back(size);
+
+		VkDeviceSize level_size;
+		if (is_block_compressed(format)) {
+			level_size = get_compressed_size(format, mip_extent(width, i), mip_extent(height, i));
+		}
+		else {
+			level_size = get_texel_size(format) * mip_extent(width, i) * mip_extent(height, i);
+		}
+		size += level_size * layers;
+		size = (size + alignment - 1) / alignment * alignment;
+	}
+	return size;
 }
 
-Texture create_cube_map_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name)
+MipmappedTextureData load_mipmapped_texture_data(const VKW_Device* device, const VKW_Path& path, Texture_Type type, ThreadPool* thread_pool)
 {
-	VkFormat format = Texture::find_format(*device, type);
+	ZoneScoped;
 
 	bool is_exr = path.extension().string() == ".exr";
 
-	// get all paths
-	std::string path_str = path.string();
-	size_t special_symbol_idx = path_str.find("%");
-	if (special_symbol_idx == std::string::npos) {
-		throw IOException(
-			fmt::format("Cube map path does not contain % to be replaced with sides (+X,-X,...): {}", path), __FILE__, __LINE__
-		);
-	}
+	// format the image is decoded and filtered in
+	VkFormat base_format = Texture::find_format(*device, type);
 
-	std::string pre_string = path_str.substr(0, special_symbol_idx);
-	std::string post_string = path_str.substr(special_symbol_idx+1, path_str.size() - (special_symbol_idx + 1));
-	std::array<VKW_Path, 6> paths = {
-		pre_string + "+X" + post_string,
-		pre_string + "-X" + post_string,		
+	if (is_exr && base_format != VK_FORMAT_R32G32B32A32_SFLOAT) {
+		throw NotImplementedException(fmt::format("Mipmapped EXR texture {} needs to be of type Tex_HDR_RGBA", path), __FILE__, __LINE__);
+	}
 
-		pre_string + "+Y" + post_string,
-		pre_string + "-Y" + post_string,
+	MipmappedTextureData data{};
+	VkFormat compressed_format = is_exr ? VK_FORMAT_UNDEFINED : Texture::find_compressed_format(*device, type);
+	data.format = compressed_format != VK_FORMAT_UNDEFINED ? compressed_format : base_format;
+
+	std::vector<VkDeviceSize> base_offsets{};
+
+	TextureCache cache;
+	if (cache.open(path, data.format)) {
+		data.width = cache.get_width();
+		data.height = cache.get_height();
+		data.mip_levels = cache.get_mip_levels();
+		data.uncompressed_size = compute_level_offsets(base_format, data.width, data.height, data.mip_levels, base_offsets);
+
+		// offsets were only checked against the cache size
+		std::span<const std::byte> levels = cache.get_data();
+		bool fits = data.mip_levels == static_cast<uint32_t>(floor(log2(std::max(data.width, data.height))) + 1) &&
+			compute_level_offsets(data.format, data.width, data.height, data.mip_levels, data.staging_offsets) <= levels.size() &&
+			std::equal(data.staging_offsets.begin(), data.staging_offsets.end(), cache.get_level_offsets().begin());
+
+		if (fits) {
+			// mapped levels are already in upload layout
+			data.staging_buffer = create_staging_buffer(device, levels.size(), levels.data(), levels.size(), "Image staging buffer");
+			return data;
+		}
 
-		pre_string + "-Z" + post_string, // vulkan cube maps are y down
-		pre_string + "+Z" + post_string,
-	};
+		spdlog::info("Texture cache of {} has invalid levels", path);
+	}
 
-	VKW_Buffer staging_buffer{};
-	VkDeviceSize image_size;
+	// decode level 0
+	VkDeviceSize texel_size = get_texel_size(base_format);
 
 	int width, height;
+	std::vector<std::byte> pixels{}; // all levels
 	if (is_exr) {
 		int channels;
+		float* rgba = load_exr_image(path, width, height, channels);
 
-		float* rgba = load_exr_image(paths[0], width, height, channels);
-
-		image_size = width * height * channels * sizeof(float);
-		staging_buffer = create_staging_buffer(device, image_size*6, rgba, image_size, "Cube map staging buffer");
+		pixels.resize(width * height * texel_size);
+		std::memcpy(pixels.data(), rgba, pixels.size());
 
 		free(rgba);
 	}
 	else {
-		throw NotImplementedException("Creating cube map with low dynamic range images is not supported", __FILE__, __LINE__);
-	}
-
-	// copy all 6 images into single staging buffer
-	for (unsigned int i = 1; i < 6; i++) {
 		int channels;
+		stbi_uc* image = load_image(path, width, height, channels, base_format);
+
+		pixels.resize(width * height * texel_size);
+		std::memcpy(pixels.data(), image, pixels.size());
 
-		float* rgba = load_exr_image(paths[i], width, height, channels);
+		stbi_image_free(image);
+	}
 
-		staging_buffer.copy_into(rgba, image_size, image_size * i);
+	data.width = static_cast<unsigned int>(width);
+	data.height = static_cast<unsigned int>(height);
+	data.mip_levels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1);
 
-		free(rgba);
+	// generate the remaining levels
+	data.uncompressed_size = compute_level_offsets(base_format, data.width, data.height, data.mip_levels, base_offsets);
+	pixels.resize(data.uncompressed_size);
+
+	for (uint32_t i = 1; i < data.mip_levels; i++) {
+		generate_mip_level(pixels, base_offsets, i, data.width, data.height, base_format);
 	}
 
-	Texture texture{};
-	texture.init(
-		device,
-		width, height,
-		format,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		sharing_exlusive(), // exclusively owned by graphics queue
-		name,
-		1,						// mip levels
-		VK_SAMPLE_COUNT_1_BIT,  // sample count
-		6,					    // array layers
-		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
-	);
+	if (compressed_format != VK_FORMAT_UNDEFINED) {
+		ZoneScopedN("Compress levels");
 
-	VKW_CommandBuffer command_buffer{};
-	command_buffer.init(
-		device,
-		command_pool,
-		true,
-		"Cubemap creation CMD"
-	);
+		std::vector<std::byte> blocks(compute_level_offsets(compressed_format, data.width, data.height, data.mip_levels, data.staging_offsets));
+		unsigned int channels = Texture::get_stbi_channels(base_format);
 
-	command_buffer.begin_single_use();
-	{
-		// transfer layout 1
-		Texture::transition_layout(
-			command_buffer,
-			texture,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-		);
+		for (uint32_t i = 0; i < data.mip_levels; i++) {
+			unsigned int level_width = mip_extent(data.width, i), level_height = mip_extent(data.height, i);
+			const uint8_t* level = reinterpret_cast<const uint8_t*>(pixels.data() + base_offsets[i]);
 
-		std::array<VkBufferImageCopy, 6> image_copies{};
+			// BC4 has no sRGB variant
+			std::vector<uint8_t> linear_level{};
+			if (is_srgb(base_format) && compressed_format == VK_FORMAT_BC4_UNORM_BLOCK) {
+				linear_level.resize(level_width * level_height * channels);
+				for (size_t j = 0; j < linear_level.size(); j++) {
+					linear_level[j] = static_cast<uint8_t>(std::lround(get_srgb_to_linear_table()[level[j]] * 255.0f));
+				}
+				level = linear_level.data();
+			}
 
-		for (unsigned int i = 0; i < 6; i++) {
-			image_copies[i] = create_buffer_image_copy(
-				image_size * i, // buffer offset
-				0, // mip level
-				i, // array level
-				(unsigned int) width,
-				(unsigned int) height
-			);
+			compress_image(compressed_format, level, level_width, level_height, channels, blocks.data() + data.staging_offsets[i], thread_pool);
 		}
 
-		vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 6, image_copies.data());
+		pixels = std::move(blocks);
+	}
+	else {
+		data.staging_offsets = base_offsets;
+	}
 
-		// transfer layout 2
-		Texture::transition_layout(
-			command_buffer,
-			texture,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		);
+	try {
+		TextureCache::write(path, data.format, data.width, data.height, pixels, data.staging_offsets);
+	}
+	catch (const IOException& e) {
+		spdlog::warn("Failed to write texture cache: {}", e.what());
 	}
-	command_buffer.submit_single_use();
-	
-	staging_buffer.del();
 
-	return texture;
+	data.staging_buffer = create_staging_buffer(device, pixels.size(), pixels.data(), pixels.size(), "Image staging buffer");
+
+	return data;
 }
 
-Texture create_mipmapped_texture_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name)
+MipmappedTextureData load_cube_map_data(const VKW_Device* device, const VKW_Path& path, Texture_Type type, ThreadPool* thread_pool)
 {
-	VkFormat format = Texture::find_format(*device, type);
+	ZoneScoped;
 
 	bool is_exr = path.extension().string() == ".exr";
-
-	// TODO Exr mipmap
-	if (is_exr) {
-		throw NotImplementedException("Creating mipmapped texture not supported for high dynamic range", __FILE__, __LINE__);
+	if (!is_exr) {
+		throw NotImplementedException("Creating cube map with low dynamic range images is not supported", __FILE__, __LINE__);
 	}
 
+	// get all paths
 	std::string path_str = path.string();
-	size_t special_symbol_idx = path_str.find(".");
-
-	VKW_Path path_mip_0{ path_str.substr(0, special_symbol_idx) + "_0" + path.extension().string()};
-
-	VKW_Buffer staging_buffer; // if already computed miplevels: all mip levels into said stating buffer, else only layer 0
-	std::vector<uint32_t> staging_offsets{}; // stores offsets into staging buffer (only used if loaded from existing images)
-	int width, height;
-	uint32_t mip_levels;
-
-	bool load_mip_maps = std::filesystem::exists(path_mip_0);
-
-	if (load_mip_maps) {
-		// load image 0
-		int channels;
-
-		std::vector<stbi_uc*> pixel_mips{}; // stores pointers to images
-		std::vector<uint32_t> image_sizes{}; // stores the size of each mip level image
-		uint32_t current_size = 0;
-
-		pixel_mips.push_back(load_image(path_mip_0, width, height, channels, format));
-		image_sizes.push_back(static_cast<uint32_t>(width * height * channels * sizeof(stbi_uc)));
-
-		staging_offsets.push_back(current_size);
-		current_size += image_sizes[0];
-
-		mip_levels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1);
-
-		// load stored images
-		for (unsigned int i = 1; i < mip_levels; i++) {
-			VKW_Path path_mip_i{ fmt::format("{}_{}{}", path_str.substr(0, special_symbol_idx), i, path.extension().string()) };
-
-			int mip_width, mip_height, mip_channels;
-
-			if (!std::filesystem::exists(path_mip_i)) {
-				throw IOException(
-					fmt::format("Mipmap image: {} does not exists even though level 0 does", path_mip_i), __FILE__, __LINE__
-				);
-			}
+	size_t special_symbol_idx = path_str.find("%");
+	if (special_symbol_idx == std::string::npos) {
+		throw IOException(
+			fmt::format("Cube map path does not contain % to be replaced with sides (+X,-X,...): {}", path), __FILE__, __LINE__
+		);
+	}
 
-			pixel_mips.push_back(load_image(path_mip_i, mip_width, mip_height, mip_channels, format));
+	std::string pre_string = path_str.substr(0, special_symbol_idx);
+	std::string post_string = path_str.substr(special_symbol_idx+1, path_str.size() - (special_symbol_idx + 1));
+	std::array<VKW_Path, 6> paths = {
+		pre_string + "+X" + post_string,
+		pre_string + "-X" + post_string,		
 
-			if (channels != mip_channels) {
-				throw IOException(
-					fmt::format("Mipmap images (level: {}) has {} channels, while mipmap level 0 has {}", i, mip_channels, channels), __FILE__, __LINE__
-				);
-			}
-			if (mip_width != (width >> i)) {
-				throw IOException(
-					fmt::format("Mipmap images (level: {}) has width {} and not expected width {}", i, mip_channels, mip_width, (width >> i)), __FILE__, __LINE__
-				);
-			}
-			if (mip_height != (height >> i)) {
-				throw IOException(
-					fmt::format("Mipmap images (level: {}) has height {} and not expected height {}", i, mip_channels, mip_height, (height >> i)), __FILE__, __LINE__
-				);
-			}
+		pre_string + "+Y" + post_string,
+		pre_string + "-Y" + post_string,
 
-			image_sizes.push_back(static_cast<uint32_t>(mip_width * mip_height * mip_channels * sizeof(stbi_uc)));
-			staging_offsets.push_back(current_size);
-			current_size += image_sizes[i];
+		pre_string + "-Z" + post_string, // vulkan cube maps are y down
+		pre_string + "+Z" + post_string,
+	};
+	VKW_Path cache_path = TextureCache::get_cache_path(pre_string + "cube" + post_string);
+
+	MipmappedTextureData data{};
+	data.layers = 6;
+
+	VkFormat compressed_format = Texture::find_compressed_format(*device, type);
+	data.format = compressed_format != VK_FORMAT_UNDEFINED ? compressed_format : Texture::find_format(*device, type);
+
+	TextureCache cache;
+	if (cache.open(paths, cache_path, data.format)) {
+		data.width = cache.get_width();
+		data.height = cache.get_height();
+		data.mip_levels = cache.get_mip_levels();
+		data.uncompressed_size = compute_level_offsets(VK_FORMAT_R32G32B32A32_SFLOAT, data.width, data.height, data.mip_levels, data.staging_offsets, data.layers);
+
+		std::span<const std::byte> levels = cache.get_data();
+		bool fits = cache.get_layers() == data.layers && data.width == data.height &&
+			data.mip_levels == std::min(ENVIRONMENT_ROUGHNESS_LEVELS, static_cast<uint32_t>(floor(log2(data.width)) + 1)) &&
+			compute_level_offsets(data.format, data.width, data.height, data.mip_levels, data.staging_offsets, data.layers) <= levels.size() &&
+			std::equal(data.staging_offsets.begin(), data.staging_offsets.end(), cache.get_level_offsets().begin());
+
+		if (fits) {
+			data.staging_buffer = create_staging_buffer(device, levels.size(), levels.data(), levels.size(), "Cube map staging buffer");
+			return data;
 		}
 
-		VkDeviceSize image_size = current_size;
-		staging_buffer = create_staging_buffer(device, image_size, pixel_mips[0], image_sizes[0], "Image staging buffer");
+		spdlog::info("Cube map cache {} has invalid levels", cache_path);
+	}
 
-		// copy images into staging buffer
-		for (unsigned int i = 1; i < mip_levels; i++) {
-			staging_buffer.copy_into(pixel_mips[i], image_sizes[i], staging_offsets[i]);
+	// decode all faces at once
+	std::array<float*, 6> faces{};
+	std::array<int, 6> widths{}, heights{};
+	std::array<std::exception_ptr, 6> errors{};
+	auto decode_face = [&](size_t i) {
+		try {
+			int channels;
+			faces[i] = load_exr_image(paths[i], widths[i], heights[i], channels);
 		}
-
-		for (unsigned int i = 0; i < mip_levels; i++) {
-			stbi_image_free(pixel_mips[i]);
+		catch (...) {
+			errors[i] = std::current_exception();
 		}
+	};
+
+	if (thread_pool) {
+		thread_pool->parallel_for(6, decode_face);
 	}
 	else {
-		// dynamic mip map generation
-		// create image with first level
-		if (is_exr) {
-			int channels;
-
-			float* rgba = load_exr_image(path, width, height, channels);
+		for (size_t i = 0; i < 6; i++) {
+			decode_face(i);
+		}
+	}
 
-			VkDeviceSize image_size = width * height * channels * sizeof(float);
-			staging_buffer = create_staging_buffer(device, image_size, rgba, image_size, "EXR staging buffer");
+	std::exception_ptr error = nullptr;
+	for (size_t i = 0; i < 6; i++) {
+		if (!error && errors[i]) {
+			error = errors[i];
+		}
+		else if (!error && (widths[i] != widths[0] || heights[i] != heights[0] || widths[i] != heights[i])) {
+			error = std::make_exception_ptr(IOException(fmt::format("Cube map faces need to be square and of the same size: {}", paths[i]), __FILE__, __LINE__));
+		}
+	}
 
-			free(rgba);
+	// all faces next to each other (level 0 of the upload layout)
+	unsigned int size = static_cast<unsigned int>(widths[0]);
+	std::vector<glm::vec4> source{};
+	if (!error) {
+		source.resize(6 * static_cast<size_t>(size) * size);
+		for (size_t i = 0; i < 6; i++) {
+			std::memcpy(source.data() + i * size * size, faces[i], size * size * sizeof(glm::vec4));
 		}
-		else {
-			int channels;
-			stbi_uc* pixels = load_image(path, width, height, channels, format);
+	}
 
-			VkDeviceSize image_size = width * height * channels * sizeof(stbi_uc);
-			staging_buffer = create_staging_buffer(device, image_size, pixels, image_size, "Image staging buffer");
+	for (float* face : faces) {
+		free(face);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
 
-			stbi_image_free(pixels);
+	data.width = size;
+	data.height = size;
+	data.mip_levels = std::min(ENVIRONMENT_ROUGHNESS_LEVELS, static_cast<uint32_t>(floor(log2(size)) + 1));
+	data.uncompressed_size = compute_level_offsets(VK_FORMAT_R32G32B32A32_SFLOAT, data.width, data.height, data.mip_levels, data.staging_offsets, data.layers);
+
+	std::vector<std::vector<glm::vec4>> levels = prefilter_cube_map(std::move(source), size, data.mip_levels, thread_pool);
+
+	// convert levels into the texture format
+	std::vector<std::byte> pixels(compute_level_offsets(data.format, data.width, data.height, data.mip_levels, data.staging_offsets, data.layers));
+	for (uint32_t i = 0; i < data.mip_levels; i++) {
+		unsigned int level_size = mip_extent(size, i);
+		size_t face_texels = static_cast<size_t>(level_size) * level_size;
+
+		for (size_t face = 0; face < 6; face++) {
+			const glm::vec4* texels = levels[i].data() + face * face_texels;
+
+			switch (data.format)
+			{
+			case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+				compress_hdr_image(data.format, &texels->x, level_size, level_size, pixels.data() + data.staging_offsets[i] + face * get_compressed_size(data.format, level_size, level_size), thread_pool);
+				break;
+			case VK_FORMAT_R16G16B16A16_SFLOAT:
+				for (size_t j = 0; j < face_texels; j++) {
+					uint64_t half = glm::packHalf4x16(texels[j]);
+					std::memcpy(pixels.data() + data.staging_offsets[i] + (face * face_texels + j) * sizeof(uint64_t), &half, sizeof(uint64_t));
+				}
+				break;
+			case VK_FORMAT_R32G32B32A32_SFLOAT:
+				std::memcpy(pixels.data() + data.staging_offsets[i] + face * face_texels * sizeof(glm::vec4), texels, face_texels * sizeof(glm::vec4));
+				break;
+			default:
+				throw NotImplementedException(fmt::format("Cube map format {:x} is not supported", static_cast<int>(data.format)), __FILE__, __LINE__);
+			}
 		}
+	}
 
-		mip_levels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1);
+	try {
+		TextureCache::write(paths, cache_path, data.format, data.width, data.height, data.layers, pixels, data.staging_offsets);
+	}
+	catch (const IOException& e) {
+		spdlog::warn("Failed to write cube map cache: {}", e.what());
 	}
 
-	Texture texture{};
-	texture.init(
-		device,
-		width, height,
-		format,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		sharing_exlusive(), // exclusively owned by graphics queue
-		name,
-		mip_levels
-	);
+	data.staging_buffer = create_staging_buffer(device, pixels.size(), pixels.data(), pixels.size(), "Cube map staging buffer");
 
-	VKW_CommandBuffer command_buffer{};
-	command_buffer.init(
-		device,
-		command_pool,
-		true,
-		"Mipmap creation CMD"
+	return data;
+}
+
+void record_mipmapped_texture_upload(const VKW_CommandBuffer& command_buffer, const Texture& texture, const MipmappedTextureData& data, uint32_t old_ownership, uint32_t new_ownership)
+{
+	// transfer layout 1
+	Texture::transition_layout(
+		command_buffer,
+		texture,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
 	);
 
-	command_buffer.begin_single_use();
-	{
-		// transfer layout 1
-		Texture::transition_layout(
-			command_buffer,
-			texture,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	// all levels at once
+	std::vector<VkBufferImageCopy> image_copies{};
+	for (uint32_t i = 0; i < data.mip_levels; i++) {
+		VkBufferImageCopy& image_copy = image_copies.emplace_back(
+			create_buffer_image_copy(
+				data.staging_offsets[i], // buffer offset
+				i, // mip level
+				0, // array level
+				mip_extent(data.width, i), mip_extent(data.height, i) // width / height
+			)
 		);
+		image_copy.imageSubresource.layerCount = data.layers; // layers are tightly packed after each other
+	}
 
-		if (load_mip_maps) {
-			// copies
-			std::vector<VkBufferImageCopy> image_copies{};
-
-			for (unsigned int i = 0; i < mip_levels; i++) {
-				image_copies.push_back(
-					create_buffer_image_copy(
-						staging_offsets[i], // buffer offsetm
-						i, // mip level
-						0, // array kevek
-						((unsigned int)width) >> i, ((unsigned int)height) >> i // width / height
-					)
-				);
-			}
-
-			vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(image_copies.size()), image_copies.data());
-		}
-		else {
-			// copy staging buffer into mip level 0
-			VkBufferImageCopy image_copy = create_buffer_image_copy(0, 0, 0, (unsigned int) width, (unsigned int) height);
-
-			vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &image_copy);
-			
-			for (unsigned int i = 1; i < mip_levels; i++) {
-				Texture::transition_layout(
-					command_buffer,
-					texture,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-					VK_QUEUE_FAMILY_IGNORED,
-					VK_QUEUE_FAMILY_IGNORED,
-					i-1,
-					1
-				);
-
-				Texture::copy(command_buffer, texture.get_image(), texture.get_image(), { ((unsigned int)width) >> (i - 1), ((unsigned int)height) >> (i - 1) }, { ((unsigned int)width) >> i, ((unsigned int)height) >> i }, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, i);
-			}
+	vkCmdCopyBufferToImage(command_buffer, data.staging_buffer, texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(image_copies.size()), image_copies.data());
 
-			Texture::transition_layout(
-				command_buffer,
-				texture,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_QUEUE_FAMILY_IGNORED,
-				VK_QUEUE_FAMILY_IGNORED,
-				mip_levels - 1,
-				1
-			);
-		}
+	// transfer layout 2
+	Texture::transition_layout(
+		command_buffer,
+		texture,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		old_ownership,
+		new_ownership
+	);
+}
 
-		// transfer layout 2
-		Texture::transition_layout(
-			command_buffer,
-			texture,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-		);
+Texture create_mipmapped_texture_from_path(const VKW_Device* device, UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name, ThreadPool* thread_pool)
+{
+	MipmappedTextureData data = load_mipmapped_texture_data(device, path, type, thread_pool);
+	if (is_block_compressed(data.format)) {
+		spdlog::info("Texture {} is block compressed: {:.2f} MiB ({:.2f} MiB uncompressed)", name, data.staging_buffer.size() / (1024.0 * 1024.0), data.uncompressed_size / (1024.0 * 1024.0));
 	}
 
-	command_buffer.submit_single_use();
+	Texture texture{};
+	texture.init(
+		device,
+		data.width, data.height,
+		data.format,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		sharing_exlusive(), // exclusively owned by graphics queue
+		name,
+		data.mip_levels
+	);
 
-	staging_buffer.del();
+	uploader.upload(texture, std::move(data));
 
 	return texture;
-}
+}
\ No newline at end of file
@@ -18,8 +18,10 @@ enum Texture_Type
 	Tex_R_Linear,   // create R only texture without sRGB to linear conversion of Tex_R
 	Tex_RGB, // create RGB texture
 	Tex_RGB_Linear, // create RGB texture without sRGB to linear conversion
+	Tex_Normal, // create normal map texture, shaders only read RG and reconstruct z (to allow two channel compression)
 	Tex_RGBA, // create RGBA texture
 	Tex_HDR_RGBA, // create RGBA with high dynamic range texture
+	Tex_HDR_RGB, // create RGB texture with high dynamic range at half precision (alpha is unused, allows BC6H compression)
 
 	Tex_Colortarget, // creates target used for rendering 
 	Tex_D,   // create depth texture
@@ -45,10 +47,11 @@ private:
 	VkImage image;
 	VkDeviceMemory memory;
 
-	mutable std::map<std::tuple<VkImageAspectFlags, VkImageViewType, int>, VkImageView> image_views;
+	mutable std::map<std::tuple<VkImageAspectFlags, VkImageViewType, int, uint32_t>, VkImageView> image_views;
 
 	unsigned int width, height;
 	uint32_t m_mip_levels;
+	VkSampleCountFlagBits m_samples = VK_SAMPLE_COUNT_1_BIT;
 	VkFormat format = VK_FORMAT_UNDEFINED;
 
 #ifdef TRACY_ENABLE
@@ -57,6 +60,7 @@ private:
 #endif
 
 	inline static std::vector<VkFormat> potential_formats(Texture_Type type);
+	inline static std::vector<VkFormat> potential_compressed_formats(Texture_Type type);
 	inline static VkFormatFeatureFlags required_format_features(Texture_Type type);
 public:
 	// transitions the layout. Can also be used to change ownership to a new queue
@@ -76,16 +80,23 @@ public:
 	static void copy(const VKW_CommandBuffer& command_buffer, VkImage src_texture, VkImage dst_texture, VkExtent2D src_size, VkExtent2D dst_size, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, uint32_t src_mip_level=0, uint32_t dst_mip_level=0);
 
 	inline static VkFormat find_format(const VKW_Device& device, Texture_Type type);
+	// block compressed format for type, VK_FORMAT_UNDEFINED if there is none or if the device does not support it
+	// compressed data has to be created with compress_image (see create_mipmapped_texture_from_path)
+	inline static VkFormat find_compressed_format(const VKW_Device& device, Texture_Type type);
 	inline static int get_stbi_channels(VkFormat format);
 
 	// gets image view of aspect with specific type (assumes one view per aspect flag, image view type combiniation)
 	VkImageView get_image_view(VkImageAspectFlags aspect_flag, VkImageViewType type = VK_IMAGE_VIEW_TYPE_2D, uint32_t base_layer = 0, uint32_t array_layers = 1) const;
+	// view of a single mip level, i.e. to write it as a storage image
+	VkImageView get_mip_image_view(VkImageAspectFlags aspect_flag, uint32_t mip_level) const;
 
 	inline VkImage get_image() const { return image; };
 	inline operator VkImage() const { return image; };
 	inline VkFormat get_format() const { return format; };
 	inline unsigned int get_width() const { return width; };
 	inline unsigned int get_height() const { return height; };
+	inline uint32_t get_mip_levels() const { return m_mip_levels; };
+	inline VkSampleCountFlagBits get_samples() const { return m_samples; };
 	inline VkExtent2D get_extent() const { return { width,height }; };
 
 	// call to create layout for texture reads on cpu (via compute shader)
@@ -94,23 +105,53 @@ public:
 	// samples from texture using single use compute shader (call create_cpu_sample_descriptor_set_layout before)
 	// TODO: Currently do not use during rendering
 	// TODO: reuse the buffers across frames
-	void cpu_texture_samples(const VKW_CommandPool& graphics_pool, VKW_DescriptorPool& descriptor_pool, const class VKW_DescriptorSetLayout& descriptor_layout, const class VKW_Sampler& sampler, const std::vector<glm::vec2>& samples, std::vector<glm::vec4>& results) const;
+	void cpu_texture_samples(const VKW_CommandPool& graphics_pool, const class VKW_PipelineCache& pipeline_cache, VKW_DescriptorPool& descriptor_pool, const class VKW_DescriptorSetLayout& descriptor_layout, const class VKW_Sampler& sampler, const std::vector<glm::vec2>& samples, std::vector<glm::vec4>& results) const;
 };
 
 
-// creates a texture from a path, needs graphics command pool as input argument as we are waiting on a stage not present supported in transfer queues (in transition_layout)
+// creates a texture from a path, the upload is recorded into the uploader (see UploadBatcher)
+// the texture can be used once the uploader was flushed (by commands on the graphics queue) or waited on (by anything else)
 // Low-dynamic range images are created with the nr channels dictated by the type (1,3,4)
 // High dynamic range images are always 4 channels
-Texture create_texture_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name);
+Texture create_texture_from_path(const VKW_Device* device, class UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name);
 
 // create a cube map from a path containing a %. % sign will be replaced with (+|-) (X|Y|Z) to get the 6 faces
+// faces are decoded in parallel if a thread pool is given. The cube map has a mip chain prefiltered for specular image based lighting
+// (see prefilter_cube_map), which is generated on the first run and cached next to the faces
 // Currently only supports hdr images (exr files)
-Texture create_cube_map_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name);
+Texture create_cube_map_from_path(const VKW_Device* device, class UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name, class ThreadPool* thread_pool = nullptr);
 
 // creates a mipmapped texture
-// first time will be more expensive but results will be stored at path_* (with star being level from 0 to N)
-// if path_0 exists we assume all exists, if it doesn't we assume non exist
-Texture create_mipmapped_texture_from_path(const VKW_Device* device, const VKW_CommandPool* command_pool, const VKW_Path& path, Texture_Type type, const std::string& name);
+// first time will be more expensive, as the mip levels are generated (and block compressed if supported, see find_compressed_format) on the cpu.
+// They are stored in a TextureCache next to path and loaded from it on later runs. EXR files need Tex_HDR_RGBA
+// compression is spread over the thread pool if one is given
+Texture create_mipmapped_texture_from_path(const VKW_Device* device, class UploadBatcher& uploader, const VKW_Path& path, Texture_Type type, const std::string& name, class ThreadPool* thread_pool = nullptr);
+
+// decoded mip levels of a mipmapped texture, see create_mipmapped_texture_from_path
+struct MipmappedTextureData {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	unsigned int width = 0, height = 0;
+	uint32_t mip_levels = 1;
+
+	VKW_Buffer staging_buffer; // all mip levels in upload layout
+	std::vector<VkDeviceSize> staging_offsets; // offset of each level into the staging buffer
+	VkDeviceSize uncompressed_size = 0; // size of all levels in the decoded format (before block compression / conversion), for statistics
+	uint32_t layers = 1; // all layers of a level are stored after each other
+};
+
+// first half of create_mipmapped_texture_from_path: loads the mip chain from its cache (or decodes the image and generates it) into a staging buffer
+// does not record or submit any commands, so it can be run on worker threads
+MipmappedTextureData load_mipmapped_texture_data(const VKW_Device* device, const VKW_Path& path, Texture_Type type, class ThreadPool* thread_pool = nullptr);
+
+// first half of create_cube_map_from_path, same as load_mipmapped_texture_data but with 6 layers
+MipmappedTextureData load_cube_map_data(const VKW_Device* device, const VKW_Path& path, Texture_Type type, class ThreadPool* thread_pool = nullptr);
+
+// second half of create_mipmapped_texture_from_path: records the copy of all levels into an active command buffer
+// texture has to be created with data's format, size and mip levels and is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL afterwards
+// staging buffer has to stay alive until execution finished
+// if the command buffer belongs to a dedicated transfer queue, pass its family and the graphics family as ownerships, the last layout transition
+// then releases the texture and has to be repeated on the graphics queue to acquire it (see Texture::transition_layout)
+void record_mipmapped_texture_upload(const VKW_CommandBuffer& command_buffer, const Texture& texture, const MipmappedTextureData& data, uint32_t old_ownership = VK_QUEUE_FAMILY_IGNORED, uint32_t new_ownership = VK_QUEUE_FAMILY_IGNORED);
 
 inline VkFormat Texture::find_format(const VKW_Device& device, Texture_Type type)
 {
@@ -130,6 +171,24 @@ inline VkFormat Texture::find_format(const VKW_Device& device, Texture_Type type
 	throw RuntimeException(fmt::format("No format found for type {}", (unsigned int) type), __FILE__, __LINE__);
 }
 
+inline VkFormat Texture::find_compressed_format(const VKW_Device& device, Texture_Type type)
+{
+	VkFormatFeatureFlags format_features = required_format_features(type) | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	std::vector<VkFormat> candidates = potential_compressed_formats(type);
+
+	VkPhysicalDevice p_device = device.get_physical_device();
+
+	for (VkFormat format : candidates) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(p_device, format, &props);
+
+		if ((props.optimalTilingFeatures & format_features) == format_features) {
+			return format;
+		}
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
 inline int Texture::get_stbi_channels(VkFormat format)
 {
 	switch (format)
@@ -153,7 +212,7 @@ inline int Texture::get_stbi_channels(VkFormat format)
 
 inline std::vector<VkFormat> Texture::potential_formats(Texture_Type type)
 {
-	// TODO: switch to compressed textures
+	// block compressed formats for sampled textures, see potential_compressed_formats
 	// see: https://registry.khronos.org/vulkan/specs/1.1/html/vkspec.html#_identification_of_formats
 	switch (type)
 	{
@@ -168,11 +227,14 @@ inline std::vector<VkFormat> Texture::potential_formats(Texture_Type type)
 	case Tex_RGB:
 		return { VK_FORMAT_R8G8B8_SRGB, VK_FORMAT_R8G8B8A8_SRGB };
 	case Tex_RGB_Linear:
+	case Tex_Normal:
 		return { VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM };
 	case Tex_RGBA:
 		return { VK_FORMAT_R8G8B8A8_SRGB };
 	case Tex_HDR_RGBA:
 		return { VK_FORMAT_R32G32B32A32_SFLOAT };
+	case Tex_HDR_RGB:
+		return { VK_FORMAT_R16G16B16A16_SFLOAT }; // 3 channel half float formats are rarely supported
 	case Tex_Colortarget:
 		return { VK_FORMAT_R16G16B16A16_SFLOAT };
 	case Tex_Float:
@@ -182,6 +244,27 @@ inline std::vector<VkFormat> Texture::potential_formats(Texture_Type type)
 	}
 }
 
+inline std::vector<VkFormat> Texture::potential_compressed_formats(Texture_Type type)
+{
+	switch (type)
+	{
+	case Tex_R:
+		return { VK_FORMAT_BC4_UNORM_BLOCK }; // no sRGB variant, values are converted to linear before compression
+	case Tex_RGB:
+		return { VK_FORMAT_BC1_RGB_SRGB_BLOCK };
+	case Tex_RGB_Linear:
+		return { VK_FORMAT_BC1_RGB_UNORM_BLOCK };
+	case Tex_Normal:
+		return { VK_FORMAT_BC5_UNORM_BLOCK };
+	case Tex_RGBA:
+		return { VK_FORMAT_BC7_SRGB_BLOCK };
+	case Tex_HDR_RGB:
+		return { VK_FORMAT_BC6H_UFLOAT_BLOCK };
+	default:
+		return {};
+	}
+}
+
 inline VkFormatFeatureFlags Texture::required_format_features(Texture_Type type) {
 	switch (type)
 	{
@@ -192,9 +275,12 @@ inline VkFormatFeatureFlags Texture::required_format_features(Texture_Type type)
 	case Tex_R_Linear:
 	case Tex_RGB:
 	case Tex_RGB_Linear:
+	case Tex_Normal:
 	case Tex_RGBA:
 	case Tex_HDR_RGBA:
 		return VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+	case Tex_HDR_RGB:
+		return VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 	case Tex_Float:
 	case Tex_Colortarget:
 		return
@@ -0,0 +1,134 @@
+#include "common.h"
+#include "TextureCache.h"
+#include "CacheFile.h"
+
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+constexpr char TEXTURE_CACHE_MAGIC[4] = { 'W', 'T', 'E', 'X' };
+
+bool TextureCache::open(const VKW_Path& source_path, VkFormat format)
+{
+	return open({ &source_path, 1 }, get_cache_path(source_path), format);
+}
+
+bool TextureCache::open(std::span<const VKW_Path> source_paths, const VKW_Path& cache_path, VkFormat format)
+{
+	ZoneScoped;
+	close();
+
+	if (!m_file.open(cache_path)) {
+		return false;
+	}
+
+	if (m_file.size() < sizeof(Header)) {
+		close();
+		return false;
+	}
+
+	m_header = reinterpret_cast<const Header*>(m_file.data());
+
+	if (std::memcmp(m_header->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) != 0 ||
+		m_header->version != TEXTURE_CACHE_VERSION ||
+		m_header->layers == 0 ||
+		m_header->level_offset + m_header->mip_levels * sizeof(uint64_t) > m_file.size() ||
+		m_header->data_offset + m_header->data_size > m_file.size()
+	) {
+		spdlog::info("Texture cache {} has an incompatible format", cache_path);
+		close();
+		return false;
+	}
+
+	// i.e. texture is now requested as linear instead of sRGB
+	if (m_header->format != format) {
+		close();
+		return false;
+	}
+
+	m_level_offsets = { reinterpret_cast<const uint64_t*>(m_file.data() + m_header->level_offset), m_header->mip_levels };
+
+	if (!is_valid(source_paths)) {
+		spdlog::info("Texture cache {} is outdated", cache_path);
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void TextureCache::close()
+{
+	m_file.close();
+	m_header = nullptr;
+	m_level_offsets = {};
+}
+
+bool TextureCache::is_valid(std::span<const VKW_Path> source_paths) const
+{
+	if (!are_cache_sources_unchanged(source_paths, { m_header->source_size, m_header->source_write_time, m_header->source_hash })) {
+		return false;
+	}
+
+	for (uint64_t offset : m_level_offsets) {
+		if (offset >= m_header->data_size) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TextureCache::write(const VKW_Path& source_path, VkFormat format, unsigned int width, unsigned int height, std::span<const std::byte> data, std::span<const VkDeviceSize> level_offsets)
+{
+	write({ &source_path, 1 }, get_cache_path(source_path), format, width, height, 1, data, level_offsets);
+}
+
+void TextureCache::write(std::span<const VKW_Path> source_paths, const VKW_Path& cache_path, VkFormat format, unsigned int width, unsigned int height, uint32_t layers, std::span<const std::byte> data, std::span<const VkDeviceSize> level_offsets)
+{
+	ZoneScoped;
+
+	Header header{};
+	std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+	header.version = TEXTURE_CACHE_VERSION;
+	header.format = format;
+	header.width = width;
+	header.height = height;
+	header.mip_levels = static_cast<uint32_t>(level_offsets.size());
+	header.layers = layers;
+
+	CacheSources sources{};
+	if (!read_cache_sources(source_paths, sources)) {
+		throw IOException(fmt::format("Failed to read sources of texture cache {}", cache_path), __FILE__, __LINE__);
+	}
+	header.source_size = sources.size;
+	header.source_write_time = sources.write_time;
+	header.source_hash = sources.hash;
+
+	header.level_offset = align_up(sizeof(Header), 16);
+	header.data_offset = align_up(header.level_offset + sizeof(uint64_t) * level_offsets.size(), 16);
+	header.data_size = data.size();
+
+	// assemble file in memory and write it at once
+	std::vector<char> file_data(header.data_offset + header.data_size);
+	std::memcpy(file_data.data(), &header, sizeof(Header));
+	for (size_t i = 0; i < level_offsets.size(); i++) {
+		uint64_t offset = level_offsets[i];
+		std::memcpy(file_data.data() + header.level_offset + i * sizeof(uint64_t), &offset, sizeof(uint64_t));
+	}
+	std::memcpy(file_data.data() + header.data_offset, data.data(), data.size());
+
+	// textures shared by several materials might be written by multiple workers at once (see write_cache_file)
+	write_cache_file(cache_path, file_data);
+}
+
+VKW_Path TextureCache::get_cache_path(const VKW_Path& source_path)
+{
+	return VKW_Path(source_path).concat(".mips");
+}
+
+std::span<const std::byte> TextureCache::get_data() const
+{
+	assert(m_header && "Tried to read from texture cache that is not open");
+	return { m_file.data() + m_header->data_offset, m_header->data_size };
+}
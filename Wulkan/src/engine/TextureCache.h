@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <span>
+
+// increase if the layout of the cache or the mip level generation changes, old caches will be rebuilt
+constexpr uint32_t TEXTURE_CACHE_VERSION = 2;
+
+// Binary mip chain of a texture stored next to its source image (at source_path + ".mips"), similar to KTX2
+// All levels are stored in upload layout (tightly packed texels or 4x4 blocks, level 0 first, all array layers of a level after each other),
+// such that the mapped level data can be copied into one staging buffer and uploaded with a single vkCmdCopyBufferToImage
+// The cache stores size, write time and hash of the source image(s) and is rejected if they changed
+class TextureCache
+{
+public:
+	TextureCache() = default;
+
+	// maps the cache of source_path, returns false if there is none, if it is outdated or if it was created for another format
+	bool open(const VKW_Path& source_path, VkFormat format);
+	// same for a texture built from several source images (i.e. the faces of a cube map), which is cached at cache_path
+	bool open(std::span<const VKW_Path> source_paths, const VKW_Path& cache_path, VkFormat format);
+	void close();
+
+	// writes the cache of source_path, level_offsets are the offsets of each mip level into data
+	static void write(const VKW_Path& source_path, VkFormat format, unsigned int width, unsigned int height, std::span<const std::byte> data, std::span<const VkDeviceSize> level_offsets);
+	static void write(std::span<const VKW_Path> source_paths, const VKW_Path& cache_path, VkFormat format, unsigned int width, unsigned int height, uint32_t layers, std::span<const std::byte> data, std::span<const VkDeviceSize> level_offsets);
+	static VKW_Path get_cache_path(const VKW_Path& source_path);
+private:
+	// file layout: Header | level offsets (uint64_t[]) | level data
+	// level offsets are relative to the level data, which is aligned to 16 bytes (the levels are aligned by the writer)
+	struct Header {
+		char magic[4];
+		uint32_t version;
+
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mip_levels;
+		uint32_t layers;
+
+		// combined over all source images
+		uint64_t source_size;
+		int64_t source_write_time;
+		uint64_t source_hash;
+
+		uint64_t level_offset;
+		uint64_t data_offset;
+		uint64_t data_size;
+	};
+
+	MappedFile m_file;
+
+	const Header* m_header = nullptr;
+	std::span<const uint64_t> m_level_offsets;
+
+	bool is_valid(std::span<const VKW_Path> source_paths) const;
+public:
+	inline VkFormat get_format() const { return m_header->format; };
+	inline unsigned int get_width() const { return m_header->width; };
+	inline unsigned int get_height() const { return m_header->height; };
+	inline uint32_t get_mip_levels() const { return m_header->mip_levels; };
+	inline uint32_t get_layers() const { return m_header->layers; };
+
+	// data of all levels, starting with level 0
+	std::span<const std::byte> get_data() const;
+	inline std::span<const uint64_t> get_level_offsets() const { return m_level_offsets; };
+};
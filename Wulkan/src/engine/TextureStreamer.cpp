@@ -0,0 +1,222 @@
+#include "common.h"
+#include "TextureStreamer.h"
+
+#include "spdlog/spdlog.h"
+
+void TextureStreamer::init(const VKW_Device* vkw_device, const VKW_Queue* transfer_queue, const VKW_Queue* graphics_queue, ThreadPool* thread_pool, const std::string& obj_name)
+{
+	device = vkw_device;
+	m_thread_pool = thread_pool;
+	m_name = obj_name;
+
+	m_uploader.init(device, transfer_queue, graphics_queue, 0, m_name);
+}
+
+void TextureStreamer::del()
+{
+	// uploads might still be executing
+	m_uploader.wait_all();
+
+	for (Entry& entry : m_entries) {
+		// workers might still write into the staging buffer
+		if (entry.decoding.valid()) {
+			try {
+				entry.data = entry.decoding.get();
+			}
+			catch (const std::exception&) {
+				// nothing to clean up
+			}
+		}
+
+		entry.data.staging_buffer.del();
+		if (entry.state == State::Uploading || entry.state == State::Resident) {
+			entry.texture.del();
+		}
+	}
+	m_entries.clear();
+	m_decoding.clear();
+	m_uploading.clear();
+	m_unbound.clear();
+
+	m_uploader.del();
+}
+
+uint32_t TextureStreamer::request(const VKW_Path& path, Texture_Type type, const std::string& texture_name)
+{
+	uint32_t handle = static_cast<uint32_t>(m_entries.size());
+
+	Entry& entry = m_entries.emplace_back();
+	entry.name = texture_name;
+
+	// the decoding job compresses its rows of blocks on the pool as well
+	const VKW_Device* d = device;
+	ThreadPool* pool = m_thread_pool;
+	entry.decoding = m_thread_pool->submit([d, path, type, pool]() {
+		return load_mipmapped_texture_data(d, path, type, pool);
+	});
+
+	m_decoding.push_back(handle);
+
+	return handle;
+}
+
+void TextureStreamer::bind_when_resident(uint32_t handle, const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& sets, uint32_t binding, const VKW_Sampler& sampler, uint32_t array_element)
+{
+	Entry& entry = m_entries.at(handle);
+	if (entry.state == State::Failed) {
+		return;
+	}
+
+	entry.bindings.push_back({ sets, binding, sampler, array_element });
+
+	// bindings are written in update, as the sets of the other frames might still be in use
+	if (entry.state == State::Resident && std::find(m_unbound.begin(), m_unbound.end(), handle) == m_unbound.end()) {
+		m_unbound.push_back(handle);
+	}
+}
+
+void TextureStreamer::update(uint32_t current_frame)
+{
+	ZoneScoped;
+
+	retire_batches();
+	write_bindings(current_frame);
+	submit_batch();
+}
+
+void TextureStreamer::retire_batches()
+{
+	bool retired = false;
+	for (uint32_t handle : m_uploading) {
+		Entry& entry = m_entries[handle];
+		if (!m_uploader.is_done(entry.ticket)) {
+			continue;
+		}
+
+		entry.data.staging_offsets.clear();
+		entry.state = State::Resident;
+
+		if (!entry.bindings.empty()) {
+			m_unbound.push_back(handle);
+		}
+		retired = true;
+	}
+	std::erase_if(m_uploading, [this](uint32_t handle) { return m_entries[handle].state == State::Resident; });
+
+	// frees the staging buffers of finished batches
+	m_uploader.retire_finished();
+
+	// all requested textures are in
+	if (retired && m_decoding.empty() && m_uploading.empty()) {
+		spdlog::info("{}: {} textures resident, {:.2f} MiB ({:.2f} MiB uncompressed)", m_name, m_entries.size(),
+			m_resident_size / (1024.0 * 1024.0), m_resident_uncompressed_size / (1024.0 * 1024.0));
+	}
+}
+
+void TextureStreamer::write_bindings(uint32_t current_frame)
+{
+	std::vector<VkDescriptorImageInfo> image_infos{};
+	std::vector<VkWriteDescriptorSet> writes{};
+
+	// reserve, as the writes point into image_infos
+	size_t write_count = 0;
+	for (uint32_t handle : m_unbound) {
+		write_count += m_entries[handle].bindings.size();
+	}
+	image_infos.reserve(write_count);
+	writes.reserve(write_count);
+
+	for (uint32_t handle : m_unbound) {
+		Entry& entry = m_entries[handle];
+
+		for (Binding& binding : entry.bindings) {
+			if (binding.written[current_frame]) {
+				continue;
+			}
+
+			VkDescriptorImageInfo& image_info = image_infos.emplace_back();
+			image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			image_info.imageView = entry.texture.get_image_view(VK_IMAGE_ASPECT_COLOR_BIT);
+			image_info.sampler = binding.sampler;
+
+			VkWriteDescriptorSet& write = writes.emplace_back();
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = binding.sets[current_frame];
+			write.dstBinding = binding.binding;
+			write.dstArrayElement = binding.array_element;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.pImageInfo = &image_info;
+
+			binding.written[current_frame] = true;
+		}
+
+		// drop bindings which are written for all frames
+		std::erase_if(entry.bindings, [](const Binding& binding) {
+			return std::all_of(binding.written.begin(), binding.written.end(), [](bool written) { return written; });
+		});
+	}
+
+	std::erase_if(m_unbound, [this](uint32_t handle) { return m_entries[handle].bindings.empty(); });
+
+	if (!writes.empty()) {
+		vkUpdateDescriptorSets(*device, static_cast<uint32_t>(writes.size()), writes.data(), 0, VK_NULL_HANDLE);
+	}
+}
+
+void TextureStreamer::submit_batch()
+{
+	// the previous batch of the uploader still executing
+	if (m_decoding.empty() || !m_uploader.is_ready()) {
+		return;
+	}
+
+	ZoneScopedN("Record texture uploads");
+
+	// collect decoded textures, without waiting for the workers
+	VkDeviceSize batch_size = 0;
+	for (uint32_t handle : m_decoding) {
+		if (batch_size >= MAX_BATCH_SIZE) {
+			break;
+		}
+
+		Entry& entry = m_entries[handle];
+		if (entry.decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			continue;
+		}
+
+		try {
+			entry.data = entry.decoding.get();
+		}
+		catch (const std::exception& e) {
+			spdlog::error("Failed to stream in {}, keeping fallback: {}", entry.name, e.what());
+			entry.state = State::Failed;
+			entry.bindings.clear();
+			continue;
+		}
+
+		entry.texture.init(
+			device,
+			entry.data.width, entry.data.height,
+			entry.data.format,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			sharing_exlusive(), // exclusively owned by graphics queue after the upload
+			entry.name,
+			entry.data.mip_levels
+		);
+		entry.state = State::Uploading;
+
+		batch_size += entry.data.staging_buffer.size();
+		m_resident_size += entry.data.staging_buffer.size();
+		m_resident_uncompressed_size += entry.data.uncompressed_size;
+
+		entry.ticket = m_uploader.upload(entry.texture, std::move(entry.data));
+		m_uploading.push_back(handle);
+	}
+
+	std::erase_if(m_decoding, [this](uint32_t handle) { return m_entries[handle].state != State::Decoding; });
+
+	if (batch_size > 0) {
+		m_uploader.flush();
+	}
+}
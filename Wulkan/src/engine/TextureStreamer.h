@@ -0,0 +1,99 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_Queue.h"
+#include "vk_wrap/VKW_Sampler.h"
+
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "UploadBatcher.h"
+
+#include <deque>
+#include <future>
+
+// Streams mipmapped textures in without blocking the render loop
+// Images are decoded into staging buffers on the thread pool, while already decoded ones are uploaded in batches (see UploadBatcher).
+// Batches are copied on the transfer queue, once their ticket is done the textures are resident and get swapped into the registered descriptors.
+// Not thread safe: request / bind_when_resident during init or on the render thread, update on the render thread
+class TextureStreamer : public VKW_Object
+{
+public:
+	TextureStreamer() = default;
+	void init(const VKW_Device* vkw_device, const VKW_Queue* transfer_queue, const VKW_Queue* graphics_queue, ThreadPool* thread_pool, const std::string& obj_name);
+	void del() override;
+
+	// starts decoding the texture (see create_mipmapped_texture_from_path), returns a handle to it
+	uint32_t request(const VKW_Path& path, Texture_Type type, const std::string& texture_name);
+
+	// writes the texture into binding (at array_element) of the given sets (one per frame in flight) once it is resident
+	// until then the caller has to bind a fallback
+	void bind_when_resident(uint32_t handle, const std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT>& sets, uint32_t binding, const VKW_Sampler& sampler, uint32_t array_element = 0);
+
+	// call once per frame after the render fence of current_frame was waited on
+	// retires finished uploads, updates the descriptor sets of current_frame and submits the next batch of decoded textures
+	void update(uint32_t current_frame);
+private:
+	enum class State {
+		Decoding,
+		Uploading,
+		Resident,
+		Failed
+	};
+
+	struct Binding {
+		std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> sets;
+		uint32_t binding;
+		VkSampler sampler;
+		uint32_t array_element;
+		std::array<bool, MAX_FRAMES_IN_FLIGHT> written{};
+	};
+
+	struct Entry {
+		std::string name;
+		State state = State::Decoding;
+		std::future<MipmappedTextureData> decoding;
+		MipmappedTextureData data; // staging buffer is handed to the uploader
+		Texture texture;
+		UploadTicket ticket = 0;
+		std::vector<Binding> bindings; // not yet written bindings
+	};
+
+	// limits the staging memory recorded into one batch (a single larger texture is still uploaded)
+	static constexpr VkDeviceSize MAX_BATCH_SIZE = 64 * 1024 * 1024;
+
+	const VKW_Device* device = nullptr;
+	ThreadPool* m_thread_pool = nullptr;
+	std::string m_name;
+
+	std::deque<Entry> m_entries; // indexed by handle, deque keeps textures at stable addresses
+	std::vector<uint32_t> m_decoding; // handles of entries still being decoded (in request order)
+	std::vector<uint32_t> m_uploading; // handles of entries submitted to the uploader
+	std::vector<uint32_t> m_unbound; // handles of resident entries with bindings left to write
+
+	// textures bring their own staging buffers, so it does not need an arena
+	UploadBatcher m_uploader;
+
+	// texture memory of all uploaded textures, compared to their size without block compression
+	VkDeviceSize m_resident_size = 0;
+	VkDeviceSize m_resident_uncompressed_size = 0;
+
+	void retire_batches();
+	void write_bindings(uint32_t current_frame);
+	void submit_batch();
+public:
+	// nullptr while the texture is not resident
+	inline Texture* get_texture(uint32_t handle);
+	inline bool is_resident(uint32_t handle) const { return m_entries.at(handle).state == State::Resident; };
+};
+
+inline Texture* TextureStreamer::get_texture(uint32_t handle)
+{
+	Entry& entry = m_entries.at(handle);
+	if (entry.state == State::Resident) {
+		return &entry.texture;
+	}
+	else {
+		return nullptr;
+	}
+}
@@ -0,0 +1,152 @@
+#include "common.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+
+static thread_local uint32_t t_thread_idx = 0;
+
+void ThreadPool::init(uint32_t nr_threads, const std::string& name)
+{
+	m_name = name;
+	m_stop = false;
+
+	m_workers.reserve(nr_threads);
+	for (uint32_t i = 0; i < nr_threads; i++) {
+		m_workers.emplace_back(&ThreadPool::worker_func, this, i);
+	}
+}
+
+void ThreadPool::del()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+	m_workers.clear();
+}
+
+void ThreadPool::worker_func(uint32_t idx)
+{
+	const std::string thread_name = fmt::format("{} {}", m_name, idx);
+	tracy::SetThreadName(thread_name.c_str());
+	t_thread_idx = idx + 1;
+
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+
+			// finish queued jobs before stopping
+			if (m_jobs.empty()) {
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
+
+uint32_t ThreadPool::get_thread_idx()
+{
+	return t_thread_idx;
+}
+
+void ThreadPool::push_job(std::function<void()>&& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_condition.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0) {
+		return;
+	}
+
+	// the calling thread also works, such that nested calls from within jobs can't dead lock
+	size_t nr_helpers = std::min<size_t>(m_workers.size(), count - 1);
+
+	ParallelForState* state = acquire_parallel_for_state();
+	state->next = 0;
+	state->finished = 0;
+	state->count = count;
+	state->func = &func;
+	state->users = static_cast<uint32_t>(nr_helpers + 1);
+	state->exception = nullptr;
+
+	for (size_t i = 0; i < nr_helpers; i++) {
+		push_job([this, state]() {
+			work_on(*state);
+			release_parallel_for_state(state);
+		});
+	}
+
+	work_on(*state);
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->done.wait(lock, [state]() { return state->finished.load() == state->count; });
+		exception = state->exception;
+	}
+	release_parallel_for_state(state);
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void ThreadPool::work_on(ParallelForState& state)
+{
+	size_t i;
+	while ((i = state.next.fetch_add(1)) < state.count) {
+		try {
+			(*state.func)(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(state.mutex);
+			if (!state.exception) {
+				state.exception = std::current_exception();
+			}
+		}
+
+		if (state.finished.fetch_add(1) + 1 == state.count) {
+			std::lock_guard<std::mutex> lock(state.mutex);
+			state.done.notify_all();
+		}
+	}
+}
+
+ThreadPool::ParallelForState* ThreadPool::acquire_parallel_for_state()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_free_parallel_for_states.empty()) {
+		return m_parallel_for_states.emplace_back(std::make_unique<ParallelForState>()).get();
+	}
+
+	ParallelForState* state = m_free_parallel_for_states.back();
+	m_free_parallel_for_states.pop_back();
+	return state;
+}
+
+void ThreadPool::release_parallel_for_state(ParallelForState* state)
+{
+	if (state->users.fetch_sub(1) == 1) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_free_parallel_for_states.push_back(state);
+	}
+}
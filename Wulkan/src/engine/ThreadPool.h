@@ -0,0 +1,85 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <future>
+
+// Fixed set of worker threads executing jobs in submission order
+// Used for cpu heavy loading tasks (parsing, compression, pipeline compilation, ...)
+class ThreadPool : public VKW_Object
+{
+public:
+	ThreadPool() = default;
+	void init(uint32_t nr_threads, const std::string& name);
+	void del() override;
+
+	// queues a job, returned future rethrows exceptions of the job
+	template <typename F>
+	auto submit(F&& func) -> std::future<std::invoke_result_t<F>>;
+
+	// calls func(i) for all i in [0, count) on the workers and the calling thread, blocks until all are done
+	// rethrows the first exception thrown by func. Can also be called from within a job
+	// does not allocate once enough calls were made, so it can be used every frame
+	void parallel_for(size_t count, const std::function<void(size_t)>& func);
+
+	// index of the calling thread, i + 1 on worker i and 0 on any thread not owned by a pool
+	// a worker only runs one job at a time, so it can be used to index per thread resources
+	static uint32_t get_thread_idx();
+private:
+	std::string m_name;
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::function<void()>> m_jobs;
+	bool m_stop = false;
+
+	// shared with the helper jobs of a parallel_for, which might only start after the call returned
+	struct ParallelForState {
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> finished{ 0 };
+		size_t count = 0;
+		const std::function<void(size_t)>* func = nullptr;
+		std::atomic<uint32_t> users{ 0 }; // the caller and its helpers, the last one releases the state
+
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr exception;
+	};
+	// all states ever used and the ones not in use, both guarded by m_mutex
+	std::vector<std::unique_ptr<ParallelForState>> m_parallel_for_states;
+	std::vector<ParallelForState*> m_free_parallel_for_states;
+
+	void worker_func(uint32_t idx);
+	void push_job(std::function<void()>&& job);
+
+	ParallelForState* acquire_parallel_for_state();
+	void release_parallel_for_state(ParallelForState* state);
+	static void work_on(ParallelForState& state);
+public:
+	inline uint32_t size() const { return static_cast<uint32_t>(m_workers.size()); };
+};
+
+template<typename F>
+inline auto ThreadPool::submit(F&& func) -> std::future<std::invoke_result_t<F>>
+{
+	using R = std::invoke_result_t<F>;
+
+	// std::function requires copyable callables
+	auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+	std::future<R> future = task->get_future();
+
+	if (m_workers.empty()) {
+		(*task)();
+	}
+	else {
+		push_job([task]() { (*task)(); });
+	}
+
+	return future;
+}
@@ -1,19 +1,8 @@
 #include "common.h"
 #include "ToneMapper.h"
 
-void ToneMapper::init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, const std::array<VKW_DescriptorSetLayout, 2>& layouts, VkFormat color_attachment_format)
+void ToneMapper::init_pipeline(const VKW_Device& device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 2>& layouts, VkFormat color_attachment_format)
 {
-	// hard coded view plane
-	const std::vector<Vertex> vertices = {
-		{glm::vec3(0.0,0.0,0.0), 0.0, {}, 0.0, {}},
-		{glm::vec3(0.0,1.0,0.0), 0.0, {}, 1.0, {}},
-		{glm::vec3(1.0,0.0,0.0), 1.0, {}, 0.0, {}},
-		{glm::vec3(1.0,1.0,0.0), 1.0, {}, 1.0, {}}
-	};
-	const std::vector<uint32_t> indices = { 0,1,2,1,3,2 };
-
-	view_plane.init(device, transfer_pool, vertices, indices);
-
 	// push constants
 	VKW_PushConstant<ToneMapperPushConstants> push_constant{};
 	push_constant.init(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -36,13 +25,27 @@ void ToneMapper::init(const VKW_Device& device, const VKW_CommandPool& transfer_
 
 	graphics_pipeline.set_color_attachment_format(color_attachment_format);
 
-	graphics_pipeline.init(&device, "Tone Mapping graphics pipeline");
+	graphics_pipeline.init(&device, "Tone Mapping graphics pipeline", &pipeline_cache);
 
 	vert_shader.del();
 	frag_shader.del();
 
 	// super init
 	RenderPass::init(std::move(graphics_pipeline), layouts, push_constant);
+}
+
+void ToneMapper::init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool)
+{
+	// hard coded view plane
+	const std::vector<Vertex> vertices = {
+		{glm::vec3(0.0,0.0,0.0), 0.0, {}, 0.0, {}},
+		{glm::vec3(0.0,1.0,0.0), 0.0, {}, 1.0, {}},
+		{glm::vec3(1.0,0.0,0.0), 1.0, {}, 0.0, {}},
+		{glm::vec3(1.0,1.0,0.0), 1.0, {}, 1.0, {}}
+	};
+	const std::vector<uint32_t> indices = { 0,1,2,1,3,2 };
+
+	view_plane.init(geometry, vertices, indices);
 
 	material.init(device, descriptor_pool, *this, { descriptor_set_layout }, { 1 }, "Tone Mapper Material");
 }
@@ -23,7 +23,10 @@ class ToneMapper : public RenderPass< ToneMapperPushConstants, TONE_MAPPER_DESC_
 public:
 	ToneMapper() = default;
 
-	void init(const VKW_Device& device, const VKW_CommandPool& transfer_pool, VKW_DescriptorPool& descriptor_pool, const std::array<VKW_DescriptorSetLayout, 2>& layouts, VkFormat color_attachment_format);
+	// creates the graphics pipeline, independent of the rest so it can be compiled together with the other pipelines
+	void init_pipeline(const VKW_Device& device, const VKW_PipelineCache& pipeline_cache, const std::array<VKW_DescriptorSetLayout, 2>& layouts, VkFormat color_attachment_format);
+	// expects init_pipeline to have been called
+	void init(const VKW_Device& device, GeometryPool& geometry, VKW_DescriptorPool& descriptor_pool);
 	void set_descriptor_bindings(const std::array<VkImageView, MAX_FRAMES_IN_FLIGHT>& views, const VKW_Sampler& texture_sampler);
 	void del() override;
 
@@ -0,0 +1,377 @@
+#include "common.h"
+#include "UploadBatcher.h"
+#include "StartupProfiler.h"
+
+#include "spdlog/spdlog.h"
+
+static VkSemaphore create_timeline_semaphore(const VKW_Device& device, const std::string& name)
+{
+	VkSemaphoreTypeCreateInfo timeline_create_info{};
+	timeline_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timeline_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timeline_create_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_create_info.pNext = &timeline_create_info;
+
+	VkSemaphore semaphore;
+	VK_CHECK_ET(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &semaphore), SetupException, fmt::format("Failed to create timeline semaphore ({})", name));
+	device.name_object((uint64_t)semaphore, VK_OBJECT_TYPE_SEMAPHORE, name);
+	return semaphore;
+}
+
+void UploadBatcher::init(const VKW_Device* vkw_device, const VKW_Queue* transfer_queue, const VKW_Queue* graphics_queue, VkDeviceSize arena_size, const std::string& obj_name)
+{
+	device = vkw_device;
+	m_transfer_queue = transfer_queue;
+	m_graphics_queue = graphics_queue;
+	m_dedicated_transfer = m_transfer_queue->get_queue_family() != m_graphics_queue->get_queue_family();
+	m_name = obj_name;
+
+	m_segment_size = (arena_size / BATCH_COUNT) & ~(ARENA_ALIGNMENT - 1);
+	if (m_segment_size > 0) {
+		m_arena.init(
+			device,
+			m_segment_size * BATCH_COUNT,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			sharing_exlusive(),
+			Mapping::Persistent,
+			fmt::format("{} arena", m_name)
+		);
+	}
+
+	m_timeline = create_timeline_semaphore(*device, fmt::format("{} timeline", m_name));
+	if (m_dedicated_transfer) {
+		m_transfer_timeline = create_timeline_semaphore(*device, fmt::format("{} transfer timeline", m_name));
+	}
+
+	for (uint32_t i = 0; i < BATCH_COUNT; i++) {
+		UploadBatch& batch = m_batches[i];
+		batch.arena_begin = i * m_segment_size;
+
+		// one pool per batch, so it can be reset as a whole once the batch is done
+		batch.transfer_pool.init(device, m_transfer_queue, fmt::format("{} transfer pool {}", m_name, i));
+		batch.transfer_command_buffer.init(device, &batch.transfer_pool, false, fmt::format("{} transfer CMD {}", m_name, i));
+
+		if (m_dedicated_transfer) {
+			batch.graphics_pool.init(device, m_graphics_queue, fmt::format("{} acquire pool {}", m_name, i));
+			batch.graphics_command_buffer.init(device, &batch.graphics_pool, false, fmt::format("{} acquire CMD {}", m_name, i));
+		}
+	}
+
+	spdlog::info("{} uploads on {} transfer queue", m_name, m_dedicated_transfer ? "dedicated" : "graphics");
+}
+
+void UploadBatcher::del()
+{
+	// a batch still being recorded is never submitted, its commands are dropped with the pool
+	for (UploadBatch& batch : m_batches) {
+		if (batch.submitted) {
+			retire(batch, true);
+		}
+
+		for (VKW_Buffer& staging_buffer : batch.staging_buffers) {
+			staging_buffer.del();
+		}
+		batch.staging_buffers.clear();
+		batch.buffer_transfers.clear();
+		batch.image_transfers.clear();
+
+		batch.transfer_pool.del();
+		if (m_dedicated_transfer) {
+			batch.graphics_pool.del();
+		}
+		batch.ticket = 0;
+	}
+
+	VK_DESTROY(m_timeline, vkDestroySemaphore, *device, m_timeline);
+	VK_DESTROY(m_transfer_timeline, vkDestroySemaphore, *device, m_transfer_timeline);
+	m_arena.del();
+}
+
+UploadTicket UploadBatcher::upload(const VKW_Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset)
+{
+	if (dst_offset + size > dst.size()) {
+		throw RuntimeException(fmt::format("Tried to upload {} bytes at offset {} that would write outside of bounds of buffer ({})", size, dst_offset, m_name), __FILE__, __LINE__);
+	}
+	if (size == 0) {
+		return 0;
+	}
+
+	UploadBatch* batch = &get_recording_batch();
+
+	VkBufferCopy copy_region{};
+	copy_region.dstOffset = dst_offset;
+	copy_region.size = size;
+
+	VkBuffer src;
+	if (size > m_segment_size) {
+		// would never fit, so gets its own staging buffer
+		VKW_Buffer& staging_buffer = batch->staging_buffers.emplace_back(create_staging_buffer(device, size, data, size, fmt::format("{} staging buffer", m_name)));
+		src = staging_buffer;
+		copy_region.srcOffset = 0;
+	}
+	else {
+		VkDeviceSize offset = (batch->arena_used + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+		if (offset + size > m_segment_size) {
+			// segment is full, continue in the next batch
+			flush();
+			batch = &get_recording_batch();
+			offset = 0;
+		}
+
+		m_arena.copy_into(data, size, batch->arena_begin + offset);
+		batch->arena_used = offset + size;
+
+		src = m_arena;
+		copy_region.srcOffset = batch->arena_begin + offset;
+	}
+
+	vkCmdCopyBuffer(batch->transfer_command_buffer, src, dst, 1, &copy_region);
+
+	if (m_dedicated_transfer) {
+		VkBufferMemoryBarrier2& barrier = batch->buffer_transfers.emplace_back();
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		barrier.srcQueueFamilyIndex = m_transfer_queue->get_queue_family();
+		barrier.dstQueueFamilyIndex = m_graphics_queue->get_queue_family();
+		barrier.buffer = dst;
+		barrier.offset = dst_offset;
+		barrier.size = size;
+	}
+
+	m_upload_count++;
+	m_uploaded_size += size;
+	StartupProfiler::add_upload(size);
+
+	return batch->ticket;
+}
+
+UploadTicket UploadBatcher::upload(const Texture& texture, MipmappedTextureData&& data)
+{
+	UploadBatch& batch = get_recording_batch();
+
+	if (m_dedicated_transfer) {
+		record_mipmapped_texture_upload(batch.transfer_command_buffer, texture, data, m_transfer_queue->get_queue_family(), m_graphics_queue->get_queue_family());
+		batch.image_transfers.push_back(texture);
+	}
+	else {
+		record_mipmapped_texture_upload(batch.transfer_command_buffer, texture, data);
+	}
+
+	batch.staging_buffers.push_back(data.staging_buffer);
+	data.staging_buffer = {};
+
+	m_upload_count++;
+	m_uploaded_size += batch.staging_buffers.back().size();
+	StartupProfiler::add_upload(batch.staging_buffers.back().size());
+
+	return batch.ticket;
+}
+
+void UploadBatcher::flush()
+{
+	UploadBatch& batch = m_batches[m_current];
+	if (batch.ticket == 0 || batch.submitted) {
+		return;
+	}
+
+	ZoneScoped;
+
+	// makes the copies and layout transitions visible to everything submitted to the graphics queue afterwards
+	VkMemoryBarrier2 visibility_barrier{};
+	visibility_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	visibility_barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	visibility_barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+	visibility_barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	visibility_barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+	VkSemaphoreSubmitInfo signal_info{};
+	signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signal_info.semaphore = m_timeline;
+	signal_info.value = batch.ticket;
+	signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	if (m_dedicated_transfer) {
+		// release on the transfer queue, only the first synchronization scope
+		for (VkBufferMemoryBarrier2& barrier : batch.buffer_transfers) {
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		}
+
+		VkDependencyInfo release_info{};
+		release_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		release_info.pBufferMemoryBarriers = batch.buffer_transfers.data();
+		release_info.bufferMemoryBarrierCount = static_cast<uint32_t>(batch.buffer_transfers.size());
+
+		if (!batch.buffer_transfers.empty()) {
+			vkCmdPipelineBarrier2(batch.transfer_command_buffer, &release_info);
+		}
+		batch.transfer_command_buffer.end_debug_zone();
+
+		VkSemaphoreSubmitInfo transfer_info = signal_info;
+		transfer_info.semaphore = m_transfer_timeline;
+		batch.transfer_command_buffer.submit({}, { transfer_info }, VK_NULL_HANDLE);
+
+		// acquire on the graphics queue, only the second synchronization scope
+		batch.graphics_command_buffer.begin();
+		batch.graphics_command_buffer.begin_debug_zone(m_name);
+
+		for (VkBufferMemoryBarrier2& barrier : batch.buffer_transfers) {
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.srcAccessMask = VK_ACCESS_2_NONE;
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		}
+
+		VkDependencyInfo acquire_info = release_info;
+		if (!batch.buffer_transfers.empty()) {
+			vkCmdPipelineBarrier2(batch.graphics_command_buffer, &acquire_info);
+		}
+
+		for (VkImage image : batch.image_transfers) {
+			Texture::transition_layout(
+				batch.graphics_command_buffer,
+				image,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				m_transfer_queue->get_queue_family(),
+				m_graphics_queue->get_queue_family()
+			);
+		}
+
+		VkDependencyInfo visibility_info{};
+		visibility_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		visibility_info.pMemoryBarriers = &visibility_barrier;
+		visibility_info.memoryBarrierCount = 1;
+		vkCmdPipelineBarrier2(batch.graphics_command_buffer, &visibility_info);
+		batch.graphics_command_buffer.end_debug_zone();
+
+		batch.graphics_command_buffer.submit({ transfer_info }, { signal_info }, VK_NULL_HANDLE);
+	}
+	else {
+		VkDependencyInfo visibility_info{};
+		visibility_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		visibility_info.pMemoryBarriers = &visibility_barrier;
+		visibility_info.memoryBarrierCount = 1;
+		vkCmdPipelineBarrier2(batch.transfer_command_buffer, &visibility_info);
+		batch.transfer_command_buffer.end_debug_zone();
+
+		batch.transfer_command_buffer.submit({}, { signal_info }, VK_NULL_HANDLE);
+	}
+
+	batch.submitted = true;
+	m_submit_count++;
+
+	m_next_ticket++;
+	m_current = (m_current + 1) % BATCH_COUNT;
+}
+
+void UploadBatcher::wait(UploadTicket ticket)
+{
+	assert(ticket <= m_next_ticket && "Tried to wait on an upload ticket which was not handed out");
+
+	if (m_batches[m_current].ticket != 0 && m_batches[m_current].ticket <= ticket) {
+		flush();
+	}
+
+	// batches finish in submission order
+	for (UploadBatch& batch : m_batches) {
+		if (batch.submitted && batch.ticket <= ticket) {
+			retire(batch, true);
+		}
+	}
+}
+
+void UploadBatcher::wait_all()
+{
+	wait(m_next_ticket);
+}
+
+bool UploadBatcher::is_done(UploadTicket ticket)
+{
+	return get_completed_value() >= ticket;
+}
+
+bool UploadBatcher::is_ready()
+{
+	UploadBatch& batch = m_batches[m_current];
+	return !batch.submitted || retire(batch, false);
+}
+
+void UploadBatcher::retire_finished()
+{
+	for (UploadBatch& batch : m_batches) {
+		if (batch.submitted) {
+			retire(batch, false);
+		}
+	}
+}
+
+UploadBatcher::UploadBatch& UploadBatcher::get_recording_batch()
+{
+	UploadBatch& batch = m_batches[m_current];
+	if (batch.ticket != 0 && !batch.submitted) {
+		return batch;
+	}
+
+	// batch of the previous round might still be executing
+	if (batch.submitted) {
+		retire(batch, true);
+	}
+
+	batch.ticket = m_next_ticket;
+	batch.arena_used = 0;
+
+	batch.transfer_command_buffer.begin();
+	batch.transfer_command_buffer.begin_debug_zone(m_name);
+
+	return batch;
+}
+
+bool UploadBatcher::retire(UploadBatch& batch, bool block)
+{
+	uint64_t done_value = batch.ticket;
+	if (get_completed_value() < done_value) {
+		if (!block) {
+			return false;
+		}
+
+		ZoneScopedN("Wait for uploads");
+
+		VkSemaphoreWaitInfo wait_info{};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.pSemaphores = &m_timeline;
+		wait_info.pValues = &done_value;
+		wait_info.semaphoreCount = 1;
+
+		StartupWaitScope wait_scope{};
+		VK_CHECK_ET(vkWaitSemaphores(*device, &wait_info, UINT64_MAX), RuntimeException, fmt::format("Failed to wait for timeline semaphore of {}", m_name));
+		m_wait_count++;
+	}
+
+	for (VKW_Buffer& staging_buffer : batch.staging_buffers) {
+		staging_buffer.del();
+	}
+	batch.staging_buffers.clear();
+	batch.buffer_transfers.clear();
+	batch.image_transfers.clear();
+
+	batch.transfer_pool.reset();
+	if (m_dedicated_transfer) {
+		batch.graphics_pool.reset();
+	}
+
+	batch.ticket = 0;
+	batch.submitted = false;
+	return true;
+}
+
+uint64_t UploadBatcher::get_completed_value() const
+{
+	uint64_t value = 0;
+	VK_CHECK_ET(vkGetSemaphoreCounterValue(*device, m_timeline, &value), RuntimeException, fmt::format("Failed to get timeline semaphore value of {}", m_name));
+	return value;
+}
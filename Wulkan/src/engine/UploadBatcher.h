@@ -0,0 +1,108 @@
+#pragma once
+
+#include "vk_wrap/VKW_Object.h"
+#include "vk_wrap/VKW_Device.h"
+#include "vk_wrap/VKW_Queue.h"
+#include "vk_wrap/VKW_CommandPool.h"
+#include "vk_wrap/VKW_CommandBuffer.h"
+#include "vk_wrap/VKW_Buffer.h"
+
+#include "Texture.h"
+
+// identifies the batch an upload was recorded into, tickets of later uploads are never smaller
+using UploadTicket = uint64_t;
+
+// Collects buffer and texture uploads and submits them together instead of one queue wait idle per copy
+// Data is copied into a persistently mapped staging arena, which is split into one segment per batch.
+// A batch is submitted once its segment is full or flush / wait is called, then recording continues in the next batch.
+// Copies are executed on the transfer queue. If it has its own queue family, the batch releases the ownership of all uploaded
+// resources and a second submission on the graphics queue acquires it after waiting on the transfer (timeline semaphore).
+// Either way uploads are visible to all commands submitted to the graphics queue after the flush, anything else has to wait on the ticket.
+// Not thread safe
+class UploadBatcher : public VKW_Object
+{
+public:
+	UploadBatcher() = default;
+	// arena_size can be 0 if only textures with their own staging buffers are uploaded
+	void init(const VKW_Device* vkw_device, const VKW_Queue* transfer_queue, const VKW_Queue* graphics_queue, VkDeviceSize arena_size, const std::string& obj_name);
+	void del() override;
+
+	// copies size bytes of data into dst at dst_offset, dst needs VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	// data can be freed right away, uploads larger than a segment of the arena get their own staging buffer
+	UploadTicket upload(const VKW_Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+	// records the upload of all levels of data (see record_mipmapped_texture_upload) and takes over its staging buffer
+	// texture is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL once the ticket is done
+	UploadTicket upload(const Texture& texture, MipmappedTextureData&& data);
+
+	// submits the batch currently being recorded (if any)
+	void flush();
+
+	// blocks until all uploads of the ticket are executed, flushes the ticket's batch if necessary
+	void wait(UploadTicket ticket);
+	void wait_all();
+
+	// do not block
+	bool is_done(UploadTicket ticket);
+	// false if the next upload would have to wait for a previous batch to free its segment
+	bool is_ready();
+	// frees the staging buffers and segments of all submitted batches that are done, does not block
+	void retire_finished();
+private:
+	struct UploadBatch {
+		VKW_CommandPool transfer_pool;
+		VKW_CommandBuffer transfer_command_buffer;
+		// acquires the ownership of the uploaded resources, only used with a dedicated transfer queue family
+		VKW_CommandPool graphics_pool;
+		VKW_CommandBuffer graphics_command_buffer;
+
+		UploadTicket ticket = 0; // 0 if batch is free
+		bool submitted = false;
+		VkDeviceSize arena_begin = 0; // segment of the arena owned by this batch
+		VkDeviceSize arena_used = 0;
+		std::vector<VKW_Buffer> staging_buffers; // dedicated staging buffers freed once the batch is done
+
+		std::vector<VkBufferMemoryBarrier2> buffer_transfers; // ownership transfers of uploaded buffer ranges
+		std::vector<VkImage> image_transfers;
+	};
+
+	static constexpr uint32_t BATCH_COUNT = 2;
+	// keeps copies out of the arena 16 byte aligned
+	static constexpr VkDeviceSize ARENA_ALIGNMENT = 16;
+
+	const VKW_Device* device = nullptr;
+	const VKW_Queue* m_transfer_queue = nullptr;
+	const VKW_Queue* m_graphics_queue = nullptr;
+	bool m_dedicated_transfer = false; // transfer queue is of a different family than the graphics queue
+	std::string m_name;
+
+	VKW_Buffer m_arena;
+	VkDeviceSize m_segment_size = 0;
+
+	// reaches the ticket once its batch is done
+	VkSemaphore m_timeline = VK_NULL_HANDLE;
+	// reaches the ticket once its copies on a dedicated transfer queue are done, waited on by the acquire
+	// (separate from m_timeline, as signals have to increase and the next transfer might finish before the last acquire)
+	VkSemaphore m_transfer_timeline = VK_NULL_HANDLE;
+
+	std::array<UploadBatch, BATCH_COUNT> m_batches;
+	uint32_t m_current = 0; // batch uploads are recorded into
+	UploadTicket m_next_ticket = 1;
+
+	// statistics
+	uint32_t m_upload_count = 0;
+	uint32_t m_submit_count = 0;
+	uint32_t m_wait_count = 0;
+	VkDeviceSize m_uploaded_size = 0;
+
+	// current batch, begins recording if it is not yet (waiting for its previous submission if necessary)
+	UploadBatch& get_recording_batch();
+	// frees the resources of a submitted batch, false if it is not done and block is not set
+	bool retire(UploadBatch& batch, bool block);
+	uint64_t get_completed_value() const;
+public:
+	inline uint32_t get_upload_count() const { return m_upload_count; };
+	inline uint32_t get_submit_count() const { return m_submit_count; };
+	inline uint32_t get_wait_count() const { return m_wait_count; };
+	inline VkDeviceSize get_uploaded_size() const { return m_uploaded_size; };
+};
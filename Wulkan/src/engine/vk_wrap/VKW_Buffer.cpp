@@ -47,6 +47,7 @@ void VKW_Buffer::init(const VKW_Device* vkw_device, VkDeviceSize size, VkBufferU
 #endif
 
 	memory = alloc_info.deviceMemory;
+	mapped_address = alloc_info.pMappedData;
 
 	// name device
 	device->name_object((uint64_t)buffer, VK_OBJECT_TYPE_BUFFER, name);
@@ -64,6 +65,7 @@ void VKW_Buffer::del()
 		buffer = VK_NULL_HANDLE;
 		allocation = VK_NULL_HANDLE;
 		memory = VK_NULL_HANDLE;
+		mapped_address = nullptr;
 	}
 }
 
@@ -78,6 +80,17 @@ void VKW_Buffer::copy_into(const void* data, size_t data_size, size_t offset)
 	vmaCopyMemoryToAllocation(allocator, data, allocation, offset, data_size);
 }
 
+void VKW_Buffer::flush(size_t offset, size_t data_size)
+{
+	if (offset + data_size > size()) {
+		throw RuntimeException(
+			fmt::format("Tried to flush outside of bounds of buffer ({})", name), __FILE__, __LINE__
+		);
+	}
+
+	VK_CHECK_ET(vmaFlushAllocation(allocator, allocation, offset, data_size), RuntimeException, fmt::format("Failed to flush buffer ({})", name));
+}
+
 void VKW_Buffer::copy_into(const VKW_CommandPool* command_pool, const VKW_Buffer& other_buffer)
 {
 	if (size() != other_buffer.size()) {
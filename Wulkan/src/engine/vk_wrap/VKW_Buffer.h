@@ -5,6 +5,8 @@
 #include "VKW_Device.h"
 #include "VKW_CommandBuffer.h"
 
+#include <atomic>
+
 
 enum class Mapping {
 	NotMapped,
@@ -23,6 +25,7 @@ public:
 	void copy_into(const void* data, size_t data_size, size_t offset=0); // copies data into VKW_Buffer (copies data_size many bytes from data to mapped_address + offset)
 	void copy_into(const VKW_CommandPool* command_pool, const VKW_Buffer& other_buffer); // copies other buffer into this one, creates and submits single use command buffer
 	void copy_from(void* data, size_t data_size) const; // copies from buffer into data (data_size many bytes)
+	void flush(size_t offset, size_t data_size); // makes writes through get_mapped_address visible to the device, does nothing for coherent memory
 private:
 	const VKW_Device* device = nullptr;
 	std::string name;
@@ -33,16 +36,19 @@ private:
 	size_t length;
 	VmaAllocation allocation = VK_NULL_HANDLE; // dont peek inside, treat as opaque
 	VkDeviceMemory memory;
+	void* mapped_address = nullptr; // only for Mapping::Persistent
 
 #ifdef TRACY_ENABLE
 	uint32_t tracy_mem_instance_id;
-	inline static uint32_t buffer_instance_count = 0;
+	inline static std::atomic<uint32_t> buffer_instance_count = 0; // staging buffers are also created on worker threads
 #endif
 public:
 	inline VkBuffer get_buffer() const { return buffer; };
 	inline operator VkBuffer() const { return buffer; };
 	// size of underlying VkBuffer in bytes
 	inline size_t size() const { return length; };
+	// written sequentially (see VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT), never read
+	inline void* get_mapped_address() const { return mapped_address; };
 };
 
 VKW_Buffer create_staging_buffer(const VKW_Device* device, VkDeviceSize buffer_size, const void* data, size_t data_size, const std::string& name="Staging buffer");
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include "common.h"
 #include "VKW_CommandBuffer.h"
+#include "StartupProfiler.h"
 
-void VKW_CommandBuffer::init(const VKW_Device* vkw_device, const VKW_CommandPool* vkw_command_pool, bool su, const std::string& obj_name)
+void VKW_CommandBuffer::init(const VKW_Device* vkw_device, const VKW_CommandPool* vkw_command_pool, bool su, const std::string& obj_name, VkCommandBufferLevel level)
 {
 	device = vkw_device;
 	m_name = obj_name;
@@ -12,7 +13,7 @@ void VKW_CommandBuffer::init(const VKW_Device* vkw_device, const VKW_CommandPool
 	VkCommandBufferAllocateInfo alloc_info{};
 	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	alloc_info.commandPool = *command_pool;
-	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;  // can be submitted directly to queue but not called from other command buffers
+	alloc_info.level = level;  // primary can be submitted directly to queue but not called from other command buffers, secondary the other way around
 	alloc_info.commandBufferCount = 1;
 
 	VK_CHECK_ET(vkAllocateCommandBuffers(*device, &alloc_info, &command_buffer), SetupException, fmt::format("Failed to create Command buffer ({})", m_name));
@@ -46,7 +47,10 @@ void VKW_CommandBuffer::submit_single_use()
 	submit_info.commandBufferCount = 1;
 
 	VK_CHECK_ET(vkQueueSubmit(*queue, 1, &submit_info, VK_NULL_HANDLE), RuntimeException, fmt::format("Failed to submit one time command buffer ({})", m_name));
-	vkQueueWaitIdle(*queue);
+	{
+		StartupWaitScope wait_scope{};
+		vkQueueWaitIdle(*queue);
+	}
 
 	VK_DESTROY_FROM(command_buffer, vkFreeCommandBuffers, *device, *command_pool, 1, &command_buffer);
 }
@@ -59,6 +63,46 @@ void VKW_CommandBuffer::begin() const
 	VK_CHECK_ET(vkBeginCommandBuffer(command_buffer, &begin_info), RuntimeException, fmt::format("Failed to begin recording command buffer ({})", m_name));
 }
 
+void VKW_CommandBuffer::begin_secondary(const VkCommandBufferInheritanceRenderingInfo& rendering_info) const
+{
+	VkCommandBufferInheritanceInfo inheritance_info{};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.pNext = &rendering_info;
+
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = &inheritance_info;
+
+	VK_CHECK_ET(vkBeginCommandBuffer(command_buffer, &begin_info), RuntimeException, fmt::format("Failed to begin recording secondary command buffer ({})", m_name));
+}
+
+void VKW_CommandBuffer::end() const
+{
+	VK_CHECK_ET(vkEndCommandBuffer(command_buffer), RuntimeException, fmt::format("Failed to record command buffer ({})", m_name));
+}
+
+void VKW_CommandBuffer::execute(std::span<const VkCommandBuffer> secondary_command_buffers) const
+{
+	vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_command_buffers.size()), secondary_command_buffers.data());
+}
+
+void VKW_CommandBuffer::memory_barrier(VkPipelineStageFlags2 src_stages, VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stages, VkAccessFlags2 dst_access) const
+{
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = src_stages;
+	barrier.srcAccessMask = src_access;
+	barrier.dstStageMask = dst_stages;
+	barrier.dstAccessMask = dst_access;
+
+	VkDependencyInfo dependency_info{};
+	dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependency_info.pMemoryBarriers = &barrier;
+	dependency_info.memoryBarrierCount = 1;
+	vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+}
+
 void VKW_CommandBuffer::submit(const std::vector<VkSemaphore>& wait_semaphores, const std::vector<VkPipelineStageFlags>& wait_stages, const std::vector<VkSemaphore>& signal_semaphores, VkFence fence) const
 {
 	VK_CHECK_ET(vkEndCommandBuffer(command_buffer), RuntimeException, fmt::format("Failed to record command buffer ({})", m_name));
@@ -81,4 +125,26 @@ void VKW_CommandBuffer::submit(const std::vector<VkSemaphore>& wait_semaphores,
 
 	
 	VK_CHECK_ET(vkQueueSubmit(*queue, 1, &submit_info, fence), RuntimeException, fmt::format("Failed to submit command buffer", m_name));
+}
+
+void VKW_CommandBuffer::submit(const std::vector<VkSemaphoreSubmitInfo>& wait_semaphores, const std::vector<VkSemaphoreSubmitInfo>& signal_semaphores, VkFence fence) const
+{
+	VK_CHECK_ET(vkEndCommandBuffer(command_buffer), RuntimeException, fmt::format("Failed to record command buffer ({})", m_name));
+
+	VkCommandBufferSubmitInfo command_buffer_info{};
+	command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	command_buffer_info.commandBuffer = command_buffer;
+
+	VkSubmitInfo2 submit_info{};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submit_info.pCommandBufferInfos = &command_buffer_info;
+	submit_info.commandBufferInfoCount = 1;
+
+	submit_info.pWaitSemaphoreInfos = wait_semaphores.data();
+	submit_info.waitSemaphoreInfoCount = static_cast<uint32_t>(wait_semaphores.size());
+
+	submit_info.pSignalSemaphoreInfos = signal_semaphores.data();
+	submit_info.signalSemaphoreInfoCount = static_cast<uint32_t>(signal_semaphores.size());
+
+	VK_CHECK_ET(vkQueueSubmit2(*queue, 1, &submit_info, fence), RuntimeException, fmt::format("Failed to submit command buffer ({})", m_name));
 }
\ No newline at end of file
@@ -3,11 +3,14 @@
 #include "VKW_Device.h"
 #include "VKW_CommandPool.h"
 
+#include <span>
+
 class VKW_CommandBuffer
 {
 public:
 	VKW_CommandBuffer() = default;
-	void init(const VKW_Device* vkw_device, const VKW_CommandPool* vkw_command_pool, bool single_use, const std::string& obj_name);
+	// secondary command buffers can only be executed from primary ones (see execute)
+	void init(const VKW_Device* vkw_device, const VKW_CommandPool* vkw_command_pool, bool single_use, const std::string& obj_name, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
 	void begin_single_use();
 	// submits command buffer and waits for the queue to be idle. WARNING: could take long
@@ -15,9 +18,19 @@ public:
 
 	// begins command buffer
 	void begin() const;
+	// begins secondary command buffer continuing a rendering begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT
+	void begin_secondary(const VkCommandBufferInheritanceRenderingInfo& rendering_info) const;
+	// ends secondary command buffer, primary ones are ended by submit
+	void end() const;
+	// executes recorded secondary command buffers, expects to be in an active primary command buffer
+	void execute(std::span<const VkCommandBuffer> secondary_command_buffers) const;
+	// global memory barrier between the commands before and after, i.e. for buffers written and read by shaders
+	void memory_barrier(VkPipelineStageFlags2 src_stages, VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stages, VkAccessFlags2 dst_access) const;
 
 	// ends and submits the command buffer (with given signal, wait semaphores and fence)
 	void submit(const std::vector<VkSemaphore>& wait_semaphores, const std::vector<VkPipelineStageFlags>& wait_stages, const std::vector<VkSemaphore>& signal_semaphores, VkFence fence) const;
+	// ends and submits the command buffer with vkQueueSubmit2, i.e. to wait on or signal values of timeline semaphores
+	void submit(const std::vector<VkSemaphoreSubmitInfo>& wait_semaphores, const std::vector<VkSemaphoreSubmitInfo>& signal_semaphores, VkFence fence) const;
 private:
 	const VKW_Device* device = nullptr;
 	std::string m_name;
@@ -29,6 +42,7 @@ private:
 public:
 	inline VkCommandBuffer get_command_buffer() const { return command_buffer; };
 	inline operator VkCommandBuffer() const { return command_buffer; };
+	inline const VKW_Queue* get_queue() const { return queue; };
 
 	inline void begin_debug_zone(const std::string& name) const;
 	inline void end_debug_zone() const;
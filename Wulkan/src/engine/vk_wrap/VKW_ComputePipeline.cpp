@@ -1,7 +1,7 @@
 #include "common.h"
 #include "VKW_ComputePipeline.h"
 
-void VKW_ComputePipeline::init(const VKW_Device* vkw_device, const VKW_Path& shader_path, const std::string& obj_name)
+void VKW_ComputePipeline::init(const VKW_Device* vkw_device, const VKW_Path& shader_path, const std::string& obj_name, const VKW_PipelineCache* pipeline_cache)
 {
 	device = vkw_device;
 	name = obj_name;
@@ -30,7 +30,7 @@ void VKW_ComputePipeline::init(const VKW_Device* vkw_device, const VKW_Path& sha
 	
 
 	VK_CHECK_ET(
-		vkCreateComputePipelines(*device, VK_NULL_HANDLE, 1, &pipeline_info, VK_NULL_HANDLE, &compute_pipeline),
+		vkCreateComputePipelines(*device, pipeline_cache ? pipeline_cache->get_pipeline_cache() : VK_NULL_HANDLE, 1, &pipeline_info, VK_NULL_HANDLE, &compute_pipeline),
 		RuntimeException,
 		fmt::format("Failed to create compute pipeline ({})", name)
 	);
@@ -6,11 +6,13 @@
 #include "VKW_Shader.h"
 #include "VKW_DescriptorSet.h"
 #include "VKW_PushConstants.h"
+#include "VKW_PipelineCache.h"
 
 class VKW_ComputePipeline : public VKW_Object {
 public:
 	VKW_ComputePipeline() = default;
-	void init(const VKW_Device* vkw_device, const VKW_Path& shader_path, const std::string& obj_name);
+	// pipeline_cache is optional, but avoids recompiling pipelines the driver has seen before
+	void init(const VKW_Device* vkw_device, const VKW_Path& shader_path, const std::string& obj_name, const VKW_PipelineCache* pipeline_cache = nullptr);
 	void del() override;
 private:
 	const VKW_Device* device = nullptr;
@@ -20,11 +20,11 @@ void VKW_DescriptorSetLayout::del()
 	VK_DESTROY(layout, vkDestroyDescriptorSetLayout, *device, layout);
 }
 
-void VKW_DescriptorSetLayout::add_binding(uint32_t binding_slot, VkDescriptorType type, VkShaderStageFlags shader_stages)
+void VKW_DescriptorSetLayout::add_binding(uint32_t binding_slot, VkDescriptorType type, VkShaderStageFlags shader_stages, uint32_t count)
 {
 	VkDescriptorSetLayoutBinding binding{};
 	binding.binding = binding_slot;
-	binding.descriptorCount = 1; // length for arrays
+	binding.descriptorCount = count; // length for arrays
 	binding.descriptorType = type;
 	binding.stageFlags = shader_stages;
 
@@ -82,7 +82,7 @@ void VKW_DescriptorSet::update(uint32_t binding, const VKW_Buffer& buffer) const
 	vkUpdateDescriptorSets(*device, 1, &buffer_write, 0, VK_NULL_HANDLE);
 }
 
-void VKW_DescriptorSet::update(uint32_t binding, VkImageView image_view, const VKW_Sampler& sampler, VkImageLayout layout) const
+void VKW_DescriptorSet::update(uint32_t binding, VkImageView image_view, const VKW_Sampler& sampler, VkImageLayout layout, uint32_t array_element) const
 {
 	VkDescriptorImageInfo image_info{};
 	image_info.imageLayout = layout;
@@ -95,7 +95,7 @@ void VKW_DescriptorSet::update(uint32_t binding, VkImageView image_view, const V
 	image_write.dstBinding = binding;
 	image_write.descriptorType = binding_types.at(binding);
 
-	image_write.dstArrayElement = 0;
+	image_write.dstArrayElement = array_element;
 	image_write.descriptorCount = 1;
 	image_write.pImageInfo = &image_info;
 
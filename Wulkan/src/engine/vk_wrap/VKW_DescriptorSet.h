@@ -22,7 +22,8 @@ private:
 
 	std::vector<VkDescriptorSetLayoutBinding> bindings;
 public:
-	void add_binding(uint32_t binding_slot, VkDescriptorType type, VkShaderStageFlags shader_stages);
+	// count > 1 for arrays of descriptors
+	void add_binding(uint32_t binding_slot, VkDescriptorType type, VkShaderStageFlags shader_stages, uint32_t count = 1);
 	inline VkDescriptorSetLayout get_layout() const { return layout; };
 	inline operator VkDescriptorSetLayout() const { return layout; };
 	const std::vector<VkDescriptorSetLayoutBinding>& get_bindings() const { return bindings; };
@@ -51,7 +52,8 @@ public:
 	void update(uint32_t binding, const VKW_Buffer& buffer) const;
 
 	// Updates descriptor at binding. Assumes binding corresponds to a combined sampler and the image corresponding to the view is in the mentioned layout 
-	void update(uint32_t binding, VkImageView image_view, const VKW_Sampler& sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) const;
+	// array_element selects the descriptor if the binding is an array
+	void update(uint32_t binding, VkImageView image_view, const VKW_Sampler& sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, uint32_t array_element = 0) const;
 
 	// Updates descriptor at binding. Assumes binding corresponds to a image corresponding to the view is in the mentioned layout 
 	// see: https://stackoverflow.com/questions/77070602/how-are-separated-sampled-images-and-samplers-used-in-vulkan-with-glsl
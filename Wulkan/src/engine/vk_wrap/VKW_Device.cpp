@@ -5,6 +5,7 @@ void VKW_Device::init(VKW_Instance* vkw_instance, const VKW_Surface& surface, co
 {
 	instance = vkw_instance;
 	m_name = obj_name;
+	m_optional_features = required_features.optional;
 	selector = std::make_unique<vkb::PhysicalDeviceSelector>(instance->get_vkb_instance());
 
 	(*selector).set_surface(surface)
@@ -62,6 +63,7 @@ void VKW_Device::select_and_build()
 	}
 
 	physical_device = selection_result.value();
+	physical_device.enable_features_if_present(m_optional_features);
 
 	vkb::DeviceBuilder builder{ physical_device };
 
@@ -15,6 +15,7 @@ struct Required_Device_Features {
 	VkPhysicalDeviceVulkan11Features rf11;
 	VkPhysicalDeviceVulkan12Features rf12;
 	VkPhysicalDeviceVulkan13Features rf13;
+	VkPhysicalDeviceFeatures optional; // enabled if supported, users have to check support themselves (i.e. via format properties)
 };
 
 class VKW_Device : public VKW_Object
@@ -33,6 +34,7 @@ private:
 	vkb::Device device;
 
 	std::unique_ptr<vkb::PhysicalDeviceSelector> selector;
+	VkPhysicalDeviceFeatures m_optional_features;
 
 	mutable bool got_device_properties;
 	mutable VkPhysicalDeviceProperties device_properties;
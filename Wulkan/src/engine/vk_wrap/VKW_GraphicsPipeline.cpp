@@ -7,7 +7,7 @@ VKW_GraphicsPipeline::VKW_GraphicsPipeline()
 	clear();
 }
 
-void VKW_GraphicsPipeline::init(const VKW_Device* vkw_device, const std::string& obj_name)
+void VKW_GraphicsPipeline::init(const VKW_Device* vkw_device, const std::string& obj_name, const VKW_PipelineCache* pipeline_cache)
 {
 	device = vkw_device;
 	name = obj_name;
@@ -76,7 +76,7 @@ void VKW_GraphicsPipeline::init(const VKW_Device* vkw_device, const std::string&
 	VK_CHECK_ET(vkCreatePipelineLayout(*device, &pipeline_layout_info, nullptr, &m_layout), RuntimeException, fmt::format("Failed to create graphics pipeline layout ({})", name + " layout"));
 	pipeline_info.layout = m_layout;
 
-	VK_CHECK_ET(vkCreateGraphicsPipelines(*device, VK_NULL_HANDLE, 1, &pipeline_info, VK_NULL_HANDLE, &graphics_pipeline), RuntimeException, fmt::format("Failed to create graphics pipeline ({})", name));
+	VK_CHECK_ET(vkCreateGraphicsPipelines(*device, pipeline_cache ? pipeline_cache->get_pipeline_cache() : VK_NULL_HANDLE, 1, &pipeline_info, VK_NULL_HANDLE, &graphics_pipeline), RuntimeException, fmt::format("Failed to create graphics pipeline ({})", name));
 	device->name_object((uint64_t)graphics_pipeline, VK_OBJECT_TYPE_PIPELINE, name);
 	device->name_object((uint64_t)m_layout, VK_OBJECT_TYPE_PIPELINE_LAYOUT, name +" layout");
 }
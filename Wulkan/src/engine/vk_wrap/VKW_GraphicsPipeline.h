@@ -6,6 +6,7 @@
 #include "VKW_Shader.h"
 #include "VKW_DescriptorSet.h"
 #include "VKW_PushConstants.h"
+#include "VKW_PipelineCache.h"
 
 #include <span>
 
@@ -13,7 +14,8 @@ class VKW_GraphicsPipeline : public VKW_Object {
 public:
 	VKW_GraphicsPipeline();
 
-	void init(const VKW_Device* vkw_device, const std::string& obj_name);
+	// pipeline_cache is optional, but avoids recompiling pipelines the driver has seen before
+	void init(const VKW_Device* vkw_device, const std::string& obj_name, const VKW_PipelineCache* pipeline_cache = nullptr);
 	void del() override;
 	void clear(); // clears all our settings to their defaults
 private:
@@ -56,7 +58,8 @@ public:
 	inline void bind(const VKW_CommandBuffer& cmd) const { vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline); };
 
 	// begins render pass using the attachment state of the pipeline
-	inline void begin_rendering(const VKW_CommandBuffer& cmd) const { vkCmdBeginRendering(cmd, &attachment_state); };
+	// with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT in flags the draws have to be executed from secondary command buffers
+	inline void begin_rendering(const VKW_CommandBuffer& cmd, VkRenderingFlags flags = 0) const;
 
 	// ends the current render pass
 	inline void end_rendering(const VKW_CommandBuffer& cmd) const { vkCmdEndRendering(cmd); };
@@ -88,6 +91,8 @@ public:
 
 	// set formats of color attachments used in this pipeline
 	inline void set_color_attachment_format(VkFormat format);
+	// by default only rgb is written
+	inline void enable_alpha_write() { color_blending_attachement.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT; };
 	// set formats of depth attachments used in this pipeline
 	inline void set_depth_attachment_format(VkFormat format);
 
@@ -116,6 +121,14 @@ public:
 	// sets the dynamic state (viewport and scissor; with extend set by set_render_size), expects to be in an active render pass
 	// Todo could later also set min and max depth for inverted zbuffer
 	inline void set_dynamic_state(const VKW_CommandBuffer& cmd);
+	// same as above but with the given extent instead of the stored one, does not modify the pipeline (can be recorded by multiple threads at once)
+	inline void set_dynamic_state(const VKW_CommandBuffer& cmd, VkExtent2D extent) const;
+	// requires enable_dynamic_depth_bias, see set_depth_bias
+	inline void set_dynamic_depth_bias(const VKW_CommandBuffer& cmd, float const_bias, float slope_factor) const;
+
+	// attachment formats and samples of the pipeline, for secondary command buffers recording into a rendering of this pipeline
+	// points into the pipeline, so it needs to outlive the returned info
+	inline VkCommandBufferInheritanceRenderingInfo get_inheritance_rendering_info() const;
 
 	inline operator VkPipeline() const { return graphics_pipeline; };
 	inline VkPipeline get_pipeline() const { return graphics_pipeline; };
@@ -219,6 +232,43 @@ inline void VKW_GraphicsPipeline::set_dynamic_state(const VKW_CommandBuffer& cmd
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 }
 
+inline void VKW_GraphicsPipeline::set_dynamic_state(const VKW_CommandBuffer& cmd, VkExtent2D extent) const
+{
+	VkViewport viewport = m_viewport;
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+
+	VkRect2D extent_scissor = scissor;
+	extent_scissor.extent = extent;
+
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &extent_scissor);
+}
+
+inline void VKW_GraphicsPipeline::set_dynamic_depth_bias(const VKW_CommandBuffer& cmd, float const_bias, float slope_factor) const
+{
+	assert(dynamic_depth_bias && "Tried to set depth bias of pipeline without dynamic depth bias");
+	vkCmdSetDepthBias(cmd, const_bias, 0, slope_factor);
+}
+
+inline void VKW_GraphicsPipeline::begin_rendering(const VKW_CommandBuffer& cmd, VkRenderingFlags flags) const
+{
+	VkRenderingInfo rendering_info = attachment_state;
+	rendering_info.flags = flags;
+	vkCmdBeginRendering(cmd, &rendering_info);
+}
+
+inline VkCommandBufferInheritanceRenderingInfo VKW_GraphicsPipeline::get_inheritance_rendering_info() const
+{
+	VkCommandBufferInheritanceRenderingInfo inheritance_info{};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	inheritance_info.colorAttachmentCount = (color_attachment_format != VK_FORMAT_UNDEFINED) ? 1 : 0;
+	inheritance_info.pColorAttachmentFormats = &color_attachment_format;
+	inheritance_info.depthAttachmentFormat = depth_attachment_format;
+	inheritance_info.rasterizationSamples = multisampling.rasterizationSamples;
+	return inheritance_info;
+}
+
 inline void VKW_GraphicsPipeline::set_sample_count(VkSampleCountFlagBits samples)
 {
 	multisampling.rasterizationSamples = samples;
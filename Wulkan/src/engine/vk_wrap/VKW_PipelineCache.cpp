@@ -0,0 +1,127 @@
+#include "common.h"
+#include "VKW_PipelineCache.h"
+
+#include "../CacheFile.h"
+
+#include <cstring>
+
+#include "spdlog/spdlog.h"
+
+constexpr char PIPELINE_CACHE_MAGIC[4] = { 'W', 'P', 'S', 'O' };
+
+void VKW_PipelineCache::init(const VKW_Device* vkw_device, const VKW_Path& path, const std::string& obj_name)
+{
+	ZoneScoped;
+
+	device = vkw_device;
+	name = obj_name;
+	m_path = path;
+
+	std::vector<char> initial_data = load();
+
+	VkPipelineCacheCreateInfo cache_info{};
+	cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cache_info.initialDataSize = initial_data.size();
+	cache_info.pInitialData = initial_data.data();
+
+	VK_CHECK_ET(vkCreatePipelineCache(*device, &cache_info, nullptr, &pipeline_cache), SetupException, fmt::format("Failed to create pipeline cache ({})", name));
+	device->name_object((uint64_t)pipeline_cache, VK_OBJECT_TYPE_PIPELINE_CACHE, name);
+
+	if (initial_data.empty()) {
+		spdlog::info("Pipeline cache {} starts out empty", m_path);
+	}
+	else {
+		spdlog::info("Loaded {} KiB of pipeline cache data from {}", initial_data.size() / 1024, m_path);
+	}
+}
+
+void VKW_PipelineCache::del()
+{
+	if (pipeline_cache != VK_NULL_HANDLE) {
+		save();
+	}
+	VK_DESTROY(pipeline_cache, vkDestroyPipelineCache, *device, pipeline_cache);
+}
+
+void VKW_PipelineCache::save() const
+{
+	ZoneScoped;
+
+	size_t data_size = 0;
+	if (vkGetPipelineCacheData(*device, pipeline_cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0) {
+		spdlog::warn("Failed to get data of pipeline cache ({})", name);
+		return;
+	}
+
+	std::vector<char> file_data(sizeof(Header) + data_size);
+	if (vkGetPipelineCacheData(*device, pipeline_cache, &data_size, file_data.data() + sizeof(Header)) != VK_SUCCESS) {
+		spdlog::warn("Failed to get data of pipeline cache ({})", name);
+		return;
+	}
+	file_data.resize(sizeof(Header) + data_size);
+
+	Header header = create_header();
+	header.data_size = data_size;
+	header.data_hash = hash_bytes({ reinterpret_cast<const std::byte*>(file_data.data() + sizeof(Header)), data_size });
+	std::memcpy(file_data.data(), &header, sizeof(Header));
+
+	try {
+		write_cache_file(m_path, file_data);
+	}
+	catch (const IOException& e) {
+		spdlog::warn("Failed to write pipeline cache {}: {}", m_path, e.what());
+	}
+}
+
+std::vector<char> VKW_PipelineCache::load() const
+{
+	MappedFile file;
+	if (!file.open(m_path)) {
+		return {};
+	}
+
+	if (file.size() < sizeof(Header)) {
+		spdlog::info("Pipeline cache {} is invalid", m_path);
+		return {};
+	}
+
+	Header header;
+	std::memcpy(&header, file.data(), sizeof(Header));
+
+	// drivers are expected to reject foreign data themselves, but not all of them handle it gracefully
+	Header expected = create_header();
+	if (std::memcmp(header.magic, expected.magic, sizeof(PIPELINE_CACHE_MAGIC)) != 0 || header.version != expected.version) {
+		spdlog::info("Pipeline cache {} has an incompatible format", m_path);
+		return {};
+	}
+
+	if (header.vendor_id != expected.vendor_id || header.device_id != expected.device_id || header.driver_version != expected.driver_version ||
+		std::memcmp(header.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) != 0
+	) {
+		spdlog::info("Pipeline cache {} was created for a different device or driver", m_path);
+		return {};
+	}
+
+	std::span<const std::byte> data = file.bytes().subspan(sizeof(Header));
+	if (header.data_size != data.size() || hash_bytes(data) != header.data_hash) {
+		spdlog::info("Pipeline cache {} is corrupted", m_path);
+		return {};
+	}
+
+	const char* begin = reinterpret_cast<const char*>(data.data());
+	return std::vector<char>(begin, begin + data.size());
+}
+
+VKW_PipelineCache::Header VKW_PipelineCache::create_header() const
+{
+	const VkPhysicalDeviceProperties& properties = device->get_device_properties();
+
+	Header header{};
+	std::memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+	header.version = PIPELINE_CACHE_VERSION;
+	header.vendor_id = properties.vendorID;
+	header.device_id = properties.deviceID;
+	header.driver_version = properties.driverVersion;
+	std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "VKW_Object.h"
+
+#include "VKW_Device.h"
+#include "../Path.h"
+
+// VkPipelineCache persisted on disk, so pipelines are not compiled from scratch on every launch
+// The file is only used if it was written for the same device, driver version and pipeline cache UUID and its data is intact,
+// otherwise the cache starts out empty. The cache data is written back when the cache is deleted
+class VKW_PipelineCache : public VKW_Object
+{
+public:
+	VKW_PipelineCache() = default;
+	void init(const VKW_Device* vkw_device, const VKW_Path& path, const std::string& obj_name);
+	void del() override;
+
+	// writes the current cache data to disk, failures are only logged as the cache is optional
+	void save() const;
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+		uint64_t data_size;
+		uint64_t data_hash;
+	};
+
+	static constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+	const VKW_Device* device = nullptr;
+	std::string name;
+	VKW_Path m_path;
+
+	VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+
+	// cache data of the file, empty if it is missing or was created for another device / driver
+	std::vector<char> load() const;
+	Header create_header() const;
+public:
+	inline VkPipelineCache get_pipeline_cache() const { return pipeline_cache; };
+	inline operator VkPipelineCache() const { return pipeline_cache; };
+};
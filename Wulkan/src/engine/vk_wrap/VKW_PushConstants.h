@@ -20,6 +20,8 @@ public:
 	inline void update(const T& t) { data = t; };
 	// pushes the set data, assumes to be recording commands into the above command buffer
 	inline void push(const VKW_CommandBuffer& command_buffer, VkPipelineLayout layout) const;
+	// pushes value without storing it, can be used by multiple threads recording at once
+	inline void push(const VKW_CommandBuffer& command_buffer, VkPipelineLayout layout, const T& value) const;
 
 	VkPushConstantRange get_range() const { return range; };
 };
@@ -37,3 +39,9 @@ inline void VKW_PushConstant<T>::push(const VKW_CommandBuffer& command_buffer, V
 {
 	vkCmdPushConstants(command_buffer, layout, range.stageFlags, range.offset, range.size, &data);
 }
+
+template<typename T>
+inline void VKW_PushConstant<T>::push(const VKW_CommandBuffer& command_buffer, VkPipelineLayout layout, const T& value) const
+{
+	vkCmdPushConstants(command_buffer, layout, range.stageFlags, range.offset, range.size, &value);
+}
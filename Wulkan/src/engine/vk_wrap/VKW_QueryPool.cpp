@@ -0,0 +1,48 @@
+#include "common.h"
+#include "VKW_QueryPool.h"
+
+void VKW_QueryPool::init(const VKW_Device* vkw_device, uint32_t count, const std::string& obj_name)
+{
+	device = vkw_device;
+	name = obj_name;
+	timestamp_period = device->get_device_properties().limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo pool_info{};
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_info.queryCount = count;
+
+	VK_CHECK_ET(vkCreateQueryPool(*device, &pool_info, nullptr, &query_pool), SetupException, fmt::format("Failed to create query pool ({})", name));
+	device->name_object((uint64_t)query_pool, VK_OBJECT_TYPE_QUERY_POOL, name);
+}
+
+void VKW_QueryPool::del()
+{
+	VK_DESTROY(query_pool, vkDestroyQueryPool, *device, query_pool);
+}
+
+void VKW_QueryPool::reset(const VKW_CommandBuffer& command_buffer, uint32_t first, uint32_t count) const
+{
+	vkCmdResetQueryPool(command_buffer, query_pool, first, count);
+}
+
+void VKW_QueryPool::write_timestamp(const VKW_CommandBuffer& command_buffer, VkPipelineStageFlags2 stage, uint32_t query) const
+{
+	vkCmdWriteTimestamp2(command_buffer, stage, query_pool, query);
+}
+
+bool VKW_QueryPool::get_timestamps(uint32_t first, uint32_t count, uint64_t* timestamps) const
+{
+	VkResult result = vkGetQueryPoolResults(*device, query_pool, first, count, sizeof(uint64_t) * count, timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result == VK_NOT_READY) {
+		return false;
+	}
+	VK_CHECK_ET(result, RuntimeException, fmt::format("Failed to get query pool results ({})", name));
+
+	return true;
+}
+
+float VKW_QueryPool::get_duration_ms(uint64_t start, uint64_t end) const
+{
+	return static_cast<float>(end - start) * timestamp_period * 1e-6f;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "VKW_Object.h"
+
+#include "VKW_Device.h"
+#include "VKW_CommandBuffer.h"
+
+// Pool of timestamp queries, written on the gpu and read back on the host once the submission writing them finished
+class VKW_QueryPool : public VKW_Object
+{
+public:
+	VKW_QueryPool() = default;
+	void init(const VKW_Device* vkw_device, uint32_t count, const std::string& obj_name);
+	void del() override;
+
+	// has to be recorded before the queries are written again, outside of rendering
+	void reset(const VKW_CommandBuffer& command_buffer, uint32_t first, uint32_t count) const;
+	// writes the time at which all previous commands finished stage
+	void write_timestamp(const VKW_CommandBuffer& command_buffer, VkPipelineStageFlags2 stage, uint32_t query) const;
+	// copies count timestamps starting at first, returns false if any of them is not available (yet)
+	bool get_timestamps(uint32_t first, uint32_t count, uint64_t* timestamps) const;
+	// time between two timestamps of the pool
+	float get_duration_ms(uint64_t start, uint64_t end) const;
+private:
+	const VKW_Device* device = nullptr;
+	std::string name;
+
+	VkQueryPool query_pool = VK_NULL_HANDLE;
+	float timestamp_period = 0.0f; // nanoseconds per tick
+public:
+	inline VkQueryPool get_query_pool() const { return query_pool; };
+	inline operator VkQueryPool() const { return query_pool; };
+};
@@ -29,6 +29,7 @@ void VKW_Queue::init(const VKW_Device& device, vkb::QueueType type, const std::s
 
 	queue = queue_result.value();
 	family_idx = idx_result.value();
+	graphics = vkb_device.queue_families.at(family_idx).queueFlags & VK_QUEUE_GRAPHICS_BIT;
 
 	device.name_object((uint64_t)queue, VK_OBJECT_TYPE_QUEUE, name);
 }
@@ -15,9 +15,12 @@ private:
 	VkQueue queue = VK_NULL_HANDLE;
 	std::string name;
 	uint32_t family_idx;
+	bool graphics = false;
 public:
 	inline VkQueue get_queue() const { return queue; };
 	inline operator VkQueue() const { return queue; };
 	inline uint32_t get_queue_family() const { return family_idx; };
+	// dedicated transfer and compute queues do not support the stages of the graphics pipeline
+	inline bool has_graphics() const { return graphics; };
 };
 
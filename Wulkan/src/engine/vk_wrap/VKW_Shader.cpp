@@ -1,5 +1,6 @@
 #include "common.h"
 #include "VKW_Shader.h"
+#include "StartupProfiler.h"
 
 #include <fstream>
 
@@ -35,6 +36,7 @@ void VKW_Shader::init(const VKW_Device* vkw_device, const VKW_Path& path, VkShad
 	file.read(reinterpret_cast<char*>(buffer.data()), file_size);
 
 	file.close();
+	StartupProfiler::add_read(file_size);
 
 
 	// create shader module
@@ -1,7 +1,9 @@
 #include "common.h"
 #include "Engine.h"
+#include "StartupProfiler.h"
 
 #include <iostream>
+#include <string_view>
 
 #define SPDLOG_FMT_EXTERNAL // Use already existing fmt implementation (should already be definied in common.h)
 #include "spdlog/spdlog.h"
@@ -10,9 +12,22 @@
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-int main() {
+// --startup-trace [path]: writes a chrome trace of the init steps and the first frame (default startup_trace.json)
+// --exit-after-startup:    closes the window after the first frame, i.e. for automated startup measurements
+int main(int argc, char* argv[]) {
     Engine app {};
 
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--startup-trace") {
+            bool has_path = i + 1 < argc && argv[i + 1][0] != '-';
+            StartupProfiler::enable(has_path ? argv[++i] : "startup_trace.json");
+        }
+        else if (arg == "--exit-after-startup") {
+            app.set_exit_after_startup(true);
+        }
+    }
+
     try {
         app.init(WIDTH, HEIGHT);
         app.run();